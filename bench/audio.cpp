@@ -0,0 +1,60 @@
+#include <cstdint>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <audio_mixer.h>
+
+// Same channel count as GenericAudio: 1 BGM and 31 SE
+constexpr int num_channels = 32;
+// Typical audio callback size
+constexpr int frames = 2048;
+
+static void MixTest(benchmark::State& state, AudioDecoderBase::Format format, int samplesize, int channels) {
+	std::vector<uint8_t> src(frames * channels * samplesize);
+	for (size_t i = 0; i < src.size(); ++i) {
+		src[i] = static_cast<uint8_t>(i * 31);
+	}
+	if (format == AudioDecoderBase::Format::F32) {
+		auto* f = reinterpret_cast<float*>(src.data());
+		for (int i = 0; i < frames * channels; ++i) {
+			f[i] = (i % 200) / 100.0f - 1.0f;
+		}
+	}
+
+	std::vector<float> mixer(frames * 2);
+	std::vector<int16_t> out(frames * 2);
+
+	for (auto _: state) {
+		std::fill(mixer.begin(), mixer.end(), 0.0f);
+		for (int i = 0; i < num_channels; ++i) {
+			AudioMixer::Mix(mixer.data(), src.data(), frames, format, channels, 0.1f);
+		}
+		AudioMixer::Limit(out.data(), mixer.data(), frames * 2, num_channels * 0.1f);
+		benchmark::DoNotOptimize(out.data());
+	}
+}
+
+static void BM_MixS16(benchmark::State& state) {
+	MixTest(state, AudioDecoderBase::Format::S16, 2, 2);
+}
+
+BENCHMARK(BM_MixS16);
+
+static void BM_MixS16Mono(benchmark::State& state) {
+	MixTest(state, AudioDecoderBase::Format::S16, 2, 1);
+}
+
+BENCHMARK(BM_MixS16Mono);
+
+static void BM_MixU8(benchmark::State& state) {
+	MixTest(state, AudioDecoderBase::Format::U8, 1, 2);
+}
+
+BENCHMARK(BM_MixU8);
+
+static void BM_MixF32(benchmark::State& state) {
+	MixTest(state, AudioDecoderBase::Format::F32, 4, 2);
+}
+
+BENCHMARK(BM_MixF32);
+
+BENCHMARK_MAIN();
@@ -1,7 +1,9 @@
 #include <cmath>
+#include <vector>
 #include <benchmark/benchmark.h>
 #include <rect.h>
 #include <bitmap.h>
+#include <bitmap_kernels.h>
 #include <pixel_format.h>
 #include <transform.h>
 
@@ -277,6 +279,65 @@ static void BM_ToneBlit(benchmark::State& state) {
 
 BENCHMARK(BM_ToneBlit);
 
+static void BM_ToneBlitSaturation(benchmark::State& state) {
+	Bitmap::SetFormat(format);
+	auto dest = Bitmap::Create(320, 240);
+	auto src = Bitmap::Create(320, 240);
+	src->Fill(Color(200, 100, 50, 255));
+	auto rect = src->GetRect();
+	auto tone = Tone(200,100,50,64);
+	for (auto _: state) {
+		dest->ToneBlit(0, 0, *src, rect, tone, opacity);
+	}
+}
+
+BENCHMARK(BM_ToneBlitSaturation);
+
+static void BM_ToneBlitAlpha(benchmark::State& state) {
+	Bitmap::SetFormat(format);
+	auto dest = Bitmap::Create(320, 240);
+	auto src = Bitmap::Create(320, 240);
+	src->Fill(Color(200, 100, 50, 128));
+	auto rect = src->GetRect();
+	auto tone = Tone(200,100,50,64);
+	for (auto _: state) {
+		dest->ToneBlit(0, 0, *src, rect, tone, opacity);
+	}
+}
+
+BENCHMARK(BM_ToneBlitAlpha);
+
+static void BM_ToneKernel(benchmark::State& state) {
+	std::vector<uint32_t> pixels(320 * 240, 0xFF3264C8);
+	auto tone = Tone(200,100,50,64);
+	for (auto _: state) {
+		BitmapKernels::ApplyTone(pixels.data(), static_cast<int>(pixels.size()), tone, 0, 8, 16, 24, ImageOpacity::Alpha_8Bit);
+	}
+}
+
+BENCHMARK(BM_ToneKernel);
+
+static void BM_HueKernel(benchmark::State& state) {
+	std::vector<uint32_t> pixels(320 * 240, 0xC86432FF);
+	for (auto _: state) {
+		BitmapKernels::HueChange(pixels.data(), static_cast<int>(pixels.size()), 0x155, 24, 16, 8, 0);
+	}
+}
+
+BENCHMARK(BM_HueKernel);
+
+static void BM_ToneRect(benchmark::State& state) {
+	Bitmap::SetFormat(format);
+	auto dest = Bitmap::Create(320, 240);
+	auto rect = dest->GetRect();
+	auto tone = Tone(255,255,255,64);
+	for (auto _: state) {
+		dest->ToneRect(rect, tone);
+	}
+}
+
+BENCHMARK(BM_ToneRect);
+
 static void BM_BlendBlit(benchmark::State& state) {
 	Bitmap::SetFormat(format);
 	auto dest = Bitmap::Create(320, 240);
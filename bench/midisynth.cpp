@@ -0,0 +1,53 @@
+#include <cstdint>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <system.h>
+
+#ifdef WANT_FMMIDI
+#include <decoder_fmmidi.h>
+
+// Typical audio callback size
+constexpr int frames = 2048;
+
+static void FmTest(benchmark::State& state, int notes_per_channel, bool modulation) {
+	FmMidiDecoder decoder;
+	auto& synth = *decoder.synth;
+
+	for (int ch = 0; ch < 16; ++ch) {
+		synth.program_change(ch, ch * 8);
+		if (modulation) {
+			synth.control_change(ch, 0x01, 64);
+			synth.channel_pressure(ch, 64);
+		}
+	}
+
+	std::vector<int_least16_t> out(frames * 2);
+	int frame = 0;
+	for (auto _: state) {
+		// Dense song: every channel retriggers a chord every 8 callbacks
+		if (frame++ % 8 == 0) {
+			for (int ch = 0; ch < 16; ++ch) {
+				for (int i = 0; i < notes_per_channel; ++i) {
+					synth.note_on(ch, 48 + i * 4 + frame % 3, 100);
+				}
+			}
+		}
+		synth.synthesize(out.data(), frames, 44100);
+		benchmark::DoNotOptimize(out.data());
+	}
+}
+
+static void BM_FmMidi(benchmark::State& state) {
+	FmTest(state, 4, false);
+}
+
+BENCHMARK(BM_FmMidi);
+
+static void BM_FmMidiModulation(benchmark::State& state) {
+	FmTest(state, 4, true);
+}
+
+BENCHMARK(BM_FmMidiModulation);
+#endif
+
+BENCHMARK_MAIN();
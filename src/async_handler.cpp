@@ -15,9 +15,13 @@
  * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <condition_variable>
 #include <cstdlib>
+#include <deque>
 #include <fstream>
 #include <map>
+#include <mutex>
+#include <thread>
 
 #ifdef EMSCRIPTEN
 #  include <emscripten.h>
@@ -42,6 +46,11 @@
 // This allows testing some aspects of async file fetching locally.
 //#define EP_DEBUG_SIMULATE_ASYNC
 
+// Platforms without (useful) thread support run tasks synchronously
+#if !defined(EMSCRIPTEN) && !defined(__3DS__) && !defined(__wii__) && !defined(PSP)
+#  define EP_ASYNC_WORKERS
+#endif
+
 namespace {
 	std::unordered_map<std::string, FileRequestAsync> async_requests;
 	std::unordered_map<std::string, std::string> file_mapping;
@@ -70,6 +79,51 @@ namespace {
 		return std::make_shared<int>(next_id++);
 	}
 
+#ifdef EP_ASYNC_WORKERS
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex tasks_mutex;
+	std::condition_variable tasks_cv;
+	bool stop_workers = false;
+
+	void WorkerFunction() {
+		Output::RegisterBackgroundThread();
+
+		for (;;) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(tasks_mutex);
+				tasks_cv.wait(lock, [] { return stop_workers || !tasks.empty(); });
+				if (tasks.empty()) {
+					// Only reached when stopping, the queue is drained first
+					return;
+				}
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+
+			task();
+		}
+	}
+
+	void StartWorkers() {
+		// One core is left for the main thread
+		unsigned count = Utils::Clamp(std::thread::hardware_concurrency(), 2u, 5u) - 1;
+
+		stop_workers = false;
+		for (unsigned i = 0; i < count; ++i) {
+			workers.emplace_back(WorkerFunction);
+		}
+	}
+
+	// Joins the workers when the program exits without calling StopWorkers
+	struct WorkersGuard {
+		~WorkersGuard() {
+			AsyncHandler::StopWorkers();
+		}
+	} workers_guard;
+#endif
+
 #ifdef EMSCRIPTEN
 	constexpr size_t ASYNC_MAX_RETRY_COUNT{ 16 };
 
@@ -276,6 +330,36 @@ void AsyncHandler::SaveFilesystem() {
 #endif
 }
 
+void AsyncHandler::QueueTask(std::function<void()> task) {
+#ifdef EP_ASYNC_WORKERS
+	{
+		std::lock_guard<std::mutex> lock(tasks_mutex);
+		if (workers.empty()) {
+			StartWorkers();
+		}
+		tasks.push_back(std::move(task));
+	}
+	tasks_cv.notify_one();
+#else
+	task();
+#endif
+}
+
+void AsyncHandler::StopWorkers() {
+#ifdef EP_ASYNC_WORKERS
+	{
+		std::lock_guard<std::mutex> lock(tasks_mutex);
+		stop_workers = true;
+	}
+	tasks_cv.notify_all();
+
+	for (auto& worker: workers) {
+		worker.join();
+	}
+	workers.clear();
+#endif
+}
+
 bool AsyncHandler::IsImportantFilePending() {
 	return IsFilePending(true, false);
 }
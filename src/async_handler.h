@@ -19,6 +19,7 @@
 #define EP_ASYNC_HANDLER_H
 
 #include <functional>
+#include <future>
 #include <memory>
 #include <string>
 #include <vector>
@@ -98,6 +99,36 @@ namespace AsyncHandler {
 	 * Only works on emscripten, noop on other platforms.
 	 */
 	void SaveFilesystem();
+
+	/**
+	 * Runs a task on a worker thread.
+	 * Only use this for work that does not access global state, such as
+	 * decoding an already opened image file.
+	 * On platforms without thread support the task runs immediately.
+	 *
+	 * @param task function to run
+	 * @return future that receives the result of the task
+	 */
+	template<typename F>
+	auto RunTask(F task) -> std::future<decltype(task())>;
+
+	/**
+	 * Finishes all queued tasks and stops the worker threads.
+	 * They are started again by the next RunTask.
+	 */
+	void StopWorkers();
+
+	// don't call this directly, use RunTask
+	void QueueTask(std::function<void()> task);
+}
+
+template<typename F>
+auto AsyncHandler::RunTask(F task) -> std::future<decltype(task())> {
+	// packaged_task is move only but std::function requires a copyable target
+	auto packaged = std::make_shared<std::packaged_task<decltype(task())()>>(std::move(task));
+	auto future = packaged->get_future();
+	QueueTask([packaged]() { (*packaged)(); });
+	return future;
 }
 
 using FileRequestBinding = std::shared_ptr<int>;
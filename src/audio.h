@@ -44,6 +44,13 @@ struct AudioInterface {
 	 */
 	virtual void Update() = 0;
 
+	/**
+	 * Executes pending audio commands and destroys the decoders that were
+	 * replaced. Waits for the audio thread, only use it before decoder state
+	 * that is shared between threads is reset.
+	 */
+	virtual void Flush() {}
+
 	/**
 	 * Plays a background music.
 	 *
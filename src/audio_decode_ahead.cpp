@@ -0,0 +1,400 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headers
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "audio_decode_ahead.h"
+#include "audio_decoder.h"
+#include "output.h"
+#include "spsc_queue.h"
+
+// Platforms without (useful) thread support play the decoder directly
+#if !defined(EMSCRIPTEN) && !defined(__3DS__) && !defined(__wii__) && !defined(PSP)
+#  define EP_DECODE_AHEAD_WORKER
+#endif
+
+namespace {
+	/** Upper bound of bytes decoded in one step, keeps the worker responsive */
+	constexpr int max_chunk_size = 8192;
+	/** Lower bound of the ring size */
+	constexpr int min_ring_size = 4096;
+
+	/** Change requested by the audio thread, applied by the worker */
+	struct Control {
+		enum class Type {
+			Volume,
+			Fade,
+			Pitch,
+			Pause,
+			Resume
+		};
+		Type type = Type::Volume;
+		int value = 0;
+		int duration = 0;
+	};
+
+	/** State of the decoder after a decoded chunk, ends at ring position end */
+	struct Mark {
+		size_t end = 0;
+		int volume = 0;
+		int ticks = 0;
+		int loop_count = 0;
+	};
+}
+
+struct AudioDecodeAhead::Stream {
+	/** Only used by the worker, taken by ReleaseDecoders */
+	std::unique_ptr<AudioDecoderBase> decoder;
+	/** Held by the worker while it uses the decoder */
+	std::mutex decoder_mutex;
+	std::chrono::milliseconds latency;
+	int frame_size = 0;
+	int bytes_per_second = 0;
+	/** Mark which did not fit into the queue, merged with the next chunk */
+	Mark unsent_mark;
+	bool has_unsent_mark = false;
+
+	/** Only used by the wrapper */
+	Mark read_mark;
+	bool has_read_mark = false;
+
+	/** Decoded PCM, positions grow monotonically and wrap on access */
+	std::vector<uint8_t> ring;
+	std::atomic<size_t> read_pos = { 0 };
+	std::atomic<size_t> write_pos = { 0 };
+
+	SpscQueue<Control, 64> controls;
+	SpscQueue<Mark, 64> marks;
+
+	/** Set by the worker when no further data will be written */
+	std::atomic<bool> finished = { false };
+	/** Set by the wrapper when it is destroyed */
+	std::atomic<bool> released = { false };
+};
+
+#ifdef EP_DECODE_AHEAD_WORKER
+namespace {
+	std::thread worker;
+	std::mutex worker_mutex;
+	std::condition_variable worker_cv;
+	std::vector<std::shared_ptr<AudioDecodeAhead::Stream>> streams;
+	bool stop_worker = false;
+	bool streams_added = false;
+
+	void ApplyControls(AudioDecodeAhead::Stream& stream) {
+		auto& decoder = *stream.decoder;
+		Control control;
+		while (stream.controls.Pop(control)) {
+			switch (control.type) {
+				case Control::Type::Volume:
+					decoder.SetVolume(control.value);
+					break;
+				case Control::Type::Fade:
+					decoder.SetFade(control.value, std::chrono::milliseconds(control.duration));
+					break;
+				case Control::Type::Pitch:
+					decoder.SetPitch(control.value);
+					break;
+				case Control::Type::Pause:
+					decoder.Pause();
+					break;
+				case Control::Type::Resume:
+					decoder.Resume();
+					break;
+			}
+		}
+	}
+
+	void PublishMark(AudioDecodeAhead::Stream& stream, size_t end) {
+		auto& decoder = *stream.decoder;
+		stream.unsent_mark.end = end;
+		stream.unsent_mark.volume = decoder.GetVolume();
+		stream.unsent_mark.ticks = decoder.GetTicks();
+		stream.unsent_mark.loop_count = decoder.GetLoopCount();
+		stream.has_unsent_mark = !stream.marks.Push(Mark(stream.unsent_mark));
+	}
+
+	/** Fills the ring of the stream as far as possible */
+	void DecodeStream(AudioDecodeAhead::Stream& stream) {
+		std::lock_guard<std::mutex> lock(stream.decoder_mutex);
+		if (!stream.decoder) {
+			return;
+		}
+
+		ApplyControls(stream);
+
+		if (stream.has_unsent_mark) {
+			stream.has_unsent_mark = !stream.marks.Push(Mark(stream.unsent_mark));
+		}
+
+		const size_t ring_size = stream.ring.size();
+		// Stop early for released streams, ReleaseDecoders waits for the lock
+		while (!stream.finished.load(std::memory_order_relaxed) && !stream.released.load(std::memory_order_acquire)) {
+			const size_t write_pos = stream.write_pos.load(std::memory_order_relaxed);
+			const size_t free_space = ring_size - (write_pos - stream.read_pos.load(std::memory_order_acquire));
+			const size_t offset = write_pos % ring_size;
+
+			// Decode directly into the ring, up to the wrap around
+			int chunk = static_cast<int>(std::min({ free_space, ring_size - offset, static_cast<size_t>(max_chunk_size) }));
+			chunk -= chunk % stream.frame_size;
+			if (chunk <= 0) {
+				break;
+			}
+
+			int read = stream.decoder->Decode(&stream.ring[offset], chunk);
+			if (read <= 0) {
+				// End of a non-looping stream or a decoder error, both stop the channel
+				stream.finished.store(true, std::memory_order_release);
+				break;
+			}
+
+			// Decode pads with silence, keep the ring frame aligned
+			read = std::min(chunk, read + (stream.frame_size - read % stream.frame_size) % stream.frame_size);
+
+			stream.decoder->Update(std::chrono::microseconds(static_cast<int64_t>(read) * 1000000 / stream.bytes_per_second));
+			PublishMark(stream, write_pos + read);
+			stream.write_pos.store(write_pos + read, std::memory_order_release);
+
+			if (stream.decoder->IsFinished() && !stream.decoder->GetLooping()) {
+				stream.finished.store(true, std::memory_order_release);
+			}
+		}
+	}
+
+	void WorkerFunction() {
+		Output::RegisterBackgroundThread();
+
+		std::vector<std::shared_ptr<AudioDecodeAhead::Stream>> active;
+		for (;;) {
+			auto interval = std::chrono::milliseconds(1000);
+			{
+				std::lock_guard<std::mutex> lock(worker_mutex);
+				if (stop_worker) {
+					return;
+				}
+
+				// Released decoders are destroyed by ReleaseDecoders on the game thread
+				streams_added = false;
+				std::copy_if(streams.begin(), streams.end(), std::back_inserter(active), [](auto& stream) {
+					return !stream->released.load(std::memory_order_acquire);
+				});
+			}
+
+			for (auto& stream: active) {
+				DecodeStream(*stream);
+				// Refill when a quarter of the buffer was consumed
+				interval = std::min(interval, stream->latency / 4);
+			}
+			active.clear();
+
+			std::unique_lock<std::mutex> lock(worker_mutex);
+			worker_cv.wait_for(lock, std::max(interval, std::chrono::milliseconds(5)), [] {
+				return stop_worker || streams_added;
+			});
+		}
+	}
+
+	void Register(std::shared_ptr<AudioDecodeAhead::Stream> stream) {
+		std::lock_guard<std::mutex> lock(worker_mutex);
+		streams.push_back(std::move(stream));
+		streams_added = true;
+		if (!worker.joinable()) {
+			stop_worker = false;
+			worker = std::thread(WorkerFunction);
+		}
+		worker_cv.notify_one();
+	}
+
+	// Safety net when Shutdown was not called, a joinable thread terminates the program
+	struct WorkerGuard {
+		~WorkerGuard() {
+			AudioDecodeAhead::Shutdown();
+		}
+	} worker_guard;
+}
+#endif
+
+bool AudioDecodeAhead::IsSupported() {
+#ifdef EP_DECODE_AHEAD_WORKER
+	return true;
+#else
+	return false;
+#endif
+}
+
+void AudioDecodeAhead::ReleaseDecoders() {
+#ifdef EP_DECODE_AHEAD_WORKER
+	std::vector<std::shared_ptr<Stream>> released;
+	{
+		std::lock_guard<std::mutex> lock(worker_mutex);
+		// Finished streams are not decoded anymore, their decoders are freed early
+		auto it = std::stable_partition(streams.begin(), streams.end(), [](auto& stream) {
+			return !stream->released.load(std::memory_order_acquire) && !stream->finished.load(std::memory_order_acquire);
+		});
+		std::move(it, streams.end(), std::back_inserter(released));
+		streams.erase(it, streams.end());
+	}
+
+	for (auto& stream: released) {
+		std::unique_ptr<AudioDecoderBase> decoder;
+		{
+			// Only contended when the worker is in the middle of a chunk of this stream
+			std::lock_guard<std::mutex> lock(stream->decoder_mutex);
+			decoder = std::move(stream->decoder);
+		}
+		// Destroyed here, outside of the decode step of the worker
+	}
+#endif
+}
+
+void AudioDecodeAhead::Shutdown() {
+#ifdef EP_DECODE_AHEAD_WORKER
+	{
+		std::lock_guard<std::mutex> lock(worker_mutex);
+		stop_worker = true;
+	}
+	worker_cv.notify_one();
+	if (worker.joinable()) {
+		worker.join();
+	}
+	streams.clear();
+#endif
+}
+
+AudioDecodeAhead::AudioDecodeAhead(std::unique_ptr<AudioDecoderBase> decoder, std::chrono::milliseconds latency) {
+	decoder->GetFormat(frequency, format, channels);
+	pitch = decoder->GetPitch();
+	volume = decoder->GetVolume();
+	music_type = decoder->GetType();
+
+	stream = std::make_shared<Stream>();
+	stream->latency = latency;
+	stream->frame_size = AudioDecoder::GetSamplesizeForFormat(format) * channels;
+	stream->bytes_per_second = stream->frame_size * frequency;
+
+	size_t ring_size = static_cast<size_t>(stream->bytes_per_second) * latency.count() / 1000;
+	ring_size = std::max<size_t>(ring_size, min_ring_size);
+	stream->ring.resize(ring_size - ring_size % stream->frame_size);
+	stream->decoder = std::move(decoder);
+
+#ifdef EP_DECODE_AHEAD_WORKER
+	Register(stream);
+#endif
+}
+
+AudioDecodeAhead::~AudioDecodeAhead() {
+	// Destroyed by ReleaseDecoders, no blocking here
+	stream->released.store(true, std::memory_order_release);
+}
+
+void AudioDecodeAhead::Pause() {
+	stream->controls.Push({ Control::Type::Pause, 0, 0 });
+}
+
+void AudioDecodeAhead::Resume() {
+	stream->controls.Push({ Control::Type::Resume, 0, 0 });
+}
+
+int AudioDecodeAhead::GetVolume() const {
+	return volume;
+}
+
+void AudioDecodeAhead::SetVolume(int new_volume) {
+	stream->controls.Push({ Control::Type::Volume, new_volume, 0 });
+}
+
+void AudioDecodeAhead::SetFade(int end, std::chrono::milliseconds duration) {
+	stream->controls.Push({ Control::Type::Fade, end, static_cast<int>(duration.count()) });
+}
+
+bool AudioDecodeAhead::IsFinished() const {
+	return stream->finished.load(std::memory_order_acquire) &&
+		stream->read_pos.load(std::memory_order_relaxed) == stream->write_pos.load(std::memory_order_acquire);
+}
+
+void AudioDecodeAhead::Update(std::chrono::microseconds) {
+	// Fades are advanced by the worker based on the decoded duration
+}
+
+void AudioDecodeAhead::GetFormat(int& out_frequency, Format& out_format, int& out_channels) const {
+	out_frequency = frequency;
+	out_format = format;
+	out_channels = channels;
+}
+
+int AudioDecodeAhead::GetPitch() const {
+	return pitch;
+}
+
+bool AudioDecodeAhead::SetPitch(int new_pitch) {
+	if (!stream->controls.Push({ Control::Type::Pitch, new_pitch, 0 })) {
+		return false;
+	}
+	pitch = new_pitch;
+	return true;
+}
+
+int AudioDecodeAhead::GetTicks() const {
+	return ticks;
+}
+
+int AudioDecodeAhead::FillBuffer(uint8_t* buffer, int size) {
+	// Read finished before the positions, everything written is visible then
+	const bool finished = stream->finished.load(std::memory_order_acquire);
+	const size_t write_pos = stream->write_pos.load(std::memory_order_acquire);
+	const size_t read_pos = stream->read_pos.load(std::memory_order_relaxed);
+	const size_t ring_size = stream->ring.size();
+
+	const int available = static_cast<int>(std::min(write_pos - read_pos, static_cast<size_t>(size)));
+	const size_t offset = read_pos % ring_size;
+	const int first = std::min(available, static_cast<int>(ring_size - offset));
+	memcpy(buffer, &stream->ring[offset], first);
+	memcpy(buffer + first, stream->ring.data(), available - first);
+	stream->read_pos.store(read_pos + available, std::memory_order_release);
+
+	// Take over the decoder state of the chunk that is currently played
+	const size_t played_pos = read_pos + available;
+	for (;;) {
+		auto& mark = stream->read_mark;
+		if (!stream->has_read_mark && !stream->marks.Pop(mark)) {
+			break;
+		}
+		stream->has_read_mark = true;
+		volume = mark.volume;
+		ticks = mark.ticks;
+		loop_count = mark.loop_count;
+		if (mark.end > played_pos) {
+			break;
+		}
+		stream->has_read_mark = false;
+	}
+
+	if (finished) {
+		return available;
+	}
+
+	// The worker fell behind: Play silence instead of stopping the channel
+	memset(buffer + available, '\0', size - available);
+	return size;
+}
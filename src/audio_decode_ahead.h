@@ -0,0 +1,99 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_AUDIO_DECODE_AHEAD_H
+#define EP_AUDIO_DECODE_AHEAD_H
+
+// Headers
+#include <chrono>
+#include <memory>
+#include "audio_decoder_base.h"
+
+/**
+ * Wraps a decoder and decodes it ahead of playback on a worker thread.
+ * Decode only copies samples which are ready, so slow decoders, seeking
+ * and file access never block the audio callback. When the worker falls
+ * behind silence is returned instead of stalling.
+ *
+ * The wrapped decoder is only used by the worker after construction and
+ * is destroyed by ReleaseDecoders once the wrapper was destroyed or the
+ * stream finished.
+ * Volume, fade and pitch changes are forwarded to it and take effect
+ * with up to the buffer latency. Ticks and loop count are reported for
+ * the decode position.
+ */
+class AudioDecodeAhead final : public AudioDecoderBase {
+public:
+	/** @return whether the platform supports decoding ahead (has threads) */
+	static bool IsSupported();
+
+	/**
+	 * Destroys the wrapped decoders of all destroyed instances and of
+	 * finished streams.
+	 * The worker never destroys decoders, call this on the game thread
+	 * before state shared by decoders (e.g. the FluidSynth synthesizer) is
+	 * changed. Only waits when the worker is decoding a chunk of a stream
+	 * that is released.
+	 */
+	static void ReleaseDecoders();
+
+	/**
+	 * Stops the worker thread and destroys all wrapped decoders.
+	 * Must be called on exit after the audio system was destroyed.
+	 */
+	static void Shutdown();
+
+	/**
+	 * Starts decoding ahead.
+	 *
+	 * @param decoder opened decoder with format, pitch, volume and looping set up
+	 * @param latency amount of audio to decode in advance
+	 */
+	AudioDecodeAhead(std::unique_ptr<AudioDecoderBase> decoder, std::chrono::milliseconds latency);
+	~AudioDecodeAhead() override;
+
+	bool Open(Filesystem_Stream::InputStream) override { return false; }
+	void Pause() override;
+	void Resume() override;
+	int GetVolume() const override;
+	void SetVolume(int volume) override;
+	void SetFade(int end, std::chrono::milliseconds duration) override;
+	bool Seek(std::streamoff, std::ios_base::seekdir) override { return false; }
+	bool IsFinished() const override;
+	void Update(std::chrono::microseconds delta) override;
+	void GetFormat(int& frequency, Format& format, int& channels) const override;
+	int GetPitch() const override;
+	bool SetPitch(int pitch) override;
+	int GetTicks() const override;
+
+	/** Shared with the worker thread */
+	struct Stream;
+
+private:
+	int FillBuffer(uint8_t* buffer, int size) override;
+
+	std::shared_ptr<Stream> stream;
+	int frequency = 0;
+	Format format = Format::S16;
+	int channels = 0;
+	int pitch = 100;
+	/** Decoder state of the chunk that is currently played */
+	int volume = 0;
+	int ticks = 0;
+};
+
+#endif
@@ -17,26 +17,17 @@
 
 #include "system.h"
 
+#include <algorithm>
 #include <cstring>
 #include <cassert>
 #include <memory>
+#include "audio_decode_ahead.h"
 #include "audio_generic.h"
+#include "audio_mixer.h"
 #include "output.h"
+#include "instrumentation.h"
 
 GenericAudio::GenericAudio(const Game_ConfigAudio& cfg) : AudioInterface(cfg) {
-	int i = 0;
-	for (auto& BGM_Channel : BGM_Channels) {
-		BGM_Channel.id = i++;
-		BGM_Channel.decoder.reset();
-		BGM_Channel.instance = this;
-	}
-	i = 0;
-	for (auto& SE_Channel : SE_Channels) {
-		SE_Channel.id = i++;
-		SE_Channel.decoder.reset();
-		SE_Channel.instance = this;
-	}
-	BGM_PlayedOnceIndicator = false;
 	midi_thread.reset();
 
 	// Initialize to some arbitrary (low-quality) format to prevent crashes
@@ -50,125 +41,181 @@ void GenericAudio::BGM_Play(Filesystem_Stream::InputStream stream, int volume, i
 		return;
 	}
 
-	for (auto& BGM_Channel : BGM_Channels) {
-		BGM_Channel.stopped = true; //Stop all running background music
-		if (!BGM_Channel.IsUsed()) {
-			// If there is an unused bgm channel
-			LockMutex();
-			BGM_PlayedOnceIndicator = false;
-			UnlockMutex();
-			PlayOnChannel(BGM_Channel, std::move(stream), volume, pitch, fadein);
-			return;
+	// Stop all running background music
+	StopMidiOut();
+	bgm_playing = true;
+	bgm_type.clear();
+
+	Command cmd;
+	cmd.type = Command::Type::BgmStop;
+	cmd.value = ++bgm_serial;
+
+	// Midiout is an exclusive resource
+	if (GenericAudioMidiOut::IsSupported(stream)) {
+		// FIXME: Try Fluidsynth and WildMidi first
+		// If they work fallback to the normal AudioDecoder handler below
+		// There should be a way to configure the order
+		if (!MidiDecoder::CreateFluidsynth(true) && !MidiDecoder::CreateWildMidi(true)) {
+			if (!midi_thread) {
+				midi_thread = std::make_unique<GenericAudioMidiOut>();
+				if (midi_thread->IsInitialized()) {
+					midi_thread->StartThread();
+				} else {
+					midi_thread.reset();
+				}
+			}
+
+			if (midi_thread) {
+				midi_thread->LockMutex();
+				auto &midi_out = midi_thread->GetMidiOut();
+				if (midi_out.Open(std::move(stream))) {
+					midi_out.SetPitch(pitch);
+					midi_out.SetVolume(0);
+					midi_out.SetFade(volume, std::chrono::milliseconds(fadein));
+					midi_out.SetLooping(true);
+					midi_out.Resume();
+					bgm_midi_out_used = true;
+					bgm_type = "midi";
+					midi_thread->UnlockMutex();
+					SendCommand(std::move(cmd));
+					return;
+				}
+				midi_thread->UnlockMutex();
+			}
+		}
+	}
+
+	if (midi_thread) {
+		midi_thread->LockMutex();
+		midi_thread->GetMidiOut().Reset();
+		midi_thread->UnlockMutex();
+	}
+
+	// Opening the decoder reads the file, do it here and not in the audio thread
+	auto decoder = AudioDecoder::Create(stream);
+	if (decoder && decoder->Open(std::move(stream))) {
+		decoder->SetPitch(pitch);
+		decoder->SetFormat(output_format.frequency, output_format.format, output_format.channels);
+		decoder->SetVolume(0);
+		decoder->SetFade(volume, std::chrono::milliseconds(fadein));
+		decoder->SetLooping(true);
+		bgm_type = decoder->GetType();
+
+		// Keeps slow decoders (e.g. MIDI synthesis) out of the audio callback
+		int decode_ahead = cfg.bgm_decode_ahead.Get();
+		if (decode_ahead > 0 && AudioDecodeAhead::IsSupported()) {
+			decoder = std::make_unique<AudioDecodeAhead>(std::move(decoder), std::chrono::milliseconds(decode_ahead));
 		}
+
+		cmd.type = Command::Type::BgmPlay;
+		cmd.decoder = std::move(decoder);
+	} else {
+		Output::Warning("Couldn't play BGM {}. Format not supported", stream.GetName());
 	}
+
+	SendCommand(std::move(cmd));
 }
 
 void GenericAudio::BGM_Pause() {
-	for (auto& BGM_Channel : BGM_Channels) {
-		if (BGM_Channel.IsUsed()) {
-			BGM_Channel.SetPaused(true);
-		}
+	if (bgm_midi_out_used) {
+		midi_thread->LockMutex();
+		midi_thread->GetMidiOut().Pause();
+		midi_thread->UnlockMutex();
 	}
+
+	Command cmd;
+	cmd.type = Command::Type::BgmPause;
+	SendCommand(std::move(cmd));
 }
 
 void GenericAudio::BGM_Resume() {
-	for (auto& BGM_Channel : BGM_Channels) {
-		if (BGM_Channel.IsUsed()) {
-			BGM_Channel.SetPaused(false);
-		}
+	if (bgm_midi_out_used) {
+		midi_thread->LockMutex();
+		midi_thread->GetMidiOut().Resume();
+		midi_thread->UnlockMutex();
 	}
+
+	Command cmd;
+	cmd.type = Command::Type::BgmResume;
+	SendCommand(std::move(cmd));
 }
 
 void GenericAudio::BGM_Stop() {
-	LockMutex();
-	for (auto& BGM_Channel : BGM_Channels) {
-		BGM_Channel.Stop();
-	}
-	BGM_PlayedOnceIndicator = false;
-	UnlockMutex();
+	StopMidiOut();
+	bgm_playing = false;
+	bgm_type.clear();
+
+	Command cmd;
+	cmd.type = Command::Type::BgmStop;
+	cmd.value = ++bgm_serial;
+	SendCommand(std::move(cmd));
 }
 
 bool GenericAudio::BGM_PlayedOnce() const {
-	if (BGM_PlayedOnceIndicator) {
-		return BGM_PlayedOnceIndicator;
-	}
-
-	LockMutex();
-	// Audio Decoders set this in the Decoding thread
-	for (auto& BGM_Channel : BGM_Channels) {
-		if (BGM_Channel.midi_out_used) {
-			BGM_PlayedOnceIndicator = midi_thread->GetMidiOut().GetLoopCount() > 0;
-		}
+	if (bgm_midi_out_used) {
+		return midi_thread->GetMidiOut().GetLoopCount() > 0;
 	}
-	UnlockMutex();
 
-	return BGM_PlayedOnceIndicator;
+	// Only valid once the audio thread started the current BGM
+	return bgm_processed_serial.load() == bgm_serial && bgm_played_once.load();
 }
 
 bool GenericAudio::BGM_IsPlaying() const {
-	for (auto& BGM_Channel : BGM_Channels) {
-		if (!BGM_Channel.stopped) {
-			return true;
-		};
-	}
-	return false;
+	return bgm_playing;
 }
 
 int GenericAudio::BGM_GetTicks() const {
-	unsigned ticks = 0;
-	LockMutex();
-	for (auto& BGM_Channel : BGM_Channels) {
-		int cur_ticks = BGM_Channel.GetTicks();
-		if (cur_ticks >= 0) {
-			ticks = static_cast<unsigned>(cur_ticks);
-		}
+	if (bgm_midi_out_used) {
+		return midi_thread->GetMidiOut().GetTicks();
 	}
-	UnlockMutex();
-	return ticks;
+
+	if (bgm_processed_serial.load() != bgm_serial) {
+		return 0;
+	}
+	return bgm_ticks.load();
 }
 
 void GenericAudio::BGM_Fade(int fade) {
-	LockMutex();
-	for (auto& BGM_Channel : BGM_Channels) {
-		BGM_Channel.SetFade(fade);
+	if (bgm_midi_out_used) {
+		midi_thread->LockMutex();
+		midi_thread->GetMidiOut().SetFade(0, std::chrono::milliseconds(fade));
+		midi_thread->UnlockMutex();
 	}
-	UnlockMutex();
+
+	Command cmd;
+	cmd.type = Command::Type::BgmFade;
+	cmd.value = fade;
+	SendCommand(std::move(cmd));
 }
 
 void GenericAudio::BGM_Volume(int volume) {
-	LockMutex();
-	for (auto& BGM_Channel : BGM_Channels) {
-		BGM_Channel.SetVolume(volume);
+	if (bgm_midi_out_used) {
+		midi_thread->LockMutex();
+		midi_thread->GetMidiOut().SetVolume(volume);
+		midi_thread->UnlockMutex();
 	}
-	UnlockMutex();
+
+	Command cmd;
+	cmd.type = Command::Type::BgmVolume;
+	cmd.value = volume;
+	SendCommand(std::move(cmd));
 }
 
 void GenericAudio::BGM_Pitch(int pitch) {
-	LockMutex();
-	for (auto& BGM_Channel : BGM_Channels) {
-		BGM_Channel.SetPitch(pitch);
+	if (bgm_midi_out_used) {
+		midi_thread->LockMutex();
+		midi_thread->GetMidiOut().SetPitch(pitch);
+		midi_thread->UnlockMutex();
 	}
-	UnlockMutex();
+
+	Command cmd;
+	cmd.type = Command::Type::BgmPitch;
+	cmd.value = pitch;
+	SendCommand(std::move(cmd));
 }
 
 std::string GenericAudio::BGM_GetType() const {
-	std::string type;
-
-	LockMutex();
-	for (auto& BGM_Channel : BGM_Channels) {
-		if (BGM_Channel.IsUsed()) {
-			if (BGM_Channel.midi_out_used) {
-				type = "midi";
-				break;
-			} else {
-				type = BGM_Channel.decoder->GetType();
-				break;
-			}
-		}
-	}
-	UnlockMutex();
-
-	return type;
+	return bgm_type;
 }
 
 void GenericAudio::SE_Play(std::unique_ptr<AudioSeCache> se, int volume, int pitch) {
@@ -177,25 +224,36 @@ void GenericAudio::SE_Play(std::unique_ptr<AudioSeCache> se, int volume, int pit
 		return;
 	}
 
-	for (auto& SE_Channel : SE_Channels) {
-		if (!SE_Channel.decoder) {
-			//If there is an unused se channel
-			PlayOnChannel(SE_Channel, std::move(se), volume, pitch);
-			return;
-		}
-	}
-	// FIXME Not displaying as warning because multiple games exhaust free channels available, see #1356
-	Output::Debug("Couldn't play {} SE. No free channel available", se->GetName());
+	// The sample is already converted to the output format, mixing it is a copy
+	Command cmd;
+	cmd.type = Command::Type::SePlay;
+	cmd.decoder = se->CreateSeDecoder(output_format.frequency, output_format.format, output_format.channels, pitch);
+	cmd.decoder->SetVolume(volume);
+	SendCommand(std::move(cmd));
 }
 
 void GenericAudio::SE_Stop() {
-	for (auto& SE_Channel : SE_Channels) {
-		SE_Channel.stopped = true; //Stop all running sound effects
-	}
+	Command cmd;
+	cmd.type = Command::Type::SeStop;
+	SendCommand(std::move(cmd));
 }
 
 void GenericAudio::Update() {
-	// no-op, handled by the Decode function called through a thread
+	// Decoding is handled by the Decode function called through a thread
+	DestroyRetiredDecoders();
+
+	int dropped = se_dropped.exchange(0);
+	if (dropped > 0) {
+		// FIXME Not displaying as warning because multiple games exhaust free channels available, see #1356
+		Output::Debug("Couldn't play {} SE. No free channel available", dropped);
+	}
+}
+
+void GenericAudio::Flush() {
+	LockMutex();
+	ProcessCommands();
+	UnlockMutex();
+	DestroyRetiredDecoders();
 }
 
 void GenericAudio::SetFormat(int frequency, AudioDecoder::Format format, int channels) {
@@ -204,86 +262,116 @@ void GenericAudio::SetFormat(int frequency, AudioDecoder::Format format, int cha
 	output_format.channels = channels;
 }
 
-bool GenericAudio::PlayOnChannel(BgmChannel& chan, Filesystem_Stream::InputStream filestream, int volume, int pitch, int fadein) {
-	chan.paused = true; // Pause channel so the audio thread doesn't work on it
-	chan.stopped = false; // Unstop channel so the audio thread doesn't delete it
-
-	if (!filestream) {
-		Output::Warning("BGM file not readable: {}", filestream.GetName());
-		return false;
+void GenericAudio::SendCommand(Command cmd) {
+	if (commands.Push(std::move(cmd))) {
+		return;
 	}
 
-	// Midiout is only supported on channel 0 because this is an exclusive resource
-	if (chan.id == 0 && GenericAudioMidiOut::IsSupported(filestream)) {
-		chan.decoder.reset();
+	// The audio thread is not consuming (e.g. the device is paused).
+	// Decode cannot run while the mutex is held, so act as the consumer.
+	LockMutex();
+	ProcessCommands();
+	ExecuteCommand(cmd);
+	UnlockMutex();
+}
 
-		// FIXME: Try Fluidsynth and WildMidi first
-		// If they work fallback to the normal AudioDecoder handler below
-		// There should be a way to configure the order
-		if (!MidiDecoder::CreateFluidsynth(true) && !MidiDecoder::CreateWildMidi(true)) {
-			if (!midi_thread) {
-				midi_thread = std::make_unique<GenericAudioMidiOut>();
-				if (midi_thread->IsInitialized()) {
-					midi_thread->StartThread();
-				} else {
-					midi_thread.reset();
-				}
-			}
+void GenericAudio::ProcessCommands() {
+	Command cmd;
+	while (commands.Pop(cmd)) {
+		ExecuteCommand(cmd);
+	}
+}
 
-			if (midi_thread) {
-				midi_thread->LockMutex();
-				auto &midi_out = midi_thread->GetMidiOut();
-				if (midi_out.Open(std::move(filestream))) {
-					midi_out.SetPitch(pitch);
-					midi_out.SetVolume(0);
-					midi_out.SetFade(volume, std::chrono::milliseconds(fadein));
-					midi_out.SetLooping(true);
-					midi_out.Resume();
-					chan.paused = false;
-					chan.midi_out_used = true;
-					midi_thread->UnlockMutex();
-					return true;
-				}
-				midi_thread->UnlockMutex();
+void GenericAudio::ExecuteCommand(Command& cmd) {
+	switch (cmd.type) {
+		case Command::Type::BgmPlay:
+		case Command::Type::BgmStop:
+			RetireDecoder(std::move(BGM_Channel.decoder));
+			BGM_Channel.decoder = std::move(cmd.decoder);
+			BGM_Channel.paused = false;
+			bgm_ticks = 0;
+			bgm_played_once = false;
+			bgm_processed_serial = cmd.value;
+			break;
+		case Command::Type::BgmPause:
+		case Command::Type::BgmResume:
+			BGM_Channel.paused = cmd.type == Command::Type::BgmPause;
+			break;
+		case Command::Type::BgmFade:
+			if (BGM_Channel.decoder) {
+				BGM_Channel.decoder->SetFade(0, std::chrono::milliseconds(cmd.value));
 			}
+			break;
+		case Command::Type::BgmVolume:
+			if (BGM_Channel.decoder) {
+				BGM_Channel.decoder->SetVolume(cmd.value);
+			}
+			break;
+		case Command::Type::BgmPitch:
+			if (BGM_Channel.decoder) {
+				BGM_Channel.decoder->SetPitch(cmd.value);
+			}
+			break;
+		case Command::Type::SePlay: {
+			auto it = std::find_if(std::begin(SE_Channels), std::end(SE_Channels), [](const SeChannel& chan) {
+				return !chan.decoder;
+			});
+			if (it != std::end(SE_Channels)) {
+				it->decoder = std::move(cmd.decoder);
+			} else {
+				++se_dropped;
+			}
+			break;
 		}
+		case Command::Type::SeStop:
+			for (auto& SE_Channel : SE_Channels) {
+				SE_Channel.decoder.reset();
+			}
+			break;
 	}
 
-	if (midi_thread) {
-		midi_thread->GetMidiOut().Reset();
+	// Frees the decoder of a SE that found no free channel
+	cmd.decoder.reset();
+}
+
+void GenericAudio::RetireDecoder(std::unique_ptr<AudioDecoderBase> decoder) {
+	if (!decoder) {
+		return;
 	}
 
-	chan.decoder = AudioDecoder::Create(filestream);
-	chan.midi_out_used = false;
-	if (chan.decoder && chan.decoder->Open(std::move(filestream))) {
-		chan.decoder->SetPitch(pitch);
-		chan.decoder->SetFormat(output_format.frequency, output_format.format, output_format.channels);
-		chan.decoder->SetVolume(0);
-		chan.decoder->SetFade(volume, std::chrono::milliseconds(fadein));
-		chan.decoder->SetLooping(true);
-		chan.paused = false; // Unpause channel -> Play it.
-
-		return true;
-	} else {
-		Output::Warning("Couldn't play BGM {}. Format not supported", filestream.GetName());
+	// Decoders share state with the game thread (e.g. the FluidSynth
+	// synthesizer). Only when the game thread stopped calling Update the
+	// queue runs full and the decoder is destroyed here.
+	if (!retired_decoders.Push(std::move(decoder))) {
+		decoder.reset();
+	}
+}
+
+void GenericAudio::DestroyRetiredDecoders() {
+	std::unique_ptr<AudioDecoderBase> decoder;
+	while (retired_decoders.Pop(decoder)) {
+		decoder.reset();
 	}
 
-	return false;
+	// Decode-ahead streams of the destroyed decoders
+	AudioDecodeAhead::ReleaseDecoders();
 }
 
-bool GenericAudio::PlayOnChannel(SeChannel& chan, std::unique_ptr<AudioSeCache> se, int volume, int pitch) {
-	chan.paused = true; // Pause channel so the audio thread doesn't work on it
-	chan.stopped = false; // Unstop channel so the audio thread doesn't delete it
+void GenericAudio::StopMidiOut() {
+	if (!bgm_midi_out_used) {
+		return;
+	}
 
-	chan.decoder = se->CreateSeDecoder();
-	chan.decoder->SetPitch(pitch);
-	chan.decoder->SetFormat(output_format.frequency, output_format.format, output_format.channels);
-	chan.decoder->SetVolume(volume);
-	chan.paused = false; // Unpause channel -> Play it.
-	return true;
+	bgm_midi_out_used = false;
+	midi_thread->LockMutex();
+	midi_thread->GetMidiOut().Reset();
+	midi_thread->GetMidiOut().Pause();
+	midi_thread->UnlockMutex();
 }
 
 void GenericAudio::Decode(uint8_t* output_buffer, int buffer_length) {
+	EP_PROFILE_ZONE("GenericAudio::Decode");
+
 	bool channel_active = false;
 	float total_volume = 0;
 	int samples_per_frame = buffer_length / output_format.channels / 2;
@@ -300,9 +388,12 @@ void GenericAudio::Decode(uint8_t* output_buffer, int buffer_length) {
 	if (scrap_buffer.size() != scrap_buffer_size) {
 		scrap_buffer.resize(scrap_buffer_size);
 	}
-	memset(mixer_buffer.data(), '\0', mixer_buffer.size());
+	std::fill(mixer_buffer.begin(), mixer_buffer.end(), 0.0f);
+
+	ProcessCommands();
 
-	for (unsigned i = 0; i < nr_of_bgm_channels + nr_of_se_channels; i++) {
+	// Channel 0 is the BGM, the others are SE
+	for (unsigned i = 0; i < 1 + nr_of_se_channels; i++) {
 		int read_bytes = 0;
 		int channels = 0;
 		int samplesize = 0;
@@ -311,77 +402,68 @@ void GenericAudio::Decode(uint8_t* output_buffer, int buffer_length) {
 		float volume;
 
 		// Mix BGM and SE together;
-		bool is_bgm_channel = i < nr_of_bgm_channels;
+		bool is_bgm_channel = i == 0;
 		bool channel_used = false;
 
 		if (is_bgm_channel) {
-			BgmChannel& currently_mixed_channel = BGM_Channels[i];
+			BgmChannel& currently_mixed_channel = BGM_Channel;
 			float current_master_volume = cfg.music_volume.Get() / 100.0f;
 
 			if (currently_mixed_channel.decoder && !currently_mixed_channel.paused) {
-				if (currently_mixed_channel.stopped) {
-					currently_mixed_channel.decoder.reset();
-				} else {
-					currently_mixed_channel.decoder->Update(std::chrono::microseconds(1000 * 1000 / 60));
-					volume = current_master_volume * (currently_mixed_channel.decoder->GetVolume() / 100.0);
-					currently_mixed_channel.decoder->GetFormat(frequency, sampleformat, channels);
-					samplesize = AudioDecoder::GetSamplesizeForFormat(sampleformat);
+				currently_mixed_channel.decoder->Update(std::chrono::microseconds(1000 * 1000 / 60));
+				volume = current_master_volume * (currently_mixed_channel.decoder->GetVolume() / 100.0);
+				currently_mixed_channel.decoder->GetFormat(frequency, sampleformat, channels);
+				samplesize = AudioDecoder::GetSamplesizeForFormat(sampleformat);
 
-					total_volume += volume;
+				total_volume += volume;
 
-					// determine how much data has to be read from this channel (but cap at the bounds of the scrap buffer)
-					unsigned bytes_to_read = (samplesize * channels * samples_per_frame);
-					bytes_to_read = (bytes_to_read < scrap_buffer_size) ? bytes_to_read : scrap_buffer_size;
+				// determine how much data has to be read from this channel (but cap at the bounds of the scrap buffer)
+				unsigned bytes_to_read = (samplesize * channels * samples_per_frame);
+				bytes_to_read = (bytes_to_read < scrap_buffer_size) ? bytes_to_read : scrap_buffer_size;
 
-					read_bytes = currently_mixed_channel.decoder->Decode(scrap_buffer.data(), bytes_to_read);
+				read_bytes = currently_mixed_channel.decoder->Decode(scrap_buffer.data(), bytes_to_read);
 
-					if (read_bytes <= 0) {
-						// An error occured when reading - the channel is faulty - discard
-						currently_mixed_channel.decoder.reset();
-						continue; // skip this loop run - there is nothing to mix
-					}
+				if (read_bytes <= 0) {
+					// An error occured when reading - the channel is faulty - discard
+					RetireDecoder(std::move(currently_mixed_channel.decoder));
+					continue; // skip this loop run - there is nothing to mix
+				}
 
-					if (!currently_mixed_channel.stopped) {
-						BGM_PlayedOnceIndicator = currently_mixed_channel.decoder->GetLoopCount() > 0;
-					}
+				bgm_played_once = currently_mixed_channel.decoder->GetLoopCount() > 0;
+				bgm_ticks = currently_mixed_channel.decoder->GetTicks();
 
-					channel_used = true;
-				}
+				channel_used = true;
 			}
 		} else {
-			SeChannel& currently_mixed_channel = SE_Channels[i - nr_of_bgm_channels];
+			SeChannel& currently_mixed_channel = SE_Channels[i - 1];
 			float current_master_volume = cfg.sound_volume.Get() / 100.0f;
 
-			if (currently_mixed_channel.decoder && !currently_mixed_channel.paused) {
-				if (currently_mixed_channel.stopped) {
-					currently_mixed_channel.decoder.reset();
-				} else {
-					volume = current_master_volume * (currently_mixed_channel.decoder->GetVolume() / 100.0);
-					currently_mixed_channel.decoder->GetFormat(frequency, sampleformat, channels);
-					samplesize = AudioDecoder::GetSamplesizeForFormat(sampleformat);
-
-					total_volume += volume;
+			if (currently_mixed_channel.decoder) {
+				volume = current_master_volume * (currently_mixed_channel.decoder->GetVolume() / 100.0);
+				currently_mixed_channel.decoder->GetFormat(frequency, sampleformat, channels);
+				samplesize = AudioDecoder::GetSamplesizeForFormat(sampleformat);
 
-					// determine how much data has to be read from this channel (but cap at the bounds of the scrap buffer)
-					unsigned bytes_to_read = (samplesize * channels * samples_per_frame);
-					bytes_to_read = (bytes_to_read < scrap_buffer_size) ? bytes_to_read : scrap_buffer_size;
+				total_volume += volume;
 
-					read_bytes = currently_mixed_channel.decoder->Decode(scrap_buffer.data(), bytes_to_read);
+				// determine how much data has to be read from this channel (but cap at the bounds of the scrap buffer)
+				unsigned bytes_to_read = (samplesize * channels * samples_per_frame);
+				bytes_to_read = (bytes_to_read < scrap_buffer_size) ? bytes_to_read : scrap_buffer_size;
 
-					if (read_bytes <= 0) {
-						// An error occured when reading - the channel is faulty - discard
-						currently_mixed_channel.decoder.reset();
-						continue; // skip this loop run - there is nothing to mix
-					}
+				read_bytes = currently_mixed_channel.decoder->Decode(scrap_buffer.data(), bytes_to_read);
 
-					// Now decide what to do when a channel has reached its end
-					if (currently_mixed_channel.decoder->IsFinished()) {
-						// SE are only played once so free the se if finished
-						currently_mixed_channel.decoder.reset();
-					}
+				if (read_bytes <= 0) {
+					// An error occured when reading - the channel is faulty - discard
+					RetireDecoder(std::move(currently_mixed_channel.decoder));
+					continue; // skip this loop run - there is nothing to mix
+				}
 
-					channel_used = true;
+				// Now decide what to do when a channel has reached its end
+				if (currently_mixed_channel.decoder->IsFinished()) {
+					// SE are only played once so free the se if finished
+					currently_mixed_channel.decoder.reset();
 				}
+
+				channel_used = true;
 			}
 		}
 
@@ -390,147 +472,17 @@ void GenericAudio::Decode(uint8_t* output_buffer, int buffer_length) {
 		//--------------------------------------------------------------------------------------------------------------------//
 
 		if (channel_used) {
-			for (unsigned ii = 0; ii < (unsigned)(read_bytes / (samplesize * channels)); ii++) {
-
-				float vall = volume;
-				float valr = vall;
-
-				// Convert to floating point
-				switch (sampleformat) {
-					case AudioDecoder::Format::S8:
-						vall *= (((int8_t *) scrap_buffer.data())[ii * channels] / 128.0);
-						valr *= (((int8_t *) scrap_buffer.data())[ii * channels + 1] / 128.0);
-						break;
-					case AudioDecoder::Format::U8:
-						vall *= (((uint8_t *) scrap_buffer.data())[ii * channels] / 128.0 - 1.0);
-						valr *= (((uint8_t *) scrap_buffer.data())[ii * channels + 1] / 128.0 - 1.0);
-						break;
-					case AudioDecoder::Format::S16:
-						vall *= (((int16_t *) scrap_buffer.data())[ii * channels] / 32768.0);
-						valr *= (((int16_t *) scrap_buffer.data())[ii * channels + 1] / 32768.0);
-						break;
-					case AudioDecoder::Format::U16:
-						vall *= (((uint16_t *) scrap_buffer.data())[ii * channels] / 32768.0 - 1.0);
-						valr *= (((uint16_t *) scrap_buffer.data())[ii * channels + 1] / 32768.0 - 1.0);
-						break;
-					case AudioDecoder::Format::S32:
-						vall *= (((int32_t *) scrap_buffer.data())[ii * channels] / 2147483648.0);
-						valr *= (((int32_t *) scrap_buffer.data())[ii * channels + 1] / 2147483648.0);
-						break;
-					case AudioDecoder::Format::U32:
-						vall *= (((uint32_t *) scrap_buffer.data())[ii * channels] / 2147483648.0 - 1.0);
-						valr *= (((uint32_t *) scrap_buffer.data())[ii * channels + 1] / 2147483648.0 - 1.0);
-						break;
-					case AudioDecoder::Format::F32:
-						vall *= (((float *) scrap_buffer.data())[ii * channels]);
-						valr *= (((float *) scrap_buffer.data())[ii * channels + 1]);
-						break;
-				}
-
-				if (!channel_active) {
-					// first channel
-					mixer_buffer[ii * output_format.channels] = vall;
-					if (channels > 1) {
-						mixer_buffer[ii * output_format.channels + 1] = valr;
-					} else {
-						mixer_buffer[ii * output_format.channels + 1] = mixer_buffer[ii * output_format.channels];
-					}
-				} else {
-					mixer_buffer[ii * output_format.channels] += vall;
-					if (channels > 1) {
-						mixer_buffer[ii * output_format.channels + 1] += valr;
-					} else {
-						mixer_buffer[ii * output_format.channels + 1] = mixer_buffer[ii * output_format.channels];
-					}
-				}
-
-			}
+			int frames = read_bytes / (samplesize * channels);
+			AudioMixer::Mix(mixer_buffer.data(), scrap_buffer.data(), frames, sampleformat, channels, volume);
 			channel_active = true;
 		}
 	}
 
 	if (channel_active) {
-		if (total_volume > 1.0) {
-			float threshold = 0.8;
-			for (unsigned i = 0; i < (unsigned)(samples_per_frame * 2); i++) {
-				float sample = mixer_buffer[i];
-				float sign = (sample < 0) ? -1.0 : 1.0;
-				sample /= sign;
-				//dynamic range compression
-				if (sample > threshold) {
-					sample_buffer[i] = sign * 32768.0 * (threshold + (1.0 - threshold) * (sample - threshold) / (total_volume - threshold));
-				} else {
-					sample_buffer[i] = sign * sample * 32768.0;
-				}
-			}
-		} else {
-			//No dynamic range compression necessary
-			for (unsigned i = 0; i < (unsigned)(samples_per_frame * 2); i++) {
-				sample_buffer[i] = mixer_buffer[i] * 32768.0;
-			}
-		}
+		AudioMixer::Limit(sample_buffer.data(), mixer_buffer.data(), samples_per_frame * 2, total_volume);
 
 		memcpy(output_buffer, sample_buffer.data(), buffer_length);
 	} else {
 		memset(output_buffer, '\0', buffer_length);
 	}
 }
-
-void GenericAudio::BgmChannel::Stop() {
-	stopped = true;
-	if (midi_out_used) {
-		midi_out_used = false;
-		instance->midi_thread->GetMidiOut().Reset();
-		instance->midi_thread->GetMidiOut().Pause();
-	} else if (decoder) {
-		decoder.reset();
-	}
-}
-
-void GenericAudio::BgmChannel::SetPaused(bool newPaused) {
-	paused = newPaused;
-	if (midi_out_used) {
-		if (newPaused) {
-			instance->midi_thread->GetMidiOut().Pause();
-		} else {
-			instance->midi_thread->GetMidiOut().Resume();
-		}
-	}
-}
-
-int GenericAudio::BgmChannel::GetTicks() const {
-	if (midi_out_used) {
-		return instance->midi_thread->GetMidiOut().GetTicks();
-	} else if (decoder) {
-		return decoder->GetTicks();
-	}
-	return -1;
-}
-
-void GenericAudio::BgmChannel::SetFade(int fade) {
-	if (midi_out_used) {
-		instance->midi_thread->GetMidiOut().SetFade(0, std::chrono::milliseconds(fade));
-	} else if (decoder) {
-		decoder->SetFade(0, std::chrono::milliseconds(fade));
-	}
-}
-
-void GenericAudio::BgmChannel::SetVolume(int volume) {
-	if (midi_out_used) {
-		instance->midi_thread->GetMidiOut().SetVolume(volume);
-	} else if (decoder) {
-		decoder->SetVolume(volume);
-	}
-}
-
-void GenericAudio::BgmChannel::SetPitch(int pitch) {
-	if (midi_out_used) {
-		instance->midi_thread->GetMidiOut().SetPitch(pitch);
-	} else if (decoder) {
-		decoder->SetPitch(pitch);
-	}
-}
-
-bool GenericAudio::BgmChannel::IsUsed() const {
-	return decoder || midi_out_used;
-}
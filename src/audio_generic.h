@@ -22,6 +22,8 @@
 #include "audio_secache.h"
 #include "audio_decoder_base.h"
 #include "audio_generic_midiout.h"
+#include "spsc_queue.h"
+#include <atomic>
 #include <memory>
 
 /**
@@ -37,6 +39,11 @@
  * 4. Implement LockMutex and UnlockMutex. Locking and Unlocking when
  *    calling Decode must be done manually.
  * 5. Implement update function (optional)
+ *
+ * The BGM and SE functions send commands through a lock-free queue to
+ * Decode which owns all channel state. The mutex is only taken when the
+ * queue is full. Replaced BGM decoders are handed back through a second
+ * queue and destroyed by Update on the game thread.
  */
 class GenericAudio : public AudioInterface {
 public:
@@ -58,6 +65,7 @@ public:
 	void SE_Play(std::unique_ptr<AudioSeCache> se, int volume, int pitch) override;
 	void SE_Stop() override;
 	virtual void Update() override;
+	void Flush() override;
 
 	void vGetConfig(Game_ConfigAudio&) const override {}
 
@@ -70,26 +78,11 @@ public:
 
 private:
 	struct BgmChannel {
-		int id;
 		std::unique_ptr<AudioDecoderBase> decoder;
-		GenericAudio* instance = nullptr;
-		bool paused;
-		bool stopped;
-		bool midi_out_used = false;
-		void Stop();
-		void SetPaused(bool newPaused);
-		int GetTicks() const;
-		void SetFade(int fade);
-		void SetVolume(int volume);
-		void SetPitch(int pitch);
-		bool IsUsed() const;
+		bool paused = false;
 	};
 	struct SeChannel {
-		int id;
 		std::unique_ptr<AudioDecoderBase> decoder;
-		GenericAudio* instance = nullptr;
-		bool paused;
-		bool stopped;
 	};
 	struct Format {
 		int frequency;
@@ -98,16 +91,66 @@ private:
 	};
 	Format output_format = {};
 
-	bool PlayOnChannel(BgmChannel& chan, Filesystem_Stream::InputStream stream, int volume, int pitch, int fadein);
-	bool PlayOnChannel(SeChannel& chan, std::unique_ptr<AudioSeCache> se, int volume, int pitch);
+	/** Sent from the game thread to Decode */
+	struct Command {
+		enum class Type {
+			BgmPlay,
+			BgmStop,
+			BgmPause,
+			BgmResume,
+			BgmFade,
+			BgmVolume,
+			BgmPitch,
+			SePlay,
+			SeStop
+		};
+		Type type = Type::BgmStop;
+		/** Serial for BgmPlay and BgmStop, otherwise the argument */
+		int value = 0;
+		std::unique_ptr<AudioDecoderBase> decoder;
+	};
+
+	/**
+	 * Queues a command for the audio thread.
+	 * When the queue is full the mutex is taken and the commands are
+	 * executed directly.
+	 */
+	void SendCommand(Command cmd);
+
+	/** Executes all queued commands, called with the mutex held */
+	void ProcessCommands();
+	void ExecuteCommand(Command& cmd);
+
+	/**
+	 * Hands a BGM decoder that is not used anymore back to the game thread.
+	 * Called with the mutex held.
+	 */
+	void RetireDecoder(std::unique_ptr<AudioDecoderBase> decoder);
+
+	/** Destroys the retired decoders, called by the game thread */
+	void DestroyRetiredDecoders();
+
+	void StopMidiOut();
 
 	static constexpr unsigned nr_of_se_channels = 31;
-	static constexpr unsigned nr_of_bgm_channels = 2;
 
-	BgmChannel BGM_Channels[nr_of_bgm_channels];
+	// Owned by the audio thread
+	BgmChannel BGM_Channel;
 	SeChannel SE_Channels[nr_of_se_channels];
-	mutable bool BGM_PlayedOnceIndicator;
-	bool Muted;
+	SpscQueue<Command, 256> commands;
+	SpscQueue<std::unique_ptr<AudioDecoderBase>, 16> retired_decoders;
+
+	// Owned by the game thread
+	bool bgm_playing = false;
+	bool bgm_midi_out_used = false;
+	std::string bgm_type;
+	int bgm_serial = 0;
+
+	// Written by the audio thread for the BGM of bgm_processed_serial
+	std::atomic<int> bgm_processed_serial = { 0 };
+	std::atomic<int> bgm_ticks = { 0 };
+	std::atomic<bool> bgm_played_once = { false };
+	std::atomic<int> se_dropped = { 0 };
 
 	std::vector<int16_t> sample_buffer = {};
 	std::vector<uint8_t> scrap_buffer = {};
@@ -17,6 +17,7 @@
 
 // Headers
 #include "audio_midi.h"
+#include "audio_decode_ahead.h"
 #include "audio_decoder_midi.h"
 #include "decoder_fluidsynth.h"
 #include "decoder_fmmidi.h"
@@ -127,6 +128,9 @@ std::unique_ptr<AudioDecoderBase> MidiDecoder::CreateFmMidi(bool resample) {
 }
 
 void MidiDecoder::Reset() {
+	// Decoders released by the audio thread still use the synthesizers
+	AudioDecodeAhead::ReleaseDecoders();
+
 	works.fluidsynth = true;
 	works.wildmidi = true;
 
@@ -0,0 +1,303 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "audio_mixer.h"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define EP_AUDIO_MIXER_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  include <arm_neon.h>
+#  define EP_AUDIO_MIXER_NEON
+#endif
+
+namespace {
+	using Format = AudioDecoderBase::Format;
+
+	constexpr float threshold = 0.8f;
+
+	// Source samples in the range of an int32, unsigned formats are shifted to signed
+	inline float ToFloat(int8_t s) { return s; }
+	inline float ToFloat(uint8_t s) { return static_cast<int8_t>(s ^ 0x80); }
+	inline float ToFloat(int16_t s) { return s; }
+	inline float ToFloat(uint16_t s) { return static_cast<int16_t>(s ^ 0x8000); }
+	inline float ToFloat(int32_t s) { return static_cast<float>(s); }
+	inline float ToFloat(uint32_t s) { return static_cast<float>(static_cast<int32_t>(s ^ 0x80000000u)); }
+	inline float ToFloat(float s) { return s; }
+
+	template <typename T>
+	constexpr float Scale() {
+		return std::is_same<T, float>::value ? 1.0f : 1.0f / (1ull << (sizeof(T) * 8 - 1));
+	}
+
+#if defined(EP_AUDIO_MIXER_SSE2)
+#  define EP_AUDIO_MIXER_SIMD
+	using vfloat = __m128;
+
+	inline vfloat VSet(float f) { return _mm_set1_ps(f); }
+	inline vfloat VLoad(const float* p) { return _mm_loadu_ps(p); }
+	inline void VStore(float* p, vfloat v) { _mm_storeu_ps(p, v); }
+	inline vfloat VMulAdd(vfloat acc, vfloat a, vfloat b) { return _mm_add_ps(acc, _mm_mul_ps(a, b)); }
+	inline vfloat VAdd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+	inline void VDup(vfloat v, vfloat& lo, vfloat& hi) { lo = _mm_unpacklo_ps(v, v); hi = _mm_unpackhi_ps(v, v); }
+
+	// Converts 8 samples to float without scaling
+	inline void Load8(const int8_t* p, vfloat& lo, vfloat& hi) {
+		__m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+		v = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+		lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+		hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+	}
+	inline void Load8(const uint8_t* p, vfloat& lo, vfloat& hi) {
+		__m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+		v = _mm_xor_si128(v, _mm_set1_epi8(static_cast<char>(0x80)));
+		v = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+		lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+		hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+	}
+	inline void Load8(const int16_t* p, vfloat& lo, vfloat& hi) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+		hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+	}
+	inline void Load8(const uint16_t* p, vfloat& lo, vfloat& hi) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		v = _mm_xor_si128(v, _mm_set1_epi16(static_cast<short>(0x8000)));
+		lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+		hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+	}
+	inline void Load8(const int32_t* p, vfloat& lo, vfloat& hi) {
+		lo = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+		hi = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 4)));
+	}
+	inline void Load8(const uint32_t* p, vfloat& lo, vfloat& hi) {
+		const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+		lo = _mm_cvtepi32_ps(_mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), bias));
+		hi = _mm_cvtepi32_ps(_mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 4)), bias));
+	}
+	inline void Load8(const float* p, vfloat& lo, vfloat& hi) {
+		lo = _mm_loadu_ps(p);
+		hi = _mm_loadu_ps(p + 4);
+	}
+
+	// Compresses 8 samples and converts them to S16 with saturation
+	inline void Limit8(int16_t* dst, const float* src, vfloat t, vfloat factor, bool compress) {
+		const vfloat sign_mask = _mm_set1_ps(-0.0f);
+		const vfloat max = _mm_set1_ps(32767.0f);
+		const vfloat min = _mm_set1_ps(-32768.0f);
+		const vfloat scale = _mm_set1_ps(32768.0f);
+		__m128i out[2];
+
+		for (int i = 0; i < 2; ++i) {
+			vfloat s = _mm_loadu_ps(src + i * 4);
+			if (compress) {
+				vfloat sign = _mm_and_ps(s, sign_mask);
+				vfloat a = _mm_andnot_ps(sign_mask, s);
+				vfloat c = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(a, t), factor));
+				vfloat over = _mm_cmpgt_ps(a, t);
+				a = _mm_or_ps(_mm_and_ps(over, c), _mm_andnot_ps(over, a));
+				s = _mm_or_ps(a, sign);
+			}
+			s = _mm_min_ps(_mm_max_ps(_mm_mul_ps(s, scale), min), max);
+			out[i] = _mm_cvttps_epi32(s);
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packs_epi32(out[0], out[1]));
+	}
+#elif defined(EP_AUDIO_MIXER_NEON)
+#  define EP_AUDIO_MIXER_SIMD
+	using vfloat = float32x4_t;
+
+	inline vfloat VSet(float f) { return vdupq_n_f32(f); }
+	inline vfloat VLoad(const float* p) { return vld1q_f32(p); }
+	inline void VStore(float* p, vfloat v) { vst1q_f32(p, v); }
+	inline vfloat VMulAdd(vfloat acc, vfloat a, vfloat b) { return vaddq_f32(acc, vmulq_f32(a, b)); }
+	inline vfloat VAdd(vfloat a, vfloat b) { return vaddq_f32(a, b); }
+	inline void VDup(vfloat v, vfloat& lo, vfloat& hi) { auto z = vzipq_f32(v, v); lo = z.val[0]; hi = z.val[1]; }
+
+	// Converts 8 samples to float without scaling
+	inline void Load8(int16x8_t v, vfloat& lo, vfloat& hi) {
+		lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+		hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+	}
+	inline void Load8(const int8_t* p, vfloat& lo, vfloat& hi) {
+		Load8(vmovl_s8(vld1_s8(p)), lo, hi);
+	}
+	inline void Load8(const uint8_t* p, vfloat& lo, vfloat& hi) {
+		Load8(vmovl_s8(vreinterpret_s8_u8(veor_u8(vld1_u8(p), vdup_n_u8(0x80)))), lo, hi);
+	}
+	inline void Load8(const int16_t* p, vfloat& lo, vfloat& hi) {
+		Load8(vld1q_s16(p), lo, hi);
+	}
+	inline void Load8(const uint16_t* p, vfloat& lo, vfloat& hi) {
+		Load8(vreinterpretq_s16_u16(veorq_u16(vld1q_u16(p), vdupq_n_u16(0x8000))), lo, hi);
+	}
+	inline void Load8(const int32_t* p, vfloat& lo, vfloat& hi) {
+		lo = vcvtq_f32_s32(vld1q_s32(p));
+		hi = vcvtq_f32_s32(vld1q_s32(p + 4));
+	}
+	inline void Load8(const uint32_t* p, vfloat& lo, vfloat& hi) {
+		const uint32x4_t bias = vdupq_n_u32(0x80000000u);
+		lo = vcvtq_f32_s32(vreinterpretq_s32_u32(veorq_u32(vld1q_u32(p), bias)));
+		hi = vcvtq_f32_s32(vreinterpretq_s32_u32(veorq_u32(vld1q_u32(p + 4), bias)));
+	}
+	inline void Load8(const float* p, vfloat& lo, vfloat& hi) {
+		lo = vld1q_f32(p);
+		hi = vld1q_f32(p + 4);
+	}
+
+	// Compresses 8 samples and converts them to S16 with saturation
+	inline void Limit8(int16_t* dst, const float* src, vfloat t, vfloat factor, bool compress) {
+		const uint32x4_t sign_mask = vdupq_n_u32(0x80000000u);
+		const vfloat max = vdupq_n_f32(32767.0f);
+		const vfloat min = vdupq_n_f32(-32768.0f);
+		int16x4_t out[2];
+
+		for (int i = 0; i < 2; ++i) {
+			vfloat s = vld1q_f32(src + i * 4);
+			if (compress) {
+				uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(s), sign_mask);
+				vfloat a = vabsq_f32(s);
+				vfloat c = vaddq_f32(t, vmulq_f32(vsubq_f32(a, t), factor));
+				a = vbslq_f32(vcgtq_f32(a, t), c, a);
+				s = vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), sign));
+			}
+			s = vminq_f32(vmaxq_f32(vmulq_n_f32(s, 32768.0f), min), max);
+			out[i] = vqmovn_s32(vcvtq_s32_f32(s));
+		}
+		vst1q_s16(dst, vcombine_s16(out[0], out[1]));
+	}
+#endif
+
+	template <typename T>
+	void MixSamples(float* dst, const T* src, int samples, float volume) {
+		const float factor = Scale<T>() * volume;
+		int i = 0;
+#ifdef EP_AUDIO_MIXER_SIMD
+		const vfloat vfactor = VSet(factor);
+		for (; i + 8 <= samples; i += 8) {
+			vfloat lo, hi;
+			Load8(src + i, lo, hi);
+			VStore(dst + i, VMulAdd(VLoad(dst + i), lo, vfactor));
+			VStore(dst + i + 4, VMulAdd(VLoad(dst + i + 4), hi, vfactor));
+		}
+#endif
+		for (; i < samples; ++i) {
+			dst[i] += ToFloat(src[i]) * factor;
+		}
+	}
+
+	template <typename T>
+	void MixFrames(float* dst, const T* src, int frames, int channels, float volume) {
+		if (channels == 2) {
+			MixSamples(dst, src, frames * 2, volume);
+			return;
+		}
+
+		const float factor = Scale<T>() * volume;
+
+		if (channels > 2) {
+			for (int i = 0; i < frames; ++i) {
+				dst[i * 2] += ToFloat(src[i * channels]) * factor;
+				dst[i * 2 + 1] += ToFloat(src[i * channels + 1]) * factor;
+			}
+			return;
+		}
+
+		// Mono: Convert in blocks and add each sample to both channels
+		constexpr int block_size = 256;
+		float block[block_size];
+		for (int i = 0; i < frames; i += block_size) {
+			const int n = std::min(block_size, frames - i);
+			std::fill(block, block + n, 0.0f);
+			MixSamples(block, src + i, n, volume);
+			float* out = dst + i * 2;
+			int j = 0;
+#ifdef EP_AUDIO_MIXER_SIMD
+			for (; j + 4 <= n; j += 4) {
+				vfloat lo, hi;
+				VDup(VLoad(block + j), lo, hi);
+				VStore(out + j * 2, VAdd(VLoad(out + j * 2), lo));
+				VStore(out + j * 2 + 4, VAdd(VLoad(out + j * 2 + 4), hi));
+			}
+#endif
+			for (; j < n; ++j) {
+				out[j * 2] += block[j];
+				out[j * 2 + 1] += block[j];
+			}
+		}
+	}
+}
+
+void AudioMixer::Mix(float* dst, const uint8_t* src, int frames, AudioDecoderBase::Format format, int channels, float volume) {
+	if (frames <= 0 || channels <= 0) {
+		return;
+	}
+
+	switch (format) {
+		case Format::S8:
+			MixFrames(dst, reinterpret_cast<const int8_t*>(src), frames, channels, volume);
+			break;
+		case Format::U8:
+			MixFrames(dst, reinterpret_cast<const uint8_t*>(src), frames, channels, volume);
+			break;
+		case Format::S16:
+			MixFrames(dst, reinterpret_cast<const int16_t*>(src), frames, channels, volume);
+			break;
+		case Format::U16:
+			MixFrames(dst, reinterpret_cast<const uint16_t*>(src), frames, channels, volume);
+			break;
+		case Format::S32:
+			MixFrames(dst, reinterpret_cast<const int32_t*>(src), frames, channels, volume);
+			break;
+		case Format::U32:
+			MixFrames(dst, reinterpret_cast<const uint32_t*>(src), frames, channels, volume);
+			break;
+		case Format::F32:
+			MixFrames(dst, reinterpret_cast<const float*>(src), frames, channels, volume);
+			break;
+	}
+}
+
+void AudioMixer::Limit(int16_t* dst, const float* src, int samples, float total_volume) {
+	// Samples above the threshold are scaled so that total_volume maps to 1.0
+	const bool compress = total_volume > 1.0f;
+	const float factor = compress ? (1.0f - threshold) / (total_volume - threshold) : 1.0f;
+
+	int i = 0;
+#ifdef EP_AUDIO_MIXER_SIMD
+	const vfloat vthreshold = VSet(threshold);
+	const vfloat vfactor = VSet(factor);
+	for (; i + 8 <= samples; i += 8) {
+		Limit8(dst + i, src + i, vthreshold, vfactor, compress);
+	}
+#endif
+	for (; i < samples; ++i) {
+		float s = src[i];
+		if (compress) {
+			float a = std::fabs(s);
+			if (a > threshold) {
+				a = threshold + (a - threshold) * factor;
+			}
+			s = std::copysign(a, s);
+		}
+		s = std::min(std::max(s * 32768.0f, -32768.0f), 32767.0f);
+		dst[i] = static_cast<int16_t>(static_cast<int32_t>(s));
+	}
+}
@@ -0,0 +1,60 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_AUDIO_MIXER_H
+#define EP_AUDIO_MIXER_H
+
+#include <cstdint>
+#include "audio_decoder_base.h"
+
+/**
+ * Sample conversion and mixing kernels used by GenericAudio.
+ *
+ * The kernels process blocks of samples with SSE2 or NEON when the target
+ * supports them and use a scalar loop otherwise. All paths produce the
+ * same result.
+ */
+namespace AudioMixer {
+	/**
+	 * Converts samples to float, scales them by volume and adds them to a
+	 * stereo float buffer.
+	 * Mono sources are added to both output channels, sources with more than
+	 * two channels contribute their first two channels.
+	 *
+	 * @param dst interleaved stereo buffer with at least frames * 2 samples
+	 * @param src interleaved source samples
+	 * @param frames number of frames in src
+	 * @param format sample format of src
+	 * @param channels number of channels of src
+	 * @param volume scale factor (1.0 is unchanged)
+	 */
+	void Mix(float* dst, const uint8_t* src, int frames, AudioDecoderBase::Format format, int channels, float volume);
+
+	/**
+	 * Converts the mixed float samples to S16.
+	 * When the summed volume of all channels exceeds 1.0 the samples above
+	 * a threshold are compressed to reduce clipping.
+	 *
+	 * @param dst output buffer
+	 * @param src mixed samples
+	 * @param samples number of samples
+	 * @param total_volume sum of the volumes of all mixed channels
+	 */
+	void Limit(int16_t* dst, const float* src, int samples, float total_volume);
+}
+
+#endif
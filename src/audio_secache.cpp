@@ -16,64 +16,163 @@
  */
 
 // Headers
+#include <atomic>
 #include <cassert>
 #include <cstring>
-#include <map>
+#include <list>
 #include <memory>
-#include <set>
+#include <unordered_map>
 #include "audio_resampler.h"
 #include "audio_secache.h"
-#include "game_clock.h"
 #include "filefinder.h"
 #include "output.h"
 
-using namespace std::chrono_literals;
-
 namespace {
-	typedef std::map<std::string, AudioSeRef> cache_type;
-
-	cache_type cache;
-
-	constexpr int cache_limit = 3 * 1024 * 1024;
-	int cache_size = 0;
+	struct CacheItem {
+		std::string key;
+		AudioSeRef se;
+	};
+
+	// Most recently used item first
+	using lru_type = std::list<CacheItem>;
+
+	lru_type lru;
+	std::unordered_map<std::string, lru_type::iterator> cache;
+
+	size_t cache_budget = 8 * 1024 * 1024;
+	size_t cache_size = 0;
+
+	/** Converted sample recorded by an AudioSeRecorder while it is played */
+	struct PendingSe {
+		AudioSeData data;
+		/** Set by the audio thread once the whole sample was recorded */
+		std::atomic<bool> complete = { false };
+	};
+
+	// Conversions that are played for the first time
+	std::unordered_map<std::string, std::shared_ptr<PendingSe>> pending;
+
+	// Converted samples are stored next to the decoded sample. The newline
+	// cannot be part of a filename so the keys never collide.
+	std::string GetVariantKey(StringView name, int frequency, AudioDecoder::Format format, int channels, int pitch) {
+		return fmt::format("{}\n{}:{}:{}:{}", name, frequency, static_cast<int>(format), channels, pitch);
+	}
 
 	void FreeCacheMemory() {
-		auto cur_time = Game_Clock::GetFrameTime();
-
-		for (auto it = cache.begin(); it != cache.end(); ) {
-			if (it->second.use_count() > 1) {
-				// SE is currently playing
-				++it;
-				continue;
-			}
-
-			if (cache_size <= cache_limit && cur_time - it->second->last_access < 3s) {
-				// Below memory limit and last access < 3s
-				++it;
+		// Every item is looked at once at most. Playing SE cannot be freed
+		// and are moved to the front because they are in use.
+		for (size_t n = lru.size(); n > 0 && cache_size > cache_budget; --n) {
+			auto it = std::prev(lru.end());
+			if (it->se.use_count() > 1) {
+				lru.splice(lru.begin(), lru, it);
 				continue;
 			}
 
 #ifdef CACHE_DEBUG
-			Output::Debug("SE: Freeing memory of {}", it->first);
+			Output::Debug("SE: Freeing memory of {}", it->key);
 #endif
 
-			cache_size -= it->second->buffer.size();
-
-			it = cache.erase(it);
+			cache_size -= it->se->buffer.size();
+			cache.erase(it->key);
+			lru.erase(it);
 		}
 
 #ifdef CACHE_DEBUG
 		Output::Debug("SE cache size: {}", cache_size / 1024.0 / 1024);
 #endif
 	}
+
+	AudioSeRef FindInCache(const std::string& key) {
+		auto it = cache.find(key);
+		if (it == cache.end()) {
+			return nullptr;
+		}
+
+		lru.splice(lru.begin(), lru, it->second);
+		return it->second->se;
+	}
+
+	void AddToCache(const std::string& key, AudioSeRef se) {
+		lru.push_front({key, se});
+		cache[key] = lru.begin();
+		cache_size += se->buffer.size();
+
+#ifdef CACHE_DEBUG
+		Output::Debug("SE cache size (Add): {}", cache_size / 1024.0 / 1024.0);
+#endif
+
+		FreeCacheMemory();
+	}
+
+	std::unique_ptr<AudioDecoderBase> CreateDecoder(AudioSeRef se) {
+		std::unique_ptr<AudioDecoderBase> dec = std::make_unique<AudioSeDecoder>(std::move(se));
+		Filesystem_Stream::InputStream is;
+		dec->Open(std::move(is));
+		return dec;
+	}
+
+	/**
+	 * Plays a converting decoder and records its output. The recording is
+	 * moved into the cache by the game thread once it is complete, so the
+	 * conversion runs on the audio thread and only once.
+	 */
+	class AudioSeRecorder final : public AudioDecoder {
+	public:
+		AudioSeRecorder(std::unique_ptr<AudioDecoderBase> dec, std::shared_ptr<PendingSe> recording) :
+			dec(std::move(dec)), recording(std::move(recording)) {
+		}
+
+		bool Open(Filesystem_Stream::InputStream) override { return true; };
+		bool IsFinished() const override { return dec->IsFinished(); }
+		void GetFormat(int& frequency, Format& format, int& channels) const override {
+			dec->GetFormat(frequency, format, channels);
+		}
+		int GetPitch() const override { return dec->GetPitch(); }
+		bool Seek(std::streamoff, std::ios_base::seekdir) override { return false; }
+		int GetTicks() const override { return 0; }
+
+	private:
+		int FillBuffer(uint8_t* buffer, int size) override {
+			int res = dec->Decode(buffer, size);
+			if (recording && res > 0) {
+				auto& data = recording->data.buffer;
+				data.insert(data.end(), buffer, buffer + res);
+			}
+
+			if (recording && res >= 0 && dec->IsFinished()) {
+				recording->complete.store(true, std::memory_order_release);
+				recording.reset();
+			}
+			return res;
+		}
+
+		std::unique_ptr<AudioDecoderBase> dec;
+		std::shared_ptr<PendingSe> recording;
+	};
+
+	/**
+	 * Moves complete recordings into the cache and drops the recordings
+	 * of decoders that were stopped before the end.
+	 */
+	void CollectPending() {
+		for (auto it = pending.begin(); it != pending.end();) {
+			auto& recording = it->second;
+			if (recording->complete.load(std::memory_order_acquire)) {
+				AddToCache(it->first, std::make_shared<AudioSeData>(std::move(recording->data)));
+			} else if (recording.use_count() > 1) {
+				++it;
+				continue;
+			}
+			it = pending.erase(it);
+		}
+	}
 }
 
 std::unique_ptr<AudioSeCache> AudioSeCache::Create(Filesystem_Stream::InputStream stream, StringView name) {
 	auto se = std::make_unique<AudioSeCache>();
 	se->name = ToString(name);
 
-	auto const it = cache.find(ToString(name));
-	if (it == cache.end()) {
+	if (cache.find(se->name) == cache.end()) {
 		// Not in cache
 		if (!stream) {
 			return {};
@@ -120,12 +219,13 @@ std::unique_ptr<AudioSeCache> AudioSeCache::GetCachedSe(StringView name) {
 }
 
 bool AudioSeCache::GetCachedFormat(int& frequency, AudioDecoder::Format& format, int& channels) const {
-	cache_type::const_iterator it = cache.find(name);
+	auto it = cache.find(name);
 
 	if (it != cache.end()) {
-		frequency = (*it).second->frequency;
-		format = (*it).second->format;
-		channels = (*it).second->channels;
+		const auto& se = it->second->se;
+		frequency = se->frequency;
+		format = se->format;
+		channels = se->channels;
 
 		return true;
 	}
@@ -134,71 +234,111 @@ bool AudioSeCache::GetCachedFormat(int& frequency, AudioDecoder::Format& format,
 }
 
 std::unique_ptr<AudioDecoderBase> AudioSeCache::CreateSeDecoder() {
-	AudioSeRef se;
-
-	auto it = cache.find(name);
-	if (it != cache.end()) {
-		se = it->second;
-		se->last_access = Game_Clock::GetFrameTime();
-
-		std::unique_ptr<AudioDecoderBase> dec = std::make_unique<AudioSeDecoder>(se);
+	std::unique_ptr<AudioDecoderBase> dec = CreateDecoder(LoadSeData());
 #ifdef USE_AUDIO_RESAMPLER
-		dec = std::make_unique<AudioResampler>(std::move(dec));
+	dec = std::make_unique<AudioResampler>(std::move(dec));
+	Filesystem_Stream::InputStream is;
+	dec->Open(std::move(is));
 #endif
-		Filesystem_Stream::InputStream is;
-		dec->Open(std::move(is));
+	return dec;
+}
+
+std::unique_ptr<AudioDecoderBase> AudioSeCache::CreateSeDecoder(int frequency, AudioDecoder::Format format, int channels, int pitch) {
+#ifdef USE_AUDIO_RESAMPLER
+	const auto key = GetVariantKey(name, frequency, format, channels, pitch);
+
+	CollectPending();
+
+	AudioSeRef se = FindInCache(key);
+	if (se) {
+		return CreateDecoder(std::move(se));
+	}
+
+	// Not converted yet: Resample while playing
+	AudioSeRef source = LoadSeData();
+	std::unique_ptr<AudioDecoderBase> dec = std::make_unique<AudioResampler>(CreateDecoder(source));
+	Filesystem_Stream::InputStream is;
+	dec->Open(std::move(is));
+	dec->SetPitch(pitch);
+	dec->SetFormat(frequency, format, channels);
+
+	if (pending.find(key) != pending.end()) {
+		// The first play is still recording
 		return dec;
 	}
 
-	// Not cached yet: Decode the sample without any resampling
+	auto recording = std::make_shared<PendingSe>();
+	auto& data = recording->data;
+	// The resampler reports the closest format it supports
+	dec->GetFormat(data.frequency, data.format, data.channels);
+
+	// Reserve the converted size, the audio thread should not reallocate while recording
+	const int source_frame_size = AudioDecoder::GetSamplesizeForFormat(source->format) * source->channels;
+	if (source_frame_size > 0 && source->frequency > 0 && pitch > 0) {
+		const double source_frames = static_cast<double>(source->buffer.size() / source_frame_size);
+		const auto frames = static_cast<size_t>(source_frames * data.frequency / source->frequency * 100 / pitch);
+		data.buffer.reserve((frames + 1024) * AudioDecoder::GetSamplesizeForFormat(data.format) * data.channels);
+	}
+
+	pending[key] = recording;
 
-	if (!se) {
-		se.reset(new AudioSeData());
+	return std::make_unique<AudioSeRecorder>(std::move(dec), std::move(recording));
+#else
+	auto dec = CreateSeDecoder();
+	dec->SetPitch(pitch);
+	dec->SetFormat(frequency, format, channels);
+	return dec;
+#endif
+}
+
+AudioSeRef AudioSeCache::LoadSeData() {
+	AudioSeRef se = FindInCache(name);
+	if (se) {
+		return se;
 	}
 
+	// Not cached yet: Decode the sample without any resampling
+	se = std::make_shared<AudioSeData>();
+
 	assert(audio_decoder);
 
 	audio_decoder->GetFormat(se->frequency, se->format, se->channels);
 	se->buffer = audio_decoder->DecodeAll();
 
-	cache.insert(std::make_pair(name, se));
-
-	cache_size += se->buffer.size();
+	AddToCache(name, se);
 
-#ifdef CACHE_DEBUG
-	Output::Debug("SE cache size (Add): {}", cache_size / 1024.0 / 1024.0);
-#endif
-
-	FreeCacheMemory();
-
-	std::unique_ptr<AudioDecoderBase> dec = std::unique_ptr<AudioDecoderBase>(new AudioSeDecoder(se));
-#ifdef USE_AUDIO_RESAMPLER
-	dec = std::unique_ptr<AudioDecoderBase>(new AudioResampler(std::move(dec)));
-#endif
-	Filesystem_Stream::InputStream is;
-	dec->Open(std::move(is));
-	return dec;
+	return se;
 }
 
 AudioSeRef AudioSeCache::GetSeData() const {
 	auto it = cache.find(name);
 	assert(it != cache.end());
 
-	return it->second;
+	return it->second->se;
 };
 
 void AudioSeCache::Clear() {
 	cache_size = 0;
 	cache.clear();
+	lru.clear();
+	pending.clear();
+}
+
+void AudioSeCache::SetBudget(size_t bytes) {
+	cache_budget = bytes;
+	FreeCacheMemory();
+}
+
+size_t AudioSeCache::GetBudget() {
+	return cache_budget;
 }
 
 StringView AudioSeCache::GetName() const {
 	return name;
 }
 
-AudioSeDecoder::AudioSeDecoder(const AudioSeRef& se) :
-	se(se) {
-	se->last_access = Game_Clock::GetFrameTime();
+AudioSeDecoder::AudioSeDecoder(AudioSeRef se) :
+	se(std::move(se)) {
 }
 
 bool AudioSeDecoder::IsFinished() const {
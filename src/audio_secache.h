@@ -36,7 +36,6 @@ class AudioSeCache;
 class AudioSeData {
 public:
 	std::vector<uint8_t> buffer;
-	Game_Clock::time_point last_access;
 	int frequency;
 	AudioDecoder::Format format;
 	int channels;
@@ -50,7 +49,7 @@ typedef std::shared_ptr<AudioSeData> AudioSeRef;
  */
 class AudioSeDecoder : public AudioDecoder {
 public:
-	explicit AudioSeDecoder(const AudioSeRef& se);
+	explicit AudioSeDecoder(AudioSeRef se);
 
 	bool Open(Filesystem_Stream::InputStream) override { return true; };
 	bool IsFinished() const override;
@@ -69,9 +68,10 @@ private:
 /**
  * AudioSeCache provides an interface for accessing sound effects.
  * It also provides an automatic cache management, any SE is only decoded
- * once, otherwise returned from the cache.
- * The cache is flushed from recently (>10 seconds by default) unused
- * samples when it reaches the memory limit (5 MB by default).
+ * once, otherwise returned from the cache. Samples converted to an output
+ * format and pitch are cached as well after their first play.
+ * The least recently used samples that are not playing are freed when the
+ * cache exceeds its memory budget (8 MB by default).
  * Uses an internal AudioDecoder for handling the decoding.
  */
 class AudioSeCache {
@@ -125,6 +125,22 @@ public:
 	 */
 	std::unique_ptr<AudioDecoderBase> CreateSeDecoder();
 
+	/**
+	 * Returns a decoder which delivers the sample converted to the
+	 * requested format and pitch. The first play converts while playing
+	 * and records the result. Once it played to the end, further calls with
+	 * the same arguments only copy the cached samples.
+	 * When the format is not supported the closest format is used, query it
+	 * with GetFormat of the decoder.
+	 *
+	 * @param frequency output frequency
+	 * @param format output format
+	 * @param channels output channels
+	 * @param pitch pitch (100 is normal pitch)
+	 * @return Converted sound effect
+	 */
+	std::unique_ptr<AudioDecoderBase> CreateSeDecoder(int frequency, AudioDecoder::Format format, int channels, int pitch);
+
 	/**
 	 * Returns the SE sample data handled by this SeCache.
 	 *
@@ -138,7 +154,24 @@ public:
 	StringView GetName() const;
 
 	static void Clear();
+
+	/**
+	 * Sets the memory budget of the SE cache.
+	 *
+	 * @param bytes budget in bytes
+	 */
+	static void SetBudget(size_t bytes);
+
+	/** @return memory budget of the SE cache in bytes */
+	static size_t GetBudget();
 private:
+	/**
+	 * Decodes the whole sample without doing any resampling and caches it.
+	 *
+	 * @return decoded sample
+	 */
+	AudioSeRef LoadSeData();
+
 	std::unique_ptr<AudioDecoderBase> audio_decoder;
 
 	std::string name;
@@ -22,6 +22,7 @@
 #include "cache.h"
 #include "background.h"
 #include "bitmap.h"
+#include "damage_tracker.h"
 #include "main_data.h"
 #include <lcf/reader_util.h>
 #include "output.h"
@@ -144,3 +145,17 @@ void Background::Draw(Bitmap& dst) {
 		dst.ToneBlit(0, 0, dst, dst.GetRect(), tone_effect, Opacity::Opaque());
 	}
 }
+
+bool Background::GetDamageState(DamageState& state) const {
+	if (tone_effect != Tone()) {
+		// The tone is applied in place to the whole screen
+		return false;
+	}
+
+	state.bounds = Rect(0, 0, Player::screen_width, Player::screen_height);
+	state.Hash(bg_bitmap.get(), bg_bitmap ? bg_bitmap->GetGeneration() : 0u,
+		fg_bitmap.get(), fg_bitmap ? fg_bitmap->GetGeneration() : 0u,
+		Scale(bg_x), Scale(bg_y), Scale(fg_x), Scale(fg_y),
+		Main_Data::game_screen->GetShakeOffsetX(), Main_Data::game_screen->GetShakeOffsetY());
+	return true;
+}
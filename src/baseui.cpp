@@ -33,10 +33,15 @@
 #elif defined(__SWITCH__)
 #  include "platform/switch/ui.h"
 #endif
+#include "platform/headless/ui.h"
 
 std::shared_ptr<BaseUi> DisplayUi;
 
 std::shared_ptr<BaseUi> BaseUi::CreateUi(long width, long height, const Game_Config& cfg) {
+	if (Player::headless_flag) {
+		return std::make_shared<HeadlessUi>(width, height, cfg);
+	}
+
 #if USE_SDL==2
 	return std::make_shared<Sdl2Ui>(width, height, cfg);
 #elif USE_SDL==1
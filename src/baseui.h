@@ -202,6 +202,18 @@ public:
 	/** Toggle wheter we should show fps on the titlebar */
 	void ToggleShowFpsOnTitle();
 
+	/** @return true if only changed screen areas should be redrawn */
+	bool IsDamageTracking() const;
+
+	/** Toggle whether only changed screen areas are redrawn */
+	void ToggleDamageTracking();
+
+	/** @return true if the map tone is applied once to the whole screen */
+	bool IsScreenTonePass() const;
+
+	/** Toggle whether the map tone is applied once to the whole screen */
+	void ToggleScreenTonePass();
+
 	/**
 	 * @return the minimum amount of time each physical frame should take.
 	 * If the UI manages time (i.e.) vsync, will return a 0 duration.
@@ -385,6 +397,22 @@ inline void BaseUi::ToggleShowFpsOnTitle() {
 	vcfg.fps_render_window.Toggle();
 }
 
+inline bool BaseUi::IsDamageTracking() const {
+	return vcfg.damage_tracking.Get();
+}
+
+inline void BaseUi::ToggleDamageTracking() {
+	vcfg.damage_tracking.Toggle();
+}
+
+inline bool BaseUi::IsScreenTonePass() const {
+	return vcfg.screen_tone_pass.Get();
+}
+
+inline void BaseUi::ToggleScreenTonePass() {
+	vcfg.screen_tone_pass.Toggle();
+}
+
 inline Game_Clock::duration BaseUi::GetFrameLimit() const {
 	return IsFrameRateSynchronized() ? Game_Clock::duration(0) : frame_limit;
 }
@@ -37,6 +37,8 @@
 BattleAnimation::BattleAnimation(const lcf::rpg::Animation& anim, bool only_sound, int cutoff) :
 	animation(anim), only_sound(only_sound)
 {
+	// Cells are positioned in Draw()
+	state_set_in_draw = true;
 	num_frames = GetRealFrames() * 2;
 	if (cutoff >= 0 && cutoff < num_frames) {
 		num_frames = cutoff;
@@ -234,6 +236,11 @@ BattleAnimationMap::BattleAnimationMap(const lcf::rpg::Animation& anim, Game_Cha
 {
 }
 
+bool BattleAnimation::GetDrawBounds(Rect&, bool&) const {
+	// The cells are drawn by changing the sprite state inside of Draw()
+	return false;
+}
+
 void BattleAnimationMap::Draw(Bitmap& dst) {
 	if (IsOnlySound()) {
 		return;
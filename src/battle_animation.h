@@ -37,6 +37,8 @@ public:
 	/** Update the animation to the next animation **/
 	void Update();
 
+	bool GetDrawBounds(Rect& bounds, bool& opaque) const override;
+
 	/** @return the current timing frame (2x the number of frames in the underlying animation **/
 	int GetFrame() const;
 
@@ -485,6 +485,15 @@ public:
 	 */
 	void ToneBlit(int x, int y, Bitmap const& src, Rect const& src_rect, const Tone &tone, Opacity const& opacity);
 
+	/**
+	 * Adjusts the tone of a region of this bitmap in place.
+	 * The alpha channel is not changed.
+	 *
+	 * @param dst_rect region to tone, clipped to the bitmap.
+	 * @param tone tone to apply.
+	 */
+	void ToneRect(Rect const& dst_rect, const Tone &tone);
+
 	/**
 	 * Blends bitmap with color.
 	 *
@@ -590,6 +599,27 @@ public:
 	ImageOpacity ComputeImageOpacity() const;
 	ImageOpacity ComputeImageOpacity(Rect rect) const;
 
+	/**
+	 * Gets a counter that is increased by every drawing operation that
+	 * changes the bitmap. Writes through pixels() are not counted.
+	 *
+	 * @return generation counter
+	 */
+	uint32_t GetGeneration() const;
+
+	/**
+	 * Restricts all following drawing operations to the given rectangles.
+	 * An empty list disables drawing entirely.
+	 *
+	 * @param rects clip rectangles
+	 */
+	void SetClipRects(const std::vector<Rect>& rects);
+
+	/**
+	 * Removes the clip set by SetClipRects.
+	 */
+	void ClearClipRects();
+
 protected:
 	DynamicFormat format;
 
@@ -633,7 +663,22 @@ protected:
 	 * @return blend mode
 	 */
 	pixman_op_t GetOperator(pixman_image_t* mask = nullptr, BlendMode blend_mode = BlendMode::Default) const;
+
+	/**
+	 * Applies a tone to a region of this bitmap in place, limited to the
+	 * clip set by SetClipRects.
+	 *
+	 * @param rect region to tone, clipped to the bitmap.
+	 * @param tone tone to apply.
+	 * @param opacity opacity of the pixels, see BitmapKernels::ApplyTone.
+	 */
+	void ApplyToneInPlace(Rect rect, const Tone& tone, ImageOpacity opacity);
+
 	bool read_only = false;
+	bool clipped = false;
+	/** Disjoint rectangles of the clip region, used by direct pixel writes */
+	std::vector<Rect> clip_rects;
+	uint32_t generation = 0;
 };
 
 inline ImageOpacity Bitmap::GetImageOpacity() const {
@@ -660,6 +705,10 @@ inline int Bitmap::GetHeight() const {
 	return height();
 }
 
+inline uint32_t Bitmap::GetGeneration() const {
+	return generation;
+}
+
 inline Rect Bitmap::GetRect() const {
 	return Rect(0, 0, width(), height());
 }
@@ -0,0 +1,552 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headers
+#include "bitmap_kernels.h"
+#include "bitmap_hslrgb.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define EP_BITMAP_KERNELS_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  include <arm_neon.h>
+#  define EP_BITMAP_KERNELS_NEON
+#endif
+
+namespace {
+	/**
+	 * Per byte parameters of color_tone for a block of 4 pixels.
+	 *
+	 * hard_light.table[i][j] equals (k * w) / 255 (clamped to 255) with
+	 * k = 2 * i and w = j for i <= 128. For i > 128 k = 2 * (255 - i) and
+	 * w and the result are inverted (255 - x, an XOR for bytes).
+	 * The alpha byte uses i = 128, which leaves it unchanged. Bytes without
+	 * a channel are cleared like color_tone does.
+	 */
+	struct ColorToneParams {
+		uint16_t k[16];
+		uint8_t flip[16];
+		uint8_t keep[16];
+		uint8_t alpha[16];
+	};
+
+	ColorToneParams MakeColorToneParams(const Tone& tone, int rs, int gs, int bs, int as) {
+		ColorToneParams params;
+		for (int i = 0; i < 16; ++i) {
+			const int shift = (i % 4) * 8;
+			int value = 128;
+			bool keep = true;
+			if (shift == rs) {
+				value = tone.red;
+			} else if (shift == gs) {
+				value = tone.green;
+			} else if (shift == bs) {
+				value = tone.blue;
+			} else if (shift != as) {
+				keep = false;
+			}
+			params.k[i] = static_cast<uint16_t>(value <= 128 ? 2 * value : 2 * (255 - value));
+			params.flip[i] = value <= 128 ? 0 : 0xFF;
+			params.keep[i] = keep ? 0xFF : 0;
+			params.alpha[i] = shift == as ? 0xFF : 0;
+		}
+		return params;
+	}
+
+#if defined(EP_BITMAP_KERNELS_SSE2)
+	// x / 255 for x <= 2 * 128 * 255, results above 255 are clamped by the caller
+	inline __m128i Div255(__m128i x) {
+		const __m128i one = _mm_set1_epi16(1);
+		return _mm_srli_epi16(_mm_adds_epu16(_mm_adds_epu16(x, one), _mm_srli_epi16(x, 8)), 8);
+	}
+
+	inline __m128i Select(__m128i mask, __m128i a, __m128i b) {
+		return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+	}
+
+	struct ToneVectors {
+		__m128i k_lo;
+		__m128i k_hi;
+		__m128i flip;
+		__m128i keep;
+		__m128i alpha;
+	};
+
+	// hard_light.table lookup of every byte
+	inline __m128i HardLight4(__m128i v, const ToneVectors& tv) {
+		const __m128i zero = _mm_setzero_si128();
+		__m128i w = _mm_xor_si128(v, tv.flip);
+		__m128i lo = Div255(_mm_mullo_epi16(_mm_unpacklo_epi8(w, zero), tv.k_lo));
+		__m128i hi = Div255(_mm_mullo_epi16(_mm_unpackhi_epi8(w, zero), tv.k_hi));
+		return _mm_xor_si128(_mm_packus_epi16(lo, hi), tv.flip);
+	}
+
+	inline __m128i ColorTone4(__m128i v, const ToneVectors& tv) {
+		return _mm_and_si128(HardLight4(v, tv), tv.keep);
+	}
+
+	// color_tone followed by multiplying the color with the alpha of the pixel
+	inline __m128i ColorToneAlpha4(__m128i v, const ToneVectors& tv, int as) {
+		const __m128i zero = _mm_setzero_si128();
+		__m128i h = HardLight4(v, tv);
+
+		__m128i a = _mm_and_si128(_mm_srl_epi32(v, _mm_cvtsi32_si128(as)), _mm_set1_epi32(0xFF));
+		a = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+		a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+
+		__m128i lo = Div255(_mm_mullo_epi16(_mm_unpacklo_epi8(h, zero), _mm_unpacklo_epi8(a, zero)));
+		__m128i hi = Div255(_mm_mullo_epi16(_mm_unpackhi_epi8(h, zero), _mm_unpackhi_epi8(a, zero)));
+		__m128i res = _mm_and_si128(_mm_packus_epi16(lo, hi), tv.keep);
+		return Select(tv.alpha, v, res);
+	}
+
+	inline __m128i Channel(__m128i v, int shift) {
+		return _mm_and_si128(_mm_srl_epi32(v, _mm_cvtsi32_si128(shift)), _mm_set1_epi32(0xFF));
+	}
+
+	// (lum * 1024 + (c - lum) * sat) >> 10 clamped to 0..255, placed at shift
+	inline __m128i Saturate(__m128i c, __m128i lum, __m128i factors, int shift) {
+		__m128i d = _mm_and_si128(_mm_sub_epi32(c, lum), _mm_set1_epi32(0xFFFF));
+		__m128i x = _mm_srai_epi32(_mm_madd_epi16(_mm_or_si128(d, _mm_slli_epi32(lum, 16)), factors), 10);
+		x = _mm_packs_epi32(x, x);
+		x = _mm_min_epi16(_mm_max_epi16(x, _mm_setzero_si128()), _mm_set1_epi16(255));
+		x = _mm_unpacklo_epi16(x, _mm_setzero_si128());
+		return _mm_sll_epi32(x, _mm_cvtsi32_si128(shift));
+	}
+
+	inline __m128i SaturationTone4(__m128i v, __m128i factors, int rs, int gs, int bs, int as) {
+		__m128i r = Channel(v, rs);
+		__m128i g = Channel(v, gs);
+		__m128i b = Channel(v, bs);
+		__m128i a = Channel(v, as);
+
+		// 7471 * b + 38470 * g + 19595 * r, 38470 exceeds int16 and is split into 65536 - 27066
+		__m128i rg = _mm_or_si128(r, _mm_slli_epi32(g, 16));
+		__m128i sum = _mm_madd_epi16(rg, _mm_set1_epi32((19595 & 0xFFFF) | static_cast<int>(static_cast<uint32_t>(-27066) << 16)));
+		sum = _mm_add_epi32(sum, _mm_slli_epi32(g, 16));
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(b, _mm_set1_epi32(7471)));
+		__m128i lum = _mm_srli_epi32(sum, 16);
+
+		__m128i res = _mm_sll_epi32(a, _mm_cvtsi32_si128(as));
+		res = _mm_or_si128(res, Saturate(r, lum, factors, rs));
+		res = _mm_or_si128(res, Saturate(g, lum, factors, gs));
+		res = _mm_or_si128(res, Saturate(b, lum, factors, bs));
+		return res;
+	}
+
+	/**
+	 * C style integer division (truncation towards zero) of num by den.
+	 * |num| must be below 2^24 and den positive. The float quotient is off
+	 * by at most one and corrected with the exact float remainder.
+	 */
+	inline __m128i DivTrunc(__m128i num, __m128i den) {
+		const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+		const __m128 one = _mm_set1_ps(1.0f);
+		__m128 n = _mm_cvtepi32_ps(num);
+		__m128 d = _mm_cvtepi32_ps(den);
+		__m128 sign = _mm_and_ps(n, sign_mask);
+		n = _mm_andnot_ps(sign_mask, n);
+
+		__m128 q = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_div_ps(n, d)));
+		__m128 rem = _mm_sub_ps(n, _mm_mul_ps(q, d));
+		q = _mm_add_ps(q, _mm_and_ps(_mm_cmpge_ps(rem, d), one));
+		q = _mm_sub_ps(q, _mm_and_ps(_mm_cmplt_ps(rem, _mm_setzero_ps()), one));
+
+		return _mm_cvttps_epi32(_mm_or_ps(q, sign));
+	}
+
+	inline __m128i Mul16(__m128i a, __m128i b) {
+		// Products of values below 2^16 that fit into 31 bit
+		__m128i lo = _mm_mullo_epi16(a, b);
+		__m128i hi = _mm_mulhi_epu16(a, b);
+		return _mm_or_si128(_mm_and_si128(lo, _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(hi, 16));
+	}
+
+	/** RGB_adjust_HSL for 4 pixels, pixels with alpha 0 are not changed */
+	inline __m128i HueChange4(__m128i v, __m128i hue, int rs, int gs, int bs, int as) {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i c255 = _mm_set1_epi32(0xFF);
+		const __m128i c511 = _mm_set1_epi32(0x1FF);
+
+		__m128i r = Channel(v, rs);
+		__m128i g = Channel(v, gs);
+		__m128i b = Channel(v, bs);
+		__m128i a = Channel(v, as);
+
+		// RGB_to_HSL, order selection
+		__m128i rg = _mm_cmpgt_epi32(r, g);
+		__m128i rb = _mm_cmpgt_epi32(r, b);
+		__m128i br = _mm_cmpgt_epi32(b, r);
+		__m128i gb = _mm_cmpgt_epi32(g, b);
+		__m128i bg = _mm_cmpgt_epi32(b, g);
+
+		__m128i o_rbg = _mm_and_si128(_mm_and_si128(rg, rb), bg);
+		__m128i o_rgb = _mm_andnot_si128(bg, _mm_and_si128(rg, rb));
+		__m128i o_brg = _mm_andnot_si128(rb, rg);
+		__m128i o_gbr = _mm_andnot_si128(rg, _mm_and_si128(br, gb));
+		__m128i o_grb = _mm_andnot_si128(rg, _mm_andnot_si128(br, _mm_set1_epi32(-1)));
+
+		__m128i group_r = _mm_or_si128(o_rgb, o_rbg);
+		__m128i group_g = _mm_or_si128(o_grb, o_gbr);
+		__m128i hi = Select(group_r, r, Select(group_g, g, b));
+		__m128i lo = Select(_mm_or_si128(o_rgb, o_grb), b, Select(_mm_or_si128(o_rbg, o_brg), g, r));
+		__m128i diff = Select(group_r, _mm_sub_epi32(g, b), Select(group_g, _mm_sub_epi32(b, r), _mm_sub_epi32(r, g)));
+		__m128i offset = Select(o_rbg, _mm_set1_epi32(0x600), Select(group_g, _mm_set1_epi32(0x200),
+			Select(group_r, zero, _mm_set1_epi32(0x400))));
+
+		__m128i c = _mm_sub_epi32(hi, lo);
+		__m128i c_zero = _mm_cmpeq_epi32(c, zero);
+		__m128i c_safe = _mm_or_si128(c, _mm_and_si128(c_zero, _mm_set1_epi32(1)));
+		__m128i h = _mm_andnot_si128(c_zero, _mm_add_epi32(DivTrunc(_mm_slli_epi32(diff, 8), c_safe), offset));
+
+		__m128i l2 = _mm_add_epi32(hi, lo);
+		__m128i l2_zero = _mm_cmpeq_epi32(l2, zero);
+		__m128i den = Select(_mm_cmpgt_epi32(l2, c255), _mm_sub_epi32(c511, l2), l2);
+		den = _mm_or_si128(den, _mm_and_si128(l2_zero, _mm_set1_epi32(1)));
+		__m128i s = _mm_andnot_si128(l2_zero, DivTrunc(_mm_slli_epi32(c, 8), den));
+		__m128i l = _mm_srli_epi32(l2, 1);
+
+		// HSL_adjust
+		h = _mm_add_epi32(h, hue);
+		h = _mm_sub_epi32(h, _mm_andnot_si128(_mm_cmplt_epi32(h, _mm_set1_epi32(0x600)), _mm_set1_epi32(0x600)));
+		s = Select(_mm_cmpgt_epi32(s, c255), c255, s);
+
+		// HSL_to_RGB
+		l2 = _mm_slli_epi32(l, 1);
+		den = Select(_mm_cmpgt_epi32(l2, c255), _mm_sub_epi32(c511, l2), l2);
+		c = _mm_srli_epi32(Mul16(s, den), 8);
+		__m128i m = _mm_srli_epi32(_mm_sub_epi32(l2, c), 1);
+		__m128i h0 = _mm_and_si128(h, c255);
+		__m128i h1 = _mm_sub_epi32(c255, h0);
+		__m128i x0 = _mm_add_epi32(m, _mm_srli_epi32(Mul16(h0, c), 8));
+		__m128i x1 = _mm_add_epi32(m, _mm_srli_epi32(Mul16(h1, c), 8));
+		__m128i mc = _mm_add_epi32(m, c);
+
+		__m128i sector = _mm_srai_epi32(h, 8);
+		__m128i s0 = _mm_cmpeq_epi32(sector, zero);
+		__m128i s1 = _mm_cmpeq_epi32(sector, _mm_set1_epi32(1));
+		__m128i s2 = _mm_cmpeq_epi32(sector, _mm_set1_epi32(2));
+		__m128i s3 = _mm_cmpeq_epi32(sector, _mm_set1_epi32(3));
+		__m128i s4 = _mm_cmpeq_epi32(sector, _mm_set1_epi32(4));
+		__m128i s5 = _mm_cmpeq_epi32(sector, _mm_set1_epi32(5));
+
+		__m128i nr = Select(_mm_or_si128(s0, s5), mc, Select(s1, x1, Select(s4, x0, m)));
+		__m128i ng = Select(_mm_or_si128(s1, s2), mc, Select(s0, x0, Select(s3, x1, m)));
+		__m128i nb = Select(_mm_or_si128(s3, s4), mc, Select(s2, x0, Select(s5, x1, m)));
+
+		// Out of range sectors and transparent pixels keep their color
+		__m128i change = _mm_andnot_si128(_mm_cmpeq_epi32(a, zero),
+			_mm_andnot_si128(_mm_cmplt_epi32(sector, zero), _mm_cmplt_epi32(sector, _mm_set1_epi32(6))));
+		nr = Select(change, _mm_and_si128(nr, c255), r);
+		ng = Select(change, _mm_and_si128(ng, c255), g);
+		nb = Select(change, _mm_and_si128(nb, c255), b);
+
+		__m128i res = _mm_sll_epi32(a, _mm_cvtsi32_si128(as));
+		res = _mm_or_si128(res, _mm_sll_epi32(nr, _mm_cvtsi32_si128(rs)));
+		res = _mm_or_si128(res, _mm_sll_epi32(ng, _mm_cvtsi32_si128(gs)));
+		res = _mm_or_si128(res, _mm_sll_epi32(nb, _mm_cvtsi32_si128(bs)));
+		return res;
+	}
+#elif defined(EP_BITMAP_KERNELS_NEON)
+	inline uint16x8_t Div255(uint16x8_t x) {
+		return vshrq_n_u16(vqaddq_u16(vqaddq_u16(x, vdupq_n_u16(1)), vshrq_n_u16(x, 8)), 8);
+	}
+
+	struct ToneVectors {
+		uint16x8_t k_lo;
+		uint16x8_t k_hi;
+		uint8x16_t flip;
+		uint8x16_t keep;
+		uint8x16_t alpha;
+	};
+
+	inline uint8x16_t HardLight4(uint8x16_t v, const ToneVectors& tv) {
+		uint8x16_t w = veorq_u8(v, tv.flip);
+		uint16x8_t lo = Div255(vmulq_u16(vmovl_u8(vget_low_u8(w)), tv.k_lo));
+		uint16x8_t hi = Div255(vmulq_u16(vmovl_u8(vget_high_u8(w)), tv.k_hi));
+		return veorq_u8(vcombine_u8(vqmovn_u16(lo), vqmovn_u16(hi)), tv.flip);
+	}
+
+	inline uint8x16_t ColorTone4(uint8x16_t v, const ToneVectors& tv) {
+		return vandq_u8(HardLight4(v, tv), tv.keep);
+	}
+
+	inline uint8x16_t ColorToneAlpha4(uint8x16_t v, const ToneVectors& tv, int as) {
+		uint8x16_t h = HardLight4(v, tv);
+
+		uint32x4_t a32 = vandq_u32(vshlq_u32(vreinterpretq_u32_u8(v), vdupq_n_s32(-as)), vdupq_n_u32(0xFF));
+		uint8x16_t a = vreinterpretq_u8_u32(vmulq_n_u32(a32, 0x01010101));
+
+		uint16x8_t lo = Div255(vmull_u8(vget_low_u8(h), vget_low_u8(a)));
+		uint16x8_t hi = Div255(vmull_u8(vget_high_u8(h), vget_high_u8(a)));
+		uint8x16_t res = vandq_u8(vcombine_u8(vqmovn_u16(lo), vqmovn_u16(hi)), tv.keep);
+		return vbslq_u8(tv.alpha, v, res);
+	}
+
+	inline int32x4_t Channel(uint32x4_t v, int shift) {
+		return vreinterpretq_s32_u32(vandq_u32(vshlq_u32(v, vdupq_n_s32(-shift)), vdupq_n_u32(0xFF)));
+	}
+
+	inline uint32x4_t Place(int32x4_t c, int shift) {
+		return vshlq_u32(vreinterpretq_u32_s32(c), vdupq_n_s32(shift));
+	}
+
+	inline uint32x4_t Saturate(int32x4_t c, int32x4_t lum, int sat, int shift) {
+		int32x4_t x = vshrq_n_s32(vmlaq_n_s32(vshlq_n_s32(lum, 10), vsubq_s32(c, lum), sat), 10);
+		x = vminq_s32(vmaxq_s32(x, vdupq_n_s32(0)), vdupq_n_s32(255));
+		return Place(x, shift);
+	}
+
+	inline uint32x4_t SaturationTone4(uint32x4_t v, int sat, int rs, int gs, int bs, int as) {
+		int32x4_t r = Channel(v, rs);
+		int32x4_t g = Channel(v, gs);
+		int32x4_t b = Channel(v, bs);
+		int32x4_t a = Channel(v, as);
+
+		int32x4_t sum = vmulq_n_s32(b, 7471);
+		sum = vmlaq_n_s32(sum, g, 38470);
+		sum = vmlaq_n_s32(sum, r, 19595);
+		int32x4_t lum = vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(sum), 16));
+
+		uint32x4_t res = Place(a, as);
+		res = vorrq_u32(res, Saturate(r, lum, sat, rs));
+		res = vorrq_u32(res, Saturate(g, lum, sat, gs));
+		res = vorrq_u32(res, Saturate(b, lum, sat, bs));
+		return res;
+	}
+
+	/**
+	 * C style integer division (truncation towards zero) of num by den.
+	 * |num| must be below 2^24 and den positive. The reciprocal estimate is
+	 * refined until the quotient is off by at most one and then corrected
+	 * with the exact float remainder.
+	 */
+	inline int32x4_t DivTrunc(int32x4_t num, int32x4_t den) {
+		const float32x4_t one = vdupq_n_f32(1.0f);
+		float32x4_t n = vcvtq_f32_s32(vabsq_s32(num));
+		float32x4_t d = vcvtq_f32_s32(den);
+
+		float32x4_t inv = vrecpeq_f32(d);
+		inv = vmulq_f32(vrecpsq_f32(d, inv), inv);
+		inv = vmulq_f32(vrecpsq_f32(d, inv), inv);
+
+		float32x4_t q = vcvtq_f32_s32(vcvtq_s32_f32(vmulq_f32(n, inv)));
+		float32x4_t rem = vmlsq_f32(n, q, d);
+		q = vaddq_f32(q, vreinterpretq_f32_u32(vandq_u32(vcgeq_f32(rem, d), vreinterpretq_u32_f32(one))));
+		q = vsubq_f32(q, vreinterpretq_f32_u32(vandq_u32(vcltq_f32(rem, vdupq_n_f32(0.0f)), vreinterpretq_u32_f32(one))));
+
+		int32x4_t res = vcvtq_s32_f32(q);
+		return vbslq_s32(vcltq_s32(num, vdupq_n_s32(0)), vnegq_s32(res), res);
+	}
+
+	inline uint32x4_t HueChange4(uint32x4_t v, int hue, int rs, int gs, int bs, int as) {
+		const int32x4_t zero = vdupq_n_s32(0);
+		const int32x4_t c255 = vdupq_n_s32(0xFF);
+		const int32x4_t c511 = vdupq_n_s32(0x1FF);
+
+		int32x4_t r = Channel(v, rs);
+		int32x4_t g = Channel(v, gs);
+		int32x4_t b = Channel(v, bs);
+		int32x4_t a = Channel(v, as);
+
+		uint32x4_t rg = vcgtq_s32(r, g);
+		uint32x4_t rb = vcgtq_s32(r, b);
+		uint32x4_t br = vcgtq_s32(b, r);
+		uint32x4_t gb = vcgtq_s32(g, b);
+		uint32x4_t bg = vcgtq_s32(b, g);
+
+		uint32x4_t o_rbg = vandq_u32(vandq_u32(rg, rb), bg);
+		uint32x4_t o_rgb = vbicq_u32(vandq_u32(rg, rb), bg);
+		uint32x4_t o_brg = vbicq_u32(rg, rb);
+		uint32x4_t o_gbr = vbicq_u32(vandq_u32(br, gb), rg);
+		uint32x4_t o_grb = vmvnq_u32(vorrq_u32(rg, br));
+
+		uint32x4_t group_r = vorrq_u32(o_rgb, o_rbg);
+		uint32x4_t group_g = vorrq_u32(o_grb, o_gbr);
+		int32x4_t hi = vbslq_s32(group_r, r, vbslq_s32(group_g, g, b));
+		int32x4_t lo = vbslq_s32(vorrq_u32(o_rgb, o_grb), b, vbslq_s32(vorrq_u32(o_rbg, o_brg), g, r));
+		int32x4_t diff = vbslq_s32(group_r, vsubq_s32(g, b), vbslq_s32(group_g, vsubq_s32(b, r), vsubq_s32(r, g)));
+		int32x4_t offset = vbslq_s32(o_rbg, vdupq_n_s32(0x600), vbslq_s32(group_g, vdupq_n_s32(0x200),
+			vbslq_s32(group_r, zero, vdupq_n_s32(0x400))));
+
+		int32x4_t c = vsubq_s32(hi, lo);
+		uint32x4_t c_zero = vceqq_s32(c, zero);
+		int32x4_t c_safe = vmaxq_s32(c, vdupq_n_s32(1));
+		int32x4_t h = vbslq_s32(c_zero, zero, vaddq_s32(DivTrunc(vshlq_n_s32(diff, 8), c_safe), offset));
+
+		int32x4_t l2 = vaddq_s32(hi, lo);
+		uint32x4_t l2_zero = vceqq_s32(l2, zero);
+		int32x4_t den = vbslq_s32(vcgtq_s32(l2, c255), vsubq_s32(c511, l2), l2);
+		den = vmaxq_s32(den, vdupq_n_s32(1));
+		int32x4_t s = vbslq_s32(l2_zero, zero, DivTrunc(vshlq_n_s32(c, 8), den));
+		int32x4_t l = vshrq_n_s32(l2, 1);
+
+		h = vaddq_s32(h, vdupq_n_s32(hue));
+		h = vbslq_s32(vcgeq_s32(h, vdupq_n_s32(0x600)), vsubq_s32(h, vdupq_n_s32(0x600)), h);
+		s = vminq_s32(s, c255);
+
+		l2 = vshlq_n_s32(l, 1);
+		den = vbslq_s32(vcgtq_s32(l2, c255), vsubq_s32(c511, l2), l2);
+		c = vshrq_n_s32(vmulq_s32(s, den), 8);
+		int32x4_t m = vshrq_n_s32(vsubq_s32(l2, c), 1);
+		int32x4_t h0 = vandq_s32(h, c255);
+		int32x4_t h1 = vsubq_s32(c255, h0);
+		int32x4_t x0 = vaddq_s32(m, vshrq_n_s32(vmulq_s32(h0, c), 8));
+		int32x4_t x1 = vaddq_s32(m, vshrq_n_s32(vmulq_s32(h1, c), 8));
+		int32x4_t mc = vaddq_s32(m, c);
+
+		int32x4_t sector = vshrq_n_s32(h, 8);
+		uint32x4_t s0 = vceqq_s32(sector, zero);
+		uint32x4_t s1 = vceqq_s32(sector, vdupq_n_s32(1));
+		uint32x4_t s2 = vceqq_s32(sector, vdupq_n_s32(2));
+		uint32x4_t s3 = vceqq_s32(sector, vdupq_n_s32(3));
+		uint32x4_t s4 = vceqq_s32(sector, vdupq_n_s32(4));
+		uint32x4_t s5 = vceqq_s32(sector, vdupq_n_s32(5));
+
+		int32x4_t nr = vbslq_s32(vorrq_u32(s0, s5), mc, vbslq_s32(s1, x1, vbslq_s32(s4, x0, m)));
+		int32x4_t ng = vbslq_s32(vorrq_u32(s1, s2), mc, vbslq_s32(s0, x0, vbslq_s32(s3, x1, m)));
+		int32x4_t nb = vbslq_s32(vorrq_u32(s3, s4), mc, vbslq_s32(s2, x0, vbslq_s32(s5, x1, m)));
+
+		uint32x4_t change = vbicq_u32(vandq_u32(vcgeq_s32(sector, zero), vcltq_s32(sector, vdupq_n_s32(6))), vceqq_s32(a, zero));
+		nr = vbslq_s32(change, vandq_s32(nr, c255), r);
+		ng = vbslq_s32(change, vandq_s32(ng, c255), g);
+		nb = vbslq_s32(change, vandq_s32(nb, c255), b);
+
+		uint32x4_t res = Place(a, as);
+		res = vorrq_u32(res, Place(nr, rs));
+		res = vorrq_u32(res, Place(ng, gs));
+		res = vorrq_u32(res, Place(nb, bs));
+		return res;
+	}
+#endif
+}
+
+namespace BitmapKernels {
+
+void ApplyTone(uint32_t* pixels, int count, const Tone& tone, int rs, int gs, int bs, int as, ImageOpacity opacity) {
+	const bool apply_sat = tone.gray != 128;
+	const bool apply_tone = (tone.red != 128 || tone.green != 128 || tone.blue != 128);
+	const bool skip_transparent = opacity != ImageOpacity::Opaque;
+	const bool premultiply = opacity == ImageOpacity::Alpha_8Bit;
+	const int sat = saturation_factor(tone.gray);
+
+	if (!apply_sat && !apply_tone) {
+		return;
+	}
+
+	int i = 0;
+
+#if defined(EP_BITMAP_KERNELS_SSE2) || defined(EP_BITMAP_KERNELS_NEON)
+	// The vector code operates on bytes, channels must be byte aligned
+	if ((rs | gs | bs | as) % 8 == 0) {
+		const auto params = MakeColorToneParams(tone, rs, gs, bs, as);
+#  if defined(EP_BITMAP_KERNELS_SSE2)
+		ToneVectors tv;
+		tv.k_lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(params.k));
+		tv.k_hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(params.k + 8));
+		tv.flip = _mm_loadu_si128(reinterpret_cast<const __m128i*>(params.flip));
+		tv.keep = _mm_loadu_si128(reinterpret_cast<const __m128i*>(params.keep));
+		tv.alpha = _mm_loadu_si128(reinterpret_cast<const __m128i*>(params.alpha));
+		const __m128i factors = _mm_set1_epi32(sat | (1024 << 16));
+
+		for (; i + 4 <= count; i += 4) {
+			auto* p = reinterpret_cast<__m128i*>(pixels + i);
+			const __m128i src = _mm_loadu_si128(p);
+			__m128i v = src;
+			if (apply_sat) {
+				v = SaturationTone4(v, factors, rs, gs, bs, as);
+			}
+			if (apply_tone) {
+				v = premultiply ? ColorToneAlpha4(v, tv, as) : ColorTone4(v, tv);
+			}
+			if (skip_transparent) {
+				v = Select(_mm_cmpeq_epi32(_mm_and_si128(src, tv.alpha), _mm_setzero_si128()), src, v);
+			}
+			_mm_storeu_si128(p, v);
+		}
+#  else
+		ToneVectors tv;
+		tv.k_lo = vld1q_u16(params.k);
+		tv.k_hi = vld1q_u16(params.k + 8);
+		tv.flip = vld1q_u8(params.flip);
+		tv.keep = vld1q_u8(params.keep);
+		tv.alpha = vld1q_u8(params.alpha);
+
+		for (; i + 4 <= count; i += 4) {
+			const uint32x4_t src = vld1q_u32(pixels + i);
+			uint32x4_t v = src;
+			if (apply_sat) {
+				v = SaturationTone4(v, sat, rs, gs, bs, as);
+			}
+			if (apply_tone) {
+				uint8x16_t v8 = vreinterpretq_u8_u32(v);
+				v = vreinterpretq_u32_u8(premultiply ? ColorToneAlpha4(v8, tv, as) : ColorTone4(v8, tv));
+			}
+			if (skip_transparent) {
+				v = vbslq_u32(vtstq_u32(src, vreinterpretq_u32_u8(tv.alpha)), v, src);
+			}
+			vst1q_u32(pixels + i, v);
+		}
+#  endif
+	}
+#endif
+
+	for (; i < count; ++i) {
+		if (skip_transparent && ((pixels[i] >> as) & 0xFF) == 0) {
+			continue;
+		}
+		if (apply_sat) {
+			saturation_tone(pixels[i], sat, rs, gs, bs, as);
+		}
+		if (apply_tone) {
+			if (premultiply) {
+				color_tone_alpha(pixels[i], tone, rs, gs, bs, as);
+			} else {
+				color_tone(pixels[i], tone, rs, gs, bs, as);
+			}
+		}
+	}
+}
+
+void HueChange(uint32_t* pixels, int count, int hue, int rs, int gs, int bs, int as) {
+	int i = 0;
+
+#if defined(EP_BITMAP_KERNELS_SSE2)
+	const __m128i hue_v = _mm_set1_epi32(hue);
+	for (; i + 4 <= count; i += 4) {
+		auto* p = reinterpret_cast<__m128i*>(pixels + i);
+		_mm_storeu_si128(p, HueChange4(_mm_loadu_si128(p), hue_v, rs, gs, bs, as));
+	}
+#elif defined(EP_BITMAP_KERNELS_NEON)
+	for (; i + 4 <= count; i += 4) {
+		vst1q_u32(pixels + i, HueChange4(vld1q_u32(pixels + i), hue, rs, gs, bs, as));
+	}
+#endif
+
+	for (; i < count; ++i) {
+		uint32_t pixel = pixels[i];
+		uint8_t r = (pixel >> rs) & 0xFF;
+		uint8_t g = (pixel >> gs) & 0xFF;
+		uint8_t b = (pixel >> bs) & 0xFF;
+		uint8_t a = (pixel >> as) & 0xFF;
+		if (a > 0)
+			RGB_adjust_HSL(r, g, b, hue);
+		pixels[i] = ((uint32_t) r << rs) | ((uint32_t) g << gs) | ((uint32_t) b << bs) | ((uint32_t) a << as);
+	}
+}
+
+}
@@ -0,0 +1,133 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_BITMAP_KERNELS_H
+#define EP_BITMAP_KERNELS_H
+
+// Headers
+#include <cstdint>
+#include "opacity.h"
+#include "tone.h"
+
+// Hard light lookup table mapping source color to destination color
+// FIXME: Replace this with std::array<std::array<uint8_t,256>,256>
+struct HardLightTable {
+	uint8_t table[256][256] = {};
+};
+
+constexpr HardLightTable make_hard_light_lookup() {
+	HardLightTable hl;
+	for (int i = 0; i < 256; ++i) {
+		for (int j = 0; j < 256; ++j) {
+			int res = 0;
+			if (i <= 128)
+				res = (2 * i * j) / 255;
+			else
+				res = 255 - 2 * (255 - i) * (255 - j) / 255;
+			hl.table[i][j] = res > 255 ? 255 : res < 0 ? 0 : res;
+		}
+	}
+	return hl;
+}
+
+inline constexpr auto hard_light = make_hard_light_lookup();
+
+/** @return saturation factor of saturation_tone for the gray component of a tone */
+static inline int saturation_factor(int gray) {
+	return gray > 128 ? 1024 + (gray - 128) * 16 : gray * 8;
+}
+
+// Saturation Tone Inline: Changes a pixel saturation
+static inline void saturation_tone(uint32_t &src_pixel, const int saturation, const int rs, const int gs, const int bs, const int as) {
+	// Algorithm from OpenPDN (MIT license)
+	// Transformation in Y'CbCr color space
+	uint8_t r = (src_pixel >> rs) & 0xFF;
+	uint8_t g = (src_pixel >> gs) & 0xFF;
+	uint8_t b = (src_pixel >> bs) & 0xFF;
+	uint8_t a = (src_pixel >> as) & 0xFF;
+
+	// Y' = 0.299 R' + 0.587 G' + 0.114 B'
+	uint8_t lum = (7471 * b + 38470 * g + 19595 * r) >> 16;
+
+	// Scale Cb/Cr by scale factor "sat"
+	int red = ((lum * 1024 + (r - lum) * saturation) >> 10);
+	red = red > 255 ? 255 : red < 0 ? 0 : red;
+	int green = ((lum * 1024 + (g - lum) * saturation) >> 10);
+	green = green > 255 ? 255 : green < 0 ? 0 : green;
+	int blue = ((lum * 1024 + (b - lum) * saturation) >> 10);
+	blue = blue > 255 ? 255 : blue < 0 ? 0 : blue;
+
+	src_pixel = ((uint32_t)red << rs) | ((uint32_t)green << gs) | ((uint32_t)blue << bs) | ((uint32_t)a << as);
+}
+
+// Color Tone Inline: Changes color of a pixel by hard light table
+static inline void color_tone(uint32_t &src_pixel, const Tone& tone, const int rs, const int gs, const int bs, const int as) {
+	src_pixel = ((uint32_t)hard_light.table[tone.red][(src_pixel >> rs) & 0xFF] << rs)
+		| ((uint32_t)hard_light.table[tone.green][(src_pixel >> gs) & 0xFF] << gs)
+		| ((uint32_t)hard_light.table[tone.blue][(src_pixel >> bs) & 0xFF] << bs)
+		| ((uint32_t)((src_pixel >> as) & 0xFF) << as);
+}
+
+static inline void color_tone_alpha(uint32_t &src_pixel, const Tone& tone, const int rs, const int gs, const int bs, const int as) {
+	uint8_t a = (src_pixel >> as) & 0xFF;
+	uint8_t r = ((uint32_t)hard_light.table[tone.red][(src_pixel >> rs) & 0xFF]) * a / 255;
+	uint8_t g = ((uint32_t)hard_light.table[tone.green][(src_pixel >> gs) & 0xFF]) * a / 255;
+	uint8_t b = ((uint32_t)hard_light.table[tone.blue][(src_pixel >> bs) & 0xFF]) * a / 255;
+	src_pixel = ((uint32_t)r << rs) | ((uint32_t)g << gs) | ((uint32_t)b << bs) | ((uint32_t)a << as);
+}
+
+/**
+ * Pixel effect kernels used by Bitmap.
+ *
+ * The kernels process rows of 32 bit pixels with SSE2 or NEON when the
+ * target supports them and use the scalar functions otherwise.
+ * All paths produce the same result.
+ */
+namespace BitmapKernels {
+	/**
+	 * Applies a tone to a row of pixels in place, ignoring the alpha channel.
+	 * Same result as saturation_tone followed by color_tone for every pixel.
+	 *
+	 * @param pixels pixels to change
+	 * @param count number of pixels
+	 * @param tone tone to apply
+	 * @param rs bit position of red
+	 * @param gs bit position of green
+	 * @param bs bit position of blue
+	 * @param as bit position of alpha
+	 * @param opacity opacity of the pixels. Unless Opaque pixels with alpha 0
+	 *                are skipped. With Alpha_8Bit color_tone_alpha is used.
+	 */
+	void ApplyTone(uint32_t* pixels, int count, const Tone& tone, int rs, int gs, int bs, int as,
+			ImageOpacity opacity = ImageOpacity::Opaque);
+
+	/**
+	 * Rotates the hue of a row of pixels in place.
+	 * Same result as RGB_adjust_HSL for every pixel with alpha above 0.
+	 *
+	 * @param pixels pixels to change
+	 * @param count number of pixels
+	 * @param hue hue change in 1/256 of 60 degrees (0 - 0x600)
+	 * @param rs bit position of red
+	 * @param gs bit position of green
+	 * @param bs bit position of blue
+	 * @param as bit position of alpha
+	 */
+	void HueChange(uint32_t* pixels, int count, int hue, int rs, int gs, int bs, int as);
+}
+
+#endif
@@ -20,9 +20,13 @@
 #  pragma warning(disable: 4003)
 #endif
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <future>
+#include <list>
 #include <map>
 #include <tuple>
-#include <chrono>
 #include <cassert>
 
 #include "async_handler.h"
@@ -34,9 +38,7 @@
 #include "output.h"
 #include "player.h"
 #include <lcf/data.h>
-#include "game_clock.h"
-
-using namespace std::chrono_literals;
+#include "instrumentation.h"
 
 namespace {
 	std::string MakeHashKey(StringView folder_name, StringView filename, bool transparent) {
@@ -69,13 +71,48 @@ namespace {
 		return key.data() + offset;
 	}
 
+	using key_type = std::string;
+
 	struct CacheItem {
+		key_type key;
 		BitmapRef bitmap;
-		Game_Clock::time_point last_access;
+		size_t size;
 	};
 
-	using key_type = std::string;
-	std::unordered_map<key_type, CacheItem> cache;
+	// Most recently used item first
+	using lru_type = std::list<CacheItem>;
+
+	struct PoolData {
+		lru_type lru;
+		size_t bytes = 0;
+		Cache::Stats stats;
+	};
+
+	constexpr int pool_count = static_cast<int>(Cache::Pool::END);
+
+	// Share of the total budget in percent reserved for each pool
+	constexpr std::array<int, pool_count> pool_share = {{
+		20, // Chipset
+		40, // Picture
+		20, // Charset
+		5, // System
+		15, // Other
+	}};
+
+	std::array<PoolData, pool_count> pools;
+	std::unordered_map<key_type, lru_type::iterator> cache;
+
+	// Images decoded in the background, added to the cache by Cache::Update
+	struct PendingDecode {
+		std::future<BitmapRef> bitmap;
+		Cache::Pool pool;
+	};
+	std::unordered_map<key_type, PendingDecode> pending_decodes;
+	// Prefetches waiting for the file download (Emscripten)
+	std::unordered_map<key_type, FileRequestBinding> prefetch_requests;
+
+	// Limits the memory used by prefetching
+	constexpr size_t max_pending_decodes = 32;
 
 	using tile_key_type = std::string;
 	std::unordered_map<tile_key_type, std::weak_ptr<Bitmap>> cache_tiles;
@@ -88,55 +125,114 @@ namespace {
 
 	std::string system2_name;
 
-	constexpr int cache_limit = 10 * 1024 * 1024;
-	size_t cache_size = 0;
+	size_t cache_budget = 10 * 1024 * 1024;
 
-	void FreeBitmapMemory() {
-		auto cur_ticks = Game_Clock::GetFrameTime();
+	PoolData& GetPool(Cache::Pool pool) {
+		return pools[static_cast<int>(pool)];
+	}
 
-		for (auto it = cache.begin(); it != cache.end();) {
-			if (it->second.bitmap.use_count() != 1) {
-				// Bitmap is referenced
-				++it;
-				continue;
-			}
+	size_t GetPoolBudget(Cache::Pool pool) {
+		return cache_budget / 100 * pool_share[static_cast<int>(pool)];
+	}
+
+	size_t GetTotalBytes() {
+		size_t total = 0;
+		for (const auto& p : pools) {
+			total += p.bytes;
+		}
+		return total;
+	}
+
+	void FreeBitmapMemory() {
+		size_t total = GetTotalBytes();
+		if (total <= cache_budget) {
+			return;
+		}
 
-			auto last_access = cur_ticks - it->second.last_access;
-			bool cache_exhausted = cache_size > cache_limit;
-			if (cache_exhausted) {
-				if (last_access <= 50ms) {
-					// Used during the last 3 frames, must be important, keep it.
-					++it;
+		// Pools may use the unused share of the others. When the budget is
+		// exceeded the pools furthest above their share are shrunk first.
+		std::array<Cache::Pool, pool_count> order;
+		for (int i = 0; i < pool_count; ++i) {
+			order[i] = static_cast<Cache::Pool>(i);
+		}
+		auto excess = [](Cache::Pool pool) {
+			return static_cast<int64_t>(GetPool(pool).bytes) - static_cast<int64_t>(GetPoolBudget(pool));
+		};
+		std::sort(order.begin(), order.end(), [&](Cache::Pool a, Cache::Pool b) {
+			return excess(a) > excess(b);
+		});
+
+		for (auto pool : order) {
+			auto& p = GetPool(pool);
+			const size_t budget = GetPoolBudget(pool);
+
+			// Every item is looked at once at most. Referenced bitmaps cannot be
+			// freed and are moved to the front because they are in use.
+			for (size_t n = p.lru.size(); n > 0 && p.bytes > budget && total > cache_budget; --n) {
+				auto it = std::prev(p.lru.end());
+				if (it->bitmap.use_count() != 1) {
+					p.lru.splice(p.lru.begin(), p.lru, it);
 					continue;
 				}
-			} else if (last_access <= 3s) {
-				++it;
-				continue;
-			}
 
 #ifdef CACHE_DEBUG
-			Output::Debug("Freeing memory of {}/{}", std::get<0>(i.first), std::get<1>(i.first));
+				Output::Debug("Freeing memory of {}", it->key);
 #endif
 
-			cache_size -= it->second.bitmap->GetSize();
-
-			it = cache.erase(it);
+				p.bytes -= it->size;
+				total -= it->size;
+				++p.stats.evictions;
+				cache.erase(it->key);
+				p.lru.erase(it);
+			}
 		}
 
 #ifdef CACHE_DEBUG
-		Output::Debug("Bitmap cache size: {}", cache_size / 1024.0 / 1024);
+		Output::Debug("Bitmap cache size: {}", total / 1024.0 / 1024);
 #endif
 	}
 
-	BitmapRef AddToCache(const std::string& key, BitmapRef bmp) {
-		if (bmp) {
-			cache_size += bmp->GetSize();
+	BitmapRef FindInCache(const key_type& key, Cache::Pool pool) {
+		auto it = cache.find(key);
+		if (it == cache.end()) {
+			++GetPool(pool).stats.misses;
+			return nullptr;
+		}
+
+		auto& p = GetPool(pool);
+		++p.stats.hits;
+		p.lru.splice(p.lru.begin(), p.lru, it->second);
+		return it->second->bitmap;
+	}
+
+	BitmapRef AddToCache(const key_type& key, BitmapRef bmp, Cache::Pool pool) {
+		auto& p = GetPool(pool);
+
+		const size_t size = bmp ? bmp->GetSize() : 0;
+		p.lru.push_front({key, bmp, size});
+		p.bytes += size;
+		cache[key] = p.lru.begin();
+
 #ifdef CACHE_DEBUG
-			Output::Debug("Bitmap cache size (Add): {}", cache_size / 1024.0 / 1024.0);
+		Output::Debug("Bitmap cache size (Add): {}", p.bytes / 1024.0 / 1024.0);
 #endif
+
+		FreeBitmapMemory();
+
+		return bmp;
+	}
+
+	BitmapRef TakePendingDecode(const key_type& key) {
+		auto it = pending_decodes.find(key);
+		if (it == pending_decodes.end()) {
+			return nullptr;
 		}
 
-		return (cache[key] = {bmp, Game_Clock::GetFrameTime()}).bitmap;
+		// Decoding already started in the background, waiting is cheaper than decoding again.
+		// Invalid images return nullptr and are reported by the regular load.
+		auto bmp = it->second.bitmap.get();
+		pending_decodes.erase(it);
+		return bmp;
 	}
 
 	struct Material {
@@ -199,6 +295,31 @@ namespace {
 		{ "Frame", true, 320, 320, 240, 240, DrawCheckerboard<Material::Frame>, true, true },
 	};
 
+	template<Material::Type T>
+	constexpr Cache::Pool GetMaterialPool() {
+		switch (T) {
+			case Material::Chipset:
+				return Cache::Pool::Chipset;
+			case Material::Picture:
+				return Cache::Pool::Picture;
+			case Material::Charset:
+			case Material::Battlecharset:
+				return Cache::Pool::Charset;
+			case Material::System:
+			case Material::System2:
+				return Cache::Pool::System;
+			default:
+				return Cache::Pool::Other;
+		}
+	}
+
+	template<Material::Type T>
+	constexpr uint32_t GetMaterialFlags() {
+		return Bitmap::Flag_ReadOnly | (
+				T == Material::Chipset ? Bitmap::Flag_Chipset :
+				T == Material::System ? Bitmap::Flag_System : 0);
+	}
+
 	template<Material::Type T>
 	BitmapRef DrawCheckerboard() {
 		static_assert(Material::REND < T && T < Material::END, "Invalid material.");
@@ -244,19 +365,23 @@ namespace {
 		//auto* req = AsyncHandler::RequestFile(s.directory, filename);
 		//assert(req != nullptr && req->IsReady());
 
-		BitmapRef bmp;
+		constexpr auto pool = GetMaterialPool<T>();
 
 		const auto key = MakeHashKey(s.directory, filename, transparent);
-		auto it = cache.find(key);
-		if (it == cache.end()) {
+		BitmapRef bmp = FindInCache(key, pool);
+		if (!bmp) {
+			EP_PROFILE_ZONE("Cache::LoadBitmap");
+
 			if (filename == CACHE_DEFAULT_BITMAP) {
 				bmp = LoadDummyBitmap<T>(s.directory, filename, true);
 			}
 
 			if (!bmp) {
-				auto is = FileFinder::OpenImage(s.directory, filename);
+				bmp = TakePendingDecode(key);
+			}
 
-				FreeBitmapMemory();
+			if (!bmp) {
+				auto is = FileFinder::OpenImage(s.directory, filename);
 
 				if (!is) {
 					if (s.warn_missing) {
@@ -266,10 +391,7 @@ namespace {
 						bmp = CreateEmpty<T>();
 					}
 				} else {
-					auto flags = Bitmap::Flag_ReadOnly | (
-							T == Material::Chipset ? Bitmap::Flag_Chipset :
-							T == Material::System ? Bitmap::Flag_System : 0);
-					bmp = Bitmap::Create(std::move(is), transparent, flags);
+					bmp = Bitmap::Create(std::move(is), transparent, GetMaterialFlags<T>());
 					if (!bmp) {
 						Output::Warning("Invalid image: {}/{}", s.directory, filename);
 					}
@@ -281,10 +403,7 @@ namespace {
 				bmp = LoadDummyBitmap<T>(s.directory, filename, transparent);
 			}
 
-			bmp = AddToCache(key, bmp);
-		} else {
-			it->second.last_access = Game_Clock::GetFrameTime();
-			bmp = it->second.bitmap;
+			bmp = AddToCache(key, bmp, pool);
 		}
 
 		assert(bmp);
@@ -317,6 +436,64 @@ namespace {
 		const Spec& s = spec[T];
 		return LoadBitmap<T>(f, s.transparent);
 	}
+
+	template<Material::Type T>
+	void StartDecode(const key_type& key, StringView filename, bool transparent) {
+		const Spec& s = spec[T];
+
+		if (cache.count(key) > 0 || pending_decodes.count(key) > 0 || pending_decodes.size() >= max_pending_decodes) {
+			return;
+		}
+
+		// Opening is done here because the filesystem is not thread-safe.
+		// Missing files are reported by the regular load.
+		auto is = FileFinder::OpenImage(s.directory, filename);
+		if (!is) {
+			return;
+		}
+
+		auto task = [is = std::move(is), transparent]() mutable {
+			EP_PROFILE_ZONE("Cache::DecodeBitmap");
+			return Bitmap::Create(std::move(is), transparent, GetMaterialFlags<T>());
+		};
+
+		pending_decodes[key] = { AsyncHandler::RunTask(std::move(task)), GetMaterialPool<T>() };
+	}
+
+	template<Material::Type T>
+	void PrefetchBitmap(StringView filename, bool transparent) {
+		static_assert(Material::REND < T && T < Material::END, "Invalid material.");
+		const Spec& s = spec[T];
+
+		if (filename.empty() || filename == CACHE_DEFAULT_BITMAP) {
+			return;
+		}
+
+		auto key = MakeHashKey(s.directory, filename, transparent);
+		if (cache.count(key) > 0 || pending_decodes.count(key) > 0 || prefetch_requests.count(key) > 0) {
+			return;
+		}
+
+		auto* request = AsyncHandler::RequestFile(s.directory, filename);
+		if (request->IsReady()) {
+			StartDecode<T>(key, filename, transparent);
+			return;
+		}
+
+		prefetch_requests[key] = request->Bind([key, file = ToString(filename), transparent](FileRequestResult* result) {
+			prefetch_requests.erase(key);
+			if (result->success) {
+				StartDecode<T>(key, file, transparent);
+			}
+		});
+		request->Start();
+	}
+
+	template<Material::Type T>
+	void PrefetchBitmap(StringView filename) {
+		const Spec& s = spec[T];
+		PrefetchBitmap<T>(filename, s.transparent);
+	}
 }
 
 std::vector<uint8_t> Cache::exfont_custom;
@@ -388,9 +565,9 @@ BitmapRef Cache::System(StringView file) {
 BitmapRef Cache::Exfont() {
 	const auto key = MakeHashKey("ExFont", "ExFont", false);
 
-	auto it = cache.find(key);
+	BitmapRef bmp = FindInCache(key, Pool::Other);
 
-	if (it == cache.end()) {
+	if (!bmp) {
 		// Allow overwriting of built-in exfont with a custom ExFont image file
 		// exfont_custom is filled by Player::CreateGameObjects
 		BitmapRef exfont_img;
@@ -402,11 +579,10 @@ BitmapRef Cache::Exfont() {
 			exfont_img = Bitmap::Create(exfont_h, sizeof(exfont_h), true);
 		}
 
-		return AddToCache(key, exfont_img);
-	} else {
-		it->second.last_access = Game_Clock::GetFrameTime();
-		return it->second.bitmap;
+		return AddToCache(key, exfont_img, Pool::Other);
 	}
+
+	return bmp;
 }
 
 BitmapRef Cache::Tile(StringView filename, int tile_id) {
@@ -495,7 +671,13 @@ BitmapRef Cache::SpriteEffect(const BitmapRef& src_bitmap, const Rect& rect, boo
 void Cache::Clear() {
 	cache_effects.clear();
 	cache.clear();
-	cache_size = 0;
+	// Running decodes finish in the background and are discarded
+	pending_decodes.clear();
+	prefetch_requests.clear();
+	for (auto& p: pools) {
+		p.lru.clear();
+		p.bytes = 0;
+	}
 
 	for (auto& kv : cache_tiles) {
 		auto& key = kv.first;
@@ -516,6 +698,63 @@ void Cache::ClearAll() {
 	system2_name.clear();
 }
 
+void Cache::PrefetchCharset(StringView file) {
+	PrefetchBitmap<Material::Charset>(file);
+}
+
+void Cache::PrefetchChipset(StringView file) {
+	PrefetchBitmap<Material::Chipset>(file);
+}
+
+void Cache::PrefetchFaceset(StringView file) {
+	PrefetchBitmap<Material::Faceset>(file);
+}
+
+void Cache::PrefetchPanorama(StringView file) {
+	PrefetchBitmap<Material::Panorama>(file);
+}
+
+void Cache::PrefetchPicture(StringView file, bool transparent) {
+	PrefetchBitmap<Material::Picture>(file, transparent);
+}
+
+void Cache::Update() {
+	for (auto it = pending_decodes.begin(); it != pending_decodes.end();) {
+		auto& pending = it->second;
+		if (pending.bitmap.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			++it;
+			continue;
+		}
+
+		auto bmp = pending.bitmap.get();
+		if (bmp) {
+			++GetPool(pending.pool).stats.prefetches;
+			AddToCache(it->first, bmp, pending.pool);
+		}
+		it = pending_decodes.erase(it);
+	}
+}
+
+void Cache::SetBudget(size_t bytes) {
+	cache_budget = bytes;
+
+	FreeBitmapMemory();
+}
+
+size_t Cache::GetBudget() {
+	return cache_budget;
+}
+
+Cache::Stats Cache::GetStats(Pool pool) {
+	const auto& p = GetPool(pool);
+
+	Stats stats = p.stats;
+	stats.bytes = p.bytes;
+	stats.entries = p.lru.size();
+	stats.budget = GetPoolBudget(pool);
+	return stats;
+}
+
 void Cache::SetSystemName(std::string filename) {
 	system_name = std::move(filename);
 }
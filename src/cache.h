@@ -61,6 +61,72 @@ namespace Cache {
 	void Clear();
 	void ClearAll();
 
+	/**
+	 * Prefetch functions: When the image is not cached it is decoded on a
+	 * worker thread and added to the cache by Update. Loading the image before
+	 * that waits for the background job instead of decoding it again.
+	 */
+	void PrefetchCharset(StringView filename);
+	void PrefetchChipset(StringView filename);
+	void PrefetchFaceset(StringView filename);
+	void PrefetchPanorama(StringView filename);
+	void PrefetchPicture(StringView filename, bool transparent);
+
+	/**
+	 * Adds images decoded in the background to the cache.
+	 * Called once per frame.
+	 */
+	void Update();
+
+	/** Image pools, every pool has its own LRU order and a reserved share of the budget */
+	enum class Pool {
+		Chipset,
+		Picture,
+		Charset,
+		System,
+		/** Every other image type */
+		Other,
+		END
+	};
+
+	/** Cache statistics of a pool */
+	struct Stats {
+		/** Lookups answered by the cache */
+		uint64_t hits = 0;
+		/** Lookups that loaded the image */
+		uint64_t misses = 0;
+		/** Unused images freed to stay in the budget */
+		uint64_t evictions = 0;
+		/** Images added by a background prefetch */
+		uint64_t prefetches = 0;
+		/** Bytes used by cached images, includes images in use */
+		size_t bytes = 0;
+		/** Number of cached images */
+		size_t entries = 0;
+		/** Bytes of the budget reserved for the pool */
+		size_t budget = 0;
+	};
+
+	/**
+	 * Sets the total memory budget of the image cache. Every pool has a share
+	 * of it reserved and may use the unused shares of the other pools. When
+	 * the budget is exceeded the least recently used images that are not
+	 * referenced anymore are freed, starting with the pools that use the most
+	 * beyond their share.
+	 *
+	 * @param bytes budget in bytes
+	 */
+	void SetBudget(size_t bytes);
+
+	/** @return total memory budget of the image cache in bytes */
+	size_t GetBudget();
+
+	/**
+	 * @param pool pool to query
+	 * @return statistics of the pool
+	 */
+	Stats GetStats(Pool pool);
+
 	/** @return the configured system bitmap, or nullptr if there is no system */
 	BitmapRef System();
 
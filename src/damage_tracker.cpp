@@ -0,0 +1,144 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headers
+#include "damage_tracker.h"
+#include "drawable_list.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+	Rect Union(const Rect& l, const Rect& r) {
+		int x1 = std::min(l.x, r.x);
+		int y1 = std::min(l.y, r.y);
+		int x2 = std::max(l.x + l.width, r.x + r.width);
+		int y2 = std::max(l.y + l.height, r.y + r.height);
+		return Rect(x1, y1, x2 - x1, y2 - y1);
+	}
+
+	bool Touches(const Rect& l, const Rect& r) {
+		return l.x <= r.x + r.width && r.x <= l.x + l.width &&
+			l.y <= r.y + r.height && r.y <= l.y + l.height;
+	}
+
+	int64_t Area(const Rect& rect) {
+		return static_cast<int64_t>(rect.width) * rect.height;
+	}
+}
+
+void DamageTracker::AddRect(std::vector<Rect>& rects, Rect rect, const Rect& screen) {
+	rect.Adjust(screen);
+	if (rect.IsEmpty()) {
+		return;
+	}
+
+	// Absorb every rectangle overlapping the new one. Joining can make the
+	// result touch rectangles that were checked before, so restart then.
+	for (size_t i = 0; i < rects.size();) {
+		if (Touches(rects[i], rect)) {
+			rect = Union(rects[i], rect);
+			rects.erase(rects.begin() + i);
+			i = 0;
+		} else {
+			++i;
+		}
+	}
+	rects.push_back(rect);
+
+	while (rects.size() > max_rects) {
+		size_t best_i = 0;
+		size_t best_j = 1;
+		int64_t best_waste = std::numeric_limits<int64_t>::max();
+		for (size_t i = 0; i < rects.size(); ++i) {
+			for (size_t j = i + 1; j < rects.size(); ++j) {
+				int64_t waste = Area(Union(rects[i], rects[j])) - Area(rects[i]) - Area(rects[j]);
+				if (waste < best_waste) {
+					best_waste = waste;
+					best_i = i;
+					best_j = j;
+				}
+			}
+		}
+
+		Rect merged = Union(rects[best_i], rects[best_j]);
+		rects.erase(rects.begin() + best_j);
+		rects.erase(rects.begin() + best_i);
+		AddRect(rects, merged, screen);
+	}
+}
+
+void DamageTracker::Update(DrawableList& list, Drawable::Z_t min_z, Drawable::Z_t max_z, const Rect& screen, uint64_t extra_key) {
+	if (list.IsDirty()) {
+		list.Sort();
+	}
+
+	cur.clear();
+	rects.clear();
+
+	bool unknown = false;
+	for (auto* drawable : list) {
+		auto z = drawable->GetZ();
+		if (z < min_z) {
+			continue;
+		}
+		if (z > max_z) {
+			break;
+		}
+		if (!drawable->IsVisible()) {
+			continue;
+		}
+
+		cur.emplace_back();
+		auto& entry = cur.back();
+		entry.drawable = drawable;
+		if (!drawable->GetDamageState(entry.state)) {
+			unknown = true;
+		}
+	}
+
+	full = unknown || !valid || screen != prev_screen || extra_key != prev_extra_key || cur.size() != prev.size();
+
+	if (!full) {
+		for (size_t i = 0; i < cur.size(); ++i) {
+			const auto& o = prev[i];
+			const auto& n = cur[i];
+			if (o.drawable != n.drawable) {
+				// Drawable added, removed or reordered
+				full = true;
+				break;
+			}
+			if (o.state.key != n.state.key || o.state.bounds != n.state.bounds) {
+				AddRect(rects, o.state.bounds, screen);
+				AddRect(rects, n.state.bounds, screen);
+			}
+		}
+	}
+
+	if (full) {
+		rects.clear();
+	}
+
+	// The state of unknown drawables cannot be compared next frame
+	valid = !unknown;
+	prev_screen = screen;
+	prev_extra_key = extra_key;
+	std::swap(prev, cur);
+}
+
+void DamageTracker::Invalidate() {
+	valid = false;
+}
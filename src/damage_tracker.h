@@ -0,0 +1,151 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_DAMAGE_TRACKER_H
+#define EP_DAMAGE_TRACKER_H
+
+// Headers
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include "drawable.h"
+#include "rect.h"
+
+class DrawableList;
+
+/**
+ * Describes what a drawable will render in the current frame.
+ * Filled by Drawable::GetDamageState.
+ */
+struct DamageState {
+	/** Screen area the drawable can touch, must be conservative */
+	Rect bounds;
+
+	/** Hash over every input that influences the rendered pixels */
+	uint64_t key = 14695981039346656037ULL;
+
+	/**
+	 * Mixes the given values into the key.
+	 *
+	 * @param values arithmetic values, enums or pointers
+	 * @return this
+	 */
+	template <typename... Args>
+	DamageState& Hash(const Args&... values);
+
+private:
+	template <typename T>
+	void HashOne(const T& value);
+};
+
+/**
+ * Computes which areas of the screen changed between two frames.
+ *
+ * The tracker remembers the ordered list of visible drawables of the
+ * previous frame together with their DamageState. When the order is the same
+ * and every drawable reports its state only the bounds of changed drawables
+ * are damaged. Everything else (unknown drawables, visibility or z changes,
+ * different destination) damages the whole screen.
+ */
+class DamageTracker {
+public:
+	/** Damaged rectangles are merged until at most this many are left */
+	static constexpr size_t max_rects = 8;
+
+	/**
+	 * Compares the drawables of the list in [min_z, max_z] against the
+	 * previous frame and computes the damage region.
+	 *
+	 * @param list drawable list that will be drawn
+	 * @param min_z Skip any drawables with z < min_z
+	 * @param max_z Skip any drawables with z > max_z
+	 * @param screen rect of the destination bitmap
+	 * @param extra_key hash of state outside of the list (scene, background color)
+	 */
+	void Update(DrawableList& list, Drawable::Z_t min_z, Drawable::Z_t max_z, const Rect& screen, uint64_t extra_key);
+
+	/** Forces a full redraw on the next Update */
+	void Invalidate();
+
+	/** @return true when the whole screen must be redrawn */
+	bool IsFull() const;
+
+	/** @return true when nothing changed since the last frame */
+	bool IsEmpty() const;
+
+	/** @return damaged rectangles, only meaningful when IsFull() is false */
+	const std::vector<Rect>& GetRects() const;
+
+	/**
+	 * Adds a rectangle to a damage list. Overlapping rectangles are joined and
+	 * when more than max_rects are in the list the pair wasting the least area
+	 * is merged.
+	 *
+	 * @param rects damage list
+	 * @param rect rectangle to add, clipped to screen
+	 * @param screen screen rectangle
+	 */
+	static void AddRect(std::vector<Rect>& rects, Rect rect, const Rect& screen);
+
+private:
+	struct Entry {
+		const Drawable* drawable = nullptr;
+		DamageState state;
+	};
+
+	std::vector<Entry> prev;
+	std::vector<Entry> cur;
+	std::vector<Rect> rects;
+	Rect prev_screen;
+	uint64_t prev_extra_key = 0;
+	bool full = true;
+	bool valid = false;
+};
+
+template <typename... Args>
+inline DamageState& DamageState::Hash(const Args&... values) {
+	(HashOne(values), ...);
+	return *this;
+}
+
+template <typename T>
+inline void DamageState::HashOne(const T& value) {
+	static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value, "Only plain values can be hashed");
+
+	// FNV-1a
+	unsigned char bytes[sizeof(T)];
+	std::memcpy(bytes, &value, sizeof(T));
+	for (auto b: bytes) {
+		key ^= b;
+		key *= 1099511628211ULL;
+	}
+}
+
+inline bool DamageTracker::IsFull() const {
+	return full;
+}
+
+inline bool DamageTracker::IsEmpty() const {
+	return !full && rects.empty();
+}
+
+inline const std::vector<Rect>& DamageTracker::GetRects() const {
+	return rects;
+}
+
+#endif
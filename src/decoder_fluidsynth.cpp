@@ -20,6 +20,7 @@
 
 #if defined(HAVE_FLUIDSYNTH) || defined(HAVE_FLUIDLITE)
 
+#include <atomic>
 #include <cassert>
 #include "filefinder.h"
 #include "output.h"
@@ -116,7 +117,8 @@ namespace {
 #if defined(HAVE_FLUIDSYNTH) && FLUIDSYNTH_VERSION_MAJOR > 1
 	fluid_sfloader_t* global_loader; // owned by global_settings
 #endif
-	int instances = 0;
+	/** Decoders can be destroyed by the audio thread */
+	std::atomic<int> instances = { 0 };
 }
 
 static fluid_synth_t* create_synth(std::string& error_message) {
@@ -184,11 +186,9 @@ static fluid_synth_t* create_synth(std::string& error_message) {
 }
 
 FluidSynthDecoder::FluidSynthDecoder() {
-	++instances;
-
 	// Optimisation: Only create the soundfont once and share the synth
 	// Sharing is only not possible when a Midi is played as a SE (unlikely)
-	if (instances > 1) {
+	if (++instances > 1) {
 		std::string error_message;
 		local_synth = create_synth(error_message);
 		if (!local_synth) {
@@ -202,8 +202,9 @@ FluidSynthDecoder::FluidSynthDecoder() {
 }
 
 FluidSynthDecoder::~FluidSynthDecoder() {
-	--instances;
-	assert(instances >= 0);
+	int remaining = --instances;
+	assert(remaining >= 0);
+	(void)remaining;
 
 	if (!use_global_synth) {
 		delete_fluid_synth(local_synth);
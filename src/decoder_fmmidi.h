@@ -37,8 +37,9 @@ public:
 	void SendMidiMessage(uint32_t message) override;
 	void SendSysExMessage(const uint8_t* data, size_t size) override;
 
-	std::unique_ptr<midisynth::synthesizer> synth;
+	// The factory owns the voice pool, it must outlive the synthesizer
 	std::unique_ptr<midisynth::fm_note_factory> note_factory;
+	std::unique_ptr<midisynth::synthesizer> synth;
 	midisynth::DRUMPARAMETER p;
 	void load_programs();
 
@@ -0,0 +1,304 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "directory_index.h"
+#include "filefinder.h"
+#include "output.h"
+#include "platform.h"
+#include "utils.h"
+#include <algorithm>
+#include <ctime>
+
+namespace {
+	constexpr uint32_t index_magic = 0x58494445; // "EDIX"
+	constexpr uint32_t index_version = 1;
+	/** Directories kept in the index file, at most */
+	constexpr size_t max_directories = 4096;
+	/**
+	 * Modification times have a resolution of one second. Directories changed
+	 * this recently are not stored because another change in the same second
+	 * would go unnoticed.
+	 */
+	constexpr int64_t racy_seconds = 2;
+	/** Longest string accepted when reading, protects against damaged files */
+	constexpr uint32_t max_string_length = 0xFFFF;
+
+	/** Reads little endian fields of the index file */
+	class Reader {
+	public:
+		explicit Reader(Span<const uint8_t> data) : pos(data.data()), end(data.data() + data.size()) {}
+
+		bool Read(uint32_t& value) {
+			if (end - pos < 4) {
+				return false;
+			}
+			value = static_cast<uint32_t>(pos[0]) | (static_cast<uint32_t>(pos[1]) << 8) |
+				(static_cast<uint32_t>(pos[2]) << 16) | (static_cast<uint32_t>(pos[3]) << 24);
+			pos += 4;
+			return true;
+		}
+
+		bool Read(uint64_t& value) {
+			uint32_t low;
+			uint32_t high;
+			if (!Read(low) || !Read(high)) {
+				return false;
+			}
+			value = (static_cast<uint64_t>(high) << 32) | low;
+			return true;
+		}
+
+		bool Read(std::string& value) {
+			uint32_t length;
+			if (!Read(length) || length > max_string_length || static_cast<uint32_t>(end - pos) < length) {
+				return false;
+			}
+			value.assign(reinterpret_cast<const char*>(pos), length);
+			pos += length;
+			return true;
+		}
+
+		bool Skip(uint32_t size) {
+			if (static_cast<uint32_t>(end - pos) < size) {
+				return false;
+			}
+			pos += size;
+			return true;
+		}
+
+		const uint8_t* GetPos() const {
+			return pos;
+		}
+
+	private:
+		const uint8_t* pos;
+		const uint8_t* end;
+	};
+
+	void Write(std::string& out, uint32_t value) {
+		for (int i = 0; i < 4; ++i) {
+			out += static_cast<char>((value >> (8 * i)) & 0xFF);
+		}
+	}
+
+	void Write(std::string& out, uint64_t value) {
+		Write(out, static_cast<uint32_t>(value));
+		Write(out, static_cast<uint32_t>(value >> 32));
+	}
+
+	void Write(std::string& out, StringView value) {
+		Write(out, static_cast<uint32_t>(value.size()));
+		out.append(value.data(), value.size());
+	}
+
+	bool IsAbsolute(StringView path) {
+		// "/home", "C:/", "ux0:/", "sdmc:/" and UNC paths
+		return !path.empty() && (path.front() == '/' || path.front() == '\\' || path.find(':') != StringView::npos);
+	}
+}
+
+DirectoryIndex::DirectoryIndex(FilesystemView fs, std::string filename) :
+	fs(fs), filename(std::move(filename)) {
+	working_dir = Platform::GetWorkingDirectory();
+
+	if (!fs || !fs.IsFile(this->filename)) {
+		return;
+	}
+
+	auto is = fs.OpenInputStream(this->filename);
+	if (!is) {
+		return;
+	}
+	buffer = Utils::ReadStream(is);
+	data = buffer;
+
+	Reader reader(data);
+	uint32_t magic;
+	uint32_t version;
+	uint32_t count;
+	if (!reader.Read(magic) || magic != index_magic ||
+		!reader.Read(version) || version != index_version ||
+		!reader.Read(count)) {
+		Output::Debug("DirectoryIndex: {} is outdated", this->filename);
+		return;
+	}
+
+	for (uint32_t i = 0; i < count; ++i) {
+		std::string path;
+		uint64_t mtime;
+		uint32_t size;
+		if (!reader.Read(path) || !reader.Read(mtime) || !reader.Read(size)) {
+			break;
+		}
+
+		Directory dir;
+		dir.mtime = static_cast<int64_t>(mtime);
+		dir.offset = static_cast<size_t>(reader.GetPos() - data.data());
+		dir.size = size;
+		if (!reader.Skip(size)) {
+			break;
+		}
+		directories[std::move(path)] = std::move(dir);
+	}
+
+	if (directories.size() != count) {
+		Output::Debug("DirectoryIndex: {} is damaged", this->filename);
+		directories.clear();
+	}
+}
+
+std::string DirectoryIndex::MakeKey(StringView path) const {
+	if (IsAbsolute(path)) {
+		return ToString(path);
+	}
+
+	if (working_dir.empty()) {
+		return "";
+	}
+
+	return FileFinder::MakePath(working_dir, path);
+}
+
+bool DirectoryIndex::Lookup(StringView path, DirectoryTree::DirectoryListType& entries, int64_t& mtime) {
+	mtime = Platform::File(ToString(path)).GetModificationTime();
+
+	std::string key = MakeKey(path);
+	auto it = directories.find(key);
+	if (key.empty() || it == directories.end() || mtime <= 0 || it->second.mtime != mtime) {
+		return false;
+	}
+
+	auto& dir = it->second;
+	Span<const uint8_t> listing;
+	if (dir.stored.empty()) {
+		listing = data.subspan(dir.offset, dir.size);
+	} else {
+		listing = Span<const uint8_t>(reinterpret_cast<const uint8_t*>(dir.stored.data()), dir.stored.size());
+	}
+
+	Reader reader(listing);
+	uint32_t count;
+	bool ok = reader.Read(count);
+	DirectoryTree::DirectoryListType result;
+	for (uint32_t i = 0; ok && i < count; ++i) {
+		std::string entry_key;
+		std::string name;
+		uint32_t type;
+		ok = reader.Read(entry_key) && reader.Read(name) && reader.Read(type) &&
+			type <= static_cast<uint32_t>(DirectoryTree::FileType::Other);
+		if (ok) {
+			result.emplace_back(std::move(entry_key), DirectoryTree::Entry(std::move(name), static_cast<DirectoryTree::FileType>(type)));
+		}
+	}
+
+	if (!ok) {
+		Output::Debug("DirectoryIndex: Listing of {} is damaged", path);
+		directories.erase(it);
+		modified = true;
+		return false;
+	}
+
+	dir.used = true;
+	entries = std::move(result);
+	return true;
+}
+
+void DirectoryIndex::Store(StringView path, int64_t mtime, const DirectoryTree::DirectoryListType& entries) {
+	std::string key = MakeKey(path);
+	if (key.empty()) {
+		return;
+	}
+
+	// Filesystems without modification times report 0, such directories are never stored
+	if (mtime <= 0 || mtime >= static_cast<int64_t>(std::time(nullptr)) - racy_seconds) {
+		if (directories.erase(key) > 0) {
+			modified = true;
+		}
+		return;
+	}
+
+	auto& dir = directories[key];
+	dir.mtime = mtime;
+	dir.used = true;
+	dir.stored.clear();
+	Write(dir.stored, static_cast<uint32_t>(entries.size()));
+	for (const auto& entry : entries) {
+		Write(dir.stored, entry.first);
+		Write(dir.stored, entry.second.name);
+		Write(dir.stored, static_cast<uint32_t>(entry.second.type));
+	}
+	modified = true;
+}
+
+void DirectoryIndex::Save() {
+	if (!modified || !fs) {
+		return;
+	}
+
+	// Directories enumerated in this session are kept when the limit is reached
+	std::vector<std::pair<const std::string, Directory>*> order;
+	order.reserve(directories.size());
+	for (auto& it : directories) {
+		order.push_back(&it);
+	}
+	std::stable_partition(order.begin(), order.end(), [](const auto* it) {
+		return it->second.used;
+	});
+	if (order.size() > max_directories) {
+		order.resize(max_directories);
+	}
+
+	std::string out;
+	std::vector<size_t> offsets;
+	offsets.reserve(order.size());
+	Write(out, index_magic);
+	Write(out, index_version);
+	Write(out, static_cast<uint32_t>(order.size()));
+	for (const auto* it : order) {
+		const auto& dir = it->second;
+		auto listing = dir.stored.empty() ?
+			StringView(reinterpret_cast<const char*>(data.data()) + dir.offset, dir.size) :
+			StringView(dir.stored);
+		Write(out, it->first);
+		Write(out, static_cast<uint64_t>(dir.mtime));
+		Write(out, static_cast<uint32_t>(listing.size()));
+		offsets.push_back(out.size());
+		out.append(listing.data(), listing.size());
+	}
+
+	std::vector<uint8_t> new_buffer(out.begin(), out.end());
+	std::unordered_map<std::string, Directory> kept;
+	for (size_t i = 0; i < order.size(); ++i) {
+		Directory dir;
+		dir.mtime = order[i]->second.mtime;
+		dir.used = order[i]->second.used;
+		dir.offset = offsets[i];
+		dir.size = order[i]->second.stored.empty() ? order[i]->second.size : order[i]->second.stored.size();
+		kept[order[i]->first] = std::move(dir);
+	}
+	buffer = std::move(new_buffer);
+	data = buffer;
+	directories = std::move(kept);
+	modified = false;
+
+	auto os = fs.OpenOutputStream(filename);
+	if (!os) {
+		Output::Debug("DirectoryIndex: Cannot write {}", filename);
+		return;
+	}
+	os.write(out.data(), out.size());
+}
@@ -0,0 +1,101 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_DIRECTORY_INDEX_H
+#define EP_DIRECTORY_INDEX_H
+
+#include "directory_tree.h"
+#include "filesystem.h"
+#include "span.h"
+#include "string_view.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Listings of native directories that are kept across launches.
+ *
+ * The index file is read into memory when it is loaded and a listing is
+ * only decoded when its directory is enumerated. The file is not mapped,
+ * because other Player instances rewrite it while they share the config
+ * directory. A listing is used as long
+ * as the modification time of the directory is unchanged. This replaces the
+ * enumeration of the directory and the normalization of every filename with
+ * a single stat call.
+ */
+class DirectoryIndex {
+public:
+	/**
+	 * Loads the index file. A missing or damaged file results in an empty index.
+	 *
+	 * @param fs Filesystem containing the index file
+	 * @param filename Name of the index file
+	 */
+	DirectoryIndex(FilesystemView fs, std::string filename);
+
+	DirectoryIndex(const DirectoryIndex&) = delete;
+	DirectoryIndex& operator=(const DirectoryIndex&) = delete;
+
+	/**
+	 * Fetches the listing of an unchanged directory.
+	 *
+	 * @param path Native path of the directory
+	 * @param entries Receives the listing, sorted by the lowered names
+	 * @param mtime Receives the modification time of the directory, pass it to Store
+	 * @return true when the listing is up-to-date
+	 */
+	bool Lookup(StringView path, DirectoryTree::DirectoryListType& entries, int64_t& mtime);
+
+	/**
+	 * Stores the listing of a directory.
+	 *
+	 * @param path Native path of the directory
+	 * @param mtime Modification time obtained by Lookup
+	 * @param entries Listing sorted by the lowered names
+	 */
+	void Store(StringView path, int64_t mtime, const DirectoryTree::DirectoryListType& entries);
+
+	/** Writes the index file when listings were stored since the last save */
+	void Save();
+
+private:
+	struct Directory {
+		int64_t mtime = -1;
+		/** Serialized listing inside data */
+		size_t offset = 0;
+		size_t size = 0;
+		/** Listing stored since the last save, replaces the serialized one */
+		std::string stored;
+		/** Enumerated in this session */
+		bool used = false;
+	};
+
+	/** @return Absolute path used as the key or an empty string when it cannot be determined */
+	std::string MakeKey(StringView path) const;
+
+	FilesystemView fs;
+	std::string filename;
+	std::string working_dir;
+	/** Content of the index file */
+	std::vector<uint8_t> buffer;
+	Span<const uint8_t> data;
+	std::unordered_map<std::string, Directory> directories;
+	bool modified = false;
+};
+
+#endif
@@ -16,6 +16,7 @@
  */
 
 #include "directory_tree.h"
+#include "directory_index.h"
 #include "filefinder.h"
 #include "filesystem.h"
 #include "output.h"
@@ -111,46 +112,72 @@ DirectoryTree::DirectoryListType* DirectoryTree::ListDirectory(StringView path)
 		}
 	}
 
-	if (!fs->GetDirectoryContent(fs_path, entries)) {
-		DebugLog("ListDirectory GetDirectoryContent Failed: {}", fs_path);
-		dir_missing_cache.push_back(make_key(fs_path));
-		return nullptr;
+	DirectoryListType fs_cache_entry;
+
+	// Listings of native directories are kept across launches
+	DirectoryIndex* index = fs->IsFeatureSupported(Filesystem::Feature::NativePath) ? FileFinder::GetDirectoryIndex() : nullptr;
+	std::string native_path;
+	int64_t mtime = -1;
+	if (index) {
+		native_path = FileFinder::MakePath(fs->GetPath(), fs_path);
 	}
 
-	InsertSorted(dir_cache, dir_key, std::move(fs_path));
+	auto warn_duplicate_folder = [](StringView name) {
+		Output::Warning("The folder \"{}\" exists twice.", name);
+		Output::Warning("This can lead to file not found errors. Merge the directories manually in a file browser.");
+	};
 
-	DirectoryListType fs_cache_entry;
+	if (index && index->Lookup(native_path, fs_cache_entry, mtime)) {
+		DebugLog("ListDirectory Index Hit: {}", native_path);
+
+		// The listing is sorted, folders that exist twice are next to the entry with the same key
+		for (size_t i = 1; i < fs_cache_entry.size(); ++i) {
+			if (fs_cache_entry[i].second.type == FileType::Directory && fs_cache_entry[i].first == fs_cache_entry[i - 1].first) {
+				warn_duplicate_folder(fs_cache_entry[i].second.name);
+			}
+		}
+	} else {
+		if (!fs->GetDirectoryContent(fs_path, entries)) {
+			DebugLog("ListDirectory GetDirectoryContent Failed: {}", fs_path);
+			dir_missing_cache.push_back(make_key(fs_path));
+			return nullptr;
+		}
 
 #ifdef EP_DEBUG_DIRECTORYTREE
-	std::stringstream ss;
+		std::stringstream ss;
 #endif
 
-	for (auto& entry : entries) {
-		std::string new_entry_key = make_key(entry.name);
+		for (auto& entry : entries) {
+			std::string new_entry_key = make_key(entry.name);
 
-		if (entry.type == FileType::Directory) {
-			if (Find(fs_cache_entry, new_entry_key) != fs_cache_entry.end()) {
-				Output::Warning("The folder \"{}\" exists twice.", entry.name);
-				Output::Warning("This can lead to file not found errors. Merge the directories manually in a file browser.");
+			if (entry.type == FileType::Directory) {
+				if (Find(fs_cache_entry, new_entry_key) != fs_cache_entry.end()) {
+					warn_duplicate_folder(entry.name);
+				}
 			}
-		}
-		fs_cache_entry.emplace_back(std::make_pair(std::move(new_entry_key), entry));
+			fs_cache_entry.emplace_back(std::make_pair(std::move(new_entry_key), entry));
 
 #ifdef EP_DEBUG_DIRECTORYTREE
-		std::string t = entry.type == FileType::Regular ? "" :
-				entry.type == FileType::Directory ? "(d)" : "(?)";
-		ss << entry.name << t << ", ";
+			std::string t = entry.type == FileType::Regular ? "" :
+					entry.type == FileType::Directory ? "(d)" : "(?)";
+			ss << entry.name << t << ", ";
 #endif
-	}
+		}
 
-	std::sort(fs_cache_entry.begin(), fs_cache_entry.end(), [](auto& left, auto& right) {
-		return left.first < right.first;
-	});
+		std::sort(fs_cache_entry.begin(), fs_cache_entry.end(), [](auto& left, auto& right) {
+			return left.first < right.first;
+		});
 
 #ifdef EP_DEBUG_DIRECTORYTREE
-	DebugLog("ListDirectory Content: {}", ss.str());
+		DebugLog("ListDirectory Content: {}", ss.str());
 #endif
 
+		if (index) {
+			index->Store(native_path, mtime, fs_cache_entry);
+		}
+	}
+
+	InsertSorted(dir_cache, dir_key, std::move(fs_path));
 	InsertSorted(fs_cache, dir_key, std::move(fs_cache_entry));
 
 	return &Find(fs_cache, dir_key)->second;
@@ -23,6 +23,8 @@
 
 class Bitmap;
 class Drawable;
+class Rect;
+struct DamageState;
 
 template <typename T>
 static constexpr bool IsDrawable = std::is_base_of<Drawable,T>::value;
@@ -57,6 +59,29 @@ public:
 
 	virtual void Draw(Bitmap& dst) = 0;
 
+	/**
+	 * Reports the screen bounds and a key over the render state for damage
+	 * tracking. Drawables that cannot describe their output return false,
+	 * which forces a full redraw.
+	 *
+	 * @param state filled with bounds and key
+	 * @return true when the state is known
+	 */
+	virtual bool GetDamageState(DamageState& state) const;
+
+	/**
+	 * Reports the screen area the drawable draws to. DrawableList skips
+	 * drawables outside of the destination and drawables hidden below an
+	 * opaque drawable that covers the whole destination.
+	 *
+	 * @param bounds filled with a conservative screen rectangle, empty when
+	 *               nothing is drawn
+	 * @param opaque set to true when every pixel of bounds is overwritten
+	 *               with an opaque pixel
+	 * @return true when the bounds are known
+	 */
+	virtual bool GetDrawBounds(Rect& bounds, bool& opaque) const;
+
 	Z_t GetZ() const;
 
 	void SetZ(Z_t z);
@@ -142,6 +167,14 @@ inline Drawable::Drawable(Z_t z, Flags flags)
 {
 }
 
+inline bool Drawable::GetDamageState(DamageState&) const {
+	return false;
+}
+
+inline bool Drawable::GetDrawBounds(Rect&, bool&) const {
+	return false;
+}
+
 inline Drawable::Z_t Drawable::GetZ() const {
 	return _z;
 }
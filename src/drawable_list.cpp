@@ -18,6 +18,9 @@
 // Headers
 #include "drawable_list.h"
 #include "drawable_mgr.h"
+#include "instrumentation.h"
+#include "bitmap.h"
+#include "rect.h"
 #include <algorithm>
 #include <cassert>
 
@@ -25,6 +28,12 @@ static bool DrawCmp(Drawable* l, Drawable* r) {
 	return l->GetZ() < r->GetZ();
 }
 
+static bool Covers(const Rect& outer, const Rect& inner) {
+	return outer.x <= inner.x && outer.y <= inner.y
+		&& outer.x + outer.width >= inner.x + inner.width
+		&& outer.y + outer.height >= inner.y + inner.height;
+}
+
 DrawableList::~DrawableList() {
 	if (DrawableMgr::GetLocalListPtr() == this) {
 		DrawableMgr::SetLocalList(nullptr);
@@ -91,23 +100,47 @@ void DrawableList::TakeFrom(DrawableList& other) noexcept {
 }
 
 void DrawableList::Draw(Bitmap& dst, Drawable::Z_t min_z, Drawable::Z_t max_z) {
+	EP_PROFILE_ZONE("DrawableList::Draw");
+
 	if (IsDirty()) {
 		Sort();
 	} else {
 		assert(IsSorted());
 	}
 
-	for (auto* drawable : _list) {
-		auto z = drawable->GetZ();
-		if (z < min_z) {
+	auto first = std::lower_bound(_list.begin(), _list.end(), min_z,
+		[](Drawable* d, Drawable::Z_t z) { return d->GetZ() < z; });
+	auto last = std::upper_bound(first, _list.end(), max_z,
+		[](Drawable::Z_t z, Drawable* d) { return z < d->GetZ(); });
+
+	const Rect dst_rect = dst.GetRect();
+
+	// Query the bounds first to find the topmost drawable hiding everything below
+	_culled.assign(last - first, false);
+	auto start = first;
+	for (auto iter = first; iter != last; ++iter) {
+		auto* drawable = *iter;
+		if (!drawable->IsVisible()) {
+			continue;
+		}
+
+		Rect bounds;
+		bool opaque = false;
+		if (!drawable->GetDrawBounds(bounds, opaque)) {
 			continue;
 		}
-		if (z > max_z) {
-			break;
+
+		if (bounds.IsOutOfBounds(dst_rect)) {
+			_culled[iter - first] = true;
+		} else if (opaque && Covers(bounds, dst_rect)) {
+			start = iter;
 		}
-		if (drawable->IsVisible()) {
+	}
+
+	for (auto iter = start; iter != last; ++iter) {
+		auto* drawable = *iter;
+		if (drawable->IsVisible() && !_culled[iter - first]) {
 			drawable->Draw(dst);
 		}
 	}
 }
-
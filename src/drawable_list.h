@@ -124,6 +124,8 @@ class DrawableList {
 
 		/**
 		 * Sort the list if it's dirty, then call Draw() on every drawable in order.
+		 * Drawables whose bounds are outside of dst or that are hidden below an
+		 * opaque drawable covering all of dst are skipped.
 		 *
 		 * @param dst The bitmap to draw onto
 		 * @param min_z Skip any drawables with z < min_z
@@ -133,6 +135,7 @@ class DrawableList {
 
 	private:
 		std::vector<Drawable*> _list;
+		std::vector<bool> _culled;
 		bool _dirty = false;
 
 		void SetClean();
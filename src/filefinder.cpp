@@ -39,6 +39,7 @@
 #include "filefinder_rtp.h"
 #include "filesystem.h"
 #include "filesystem_root.h"
+#include "directory_index.h"
 #include "fileext_guesser.h"
 #include "output.h"
 #include "player.h"
@@ -59,6 +60,7 @@ namespace {
 
 	std::string fonts_path;
 	std::shared_ptr<Filesystem> root_fs;
+	std::unique_ptr<DirectoryIndex> directory_index;
 	FilesystemView game_fs;
 	FilesystemView save_fs;
 
@@ -146,6 +148,25 @@ FilesystemView FileFinder::Root() {
 	return root_fs->Subtree("");
 }
 
+void FileFinder::LoadDirectoryIndex(FilesystemView fs) {
+#if defined(PLAYER_NINTENDO) || defined(__vita__) || defined(PSP)
+	// The FAT drivers of these platforms do not update the modification time of directories
+	(void)fs;
+#else
+	directory_index = std::make_unique<DirectoryIndex>(fs, DIRECTORY_INDEX_NAME);
+#endif
+}
+
+void FileFinder::SaveDirectoryIndex() {
+	if (directory_index) {
+		directory_index->Save();
+	}
+}
+
+DirectoryIndex* FileFinder::GetDirectoryIndex() {
+	return directory_index.get();
+}
+
 std::string FileFinder::MakePath(StringView dir, StringView name) {
 	std::string str;
 	if (dir.empty()) {
@@ -299,6 +320,8 @@ bool FileFinder::IsSupportedArchiveExtension(std::string path) {
 }
 
 void FileFinder::Quit() {
+	SaveDirectoryIndex();
+	directory_index.reset();
 	root_fs.reset();
 }
 
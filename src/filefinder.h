@@ -32,6 +32,8 @@
 #include <unordered_map>
 #include <vector>
 
+class DirectoryIndex;
+
 /**
  * FileFinder contains helper methods for finding case
  * insensitive files paths.
@@ -45,6 +47,21 @@ namespace FileFinder {
 	/** @return A filesystem handle for arbitrary file access inside the host filesystem */
 	FilesystemView Root();
 
+	/**
+	 * Loads the directory index, the listings of native directories saved by
+	 * a previous launch. Does nothing on platforms whose directory
+	 * modification times are unreliable.
+	 *
+	 * @param fs Filesystem containing the index file
+	 */
+	void LoadDirectoryIndex(FilesystemView fs);
+
+	/** Writes the directory index when new listings were added */
+	void SaveDirectoryIndex();
+
+	/** @return The directory index or nullptr when none is loaded */
+	DirectoryIndex* GetDirectoryIndex();
+
 	/** @return A filesystem handle for file access inside the game directory */
 	FilesystemView Game();
 
@@ -46,7 +46,9 @@ public:
 	/** Features provided by the filesystem */
 	enum class Feature {
 		/** Filesystem supports Write operations */
-		Write = 1
+		Write = 1,
+		/** Paths made with MakePath can be passed to the Platform API (e.g. Platform::MappedFile) */
+		NativePath = 2
 	};
 
 	virtual ~Filesystem() = default;
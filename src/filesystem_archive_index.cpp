@@ -0,0 +1,198 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "filesystem_archive_index.h"
+#include "output.h"
+#include "platform.h"
+#include <array>
+#include <istream>
+#include <ostream>
+
+namespace {
+	constexpr uint32_t index_magic = 0x58444945; // "EIDX"
+	constexpr uint32_t index_version = 1;
+	/** Longest string accepted when reading, protects against corrupted files */
+	constexpr uint32_t max_string_length = 0xFFFF;
+
+	size_t min_file_entries = ArchiveIndex::default_min_file_entries;
+
+	std::string GetIndexPath(StringView archive_path) {
+		return ToString(archive_path) + ".easyrpg-index";
+	}
+
+	/** Size and modification time of the archive, an index file is only valid for these */
+	bool GetArchiveStamp(FilesystemView parent_fs, StringView archive_path, uint64_t& size, uint64_t& mtime) {
+		if (!parent_fs.IsFeatureSupported(Filesystem::Feature::NativePath)) {
+			return false;
+		}
+
+		Platform::File file(parent_fs.MakePath(archive_path));
+		int64_t file_size = file.GetSize();
+		int64_t file_mtime = file.GetModificationTime();
+		if (file_size < 0 || file_mtime < 0) {
+			return false;
+		}
+
+		size = static_cast<uint64_t>(file_size);
+		mtime = static_cast<uint64_t>(file_mtime);
+		return true;
+	}
+}
+
+void ArchiveIndex::Add(StringView path, bool is_directory) {
+	if (is_directory) {
+		directories[ToString(path)];
+	}
+
+	if (path.empty()) {
+		return;
+	}
+
+	auto slash = path.find_last_of('/');
+	StringView parent = slash == StringView::npos ? StringView() : path.substr(0, slash);
+	StringView name = slash == StringView::npos ? path : path.substr(slash + 1);
+
+	directories[ToString(parent)].emplace_back(ToString(name),
+		is_directory ? DirectoryTree::FileType::Directory : DirectoryTree::FileType::Regular);
+}
+
+const std::vector<DirectoryTree::Entry>* ArchiveIndex::Find(StringView path) const {
+	auto it = directories.find(ToString(path));
+	if (it == directories.end()) {
+		return nullptr;
+	}
+	return &it->second;
+}
+
+void ArchiveIndex::Clear() {
+	directories.clear();
+}
+
+size_t ArchiveIndex::GetMinFileEntries() {
+	return min_file_entries;
+}
+
+void ArchiveIndex::SetMinFileEntries(size_t entries) {
+	min_file_entries = entries;
+}
+
+Filesystem_Stream::InputStream ArchiveIndex::OpenIndexFile(FilesystemView parent_fs, StringView archive_path, StringView key) {
+	uint64_t size;
+	uint64_t mtime;
+	if (!GetArchiveStamp(parent_fs, archive_path, size, mtime)) {
+		return Filesystem_Stream::InputStream();
+	}
+
+	std::string index_path = GetIndexPath(archive_path);
+	if (!parent_fs.IsFile(index_path)) {
+		return Filesystem_Stream::InputStream();
+	}
+
+	auto is = parent_fs.OpenInputStream(index_path);
+	if (!is) {
+		return Filesystem_Stream::InputStream();
+	}
+
+	uint32_t magic;
+	uint32_t version;
+	std::string file_key;
+	uint64_t file_size;
+	uint64_t file_mtime;
+	if (!Read(is, magic) || magic != index_magic ||
+		!Read(is, version) || version != index_version ||
+		!Read(is, file_key) || file_key != key ||
+		!Read(is, file_size) || file_size != size ||
+		!Read(is, file_mtime) || file_mtime != mtime) {
+		Output::Debug("{}: Index file is outdated", archive_path);
+		return Filesystem_Stream::InputStream();
+	}
+
+	return is;
+}
+
+Filesystem_Stream::OutputStream ArchiveIndex::CreateIndexFile(FilesystemView parent_fs, StringView archive_path, StringView key) {
+	uint64_t size;
+	uint64_t mtime;
+	if (!parent_fs.IsFeatureSupported(Filesystem::Feature::Write) ||
+		!GetArchiveStamp(parent_fs, archive_path, size, mtime)) {
+		return Filesystem_Stream::OutputStream();
+	}
+
+	auto os = parent_fs.OpenOutputStream(GetIndexPath(archive_path));
+	if (!os) {
+		return Filesystem_Stream::OutputStream();
+	}
+
+	Write(os, index_magic);
+	Write(os, index_version);
+	Write(os, key);
+	Write(os, size);
+	Write(os, mtime);
+	return os;
+}
+
+bool ArchiveIndex::Read(std::istream& is, uint32_t& value) {
+	std::array<unsigned char, 4> bytes;
+	if (!is.read(reinterpret_cast<char*>(bytes.data()), bytes.size())) {
+		return false;
+	}
+
+	value = 0;
+	for (size_t i = 0; i < bytes.size(); ++i) {
+		value |= static_cast<uint32_t>(bytes[i]) << (8 * i);
+	}
+	return true;
+}
+
+bool ArchiveIndex::Read(std::istream& is, uint64_t& value) {
+	uint32_t low;
+	uint32_t high;
+	if (!Read(is, low) || !Read(is, high)) {
+		return false;
+	}
+
+	value = (static_cast<uint64_t>(high) << 32) | low;
+	return true;
+}
+
+bool ArchiveIndex::Read(std::istream& is, std::string& value) {
+	uint32_t length;
+	if (!Read(is, length) || length > max_string_length) {
+		return false;
+	}
+
+	value.resize(length);
+	return length == 0 || is.read(&value[0], length);
+}
+
+void ArchiveIndex::Write(std::ostream& os, uint32_t value) {
+	std::array<unsigned char, 4> bytes;
+	for (size_t i = 0; i < bytes.size(); ++i) {
+		bytes[i] = static_cast<unsigned char>(value >> (8 * i));
+	}
+	os.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+void ArchiveIndex::Write(std::ostream& os, uint64_t value) {
+	Write(os, static_cast<uint32_t>(value));
+	Write(os, static_cast<uint32_t>(value >> 32));
+}
+
+void ArchiveIndex::Write(std::ostream& os, StringView value) {
+	Write(os, static_cast<uint32_t>(value.size()));
+	os.write(value.data(), value.size());
+}
@@ -0,0 +1,114 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_FILESYSTEM_ARCHIVE_INDEX_H
+#define EP_FILESYSTEM_ARCHIVE_INDEX_H
+
+#include "directory_tree.h"
+#include "filesystem.h"
+#include "filesystem_stream.h"
+#include "string_view.h"
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Directory index of an archive filesystem.
+ * The content of every directory is collected once when the archive is opened.
+ *
+ * The entry list of large archives is additionally stored in an index file
+ * next to the archive. It is reused on the next launch as long as the size
+ * and the modification time of the archive are unchanged.
+ */
+class ArchiveIndex {
+public:
+	/** Archives with less entries are scanned quickly and get no index file */
+	static constexpr size_t default_min_file_entries = 256;
+	/** Entry lists read from an index file reserve at most this many entries up front */
+	static constexpr uint32_t max_reserved_entries = 4096;
+
+	/**
+	 * Adds an entry to the content of its parent directory.
+	 *
+	 * @param path normalized path of the entry, empty for the root
+	 * @param is_directory whether the entry is a directory
+	 */
+	void Add(StringView path, bool is_directory);
+
+	/**
+	 * @param path normalized path of a directory
+	 * @return content of the directory or nullptr when the directory does not exist
+	 */
+	const std::vector<DirectoryTree::Entry>* Find(StringView path) const;
+
+	/** Removes all entries */
+	void Clear();
+
+	/**
+	 * @return Entry count from which archives get an index file
+	 */
+	static size_t GetMinFileEntries();
+
+	/**
+	 * Changes the entry count from which archives get an index file.
+	 * Used by the unit tests, the test archives are small.
+	 *
+	 * @param entries New entry count
+	 */
+	static void SetMinFileEntries(size_t entries);
+
+	/**
+	 * Opens the index file of an archive.
+	 *
+	 * @param parent_fs Filesystem containing the archive
+	 * @param archive_path Path of the archive in parent_fs
+	 * @param key Archive type and requested encoding. Index files written with a different key are ignored.
+	 * @return Stream positioned after the header or an invalid stream when no up-to-date index file exists
+	 */
+	static Filesystem_Stream::InputStream OpenIndexFile(FilesystemView parent_fs, StringView archive_path, StringView key);
+
+	/**
+	 * Creates the index file of an archive and writes the header.
+	 * Fails when the parent filesystem is not writable.
+	 *
+	 * @param parent_fs Filesystem containing the archive
+	 * @param archive_path Path of the archive in parent_fs
+	 * @param key Archive type and requested encoding
+	 * @return Stream positioned after the header or an invalid stream on failure
+	 */
+	static Filesystem_Stream::OutputStream CreateIndexFile(FilesystemView parent_fs, StringView archive_path, StringView key);
+
+	/**
+	 * Little endian (de)serialization of index file fields.
+	 * The read functions return false when the stream is exhausted.
+	 */
+	/** @{ */
+	static bool Read(std::istream& is, uint32_t& value);
+	static bool Read(std::istream& is, uint64_t& value);
+	static bool Read(std::istream& is, std::string& value);
+	static void Write(std::ostream& os, uint32_t value);
+	static void Write(std::ostream& os, uint64_t value);
+	static void Write(std::ostream& os, StringView value);
+	/** @} */
+
+private:
+	std::unordered_map<std::string, std::vector<DirectoryTree::Entry>> directories;
+};
+
+#endif
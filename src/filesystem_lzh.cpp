@@ -20,13 +20,13 @@
 #ifdef HAVE_LHASA
 
 #include "filesystem_lzh.h"
+#include "filesystem_archive_index.h"
 #include "filefinder.h"
 #include "output.h"
 #include "utils.h"
 
 #include <lcf/encoder.h>
 #include <lcf/reader_util.h>
-#include <lcf/scope_guard.h>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
@@ -81,39 +81,82 @@ LzhFilesystem::LzhFilesystem(std::string base_path, FilesystemView parent_fs, St
 		return;
 	}
 
-	lha_is.reset(lha_input_stream_new(&vio, &is));
+	encoding = ToString(enc);
+	const std::string index_key = "lzh:" + encoding;
 
-	lha_reader.reset(lha_reader_new(lha_is.get()));
+	auto index_file = ArchiveIndex::OpenIndexFile(parent_fs, GetPath(), index_key);
+	if (!index_file || !ReadIndexFile(index_file)) {
+		if (!ReadHeaders()) {
+			Output::Debug("LzhFS: {} is not a valid archive", GetPath());
+			return;
+		}
 
-	if (!lha_reader) {
-		Output::Debug("LzhFS: {} is not a valid archive", GetPath());
-		return;
+		if (lzh_entries.size() >= ArchiveIndex::GetMinFileEntries()) {
+			// Scanning large archives is slow on some devices, store the result for the next launch
+			auto os = ArchiveIndex::CreateIndexFile(parent_fs, GetPath(), index_key);
+			if (os) {
+				WriteIndexFile(os);
+			}
+		}
 	}
 
-	encoding = ToString(enc);
-	LHAFileHeader* header;
+	for (const auto& it : lzh_entries) {
+		index.Add(it.first, it.second.is_directory);
+	}
+}
 
-	LzhEntry entry;
-	std::vector<std::string> paths;
+bool LzhFilesystem::ReadHeaders() {
+	std::unique_ptr<LHAInputStream, LhasaDeleter> lha_is(lha_input_stream_new(&vio, &is));
+	std::unique_ptr<LHAReader, LhasaDeleter> lha_reader(lha_reader_new(lha_is.get()));
+
+	if (!lha_reader) {
+		return false;
+	}
+
+	struct Header {
+		std::string path;
+		std::string filename;
+		std::string compress_method;
+		size_t length;
+		size_t compressed_length;
+		size_t raw_data_len;
+		bool has_path;
+	};
 
 	// Compressed data offset is manually calculated to reduce calls to tellg()
 	auto last_offset = is.tellg();
 
+	// The headers are read once, the encoding is guessed from the stored names
+	std::vector<Header> headers;
+	LHAFileHeader* header;
+	while ((header = lha_reader_next_file(lha_reader.get())) != nullptr) {
+		Header h;
+		h.has_path = header->path != nullptr;
+		if (h.has_path) {
+			h.path = header->path;
+		}
+		if (header->filename != nullptr) {
+			h.filename = header->filename;
+		}
+		h.compress_method = header->compress_method;
+		h.length = header->length;
+		h.compressed_length = header->compressed_length;
+		h.raw_data_len = header->raw_data_len;
+		headers.push_back(std::move(h));
+	}
+
 	// Guess the encoding
 	if (encoding.empty()) {
 		std::stringstream filename_guess;
 		int items = 0;
 
-		while ((header = lha_reader_next_file(lha_reader.get())) != nullptr) {
-			std::string filepath;
-
+		for (const auto& h : headers) {
 			// Only consider Non-ASCII and skip directories
-			if (strcmp(header->compress_method, LHA_COMPRESS_TYPE_DIR) != 0) {
-				filepath = header->filename;
-				if (Utils::StringIsAscii(filepath)) {
+			if (h.compress_method != LHA_COMPRESS_TYPE_DIR) {
+				if (Utils::StringIsAscii(h.filename)) {
 					continue;
 				}
-				filename_guess << filepath;
+				filename_guess << h.filename;
 
 				++items;
 				if (items == 10) {
@@ -139,45 +182,37 @@ LzhFilesystem::LzhFilesystem(std::string base_path, FilesystemView parent_fs, St
 			}
 		}
 		Output::Debug("Detected LZH encoding: {}", encoding);
-
-		is.clear();
-		is.seekg(last_offset);
-
-		// Cannot figure out how to rewind the reader: Creating a new one instead
-		lha_reader.reset(lha_reader_new(lha_is.get()));
-
-		if (!lha_reader) {
-			Output::Debug("LzhFS: {} is not a valid archive", GetPath());
-			return;
-		}
 	}
 
 	// Read the archive
 	lcf::Encoder lzh_encoder(encoding);
 
-	while ((header = lha_reader_next_file(lha_reader.get())) != nullptr) {
+	LzhEntry entry;
+	std::vector<std::string> paths;
+
+	for (auto& h : headers) {
 		std::string filepath;
 
-		if (!strcmp(header->compress_method, LHA_COMPRESS_TYPE_DIR)) {
-			last_offset += header->raw_data_len;
+		if (h.compress_method == LHA_COMPRESS_TYPE_DIR) {
+			last_offset += h.raw_data_len;
 
-			filepath = header->path;
+			filepath = h.path;
 			lzh_encoder.Encode(filepath);
 			if (filepath.back() == '/') {
 				filepath.pop_back();
 			}
 			paths.push_back(filepath);
 		} else {
-			entry.uncompressed_size = header->length;
-			entry.compressed_size = header->compressed_length;
-			entry.fileoffset = last_offset + static_cast<std::streamoff>(header->raw_data_len);
+			entry.uncompressed_size = h.length;
+			entry.compressed_size = h.compressed_length;
+			entry.fileoffset = last_offset + static_cast<std::streamoff>(h.raw_data_len);
 			last_offset = entry.fileoffset + entry.compressed_size;
 
 			entry.is_directory = false;
-			entry.compress_method = header->compress_method;
-			if (header->path != nullptr) {
+			entry.compress_method = h.compress_method;
+			if (h.has_path) {
 				// File is not in the root
-				filepath = header->path;
+				filepath = h.path;
 				lzh_encoder.Encode(filepath);
 
 				// Safety check: Directories should end with a /
@@ -189,7 +224,7 @@ LzhFilesystem::LzhFilesystem(std::string base_path, FilesystemView parent_fs, St
 					filepath += '/';
 				}
 			}
-			std::string fname = header->filename;
+			std::string fname = std::move(h.filename);
 			lzh_encoder.Encode(fname);
 			filepath += fname;
 
@@ -231,6 +266,57 @@ LzhFilesystem::LzhFilesystem(std::string base_path, FilesystemView parent_fs, St
 		return a.first == b.first;
 	});
 	lzh_entries.erase(lzh_entries.begin(), entries_del_it.base());
+
+	return true;
+}
+
+bool LzhFilesystem::ReadIndexFile(std::istream& index_is) {
+	std::string index_encoding;
+	uint32_t count;
+	if (!ArchiveIndex::Read(index_is, index_encoding) || !ArchiveIndex::Read(index_is, count)) {
+		return false;
+	}
+
+	// Grow the list while reading, a wrong count runs into the end of the file instead of allocating
+	std::vector<std::pair<std::string, LzhEntry>> entries;
+	entries.reserve(std::min<uint32_t>(count, ArchiveIndex::max_reserved_entries));
+	for (uint32_t i = 0; i < count; ++i) {
+		std::pair<std::string, LzhEntry> it;
+		uint64_t compressed_size;
+		uint64_t uncompressed_size;
+		uint64_t fileoffset;
+		uint32_t is_directory;
+		if (!ArchiveIndex::Read(index_is, it.first) ||
+			!ArchiveIndex::Read(index_is, compressed_size) ||
+			!ArchiveIndex::Read(index_is, uncompressed_size) ||
+			!ArchiveIndex::Read(index_is, fileoffset) ||
+			!ArchiveIndex::Read(index_is, it.second.compress_method) ||
+			!ArchiveIndex::Read(index_is, is_directory)) {
+			return false;
+		}
+		it.second.compressed_size = static_cast<size_t>(compressed_size);
+		it.second.uncompressed_size = static_cast<size_t>(uncompressed_size);
+		it.second.fileoffset = static_cast<std::streamoff>(fileoffset);
+		it.second.is_directory = is_directory != 0;
+		entries.push_back(std::move(it));
+	}
+
+	encoding = std::move(index_encoding);
+	lzh_entries = std::move(entries);
+	return true;
+}
+
+void LzhFilesystem::WriteIndexFile(std::ostream& os) const {
+	ArchiveIndex::Write(os, encoding);
+	ArchiveIndex::Write(os, static_cast<uint32_t>(lzh_entries.size()));
+	for (const auto& it : lzh_entries) {
+		ArchiveIndex::Write(os, it.first);
+		ArchiveIndex::Write(os, static_cast<uint64_t>(it.second.compressed_size));
+		ArchiveIndex::Write(os, static_cast<uint64_t>(it.second.uncompressed_size));
+		ArchiveIndex::Write(os, static_cast<uint64_t>(it.second.fileoffset));
+		ArchiveIndex::Write(os, it.second.compress_method);
+		ArchiveIndex::Write(os, static_cast<uint32_t>(it.second.is_directory));
+	}
 }
 
 bool LzhFilesystem::IsFile(StringView path) const {
@@ -306,28 +392,9 @@ bool LzhFilesystem::GetDirectoryContent(StringView path, std::vector<DirectoryTr
 		return false;
 	}
 
-	std::string path_normalized = normalize_path(path);
-	if (!path_normalized.empty() && path_normalized.back() != '/') {
-		path_normalized += "/";
-	}
-
-	auto check = [&](auto& it) {
-		if (StringView(it.first).starts_with(path_normalized) &&
-			it.first.substr(path_normalized.size(), it.first.size() - path_normalized.size()).find_last_of('/') == std::string::npos) {
-			// Everything that starts with the path but isn't the path and does contain no slash
-			auto filename = it.first.substr(path_normalized.size(), it.first.size() - path_normalized.size());
-			if (filename.empty()) {
-				return;
-			}
-
-			entries.emplace_back(
-					it.first.substr(path_normalized.size(), it.first.size() - path_normalized.size()),
-					it.second.is_directory ? DirectoryTree::FileType::Directory : DirectoryTree::FileType::Regular);
-		}
-	};
-
-	for (const auto& it : lzh_entries) {
-		check(it);
+	auto* content = index.Find(normalize_path(path));
+	if (content) {
+		entries.insert(entries.end(), content->begin(), content->end());
 	}
 
 	return true;
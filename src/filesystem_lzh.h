@@ -23,6 +23,7 @@
 #ifdef HAVE_LHASA
 
 #include "filesystem.h"
+#include "filesystem_archive_index.h"
 #include "filesystem_stream.h"
 #include <fstream>
 #include <memory>
@@ -68,9 +69,16 @@ private:
 		bool is_directory;
 	};
 
+	/** Reads the entry list from the file headers, the encoding is detected when unset */
+	bool ReadHeaders();
+	/** Reads the entry list and the encoding from an index file created by WriteIndexFile */
+	bool ReadIndexFile(std::istream& index_is);
+	void WriteIndexFile(std::ostream& os) const;
 	const LzhEntry* Find(StringView what) const;
 
 	std::vector<std::pair<std::string, LzhEntry>> lzh_entries;
+	/** Content of all directories */
+	ArchiveIndex index;
 	std::string encoding;
 	mutable std::vector<char> filename_buffer;
 
@@ -89,8 +97,6 @@ private:
 	};
 
 	mutable Filesystem_Stream::InputStream is;
-	mutable std::unique_ptr<LHAInputStream, LhasaDeleter> lha_is;
-	mutable std::unique_ptr<LHAReader, LhasaDeleter> lha_reader;
 };
 
 #endif
@@ -120,7 +120,7 @@ bool NativeFilesystem::MakeDirectory(StringView path, bool follow_symlinks) cons
 }
 
 bool NativeFilesystem::IsFeatureSupported(Feature f) const {
-	return f == Filesystem::Feature::Write;
+	return f == Filesystem::Feature::Write || f == Filesystem::Feature::NativePath;
 }
 
 std::string NativeFilesystem::Describe() const {
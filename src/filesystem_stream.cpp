@@ -17,6 +17,7 @@
 
 #include "filesystem_stream.h"
 
+#include <algorithm>
 #include <utility>
 
 Filesystem_Stream::InputStream::InputStream(std::streambuf* sb, std::string name) :
@@ -122,3 +123,56 @@ Filesystem_Stream::InputMemoryStreamBuf::InputMemoryStreamBuf(std::vector<uint8_
 		: InputMemoryStreamBufView(buffer), buffer(std::move(buffer)) {
 
 }
+
+Filesystem_Stream::InputSharedMemoryStreamBuf::InputSharedMemoryStreamBuf(Span<uint8_t> buffer_view, std::shared_ptr<const void> owner)
+		: InputMemoryStreamBufView(buffer_view), owner(std::move(owner)) {
+
+}
+
+Filesystem_Stream::InputWindowStreamBuf::InputWindowStreamBuf(InputStream stream, std::streamoff offset, std::streamoff size)
+		: std::streambuf(), stream(std::move(stream)), offset(offset), size(size) {
+	setg(buffer.data(), buffer.data(), buffer.data());
+}
+
+std::streambuf::int_type Filesystem_Stream::InputWindowStreamBuf::underflow() {
+	std::streamoff pos = buffer_pos + (gptr() - eback());
+	if (pos >= size) {
+		return traits_type::eof();
+	}
+
+	std::streamsize n = 0;
+	if (stream.rdbuf()->pubseekpos(offset + pos, std::ios_base::in) == std::streambuf::pos_type(offset + pos)) {
+		n = stream.rdbuf()->sgetn(buffer.data(), std::min<std::streamoff>(buffer.size(), size - pos));
+	}
+
+	buffer_pos = pos;
+	setg(buffer.data(), buffer.data(), buffer.data() + std::max<std::streamsize>(n, 0));
+	if (n <= 0) {
+		return traits_type::eof();
+	}
+	return traits_type::to_int_type(*gptr());
+}
+
+std::streambuf::pos_type Filesystem_Stream::InputWindowStreamBuf::seekoff(std::streambuf::off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode mode) {
+	std::streambuf::pos_type off;
+	if (dir == std::ios_base::beg) {
+		off = offset;
+	} else if (dir == std::ios_base::cur) {
+		off = buffer_pos + (gptr() - eback()) + offset;
+	} else {
+		off = size + offset;
+	}
+	return seekpos(off, mode);
+}
+
+std::streambuf::pos_type Filesystem_Stream::InputWindowStreamBuf::seekpos(std::streambuf::pos_type pos, std::ios_base::openmode) {
+	std::streamoff off = Utils::Clamp<std::streamoff>(pos, 0, size);
+	if (off >= buffer_pos && off <= buffer_pos + (egptr() - eback())) {
+		setg(eback(), eback() + (off - buffer_pos), egptr());
+	} else {
+		// Read on the next underflow
+		buffer_pos = off;
+		setg(buffer.data(), buffer.data(), buffer.data());
+	}
+	return off;
+}
@@ -19,8 +19,10 @@
 #define EP_FILESYSTEM_STREAM_H
 
 // Headers
+#include <array>
 #include <cassert>
 #include <istream>
+#include <memory>
 #include <ostream>
 #include "filesystem.h"
 #include "utils.h"
@@ -96,6 +98,47 @@ namespace Filesystem_Stream {
 		std::vector<uint8_t> buffer;
 	};
 
+	/** Streambuf interface for an in-memory buffer. Keeps the owner of the buffer alive. */
+	class InputSharedMemoryStreamBuf : public InputMemoryStreamBufView {
+	public:
+		/**
+		 * @param buffer_view part of the buffer to read
+		 * @param owner object the buffer belongs to
+		 */
+		InputSharedMemoryStreamBuf(Span<uint8_t> buffer_view, std::shared_ptr<const void> owner);
+		InputSharedMemoryStreamBuf(InputSharedMemoryStreamBuf const& other) = delete;
+		InputSharedMemoryStreamBuf const& operator=(InputSharedMemoryStreamBuf const& other) = delete;
+
+	private:
+		std::shared_ptr<const void> owner;
+	};
+
+	/** Streambuf interface for a range of another stream. Takes ownership of the stream. */
+	class InputWindowStreamBuf : public std::streambuf {
+	public:
+		/**
+		 * @param stream stream to read from
+		 * @param offset start of the range in the stream
+		 * @param size size of the range
+		 */
+		InputWindowStreamBuf(InputStream stream, std::streamoff offset, std::streamoff size);
+		InputWindowStreamBuf(InputWindowStreamBuf const& other) = delete;
+		InputWindowStreamBuf const& operator=(InputWindowStreamBuf const& other) = delete;
+
+	protected:
+		std::streambuf::int_type underflow() override;
+		std::streambuf::pos_type seekoff(std::streambuf::off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode mode) override;
+		std::streambuf::pos_type seekpos(std::streambuf::pos_type pos, std::ios_base::openmode mode) override;
+
+	private:
+		InputStream stream;
+		std::streamoff offset = 0;
+		std::streamoff size = 0;
+		/** Position of the buffer start in the range */
+		std::streamoff buffer_pos = 0;
+		std::array<char, 8192> buffer;
+	};
+
 	static constexpr std::ios_base::seekdir CSeekdirToCppSeekdir(int origin);
 
 	static constexpr int CppSeekdirToCSeekdir(std::ios_base::seekdir origin);
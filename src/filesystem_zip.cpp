@@ -16,16 +16,18 @@
  */
 
 #include "filesystem_zip.h"
+#include "filesystem_archive_index.h"
 #include "filefinder.h"
 #include "output.h"
+#include "platform.h"
 #include "utils.h"
 
 #include <zlib.h>
 #include <lcf/encoder.h>
 #include <lcf/reader_util.h>
-#include <lcf/scope_guard.h>
 #include <iostream>
 #include <sstream>
+#include <array>
 #include <cassert>
 #include <algorithm>
 #include <fmt/core.h>
@@ -37,6 +39,211 @@ constexpr uint32_t central_directory_entry = 0x02014b50;
 constexpr uint32_t local_header = 0x04034b50;
 constexpr uint32_t local_header_size = 30;
 
+namespace {
+	/** Uncompressed bytes between two seek checkpoints, at least */
+	constexpr uint32_t checkpoint_min_interval = 1024 * 1024;
+	/** Checkpoints of an entry, at most. Each one holds the 32 KiB inflate window */
+	constexpr uint32_t max_checkpoints = 32;
+
+	struct InflateStateDeleter {
+		void operator()(z_stream* stream) const {
+			inflateEnd(stream);
+			delete stream;
+		}
+	};
+
+	/**
+	 * Streambuf that inflates a Deflate entry while it is read.
+	 * Seeks are resolved on the next read. Seeking backwards continues from
+	 * the closest checkpoint, a copy of the inflate state taken at regular
+	 * intervals, instead of inflating from the start of the entry again.
+	 */
+	class InflateStreamBuf : public std::streambuf {
+	public:
+		/**
+		 * @param source stream of the compressed data
+		 * @param size uncompressed size
+		 * @param name entry name for warnings
+		 */
+		InflateStreamBuf(std::unique_ptr<std::streambuf> source, uint32_t size, std::string name);
+		InflateStreamBuf(InflateStreamBuf const& other) = delete;
+		InflateStreamBuf const& operator=(InflateStreamBuf const& other) = delete;
+		~InflateStreamBuf() override;
+
+		/** @return Whether zlib was initialized */
+		bool IsOk() const;
+
+	protected:
+		std::streambuf::int_type underflow() override;
+		std::streambuf::pos_type seekoff(std::streambuf::off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode mode) override;
+		std::streambuf::pos_type seekpos(std::streambuf::pos_type pos, std::ios_base::openmode mode) override;
+
+	private:
+		struct Checkpoint {
+			/** Position in the uncompressed data */
+			uint32_t out_pos;
+			/** Position in the compressed data */
+			uint32_t in_pos;
+			std::unique_ptr<z_stream, InflateStateDeleter> state;
+		};
+
+		/** Inflates the next part of the entry into the buffer */
+		bool Fill();
+		/** Moves the inflate state back to the closest position before pos */
+		void Rewind(uint32_t pos);
+		void AddCheckpoint();
+
+		std::unique_ptr<std::streambuf> source;
+		uint32_t size;
+		std::string name;
+		z_stream stream = {};
+		bool ok = false;
+		/** Compressed bytes read from the source */
+		uint32_t in_pos = 0;
+		/** Uncompressed bytes produced by the stream */
+		uint32_t out_pos = 0;
+		/** Position of the buffer start in the uncompressed data */
+		uint32_t buffer_pos = 0;
+		uint32_t checkpoint_interval;
+		std::vector<Checkpoint> checkpoints;
+		std::array<Bytef, 16384> in_buffer;
+		std::array<char, 16384> out_buffer;
+	};
+
+	InflateStreamBuf::InflateStreamBuf(std::unique_ptr<std::streambuf> source, uint32_t size, std::string name) :
+		source(std::move(source)), size(size), name(std::move(name)) {
+		checkpoint_interval = std::max(checkpoint_min_interval, size / max_checkpoints);
+		ok = inflateInit2(&stream, -MAX_WBITS) == Z_OK;
+		setg(out_buffer.data(), out_buffer.data(), out_buffer.data());
+	}
+
+	InflateStreamBuf::~InflateStreamBuf() {
+		inflateEnd(&stream);
+	}
+
+	bool InflateStreamBuf::IsOk() const {
+		return ok;
+	}
+
+	bool InflateStreamBuf::Fill() {
+		if (!ok || out_pos >= size) {
+			return false;
+		}
+
+		if (out_pos >= (checkpoints.empty() ? 0 : checkpoints.back().out_pos) + checkpoint_interval) {
+			AddCheckpoint();
+		}
+
+		stream.next_out = reinterpret_cast<Bytef*>(out_buffer.data());
+		stream.avail_out = static_cast<uInt>(std::min<uint32_t>(out_buffer.size(), size - out_pos));
+		const uInt capacity = stream.avail_out;
+
+		while (stream.avail_out > 0) {
+			if (stream.avail_in == 0) {
+				auto n = source->sgetn(reinterpret_cast<char*>(in_buffer.data()), in_buffer.size());
+				if (n <= 0) {
+					Output::Warning("ZipFS: {} is truncated (Archive corrupted?)", name);
+					ok = false;
+					break;
+				}
+				stream.next_in = in_buffer.data();
+				stream.avail_in = static_cast<uInt>(n);
+				in_pos += static_cast<uint32_t>(n);
+			}
+
+			int zlib_error = inflate(&stream, Z_NO_FLUSH);
+			if (zlib_error == Z_STREAM_END) {
+				break;
+			} else if (zlib_error != Z_OK) {
+				Output::Warning("ZipFS: zlib failed for {}: {} ({})", name, zlib_error, stream.msg ? stream.msg : "No error message");
+				ok = false;
+				break;
+			}
+		}
+
+		const uint32_t n = capacity - stream.avail_out;
+		buffer_pos = out_pos;
+		out_pos += n;
+		setg(out_buffer.data(), out_buffer.data(), out_buffer.data() + n);
+		return n > 0;
+	}
+
+	void InflateStreamBuf::Rewind(uint32_t pos) {
+		auto it = std::find_if(checkpoints.rbegin(), checkpoints.rend(), [&](const auto& cp) {
+			return cp.out_pos <= pos;
+		});
+
+		if (it == checkpoints.rend()) {
+			ok = inflateReset(&stream) == Z_OK;
+			in_pos = 0;
+			out_pos = 0;
+		} else {
+			inflateEnd(&stream);
+			ok = inflateCopy(&stream, it->state.get()) == Z_OK;
+			in_pos = it->in_pos;
+			out_pos = it->out_pos;
+		}
+
+		stream.next_in = nullptr;
+		stream.avail_in = 0;
+		source->pubseekpos(in_pos, std::ios_base::in);
+	}
+
+	void InflateStreamBuf::AddCheckpoint() {
+		std::unique_ptr<z_stream, InflateStateDeleter> state(new z_stream());
+		if (inflateCopy(state.get(), &stream) != Z_OK) {
+			return;
+		}
+		checkpoints.push_back({out_pos, in_pos - stream.avail_in, std::move(state)});
+	}
+
+	std::streambuf::int_type InflateStreamBuf::underflow() {
+		const uint32_t pos = buffer_pos + static_cast<uint32_t>(gptr() - eback());
+		if (pos >= size) {
+			return traits_type::eof();
+		}
+
+		if (pos < out_pos) {
+			Rewind(pos);
+		}
+
+		do {
+			if (!Fill()) {
+				setg(out_buffer.data(), out_buffer.data(), out_buffer.data());
+				buffer_pos = pos;
+				return traits_type::eof();
+			}
+		} while (out_pos <= pos);
+
+		setg(eback(), eback() + (pos - buffer_pos), egptr());
+		return traits_type::to_int_type(*gptr());
+	}
+
+	std::streambuf::pos_type InflateStreamBuf::seekoff(std::streambuf::off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode mode) {
+		std::streambuf::pos_type off;
+		if (dir == std::ios_base::beg) {
+			off = offset;
+		} else if (dir == std::ios_base::cur) {
+			off = buffer_pos + (gptr() - eback()) + offset;
+		} else {
+			off = size + offset;
+		}
+		return seekpos(off, mode);
+	}
+
+	std::streambuf::pos_type InflateStreamBuf::seekpos(std::streambuf::pos_type pos, std::ios_base::openmode) {
+		auto off = static_cast<uint32_t>(Utils::Clamp<std::streambuf::pos_type>(pos, 0, size));
+		if (off >= buffer_pos && off <= buffer_pos + static_cast<uint32_t>(egptr() - eback())) {
+			setg(eback(), eback() + (off - buffer_pos), egptr());
+		} else {
+			// Inflated on the next underflow
+			buffer_pos = off;
+			setg(out_buffer.data(), out_buffer.data(), out_buffer.data());
+		}
+		return off;
+	}
+}
+
 static std::string normalize_path(StringView path) {
 	if (path == "." || path == "/" || path.empty()) {
 		return "";
@@ -59,32 +266,79 @@ ZipFilesystem::ZipFilesystem(std::string base_path, FilesystemView parent_fs, St
 		return;
 	}
 
+	encoding = ToString(enc);
+	const std::string index_key = "zip:" + encoding;
+
+	auto index_file = ArchiveIndex::OpenIndexFile(parent_fs, GetPath(), index_key);
+	if (!index_file || !ReadIndexFile(index_file)) {
+		if (!ReadCentralDirectory(zipfile)) {
+			Output::Debug("ZipFS: {} is not a valid archive", GetPath());
+			return;
+		}
+
+		if (zip_entries.size() >= ArchiveIndex::GetMinFileEntries()) {
+			// Scanning large archives is slow on some devices, store the result for the next launch
+			auto os = ArchiveIndex::CreateIndexFile(parent_fs, GetPath(), index_key);
+			if (os) {
+				WriteIndexFile(os);
+			}
+		}
+	}
+
+	for (const auto& it : zip_entries) {
+		index.Add(it.first, it.second.is_directory);
+	}
+	for (const auto& it : zip_entries_cp437) {
+		index.Add(it.first, it.second.is_directory);
+	}
+
+	if (parent_fs.IsFeatureSupported(Feature::NativePath)) {
+		// Entries are read straight from the mapping when the archive is a real file
+		auto mapping = std::make_shared<const Platform::MappedFile>(parent_fs.MakePath(GetPath()));
+		if (*mapping) {
+			archive_map = std::move(mapping);
+		}
+	}
+}
+
+bool ZipFilesystem::ReadCentralDirectory(std::istream& zipfile) {
 	uint16_t central_directory_entries = 0;
 	uint32_t central_directory_size = 0;
 	uint32_t central_directory_offset = 0;
 
-	ZipEntry entry = {};
-	entry.is_directory = false;
-	std::string filepath;
-	std::string filepath_cp437;
-	bool is_utf8;
-
-	encoding = ToString(enc);
 	if (!FindCentralDirectory(zipfile, central_directory_offset, central_directory_size, central_directory_entries)) {
-		Output::Debug("ZipFS: {} is not a valid archive", GetPath());
-		return;
+		return false;
+	}
+
+	struct CentralEntry {
+		std::string filepath;
+		ZipEntry entry;
+		bool is_utf8;
+	};
+
+	// The central directory is read once, the encoding is guessed from the stored names
+	std::vector<CentralEntry> central_entries;
+	central_entries.reserve(central_directory_entries);
+
+	zipfile.clear();
+	zipfile.seekg(central_directory_offset);
+
+	CentralEntry central = {};
+	while (ReadCentralDirectoryEntry(zipfile, central.filepath, central.entry, central.is_utf8)) {
+		central.entry.is_directory = false;
+		central_entries.push_back(central);
 	}
 
 	if (encoding.empty()) {
-		zipfile.seekg(central_directory_offset);
 		std::stringstream filename_guess;
 
 		// Guess the encoding first
 		int items = 0;
-		while (ReadCentralDirectoryEntry(zipfile, filepath, entry, is_utf8)) {
+		for (const auto& it : central_entries) {
+			const auto& filepath = it.filepath;
 			// Only consider Non-ASCII & Non-UTF8 for encoding detection
 			// Skip directories, files already contain the paths
-			if (is_utf8 || filepath.back() == '/' || Utils::StringIsAscii(filepath)) {
+			if (it.is_utf8 || filepath.back() == '/' || Utils::StringIsAscii(filepath)) {
 				continue;
 			}
 			// Codepath will be only entered by Windows "compressed folder" ZIPs (uses local encoding) and
@@ -124,14 +378,13 @@ ZipFilesystem::ZipFilesystem(std::string base_path, FilesystemView parent_fs, St
 	}
 	bool enc_is_utf8 = encoding == "UTF-8";
 
-	zipfile.clear();
-	zipfile.seekg(central_directory_offset);
-
 	lcf::Encoder detected_encoder(encoding);
 	lcf::Encoder cp437_encoder("437");
 	std::vector<std::string> paths;
-	while (ReadCentralDirectoryEntry(zipfile, filepath, entry, is_utf8)) {
-		if (is_utf8 || enc_is_utf8 || Utils::StringIsAscii(filepath)) {
+	std::string filepath_cp437;
+	for (auto& it : central_entries) {
+		auto& filepath = it.filepath;
+		if (it.is_utf8 || enc_is_utf8 || Utils::StringIsAscii(filepath)) {
 			// No reencoding necessary
 			filepath_cp437.clear();
 		} else {
@@ -156,9 +409,9 @@ ZipFilesystem::ZipFilesystem(std::string base_path, FilesystemView parent_fs, St
 				filepath = std::get<0>(FileFinder::GetPathAndFilename(filepath));
 			}
 		} else {
-			zip_entries.emplace_back(filepath, entry);
+			zip_entries.emplace_back(filepath, it.entry);
 			if (!filepath_cp437.empty()) {
-				zip_entries_cp437.emplace_back(filepath_cp437, entry);
+				zip_entries_cp437.emplace_back(filepath_cp437, it.entry);
 			}
 
 			// Determine intermediate directories
@@ -172,7 +425,7 @@ ZipFilesystem::ZipFilesystem(std::string base_path, FilesystemView parent_fs, St
 		}
 	}
 	// Build directories
-	entry = {};
+	ZipEntry entry = {};
 	entry.is_directory = true;
 
 	// add root path
@@ -205,6 +458,60 @@ ZipFilesystem::ZipFilesystem(std::string base_path, FilesystemView parent_fs, St
 		return a.first == b.first;
 	});
 	zip_entries_cp437.erase(zip_entries_cp437.begin(), entries_del_it.base());
+
+	return true;
+}
+
+bool ZipFilesystem::ReadIndexFile(std::istream& is) {
+	std::string index_encoding;
+	std::array<std::vector<std::pair<std::string, ZipEntry>>, 2> lists;
+
+	if (!ArchiveIndex::Read(is, index_encoding)) {
+		return false;
+	}
+
+	for (auto& list : lists) {
+		uint32_t count;
+		if (!ArchiveIndex::Read(is, count)) {
+			return false;
+		}
+
+		// Grow the list while reading, a wrong count runs into the end of the file instead of allocating
+		list.reserve(std::min<uint32_t>(count, ArchiveIndex::max_reserved_entries));
+		for (uint32_t i = 0; i < count; ++i) {
+			std::pair<std::string, ZipEntry> it;
+			uint32_t is_directory;
+			if (!ArchiveIndex::Read(is, it.first) ||
+				!ArchiveIndex::Read(is, it.second.compressed_size) ||
+				!ArchiveIndex::Read(is, it.second.uncompressed_size) ||
+				!ArchiveIndex::Read(is, it.second.fileoffset) ||
+				!ArchiveIndex::Read(is, is_directory)) {
+				return false;
+			}
+			it.second.is_directory = is_directory != 0;
+			list.push_back(std::move(it));
+		}
+	}
+
+	encoding = std::move(index_encoding);
+	zip_entries = std::move(lists[0]);
+	zip_entries_cp437 = std::move(lists[1]);
+	return true;
+}
+
+void ZipFilesystem::WriteIndexFile(std::ostream& os) const {
+	ArchiveIndex::Write(os, encoding);
+
+	for (const auto* list : {&zip_entries, &zip_entries_cp437}) {
+		ArchiveIndex::Write(os, static_cast<uint32_t>(list->size()));
+		for (const auto& it : *list) {
+			ArchiveIndex::Write(os, it.first);
+			ArchiveIndex::Write(os, it.second.compressed_size);
+			ArchiveIndex::Write(os, it.second.uncompressed_size);
+			ArchiveIndex::Write(os, it.second.fileoffset);
+			ArchiveIndex::Write(os, static_cast<uint32_t>(it.second.is_directory));
+		}
+	}
 }
 
 bool ZipFilesystem::FindCentralDirectory(std::istream& zipfile, uint32_t& offset, uint32_t& size, uint16_t& num_entries) const {
@@ -386,40 +693,33 @@ std::streambuf* ZipFilesystem::CreateInputStreambuffer(StringView path, std::ios
 				return nullptr;
 			}
 
-			zip_file.seekg(central_entry->fileoffset + local_entry.fileoffset);
-			if (method == StorageMethod::Plain) {
-				auto data = std::vector<uint8_t>(local_entry.uncompressed_size);
-				zip_file.read(reinterpret_cast<char*>(data.data()), data.size());
-				return new Filesystem_Stream::InputMemoryStreamBuf(std::move(data));
-			} else if (method == StorageMethod::Deflate) {
-				std::vector<uint8_t> comp_buf;
-				comp_buf.resize(local_entry.compressed_size);
-				zip_file.read(reinterpret_cast<char*>(comp_buf.data()), comp_buf.size());
-				auto dec_buf = std::vector<uint8_t>(local_entry.uncompressed_size);
-				z_stream zlib_stream = {};
-				zlib_stream.next_in = reinterpret_cast<Bytef*>(comp_buf.data());
-				zlib_stream.avail_in = static_cast<uInt>(comp_buf.size());
-				zlib_stream.next_out = reinterpret_cast<Bytef*>(dec_buf.data());
-				zlib_stream.avail_out = static_cast<uInt>(dec_buf.size());
-				inflateInit2(&zlib_stream, -MAX_WBITS);
-				auto inflate_sg = lcf::makeScopeGuard([&]() {
-					inflateEnd(&zlib_stream);
-				});
-
-				int zlib_error = inflate(&zlib_stream, Z_NO_FLUSH);
-				if (zlib_error == Z_OK) {
-					Output::Warning("ZipFS: zlib failed for {}: More data available (Archive corrupted?)", path_normalized);
-					return nullptr;
-				}
-				else if (zlib_error != Z_STREAM_END) {
-					Output::Warning("ZipFS: zlib failed for {}: {} ({})", path_normalized, zlib_error, zlib_stream.msg ? zlib_stream.msg : "No error message");
-					return nullptr;
-				}
-				return new Filesystem_Stream::InputMemoryStreamBuf(std::move(dec_buf));
-			} else {
+			if (method != StorageMethod::Plain && method != StorageMethod::Deflate) {
 				Output::Warning("ZipFS: {} has unsupported compression format. Only Deflate is supported", path_normalized);
 				return nullptr;
 			}
+
+			const uint64_t data_offset = static_cast<uint64_t>(central_entry->fileoffset) + local_entry.fileoffset;
+			const uint32_t data_size = method == StorageMethod::Plain ? local_entry.uncompressed_size : local_entry.compressed_size;
+
+			// Reads the stored data of the entry without copying it
+			std::unique_ptr<std::streambuf> data_buf;
+			if (archive_map && data_offset + data_size <= archive_map->GetSize()) {
+				auto* data = const_cast<uint8_t*>(archive_map->GetData()) + data_offset;
+				data_buf = std::make_unique<Filesystem_Stream::InputSharedMemoryStreamBuf>(Span<uint8_t>(data, data_size), archive_map);
+			} else {
+				data_buf = std::make_unique<Filesystem_Stream::InputWindowStreamBuf>(std::move(zip_file), data_offset, data_size);
+			}
+
+			if (method == StorageMethod::Plain) {
+				return data_buf.release();
+			}
+
+			auto inflate_buf = std::make_unique<InflateStreamBuf>(std::move(data_buf), local_entry.uncompressed_size, path_normalized);
+			if (!inflate_buf->IsOk()) {
+				Output::Warning("ZipFS: zlib failed for {}: Initialization failed", path_normalized);
+				return nullptr;
+			}
+			return inflate_buf.release();
 		}
 	}
 	return nullptr;
@@ -430,32 +730,9 @@ bool ZipFilesystem::GetDirectoryContent(StringView path, std::vector<DirectoryTr
 		return false;
 	}
 
-	std::string path_normalized = normalize_path(path);
-	if (!path_normalized.empty() && path_normalized.back() != '/') {
-		path_normalized += "/";
-	}
-
-	auto check = [&](auto& it) {
-		if (StringView(it.first).starts_with(path_normalized) &&
-			it.first.substr(path_normalized.size(), it.first.size() - path_normalized.size()).find_last_of('/') == std::string::npos) {
-			// Everything that starts with the path but isn't the path and does contain no slash
-			auto filename = it.first.substr(path_normalized.size(), it.first.size() - path_normalized.size());
-			if (filename.empty()) {
-				return;
-			}
-
-			entries.emplace_back(
-					it.first.substr(path_normalized.size(), it.first.size() - path_normalized.size()),
-					it.second.is_directory ? DirectoryTree::FileType::Directory : DirectoryTree::FileType::Regular);
-		}
-	};
-
-	for (const auto& it : zip_entries) {
-		check(it);
-	}
-
-	for (const auto& it : zip_entries_cp437) {
-		check(it);
+	auto* content = index.Find(normalize_path(path));
+	if (content) {
+		entries.insert(entries.end(), content->begin(), content->end());
 	}
 
 	return true;
@@ -19,12 +19,17 @@
 #define EP_FILESYSTEM_ZIP_H
 
 #include "filesystem.h"
+#include "filesystem_archive_index.h"
 #include "filesystem_stream.h"
 #include <fstream>
 #include <memory>
 #include <unordered_map>
 #include <vector>
 
+namespace Platform {
+	class MappedFile;
+}
+
 /**
  * A virtual filesystem that allows file/directory operations inside a ZIP archive.
  */
@@ -62,6 +67,11 @@ private:
 		bool is_directory;
 	};
 
+	/** Reads the entry list from the central directory, the encoding is detected when unset */
+	bool ReadCentralDirectory(std::istream& zipfile);
+	/** Reads the entry list and the encoding from an index file created by WriteIndexFile */
+	bool ReadIndexFile(std::istream& is);
+	void WriteIndexFile(std::ostream& os) const;
 	bool FindCentralDirectory(std::istream& stream, uint32_t& offset, uint32_t& size, uint16_t& num_entries) const;
 	bool ReadCentralDirectoryEntry(std::istream& zipfile, std::string& filepath, ZipEntry& entry, bool& is_utf8) const;
 	bool ReadLocalHeader(std::istream& zipfile, StorageMethod& method, ZipEntry& entry) const;
@@ -69,8 +79,12 @@ private:
 
 	std::vector<std::pair<std::string, ZipEntry>> zip_entries;
 	std::vector<std::pair<std::string, ZipEntry>> zip_entries_cp437;
+	/** Content of all directories, both lists are indexed */
+	ArchiveIndex index;
 	std::string encoding;
 	mutable std::vector<char> filename_buffer;
+	/** Archive mapped into memory, null when mapping is not possible */
+	std::shared_ptr<const Platform::MappedFile> archive_map;
 };
 
 #endif
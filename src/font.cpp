@@ -235,7 +235,9 @@ namespace {
 
 BitmapFont::BitmapFont(StringView name, function_type func)
 	: Font(name, HEIGHT, false, false), func(func)
-{}
+{
+	atlas = std::make_unique<GlyphAtlas>();
+}
 
 Rect BitmapFont::vGetSize(char32_t glyph) const {
 	auto bm_glyph = func(glyph);
@@ -302,6 +304,8 @@ FTFont::FTFont(Filesystem_Stream::InputStream is, int size, bool bold, bool ital
 
 	baseline_offset = static_cast<int>(size * (10.0 / 12.0));
 
+	atlas = std::make_unique<GlyphAtlas>();
+
 	if (!strcmp(face->family_name, "RM2000") || !strcmp(face->family_name, "RMG2000")) {
 		// Workaround for bad kerning in RM2000 and RMG2000 fonts
 		rm2000_workaround = true;
@@ -594,6 +598,11 @@ FontRef Font::CreateFtFont(Filesystem_Stream::InputStream is, int size, bool bol
 void Font::ResetDefault() {
 	SetDefault(nullptr, true);
 	SetDefault(nullptr, false);
+
+	// The glyph lookup of the bitmap fonts depends on the encoding of the game
+	for (auto& font : {gothic, mincho, rmg2000, ttyp0}) {
+		font->atlas->Clear();
+	}
 }
 
 void Font::Dispose() {
@@ -644,9 +653,10 @@ Point Font::Render(Bitmap& dest, int const x, int const y, const Bitmap& sys, in
 		return {};
 	}
 
-	auto gret = vRender(glyph);
+	Rect src_rect;
+	auto gret = RenderGlyph(glyph, false, src_rect);
 
-	auto rect = Rect(x, y, gret.bitmap->width(), gret.bitmap->height());
+	auto rect = Rect(x, y, src_rect.width, src_rect.height);
 	if (EP_UNLIKELY(rect.width == 0)) {
 		return {};
 	}
@@ -660,7 +670,7 @@ Point Font::Render(Bitmap& dest, int const x, int const y, const Bitmap& sys, in
 	if (color != ColorShadow) {
 		if (!gret.has_color && current_style.draw_shadow) {
 			auto shadow_rect = Rect(rect.x + 1, rect.y + 1, rect.width, rect.height);
-			dest.MaskedBlit(shadow_rect, *gret.bitmap, 0, 0, sys, 16, 32);
+			dest.MaskedBlit(shadow_rect, *gret.bitmap, src_rect.x, src_rect.y, sys, 16, 32);
 		}
 
 		src_x = color % 10 * 16 + 2;
@@ -674,19 +684,19 @@ Point Font::Render(Bitmap& dest, int const x, int const y, const Bitmap& sys, in
 		if (current_style.draw_gradient) {
 			// When the glyph is large the system graphic color mask will be outside the rectangle
 			// Move the mask slightly up to avoid this
-			int offset = gret.bitmap->height() - gret.offset.y;
+			int offset = src_rect.height - gret.offset.y;
 			if (offset > 12) {
 				src_y -= offset - 12;
 			}
 
-			dest.MaskedBlit(rect, *gret.bitmap, 0, 0, sys, src_x, src_y);
+			dest.MaskedBlit(rect, *gret.bitmap, src_rect.x, src_rect.y, sys, src_x, src_y);
 		} else {
 			auto col = sys.GetColorAt(current_style.color_offset.x + src_x, current_style.color_offset.y + src_y);
-			auto col_bm = Bitmap::Create(gret.bitmap->width(), gret.bitmap->height(), col);
-			dest.MaskedBlit(rect, *gret.bitmap, 0, 0, *col_bm, 0, 0);
+			auto col_bm = Bitmap::Create(src_rect.width, src_rect.height, col);
+			dest.MaskedBlit(rect, *gret.bitmap, src_rect.x, src_rect.y, *col_bm, 0, 0);
 		}
 	} else {
-		dest.Blit(rect.x, rect.y, *gret.bitmap, gret.bitmap->GetRect(), Opacity::Opaque());
+		dest.Blit(rect.x, rect.y, *gret.bitmap, src_rect, Opacity::Opaque());
 	}
 
 	gret.advance.x += current_style.letter_spacing;
@@ -699,9 +709,10 @@ Point Font::Render(Bitmap& dest, int const x, int const y, const Bitmap& sys, in
 		return Render(dest, x, y, sys, color, shape.code);
 	}
 
-	auto gret = vRenderShaped(shape.code);
+	Rect src_rect;
+	auto gret = RenderGlyph(shape.code, true, src_rect);
 
-	auto rect = Rect(x, y, gret.bitmap->width(), gret.bitmap->height());
+	auto rect = Rect(x, y, src_rect.width, src_rect.height);
 	if (EP_UNLIKELY(rect.width == 0)) {
 		return {};
 	}
@@ -715,7 +726,7 @@ Point Font::Render(Bitmap& dest, int const x, int const y, const Bitmap& sys, in
 	if (color != ColorShadow) {
 		if (!gret.has_color && current_style.draw_shadow) {
 			auto shadow_rect = Rect(rect.x + 1, rect.y + 1, rect.width, rect.height);
-			dest.MaskedBlit(shadow_rect, *gret.bitmap, 0, 0, sys, 16, 32);
+			dest.MaskedBlit(shadow_rect, *gret.bitmap, src_rect.x, src_rect.y, sys, 16, 32);
 		}
 
 		src_x = color % 10 * 16 + 2;
@@ -723,7 +734,7 @@ Point Font::Render(Bitmap& dest, int const x, int const y, const Bitmap& sys, in
 
 		// When the glyph is large the system graphic color mask will be outside the rectangle
 		// Move the mask slightly up to avoid this
-		int offset = gret.bitmap->height() - shape.offset.y - gret.offset.y;
+		int offset = src_rect.height - shape.offset.y - gret.offset.y;
 		if (offset > 12) {
 			src_y -= offset - 12;
 		}
@@ -733,9 +744,9 @@ Point Font::Render(Bitmap& dest, int const x, int const y, const Bitmap& sys, in
 	}
 
 	if (!gret.has_color) {
-		dest.MaskedBlit(rect, *gret.bitmap, 0, 0, sys, src_x, src_y);
+		dest.MaskedBlit(rect, *gret.bitmap, src_rect.x, src_rect.y, sys, src_x, src_y);
 	} else {
-		dest.Blit(rect.x, rect.y, *gret.bitmap, gret.bitmap->GetRect(), Opacity::Opaque());
+		dest.Blit(rect.x, rect.y, *gret.bitmap, src_rect, Opacity::Opaque());
 	}
 
 	Point advance = { shape.advance.x + current_style.letter_spacing, shape.advance.y };
@@ -747,16 +758,38 @@ Point Font::Render(Bitmap& dest, int x, int y, Color const& color, char32_t glyp
 		return {};
 	}
 
-	auto gret = vRender(glyph);
+	Rect src_rect;
+	auto gret = RenderGlyph(glyph, false, src_rect);
 
-	auto rect = Rect(x, y, gret.bitmap->width(), gret.bitmap->height());
-	dest.MaskedBlit(rect, *gret.bitmap, 0, 0, color);
+	auto rect = Rect(x, y, src_rect.width, src_rect.height);
+	dest.MaskedBlit(rect, *gret.bitmap, src_rect.x, src_rect.y, color);
 
 	gret.advance.x += current_style.letter_spacing;
 
 	return gret.advance;
 }
 
+Font::GlyphRet Font::RenderGlyph(char32_t glyph, bool shaped, Rect& rect) const {
+	uint64_t key = 0;
+	if (atlas) {
+		key = GlyphAtlas::MakeKey(glyph, current_style.size, shaped);
+		if (auto* cached = atlas->Find(key)) {
+			rect = cached->rect;
+			return { cached->bitmap, cached->advance, cached->offset };
+		}
+	}
+
+	auto gret = shaped ? vRenderShaped(glyph) : vRender(glyph);
+	rect = gret.bitmap->GetRect();
+
+	// Colored glyphs are not masked and cannot be stored in the alpha pages
+	if (atlas && !gret.has_color) {
+		atlas->Insert(key, *gret.bitmap, gret.advance, gret.offset);
+	}
+
+	return gret;
+}
+
 bool Font::CanShape() const {
 	return vCanShape();
 }
@@ -20,11 +20,13 @@
 
 // Headers
 #include "filesystem_stream.h"
+#include "glyph_atlas.h"
 #include "point.h"
 #include "system.h"
 #include "memory_management.h"
 #include "rect.h"
 #include "string_view.h"
+#include <memory>
 #include <string>
 #include <lcf/scope_guard.h>
 
@@ -252,11 +254,23 @@ class Font {
  protected:
 	Font(StringView name, int size, bool bold, bool italic);
 
+	/**
+	 * Fetches a glyph from the glyph atlas and renders it when it is not cached.
+	 *
+	 * @param glyph which utf32 glyph or, when shaped, which glyph index to render
+	 * @param shaped whether to render through vRenderShaped
+	 * @param rect receives the area of the returned bitmap containing the glyph
+	 * @return rendered glyph
+	 */
+	GlyphRet RenderGlyph(char32_t glyph, bool shaped, Rect& rect) const;
+
 	std::string name;
 	bool style_applied = false;
 	Style original_style;
 	Style current_style;
 	FontRef fallback_font;
+	/** Cache of rendered glyphs, nullptr when the rendered glyphs can change */
+	std::unique_ptr<GlyphAtlas> atlas;
 };
 
 #endif
@@ -16,6 +16,8 @@
  */
 
 #include <sstream>
+#include <algorithm>
+#include <fmt/format.h>
 
 #include "fps_overlay.h"
 #include "game_clock.h"
@@ -23,7 +25,9 @@
 #include "utils.h"
 #include "input.h"
 #include "font.h"
+#include "damage_tracker.h"
 #include "drawable_mgr.h"
+#include "player.h"
 
 using namespace std::chrono_literals;
 
@@ -59,6 +63,106 @@ bool FpsOverlay::Update() {
 
 	UpdateText();
 
+	if (Instrumentation::IsProfilerEnabled()) {
+		UpdateProfileText();
+	}
+
+	return true;
+}
+
+void FpsOverlay::UpdateProfileText() {
+	auto stats = Instrumentation::GetZoneStats();
+	auto frame = Instrumentation::GetFrameCount();
+	auto frames = std::max<uint64_t>(frame - last_profile_frame, 1);
+
+	struct Line {
+		const char* name;
+		double ms;
+	};
+	std::vector<Line> lines;
+	for (size_t i = 0; i < stats.size(); ++i) {
+		uint64_t ns = stats[i].total_ns;
+		if (i < last_profile_stats.size()) {
+			ns -= last_profile_stats[i].total_ns;
+		}
+		if (ns > 0) {
+			lines.push_back({ stats[i].name, ns / 1e6 / frames });
+		}
+	}
+	std::sort(lines.begin(), lines.end(), [](const Line& l, const Line& r) { return l.ms > r.ms; });
+
+	profile_lines.clear();
+	for (const auto& line: lines) {
+		profile_lines.push_back(fmt::format("{:6.2f}ms {}", line.ms, line.name));
+	}
+
+	last_profile_stats = std::move(stats);
+	last_profile_frame = frame;
+	profile_dirty = true;
+}
+
+void FpsOverlay::DrawProfile(Bitmap& dst, int y) {
+	if (profile_lines.empty()) {
+		return;
+	}
+
+	if (profile_dirty) {
+		const auto& font = *Font::DefaultBitmapFont();
+		int width = 0;
+		int line_height = 0;
+		for (const auto& line: profile_lines) {
+			Rect rect = Text::GetSize(font, line);
+			width = std::max(width, rect.width + 1);
+			line_height = std::max(line_height, rect.height);
+		}
+		int height = line_height * static_cast<int>(profile_lines.size());
+
+		if (!profile_bitmap || profile_bitmap->GetWidth() < width || profile_bitmap->GetHeight() != height) {
+			profile_bitmap = Bitmap::Create(width, height, true);
+		}
+		profile_bitmap->Clear();
+		profile_bitmap->Fill(Color(0, 0, 0, 128));
+
+		int line_y = 0;
+		for (const auto& line: profile_lines) {
+			Text::Draw(*profile_bitmap, 1, line_y, font, Color(255, 255, 255, 255), line);
+			line_y += line_height;
+		}
+
+		profile_dirty = false;
+	}
+
+	dst.Blit(1, y, *profile_bitmap, profile_bitmap->GetRect(), 255);
+}
+
+bool FpsOverlay::GetDamageState(DamageState& state) const {
+	const bool draw_profile = draw_fps && Instrumentation::IsProfilerEnabled();
+	const bool draw_speedup = last_speed_mod > 1;
+
+	if ((draw_fps && fps_dirty) || (draw_profile && profile_dirty) || (draw_speedup && speedup_dirty)) {
+		// Text bitmaps are rebuilt in Draw() and their size is not known yet
+		return false;
+	}
+
+	int height = 0;
+	if (draw_fps) {
+		height = 2 + fps_rect.height;
+		if (draw_profile && profile_bitmap && !profile_lines.empty()) {
+			height += 1 + profile_bitmap->GetHeight();
+		}
+	}
+	if (draw_speedup) {
+		height = std::max(height, 2 + speedup_rect.height);
+	}
+
+	// Everything is in a band along the top of the screen
+	state.bounds = Rect(0, 0, Player::screen_width, height);
+
+	auto gen = [](const BitmapRef& bitmap) { return bitmap ? bitmap->GetGeneration() : 0u; };
+	state.Hash(draw_fps, draw_profile, last_speed_mod, profile_lines.empty(),
+		fps_bitmap.get(), gen(fps_bitmap), speedup_bitmap.get(), gen(speedup_bitmap),
+		profile_bitmap.get(), gen(profile_bitmap),
+		fps_rect.width, fps_rect.height, speedup_rect.width, speedup_rect.height);
 	return true;
 }
 
@@ -82,6 +186,10 @@ void FpsOverlay::Draw(Bitmap& dst) {
 		}
 
 		dst.Blit(1, 2, *fps_bitmap, fps_rect, 255);
+
+		if (Instrumentation::IsProfilerEnabled()) {
+			DrawProfile(dst, 2 + fps_rect.height + 1);
+		}
 	}
 
 	// Always drawn when speedup is on independent of FPS
@@ -20,14 +20,18 @@
 
 #include <deque>
 #include <string>
+#include <vector>
 #include "drawable.h"
 #include "memory_management.h"
 #include "rect.h"
 #include "game_clock.h"
+#include "instrumentation.h"
 
 /**
  * FpsOverlay class.
  * Shows current FPS and the speedup indicator.
+ * When the built-in profiler is enabled the average time per frame
+ * of every zone is listed below the FPS.
  */
 class FpsOverlay : public Drawable {
 public:
@@ -35,6 +39,8 @@ public:
 
 	void Draw(Bitmap& dst) override;
 
+	bool GetDamageState(DamageState& state) const override;
+
 	/**
 	 * Update the fps overlay.
 	 *
@@ -58,6 +64,8 @@ public:
 
 private:
 	void UpdateText();
+	void UpdateProfileText();
+	void DrawProfile(Bitmap& dst, int y);
 
 	BitmapRef fps_bitmap;
 	BitmapRef speedup_bitmap;
@@ -69,6 +77,14 @@ private:
 
 	std::string text;
 
+	/** One line per profiler zone */
+	std::vector<std::string> profile_lines;
+	/** Zone statistics and frame count at the last refresh */
+	std::vector<Instrumentation::ZoneStat> last_profile_stats;
+	uint64_t last_profile_frame = 0;
+	BitmapRef profile_bitmap;
+	bool profile_dirty = false;
+
 	int last_speed_mod = 1;
 	bool speedup_dirty = true;
 	bool fps_dirty = true;
@@ -43,6 +43,22 @@ Game_Character::Game_Character(Type type, lcf::rpg::SaveMapEventBase* d) :
 Game_Character::~Game_Character() {
 }
 
+void Game_Character::SetX(int new_x) {
+	const int old_x = GetX();
+	data()->position_x = new_x;
+	if (GetType() == Event && old_x != new_x) {
+		Game_Map::UpdateEventPosition(*this, old_x, GetY());
+	}
+}
+
+void Game_Character::SetY(int new_y) {
+	const int old_y = GetY();
+	data()->position_y = new_y;
+	if (GetType() == Event && old_y != new_y) {
+		Game_Map::UpdateEventPosition(*this, GetX(), old_y);
+	}
+}
+
 void Game_Character::SanitizeData(StringView name) {
 	SanitizeMoveRoute(name, data()->move_route, data()->move_route_index, "move_route_index");
 }
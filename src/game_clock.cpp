@@ -33,8 +33,12 @@ Game_Clock::duration Game_Clock::OnNextFrame(time_point now) {
 
 	const auto dt = now - data.frame_time;
 	data.frame_time = now;
-	data.frame_accumulator += std::chrono::duration_cast<duration>(dt * data.speed);
-	data.frame_accumulator = std::min(data.frame_accumulator, mfa);
+	if (data.fixed_step) {
+		data.frame_accumulator += GetTargetGameTimeStep();
+	} else {
+		data.frame_accumulator += std::chrono::duration_cast<duration>(dt * data.speed);
+		data.frame_accumulator = std::min(data.frame_accumulator, mfa);
+	}
 
 	const auto fps = (1.0f / std::chrono::duration<float>(dt).count());
 	data.fps = (data.fps * _fps_smooth) + (fps * (1.0f - _fps_smooth));
@@ -76,6 +76,18 @@ public:
 	/** @return the speed up or slowdown factor we'll use to run the game. */
 	static float GetGameSpeedFactor();
 
+	/**
+	 * Enables fixed time stepping. When enabled every call to OnNextFrame
+	 * schedules exactly one logical frame, regardless of how much real time
+	 * passed. Used for unattended runs that should go as fast as possible.
+	 *
+	 * @param fixed whether to use a fixed time step
+	 */
+	static void SetFixedTimeStep(bool fixed);
+
+	/** @return whether fixed time stepping is enabled */
+	static bool IsFixedTimeStep();
+
 	/** Get the time of the current frame */
 	static time_point GetFrameTime();
 
@@ -117,6 +129,7 @@ private:
 		float speed = 1.0;
 		float fps = 0.0;
 		int frame = 0;
+		bool fixed_step = false;
 	};
 	static Data data;
 };
@@ -180,4 +193,12 @@ inline float Game_Clock::GetGameSpeedFactor() {
 	return data.speed;
 }
 
+inline void Game_Clock::SetFixedTimeStep(bool fixed) {
+	data.fixed_step = fixed;
+}
+
+inline bool Game_Clock::IsFixedTimeStep() {
+	return data.fixed_step;
+}
+
 #endif
@@ -89,6 +89,13 @@ std::vector<lcf::rpg::EventCommand>& Game_CommonEvent::GetList() {
 	return lcf::ReaderUtil::GetElement(lcf::Data::commonevents, common_event_id)->event_commands;
 }
 
+Game_Interpreter::CommandList Game_CommonEvent::GetSharedList() {
+	if (!shared_list) {
+		shared_list = Game_Interpreter::MakeSharedList(GetList());
+	}
+	return shared_list;
+}
+
 lcf::rpg::SaveEventExecState Game_CommonEvent::GetSaveData() {
 	lcf::rpg::SaveEventExecState state;
 	if (interpreter) {
@@ -96,6 +96,15 @@ public:
 	 */
 	std::vector<lcf::rpg::EventCommand>& GetList();
 
+	/**
+	 * Gets event commands list as a list that is shared by all interpreter
+	 * frames running them. The commands are copied and their images are
+	 * prefetched on first use.
+	 *
+	 * @return shared event commands list.
+	 */
+	Game_Interpreter::CommandList GetSharedList();
+
 	lcf::rpg::SaveEventExecState GetSaveData();
 
 	/** @return true if waiting for foreground execution */
@@ -112,6 +121,8 @@ private:
 
 	/** Interpreter for parallel common events. */
 	std::unique_ptr<Game_Interpreter_Map> interpreter;
+
+	Game_Interpreter::CommandList shared_list;
 };
 
 #endif
@@ -49,6 +49,8 @@ void Game_ConfigVideo::Hide() {
 	// Always enabled by default:
 	// - renderer (name of the renderer)
 	// - show_fps (Rendering of FPS, engine feature)
+	// - damage_tracking (Partial redraw, engine feature)
+	// - screen_tone_pass (Map tone in one pass, engine feature)
 
 	vsync.SetOptionVisible(false);
 	fullscreen.SetOptionVisible(false);
@@ -277,6 +279,22 @@ void Game_Config::LoadFromArgs(CmdlineParser& cp) {
 			video.fps_render_window.Set(false);
 			continue;
 		}
+		if (cp.ParseNext(arg, 0, "--damage-tracking")) {
+			video.damage_tracking.Set(true);
+			continue;
+		}
+		if (cp.ParseNext(arg, 0, "--no-damage-tracking")) {
+			video.damage_tracking.Set(false);
+			continue;
+		}
+		if (cp.ParseNext(arg, 0, "--screen-tone-pass")) {
+			video.screen_tone_pass.Set(true);
+			continue;
+		}
+		if (cp.ParseNext(arg, 0, "--no-screen-tone-pass")) {
+			video.screen_tone_pass.Set(false);
+			continue;
+		}
 		if (cp.ParseNext(arg, 0, "--window")) {
 			video.fullscreen.Set(false);
 			continue;
@@ -325,6 +343,18 @@ void Game_Config::LoadFromArgs(CmdlineParser& cp) {
 			}
 			continue;
 		}
+		if (cp.ParseNext(arg, 1, "--image-cache-size")) {
+			if (arg.ParseValue(0, li_value)) {
+				player.image_cache_size.Set(li_value);
+			}
+			continue;
+		}
+		if (cp.ParseNext(arg, 1, "--bgm-decode-ahead")) {
+			if (arg.ParseValue(0, li_value)) {
+				audio.bgm_decode_ahead.Set(li_value);
+			}
+			continue;
+		}
 		if (cp.ParseNext(arg, 1, "--music-volume")) {
 			if (arg.ParseValue(0, li_value)) {
 				audio.music_volume.Set(li_value);
@@ -360,6 +390,8 @@ void Game_Config::LoadFromStream(Filesystem_Stream::InputStream& is) {
 	video.scaling_mode.FromIni(ini);
 	video.stretch.FromIni(ini);
 	video.touch_ui.FromIni(ini);
+	video.damage_tracking.FromIni(ini);
+	video.screen_tone_pass.FromIni(ini);
 	video.game_resolution.FromIni(ini);
 
 	if (ini.HasValue("Video", "WindowX") && ini.HasValue("Video", "WindowY") && ini.HasValue("Video", "WindowWidth") && ini.HasValue("Video", "WindowHeight")) {
@@ -372,6 +404,7 @@ void Game_Config::LoadFromStream(Filesystem_Stream::InputStream& is) {
 	/** AUDIO SECTION */
 	audio.music_volume.FromIni(ini);
 	audio.sound_volume.FromIni(ini);
+	audio.bgm_decode_ahead.FromIni(ini);
 
 	/** INPUT SECTION */
 	input.buttons = Input::GetDefaultButtonMappings();
@@ -427,6 +460,7 @@ void Game_Config::LoadFromStream(Filesystem_Stream::InputStream& is) {
 	player.settings_in_title.FromIni(ini);
 	player.settings_in_menu.FromIni(ini);
 	player.show_startup_logos.FromIni(ini);
+	player.image_cache_size.FromIni(ini);
 }
 
 void Game_Config::WriteToStream(Filesystem_Stream::OutputStream& os) const {
@@ -442,6 +476,8 @@ void Game_Config::WriteToStream(Filesystem_Stream::OutputStream& os) const {
 	video.scaling_mode.ToIni(os);
 	video.stretch.ToIni(os);
 	video.touch_ui.ToIni(os);
+	video.damage_tracking.ToIni(os);
+	video.screen_tone_pass.ToIni(os);
 	video.game_resolution.ToIni(os);
 
 	// only preserve when toggling between window and fullscreen is supported
@@ -458,6 +494,7 @@ void Game_Config::WriteToStream(Filesystem_Stream::OutputStream& os) const {
 
 	audio.music_volume.ToIni(os);
 	audio.sound_volume.ToIni(os);
+	audio.bgm_decode_ahead.ToIni(os);
 	os << "\n";
 
 	/** INPUT SECTION */
@@ -503,6 +540,7 @@ void Game_Config::WriteToStream(Filesystem_Stream::OutputStream& os) const {
 	player.settings_in_title.ToIni(os);
 	player.settings_in_menu.ToIni(os);
 	player.show_startup_logos.ToIni(os);
+	player.image_cache_size.ToIni(os);
 
 	os << "\n";
 }
@@ -68,6 +68,7 @@ struct Game_ConfigPlayer {
 		Utils::MakeSvArray("None", "Custom", "All"),
 		Utils::MakeSvArray("none", "custom", "all"),
 		Utils::MakeSvArray("Do not show any additional logos", "Show custom logos bundled with the game", "Show all logos, including the original from RPG Maker")};
+	RangeConfigParam<int> image_cache_size{ "Image cache size (MiB)", "Memory for keeping unused images loaded. Raise for picture heavy games", "Player", "ImageCacheSize", 10, 1, 1024 };
 
 	void Hide();
 };
@@ -86,6 +87,8 @@ struct Game_ConfigVideo {
 		Utils::MakeSvArray("Scale to screen size (Causes scaling artifacts)", "Scale to multiple of the game resolution", "Like Nearest, but output is blurred to avoid artifacts")};
 	BoolConfigParam stretch{ "Stretch", "Stretch to the width of the window/screen", "Video", "Stretch", false };
 	BoolConfigParam touch_ui{ "Touch Ui", "Display the touch ui", "Video", "TouchUi", true };
+	BoolConfigParam damage_tracking{ "Partial Redraw", "Only redraw and upload screen areas that changed (Saves power)", "Video", "DamageTracking", false };
+	BoolConfigParam screen_tone_pass{ "Screen Tone Pass", "Tint the map once instead of every sprite (Faster, slightly different colors)", "Video", "ScreenTonePass", false };
 	EnumConfigParam<GameResolution, 3> game_resolution{ "Resolution", "Game resolution. Changes require a restart.", "Video", "GameResolution", GameResolution::Original,
 		Utils::MakeSvArray("Original (Recommended)", "Widescreen (Experimental)", "Ultrawide (Experimental)"),
 		Utils::MakeSvArray("original", "widescreen", "ultrawide"),
@@ -103,6 +106,7 @@ struct Game_ConfigVideo {
 struct Game_ConfigAudio {
 	RangeConfigParam<int> music_volume{ "BGM Volume", "Volume of the background music", "Audio", "MusicVolume", 100, 0, 100 };
 	RangeConfigParam<int> sound_volume{ "SFX Volume", "Volume of the sound effects", "Audio", "SoundVolume", 100, 0, 100 };
+	RangeConfigParam<int> bgm_decode_ahead{ "BGM Decode Ahead", "Milliseconds of music decoded in advance. Raise when music stutters", "Audio", "BgmDecodeAhead", 100, 0, 1000 };
 
 	void Hide();
 };
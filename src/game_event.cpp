@@ -364,6 +364,25 @@ const std::vector<lcf::rpg::EventCommand>& Game_Event::GetList() const {
 	return page ? page->event_commands : _empty_list;
 }
 
+Game_Interpreter::CommandList Game_Event::GetSharedList() const {
+	return page ? GetSharedList(page) : nullptr;
+}
+
+Game_Interpreter::CommandList Game_Event::GetSharedList(const lcf::rpg::EventPage* event_page) const {
+	const size_t index = event_page - event->pages.data();
+	assert(index < event->pages.size());
+
+	if (shared_lists.size() <= index) {
+		shared_lists.resize(event->pages.size());
+	}
+
+	auto& list = shared_lists[index];
+	if (!list) {
+		list = Game_Interpreter::MakeSharedList(event_page->event_commands);
+	}
+	return list;
+}
+
 void Game_Event::OnFinishForegroundEvent() {
 	UpdateFacing();
 	SetPaused(false);
@@ -102,6 +102,24 @@ public:
 	 */
 	const std::vector<lcf::rpg::EventCommand>& GetList() const;
 
+	/**
+	 * Gets the commands of the active page as a list that is shared by
+	 * all interpreter frames running them.
+	 *
+	 * @return shared event commands list, empty when no page is active.
+	 */
+	Game_Interpreter::CommandList GetSharedList() const;
+
+	/**
+	 * Gets the commands of a page as a shared list.
+	 * The commands are copied and their images are prefetched the first
+	 * time a page is requested.
+	 *
+	 * @param event_page page of this event
+	 * @return shared event commands list.
+	 */
+	Game_Interpreter::CommandList GetSharedList(const lcf::rpg::EventPage* event_page) const;
+
 	/**
 	 * Event returns to its original direction before talking to the hero.
 	 */
@@ -212,6 +230,8 @@ private:
 	const lcf::rpg::Event* event = nullptr;
 	const lcf::rpg::EventPage* page = nullptr;
 	std::unique_ptr<Game_Interpreter_Map> interpreter;
+	/** Shared command lists, indexed like event->pages */
+	mutable std::vector<Game_Interpreter::CommandList> shared_lists;
 };
 
 inline int Game_Event::GetNumPages() const {
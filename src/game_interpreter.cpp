@@ -26,6 +26,7 @@
 #include <cassert>
 #include "game_interpreter.h"
 #include "audio.h"
+#include "cache.h"
 #include "dynrpg.h"
 #include "filefinder.h"
 #include "game_map.h"
@@ -68,6 +69,7 @@
 #include "baseui.h"
 #include "algo.h"
 #include "rand.h"
+#include "instrumentation.h"
 
 enum BranchSubcommand {
 	eOptionBranchElse = 1
@@ -89,6 +91,8 @@ Game_Interpreter::~Game_Interpreter() {
 // Clear.
 void Game_Interpreter::Clear() {
 	_state = {};
+	_commands.clear();
+	_control_flow.clear();
 	_keyinput = {};
 	_async_op = {};
 }
@@ -99,6 +103,11 @@ bool Game_Interpreter::IsRunning() const {
 }
 
 // Setup.
+namespace {
+	// Commands scanned for prefetching when a shared list is created
+	constexpr size_t prefetch_lookahead = 64;
+}
+
 void Game_Interpreter::Push(
 	std::vector<lcf::rpg::EventCommand> _list,
 	int event_id,
@@ -108,13 +117,24 @@ void Game_Interpreter::Push(
 		return;
 	}
 
+	Push(std::make_shared<const std::vector<lcf::rpg::EventCommand>>(std::move(_list)), event_id, started_by_decision_key);
+}
+
+void Game_Interpreter::Push(
+	CommandList _list,
+	int event_id,
+	bool started_by_decision_key
+) {
+	if (!_list || _list->empty()) {
+		return;
+	}
+
 	if ((int)_state.stack.size() > call_stack_limit) {
 		Output::Error("Call Event limit ({}) has been exceeded", call_stack_limit);
 	}
 
 	lcf::rpg::SaveEventExecFrame frame;
 	frame.ID = _state.stack.size() + 1;
-	frame.commands = std::move(_list);
 	frame.current_command = 0;
 	frame.triggered_by_decision_key = started_by_decision_key;
 	frame.event_id = event_id;
@@ -126,9 +146,43 @@ void Game_Interpreter::Push(
 	}
 
 	_state.stack.push_back(std::move(frame));
+	_commands.push_back(std::move(_list));
+	_control_flow.resize(_state.stack.size() - 1);
 }
 
 
+Game_Interpreter::CommandList Game_Interpreter::MakeSharedList(const std::vector<lcf::rpg::EventCommand>& list) {
+	// Image heavy events often start with many Show Picture commands
+	PrefetchAssets(list, prefetch_lookahead);
+
+	return std::make_shared<const std::vector<lcf::rpg::EventCommand>>(list);
+}
+
+void Game_Interpreter::PrefetchAssets(const std::vector<lcf::rpg::EventCommand>& list, size_t max_commands) {
+	const size_t n = std::min(list.size(), max_commands);
+
+	for (size_t i = 0; i < n; ++i) {
+		const auto& com = list[i];
+		const auto num_params = com.parameters.size();
+
+		switch (static_cast<Cmd>(com.code)) {
+			case Cmd::ShowPicture:
+				// Names that depend on variables are only known when the command runs
+				if (num_params > 7 && !(num_params > 19 && com.parameters[19] != 0)) {
+					Cache::PrefetchPicture(com.string, com.parameters[7] > 0);
+				}
+				break;
+			case Cmd::ChangeFaceGraphic:
+				if (!Player::IsPatchManiac() || num_params <= 3 || (com.parameters[3] & 0xF) == 0) {
+					Cache::PrefetchFaceset(com.string);
+				}
+				break;
+			default:
+				break;
+		}
+	}
+}
+
 void Game_Interpreter::KeyInputState::fromSave(const lcf::rpg::SaveEventExecState& save) {
 	*this = {};
 
@@ -276,6 +330,9 @@ void Game_Interpreter::KeyInputState::toSave(lcf::rpg::SaveEventExecState& save)
 
 lcf::rpg::SaveEventExecState Game_Interpreter::GetState() const {
 	auto save = _state;
+	for (size_t i = 0; i < save.stack.size(); ++i) {
+		save.stack[i].commands = *_commands[i];
+	}
 	_keyinput.toSave(save);
 	return save;
 }
@@ -352,6 +409,8 @@ int Game_Interpreter::GetSubcommandIndex(int indent) const {
 
 // Update
 void Game_Interpreter::Update(bool reset_loop_count) {
+	EP_PROFILE_ZONE("Game_Interpreter::Update");
+
 	if (reset_loop_count) {
 		loop_count = 0;
 	}
@@ -471,7 +530,7 @@ void Game_Interpreter::Update(bool reset_loop_count) {
 		}
 
 		// Pop any completed stack frames
-		if (frame->current_command >= (int)frame->commands.size()) {
+		if (frame->current_command >= (int)GetFrameCommands().size()) {
 			if (!OnFinishStackFrame()) {
 				break;
 			}
@@ -521,15 +580,15 @@ void Game_Interpreter::Update(bool reset_loop_count) {
 
 // Setup Starting Event
 void Game_Interpreter::Push(Game_Event* ev) {
-	Push(ev->GetList(), ev->GetId(), ev->WasStartedByDecisionKey());
+	Push(ev->GetSharedList(), ev->GetId(), ev->WasStartedByDecisionKey());
 }
 
 void Game_Interpreter::Push(Game_Event* ev, const lcf::rpg::EventPage* page, bool triggered_by_decision_key) {
-	Push(page->event_commands, ev->GetId(), triggered_by_decision_key);
+	Push(ev->GetSharedList(page), ev->GetId(), triggered_by_decision_key);
 }
 
 void Game_Interpreter::Push(Game_CommonEvent* ev) {
-	Push(ev->GetList(), 0, false);
+	Push(ev->GetSharedList(), 0, false);
 }
 
 bool Game_Interpreter::CheckGameOver() {
@@ -544,23 +603,30 @@ bool Game_Interpreter::CheckGameOver() {
 }
 
 void Game_Interpreter::SkipToNextConditional(std::initializer_list<Cmd> codes, int indent) {
+	const auto& control_flow = GetControlFlow();
 	auto& frame = GetFrame();
-	const auto& list = frame.commands;
+	const auto& list = GetFrameCommands();
 	auto& index = frame.current_command;
 
 	if (index >= static_cast<int>(list.size())) {
 		return;
 	}
 
-	for (++index; index < static_cast<int>(list.size()); ++index) {
-		const auto& com = list[index];
-		if (com.indent > indent) {
-			continue;
-		}
-		if (std::find(codes.begin(), codes.end(), static_cast<Cmd>(com.code)) != codes.end()) {
-			break;
-		}
+	index = control_flow.SkipToNextConditional(list, index, codes, indent);
+}
+
+const Game_Interpreter_ControlFlow& Game_Interpreter::GetControlFlow() {
+	const size_t frame_idx = _state.stack.size() - 1;
+
+	if (_control_flow.size() <= frame_idx) {
+		_control_flow.resize(frame_idx + 1);
+	}
+
+	auto& control_flow = _control_flow[frame_idx];
+	if (!control_flow) {
+		control_flow = std::make_unique<Game_Interpreter_ControlFlow>(GetFrameCommands());
 	}
+	return *control_flow;
 }
 
 int Game_Interpreter::DecodeInt(lcf::DBArray<int32_t>::const_iterator& it) {
@@ -615,8 +681,8 @@ lcf::rpg::MoveCommand Game_Interpreter::DecodeMove(lcf::DBArray<int32_t>::const_
 
 // Execute Command.
 bool Game_Interpreter::ExecuteCommand() {
-	auto& frame = GetFrame();
-	const auto& com = frame.commands[frame.current_command];
+	const auto& frame = GetFrame();
+	const auto& com = GetFrameCommands()[frame.current_command];
 	return ExecuteCommand(com);
 }
 
@@ -858,6 +924,8 @@ bool Game_Interpreter::OnFinishStackFrame() {
 	} else {
 		// If a called frame, or base frame of foreground interpreter, pop the stack.
 		_state.stack.pop_back();
+		_commands.pop_back();
+		_control_flow.resize(_state.stack.size());
 	}
 
 	return !is_base_frame;
@@ -865,7 +933,7 @@ bool Game_Interpreter::OnFinishStackFrame() {
 
 std::vector<std::string> Game_Interpreter::GetChoices(int max_num_choices) {
 	const auto& frame = GetFrame();
-	const auto& list = frame.commands;
+	const auto& list = GetFrameCommands();
 	auto& index = frame.current_command;
 
 	// Let's find the choices
@@ -902,7 +970,7 @@ bool Game_Interpreter::CommandOptionGeneric(lcf::rpg::EventCommand const& com, i
 
 bool Game_Interpreter::CommandShowMessage(lcf::rpg::EventCommand const& com) { // code 10110
 	auto& frame = GetFrame();
-	const auto& list = frame.commands;
+	const auto& list = GetFrameCommands();
 	auto& index = frame.current_command;
 
 	if (!Game_Message::CanShowMessage(main_flag)) {
@@ -2124,7 +2192,7 @@ bool Game_Interpreter::CommandComment(const lcf::rpg::EventCommand &com) {
 		}
 
 		auto& frame = GetFrame();
-		const auto& list = frame.commands;
+		const auto& list = GetFrameCommands();
 		auto& index = frame.current_command;
 
 		std::string command = ToString(com.string);
@@ -2146,7 +2214,7 @@ bool Game_Interpreter::CommandComment(const lcf::rpg::EventCommand &com) {
 
 void Game_Interpreter::EndEventProcessing() {
 	auto& frame = GetFrame();
-	const auto& list = frame.commands;
+	const auto& list = GetFrameCommands();
 	auto& index = frame.current_command;
 
 	index = static_cast<int>(list.size());
@@ -3683,19 +3751,15 @@ bool Game_Interpreter::CommandEndBranch(lcf::rpg::EventCommand const& /* com */)
 }
 
 bool Game_Interpreter::CommandJumpToLabel(lcf::rpg::EventCommand const& com) { // code 12120
+	const auto& control_flow = GetControlFlow();
 	auto& frame = GetFrame();
-	const auto& list = frame.commands;
 	auto& index = frame.current_command;
 
 	int label_id = com.parameters[0];
 
-	for (int idx = 0; (size_t)idx < list.size(); idx++) {
-		if (static_cast<Cmd>(list[idx].code) != Cmd::Label)
-			continue;
-		if (list[idx].parameters[0] != label_id)
-			continue;
+	int idx = control_flow.FindLabel(label_id);
+	if (idx >= 0) {
 		index = idx;
-		break;
 	}
 
 	return true;
@@ -3765,7 +3829,7 @@ bool Game_Interpreter::CommandLoop(lcf::rpg::EventCommand const& com) { // code
 
 bool Game_Interpreter::CommandBreakLoop(lcf::rpg::EventCommand const& /* com */) { // code 12220
 	auto& frame = GetFrame();
-	const auto& list = frame.commands;
+	const auto& list = GetFrameCommands();
 	auto& index = frame.current_command;
 
 	// BreakLoop will jump to the end of the event if there is no loop.
@@ -3792,11 +3856,8 @@ bool Game_Interpreter::CommandBreakLoop(lcf::rpg::EventCommand const& /* com */)
 
 bool Game_Interpreter::CommandEndLoop(lcf::rpg::EventCommand const& com) { // code 22210
 	auto& frame = GetFrame();
-	const auto& list = frame.commands;
 	auto& index = frame.current_command;
 
-	int indent = com.indent;
-
 	if (Player::IsPatchManiac() && com.parameters.size() >= 5 && com.parameters[0] != 0) {
 		int type = com.parameters[0];
 		int offset = com.indent * 2;
@@ -3849,19 +3910,16 @@ bool Game_Interpreter::CommandEndLoop(lcf::rpg::EventCommand const& com) { // co
 	}
 
 	// Restart the loop
-	for (int idx = index; idx >= 0; idx--) {
-		if (list[idx].indent > indent)
-			continue;
-		if (list[idx].indent < indent)
-			return false;
-		if (static_cast<Cmd>(list[idx].code) != Cmd::Loop)
-			continue;
+	int idx = GetControlFlow().FindLoopStart(index);
+	if (idx == Game_Interpreter_ControlFlow::loop_blocked) {
+		return false;
+	}
+	if (idx >= 0) {
 		index = idx;
-		break;
 	}
 
 	// Jump past the Cmd::Loop to the first command.
-	if (index < (int)frame.commands.size()) {
+	if (index < (int)GetFrameCommands().size()) {
 		++index;
 	}
 
@@ -3948,7 +4006,7 @@ bool Game_Interpreter::CommandCallEvent(lcf::rpg::EventCommand const& com) { //
 		return true;
 	}
 
-	Push(page->event_commands, event->GetId(), false);
+	Push(event->GetSharedList(page), event->GetId(), false);
 
 	return true;
 }
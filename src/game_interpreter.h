@@ -19,12 +19,15 @@
 #define EP_GAME_INTERPRETER_H
 
 #include <cstdint>
+#include <limits>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include "async_handler.h"
 #include "game_character.h"
 #include "game_actor.h"
+#include "game_interpreter_control_flow.h"
 #include <lcf/dbarray.h>
 #include <lcf/rpg/fwd.h>
 #include <lcf/rpg/eventcommand.h>
@@ -44,6 +47,8 @@ class Game_Interpreter
 {
 public:
 	using Cmd = lcf::rpg::EventCommand::Code;
+	/** Immutable command list shared by all frames that run it */
+	using CommandList = std::shared_ptr<const std::vector<lcf::rpg::EventCommand>>;
 
 	static Game_Interpreter& GetForegroundInterpreter();
 
@@ -68,10 +73,34 @@ public:
 			int _event_id,
 			bool started_by_decision_key = false
 	);
+	void Push(
+			CommandList _list,
+			int _event_id,
+			bool started_by_decision_key = false
+	);
 	void Push(Game_Event* ev);
 	void Push(Game_Event* ev, const lcf::rpg::EventPage* page, bool triggered_by_decision_key);
 	void Push(Game_CommonEvent* ev);
 
+	/**
+	 * Starts loading the images used by Show Picture and Face Graphic
+	 * commands in the background.
+	 *
+	 * @param list event commands to scan
+	 * @param max_commands how many commands are scanned at most
+	 */
+	static void PrefetchAssets(const std::vector<lcf::rpg::EventCommand>& list, size_t max_commands = std::numeric_limits<size_t>::max());
+
+	/**
+	 * Copies event commands into a list that can be shared by interpreter
+	 * frames. The images used by the first commands are prefetched, so this
+	 * happens once per event page or common event instead of on every Push.
+	 *
+	 * @param list event commands to copy
+	 * @return shared event commands list
+	 */
+	static CommandList MakeSharedList(const std::vector<lcf::rpg::EventCommand>& list);
+
 	void InputButton();
 	void SetupChoices(const std::vector<std::string>& choices, int indent, PendingMessage& pm);
 
@@ -116,6 +145,8 @@ protected:
 	lcf::rpg::SaveEventExecFrame& GetFrame();
 	const lcf::rpg::SaveEventExecFrame* GetFramePtr() const;
 	lcf::rpg::SaveEventExecFrame* GetFramePtr();
+	/** @return commands of the current frame */
+	const std::vector<lcf::rpg::EventCommand>& GetFrameCommands() const;
 
 	bool main_flag;
 
@@ -151,6 +182,13 @@ protected:
 	 */
 	void SkipToNextConditional(std::initializer_list<Cmd> codes, int indent);
 
+	/**
+	 * Returns the jump targets of the current frame, building them on first use.
+	 *
+	 * @return control flow table of the current frame
+	 */
+	const Game_Interpreter_ControlFlow& GetControlFlow();
+
 	/**
 	 * Sets up a wait (and closes the message box)
 	 */
@@ -338,6 +376,13 @@ protected:
 	int ManiacBitmask(int value, int mask) const;
 
 	lcf::rpg::SaveEventExecState _state;
+	/**
+	 * Commands of the stack frames, one entry per frame.
+	 * The commands of the frames in _state stay empty, GetState copies them.
+	 */
+	std::vector<CommandList> _commands;
+	/** Lazily built control flow tables, one slot per stack frame */
+	std::vector<std::unique_ptr<Game_Interpreter_ControlFlow>> _control_flow;
 	KeyInputState _keyinput;
 	AsyncOp _async_op = {};
 };
@@ -350,6 +395,11 @@ inline lcf::rpg::SaveEventExecFrame* Game_Interpreter::GetFramePtr() {
 	return !_state.stack.empty() ? &_state.stack.back() : nullptr;
 }
 
+inline const std::vector<lcf::rpg::EventCommand>& Game_Interpreter::GetFrameCommands() const {
+	assert(!_commands.empty());
+	return *_commands.back();
+}
+
 inline const lcf::rpg::SaveEventExecFrame& Game_Interpreter::GetFrame() const {
 	auto* frame = GetFramePtr();
 	assert(frame);
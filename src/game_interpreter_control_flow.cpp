@@ -0,0 +1,93 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "game_interpreter_control_flow.h"
+#include <algorithm>
+
+Game_Interpreter_ControlFlow::Game_Interpreter_ControlFlow(const std::vector<lcf::rpg::EventCommand>& list) {
+	const int size = static_cast<int>(list.size());
+	next_sibling.resize(size, size);
+
+	// Commands still waiting for a following command with a lower or equal indent
+	std::vector<int> open;
+
+	// Per indent: last Loop at that indent, or why there is none
+	std::vector<int> loops;
+	int min_indent = 0;
+	for (const auto& com: list) {
+		min_indent = std::min<int>(min_indent, com.indent);
+	}
+
+	for (int i = 0; i < size; ++i) {
+		const auto& com = list[i];
+		const auto code = static_cast<Cmd>(com.code);
+
+		while (!open.empty() && list[open.back()].indent >= com.indent) {
+			next_sibling[open.back()] = i;
+			open.pop_back();
+		}
+		open.push_back(i);
+
+		if (code == Cmd::Label && !com.parameters.empty()) {
+			labels.emplace(com.parameters[0], i);
+		}
+
+		// Levels which never had a command are behind all the previous, lower indented ones
+		const size_t level = com.indent - min_indent;
+		if (loops.size() <= level) {
+			loops.resize(level + 1, i > 0 ? loop_blocked : loop_not_found);
+		}
+		std::fill(loops.begin() + level + 1, loops.end(), loop_blocked);
+
+		if (code == Cmd::EndLoop) {
+			loop_starts.emplace(i, loops[level]);
+		} else if (code == Cmd::Loop) {
+			loops[level] = i;
+		}
+	}
+}
+
+int Game_Interpreter_ControlFlow::FindLabel(int label_id) const {
+	auto it = labels.find(label_id);
+	return it != labels.end() ? it->second : -1;
+}
+
+int Game_Interpreter_ControlFlow::SkipToNextConditional(const std::vector<lcf::rpg::EventCommand>& list, int index, std::initializer_list<Cmd> codes, int indent) const {
+	const int size = static_cast<int>(list.size());
+
+	while (index < size) {
+		// All commands between index and its sibling are more indented than index.
+		// When index is less indented than the search they can still match.
+		int next = list[index].indent >= indent ? next_sibling[index] : index + 1;
+		if (next >= size) {
+			return size;
+		}
+
+		const auto& com = list[next];
+		if (com.indent <= indent && std::find(codes.begin(), codes.end(), static_cast<Cmd>(com.code)) != codes.end()) {
+			return next;
+		}
+		index = next;
+	}
+
+	return size;
+}
+
+int Game_Interpreter_ControlFlow::FindLoopStart(int index) const {
+	auto it = loop_starts.find(index);
+	return it != loop_starts.end() ? it->second : loop_not_found;
+}
@@ -0,0 +1,83 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_GAME_INTERPRETER_CONTROL_FLOW_H
+#define EP_GAME_INTERPRETER_CONTROL_FLOW_H
+
+#include <initializer_list>
+#include <unordered_map>
+#include <vector>
+#include <lcf/rpg/eventcommand.h>
+
+/**
+ * Jump targets of an event command list.
+ *
+ * Built once per interpreter frame so that labels, conditional branches,
+ * choices and loops do not rescan the command list on every jump.
+ * All lookups return exactly what the linear scans in Game_Interpreter
+ * would return, including for malformed event code.
+ */
+class Game_Interpreter_ControlFlow {
+public:
+	using Cmd = lcf::rpg::EventCommand::Code;
+
+	/** Returned by FindLoopStart when a lower indented command is hit first */
+	static constexpr int loop_blocked = -1;
+	/** Returned by FindLoopStart when the list has no matching Loop */
+	static constexpr int loop_not_found = -2;
+
+	/**
+	 * Builds the table.
+	 *
+	 * @param list command list of the frame
+	 */
+	explicit Game_Interpreter_ControlFlow(const std::vector<lcf::rpg::EventCommand>& list);
+
+	/**
+	 * @param label_id label to search
+	 * @return index of the first Label command with that id or -1
+	 */
+	int FindLabel(int label_id) const;
+
+	/**
+	 * Finds the first command after index which has one of the codes and
+	 * com.indent <= indent. Commands with a higher indent are skipped.
+	 *
+	 * @param list command list the table was built from
+	 * @param index start position (not checked)
+	 * @param codes which codes to check
+	 * @param indent the indentation level to check
+	 * @return index of the command or list.size() when not found
+	 */
+	int SkipToNextConditional(const std::vector<lcf::rpg::EventCommand>& list, int index, std::initializer_list<Cmd> codes, int indent) const;
+
+	/**
+	 * Finds the Loop command belonging to an EndLoop command.
+	 *
+	 * @param index index of the EndLoop command
+	 * @return index of the Loop, loop_blocked or loop_not_found
+	 */
+	int FindLoopStart(int index) const;
+
+private:
+	/** For each command the next index with an indent <= its own indent */
+	std::vector<int> next_sibling;
+	std::unordered_map<int, int> labels;
+	std::unordered_map<int, int> loop_starts;
+};
+
+#endif
@@ -73,6 +73,10 @@ enum InnSubcommand {
 void Game_Interpreter_Map::SetState(const lcf::rpg::SaveEventExecState& save) {
 	Clear();
 	_state = save;
+	for (auto& frame: _state.stack) {
+		_commands.push_back(std::make_shared<const std::vector<lcf::rpg::EventCommand>>(std::move(frame.commands)));
+		frame.commands.clear();
+	}
 	_keyinput.fromSave(save);
 }
 
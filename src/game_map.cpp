@@ -22,9 +22,11 @@
 #include <algorithm>
 #include <climits>
 #include <numeric>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "async_handler.h"
+#include "cache.h"
 #include "options.h"
 #include "system.h"
 #include "game_battle.h"
@@ -55,6 +57,8 @@
 #include <lcf/rpg/save.h>
 #include "scene_gameover.h"
 #include "feature.h"
+#include "instrumentation.h"
+#include "map_cache.h"
 
 namespace {
 	// Intended bad value, Game_Map::Init sets them correctly
@@ -87,12 +91,74 @@ namespace {
 
 	bool translation_changed = false;
 
+	// Reverse index from the inputs of the event page conditions to the
+	// events (index into events) reading them.
+	struct RefreshDependency {
+		int id = 0;
+		// Value during the last refresh
+		int value = 0;
+		std::vector<int> events;
+	};
+
+	struct RefreshIndex {
+		std::vector<RefreshDependency> switches;
+		std::vector<RefreshDependency> variables;
+		std::vector<RefreshDependency> items;
+		std::vector<RefreshDependency> actors;
+		// Timer conditions change without any write, always evaluated
+		std::vector<int> always;
+		std::vector<bool> dirty;
+		// Evaluate every event, set after the events were created
+		bool full = true;
+	} refresh_index;
+
+	// Position (see PositionKey) to the indices into events at this position, ascending
+	std::unordered_map<uint64_t, std::vector<int>> event_positions;
+
+	uint64_t PositionKey(int x, int y) {
+		return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+	}
+
+	void BuildEventPositions() {
+		event_positions.clear();
+		for (int i = 0; i < static_cast<int>(events.size()); ++i) {
+			event_positions[PositionKey(events[i].GetX(), events[i].GetY())].push_back(i);
+		}
+	}
+
+	/**
+	 * Calls func for every event at (x,y) in ascending order until func returns true.
+	 * The bucket is looked up again after every call because func may move events.
+	 * This visits the same events as a linear scan over all events would.
+	 */
+	template <typename F>
+	bool AnyEventAt(int x, int y, F&& func) {
+		const auto key = PositionKey(x, y);
+		int last = -1;
+		for (;;) {
+			auto it = event_positions.find(key);
+			if (it == event_positions.end()) {
+				return false;
+			}
+			auto& bucket = it->second;
+			auto next = std::upper_bound(bucket.begin(), bucket.end(), last);
+			if (next == bucket.end()) {
+				return false;
+			}
+			last = *next;
+			if (func(events[last])) {
+				return true;
+			}
+		}
+	}
+
 	// Used when the current map is not in the maptree
 	const lcf::rpg::MapInfo empty_map_info;
 }
 
 namespace Game_Map {
 void SetupCommon();
+void BuildRefreshIndex();
 }
 
 void Game_Map::OnContinueFromBattle() {
@@ -132,6 +198,8 @@ void Game_Map::InitCommonEvents() {
 
 void Game_Map::Dispose() {
 	events.clear();
+	event_positions.clear();
+	refresh_index = {};
 	map.reset();
 	map_info = {};
 	panorama = {};
@@ -212,6 +280,8 @@ void Game_Map::Setup(std::unique_ptr<lcf::rpg::Map> map_in) {
 	// Update the save counts so that if the player saves the game
 	// events will properly resume upon loading.
 	Main_Data::game_player->UpdateSaveCounts(lcf::Data::system.save_count, GetMapSaveCount());
+
+	PrefetchAssets();
 }
 
 void Game_Map::SetupFromSave(
@@ -246,6 +316,8 @@ void Game_Map::SetupFromSave(
 			auto& ev = events[i];
 			ev.SetSaveData(map_info.events[i]);
 		}
+		// SetSaveData bypasses UpdateEventPosition
+		BuildEventPositions();
 	}
 	map_info.events.clear();
 	interpreter->Clear();
@@ -285,19 +357,34 @@ void Game_Map::SetupFromSave(
 	// FIXME: RPG_RT compatibility bug: On async platforms, panorama async loading can
 	// cause panorama chunks to be out of sync.
 	Game_Map::Parallax::ChangeBG(GetParallaxParams());
-}
 
-std::unique_ptr<lcf::rpg::Map> Game_Map::loadMapFile(int map_id) {
-	std::unique_ptr<lcf::rpg::Map> map;
+	PrefetchAssets();
+}
 
+static std::string FindMapFile(int map_id, std::string& map_name, bool& xml) {
 	// Try loading EasyRPG map files first, then fallback to normal RPG Maker
-	// FIXME: Assert map was cached for async platforms
-	std::string map_name = Game_Map::ConstructMapName(map_id, true);
+	map_name = Game_Map::ConstructMapName(map_id, true);
 	std::string map_file = FileFinder::Game().FindFile(map_name);
+	xml = !map_file.empty();
 	if (map_file.empty()) {
 		map_name = Game_Map::ConstructMapName(map_id, false);
 		map_file = FileFinder::Game().FindFile(map_name);
+	}
+	return map_file;
+}
 
+std::unique_ptr<lcf::rpg::Map> Game_Map::loadMapFile(int map_id) {
+	auto parsed = MapCache::Get(map_id);
+	if (parsed.map && Input::IsRecording() && !parsed.xml && !parsed.has_crc) {
+		// Parse again to get the checksum
+		parsed = {};
+	}
+
+	if (!parsed.map) {
+		// FIXME: Assert map was cached for async platforms
+		std::string map_name;
+		bool xml;
+		std::string map_file = FindMapFile(map_id, map_name, xml);
 		if (map_file.empty()) {
 			Output::Error("Loading of Map {} failed.\nThe map was not found.", map_name);
 			return nullptr;
@@ -309,30 +396,27 @@ std::unique_ptr<lcf::rpg::Map> Game_Map::loadMapFile(int map_id) {
 			return nullptr;
 		}
 
-		map = lcf::LMU_Reader::Load(map_stream, Player::encoding);
+		parsed = MapCache::Parse(std::move(map_stream), xml, Player::encoding, Input::IsRecording());
 
-		if (Input::IsRecording()) {
-			map_stream.clear();
-			map_stream.seekg(0);
-			Input::AddRecordingData(Input::RecordingData::Hash,
-						   fmt::format("map{:04} {:#08x}", map_id, Utils::CRC32(map_stream)));
-		}
-	} else {
-		auto map_stream = FileFinder::Game().OpenInputStream(map_file);
-		if (!map_stream) {
-			Output::Error("Loading of Map {} failed.\nMap not readable.", map_name);
+		Output::Debug("Loaded Map {}", map_name);
+
+		if (!parsed.map) {
+			Output::ErrorStr(lcf::LcfReader::GetError());
 			return nullptr;
 		}
-		map = lcf::LMU_Reader::LoadXml(map_stream);
-	}
 
-	Output::Debug("Loaded Map {}", map_name);
+		MapCache::Add(map_id, parsed);
+	} else {
+		Output::Debug("Loaded Map {} from cache", map_id);
+	}
 
-	if (map.get() == NULL) {
-		Output::ErrorStr(lcf::LcfReader::GetError());
+	if (Input::IsRecording() && !parsed.xml) {
+		Input::AddRecordingData(Input::RecordingData::Hash,
+					   fmt::format("map{:04} {:#08x}", map_id, parsed.crc));
 	}
 
-	return map;
+	// The cached map must stay unmodified, setup and translation change it
+	return std::make_unique<lcf::rpg::Map>(*parsed.map);
 }
 
 void Game_Map::SetupCommon() {
@@ -359,6 +443,56 @@ void Game_Map::SetupCommon() {
 	for (const auto& ev : map->events) {
 		events.emplace_back(GetMapId(), &ev);
 	}
+
+	BuildEventPositions();
+	BuildRefreshIndex();
+}
+
+void Game_Map::BuildRefreshIndex() {
+	refresh_index = {};
+
+	using Lookup = std::unordered_map<int, size_t>;
+	Lookup switches, variables, items, actors;
+
+	auto add = [](std::vector<RefreshDependency>& deps, Lookup& lookup, int id, int ev) {
+		auto ins = lookup.emplace(id, deps.size());
+		if (ins.second) {
+			deps.emplace_back();
+			deps.back().id = id;
+		}
+		auto& dep_events = deps[ins.first->second].events;
+		if (dep_events.empty() || dep_events.back() != ev) {
+			dep_events.push_back(ev);
+		}
+	};
+
+	for (int i = 0; i < static_cast<int>(events.size()); ++i) {
+		bool always = false;
+		for (const auto& page : map->events[i].pages) {
+			const auto& cond = page.condition;
+			if (cond.flags.switch_a) {
+				add(refresh_index.switches, switches, cond.switch_a_id, i);
+			}
+			if (cond.flags.switch_b) {
+				add(refresh_index.switches, switches, cond.switch_b_id, i);
+			}
+			if (cond.flags.variable) {
+				add(refresh_index.variables, variables, cond.variable_id, i);
+			}
+			if (cond.flags.item) {
+				add(refresh_index.items, items, cond.item_id, i);
+			}
+			if (cond.flags.actor) {
+				add(refresh_index.actors, actors, cond.actor_id, i);
+			}
+			always |= cond.flags.timer || cond.flags.timer2;
+		}
+		if (always) {
+			refresh_index.always.push_back(i);
+		}
+	}
+
+	refresh_index.dirty.resize(events.size());
 }
 
 void Game_Map::PrepareSave(lcf::rpg::Save& save) {
@@ -421,8 +555,46 @@ std::vector<uint8_t> Game_Map::GetTilesLayer(int layer) {
 
 void Game_Map::Refresh() {
 	if (GetMapId() > 0) {
-		for (Game_Event& ev : events) {
-			ev.RefreshPage();
+		auto& dirty = refresh_index.dirty;
+
+		auto check = [&](std::vector<RefreshDependency>& deps, auto&& get_value) {
+			for (auto& dep : deps) {
+				int value = get_value(dep.id);
+				if (value != dep.value) {
+					dep.value = value;
+					for (int ev : dep.events) {
+						dirty[ev] = true;
+					}
+				}
+			}
+		};
+
+		check(refresh_index.switches, [](int id) {
+			return Main_Data::game_switches->GetInt(id);
+		});
+		check(refresh_index.variables, [](int id) {
+			return Main_Data::game_variables->Get(id);
+		});
+		check(refresh_index.items, [](int id) {
+			return static_cast<int>(Main_Data::game_party->GetItemCount(id) + Main_Data::game_party->GetEquippedItemCount(id) > 0);
+		});
+		check(refresh_index.actors, [](int id) {
+			return static_cast<int>(Main_Data::game_party->IsActorInParty(id));
+		});
+		for (int ev : refresh_index.always) {
+			dirty[ev] = true;
+		}
+
+		const bool full = refresh_index.full;
+		refresh_index.full = false;
+
+		// The page of an event is only a function of the inputs checked above.
+		// Events without a page are refreshed to reapply the "no page" state.
+		for (size_t i = 0; i < events.size(); ++i) {
+			if (full || dirty[i] || events[i].GetActivePage() == nullptr) {
+				events[i].RefreshPage();
+			}
+			dirty[i] = false;
 		}
 	}
 
@@ -663,14 +835,15 @@ bool Game_Map::CheckOrMakeWayEx(const Game_Character& self,
 	}
 	if (vehicle_type != Game_Vehicle::Airship && check_events_and_vehicles) {
 		// Check for collision with events on the target tile.
-		for (auto& other: GetEvents()) {
+		bool collides = AnyEventAt(to_x, to_y, [&](Game_Event& other) {
 			if (ignore_some_events_by_id != NULL &&
 					ignore_some_events_by_id->find(other.GetId()) !=
 					ignore_some_events_by_id->end())
-				continue;
-			if (CheckOrMakeCollideEvent(other)) {
 				return false;
-			}
+			return CheckOrMakeCollideEvent(other);
+		});
+		if (collides) {
+			return false;
 		}
 		auto& player = Main_Data::game_player;
 		if (player->GetVehicleType() == Game_Vehicle::None) {
@@ -726,12 +899,11 @@ bool Game_Map::CanLandAirship(int x, int y) {
 		return false;
 	}
 
-	for (auto& ev: events) {
-		if (ev.IsInPosition(x, y)
-				&& ev.IsActive()
-				&& ev.GetActivePage() != nullptr) {
-			return false;
-		}
+	bool event_blocks = AnyEventAt(x, y, [](Game_Event& ev) {
+		return ev.IsActive() && ev.GetActivePage() != nullptr;
+	});
+	if (event_blocks) {
+		return false;
 	}
 	for (auto vid: { Game_Vehicle::Boat, Game_Vehicle::Ship }) {
 		auto& vehicle = vehicles[vid - 1];
@@ -764,13 +936,13 @@ bool Game_Map::CanDisembarkShip(Game_Player& player, int x, int y) {
 		return false;
 	}
 
-	for (auto& ev: GetEvents()) {
-		if (ev.IsInPosition(x, y)
-			&& ev.GetLayer() == lcf::rpg::EventPage::Layers_same
+	bool event_blocks = AnyEventAt(x, y, [](Game_Event& ev) {
+		return ev.GetLayer() == lcf::rpg::EventPage::Layers_same
 			&& ev.IsActive()
-			&& ev.GetActivePage() != nullptr) {
-			return false;
-		}
+			&& ev.GetActivePage() != nullptr;
+	});
+	if (event_blocks) {
+		return false;
 	}
 
 	int bit = GetPassableMask(x, y, player.GetX(), player.GetY());
@@ -842,20 +1014,21 @@ bool Game_Map::IsPassableTile(
 
 		// Highest ID event with layer=below, not through, and a tile graphic wins.
 		int event_tile_id = 0;
-		for (auto& ev: events) {
+		AnyEventAt(x, y, [&](Game_Event& ev) {
 			if (self == &ev) {
-				continue;
+				return false;
 			}
 			if (!ev.IsActive() || ev.GetActivePage() == nullptr || ev.GetThrough()) {
-				continue;
+				return false;
 			}
-			if (ev.IsInPosition(x, y) && ev.GetLayer() == lcf::rpg::EventPage::Layers_below) {
+			if (ev.GetLayer() == lcf::rpg::EventPage::Layers_below) {
 				int tile_id = ev.GetTileId();
 				if (tile_id > 0) {
 					event_tile_id = tile_id;
 				}
 			}
-		}
+			return false;
+		});
 
 		// If there was a below tile event, and the tile is not above
 		// Override the chipset with event tile behavior.
@@ -956,25 +1129,59 @@ int Game_Map::GetTerrainTag(int x, int y) {
 	return terrain_data[chip_index];
 }
 
-void Game_Map::GetEventsXY(std::vector<Game_Event*>& events, int x, int y) {
-	for (Game_Event& ev : GetEvents()) {
-		if (ev.IsInPosition(x, y) && ev.IsActive()) {
-			events.push_back(&ev);
+void Game_Map::GetEventsXY(std::vector<Game_Event*>& out, int x, int y) {
+	AnyEventAt(x, y, [&](Game_Event& ev) {
+		if (ev.IsActive()) {
+			out.push_back(&ev);
 		}
-	}
+		return false;
+	});
 }
 
 Game_Event* Game_Map::GetEventAt(int x, int y, bool require_active) {
-	auto& events = GetEvents();
-	for (auto iter = events.rbegin(); iter != events.rend(); ++iter) {
-		auto& ev = *iter;
-		if (ev.IsInPosition(x, y) && (!require_active || ev.IsActive())) {
+	auto it = event_positions.find(PositionKey(x, y));
+	if (it == event_positions.end()) {
+		return nullptr;
+	}
+	auto& bucket = it->second;
+	for (auto iter = bucket.rbegin(); iter != bucket.rend(); ++iter) {
+		auto& ev = events[*iter];
+		if (!require_active || ev.IsActive()) {
 			return &ev;
 		}
 	}
 	return nullptr;
 }
 
+void Game_Map::UpdateEventPosition(const Game_Character& ch, int old_x, int old_y) {
+	if (ch.GetType() != Game_Character::Event || events.empty()) {
+		return;
+	}
+
+	// Events outside of the map (e.g. while constructing or in unit tests) are not indexed
+	const auto* ev = static_cast<const Game_Event*>(&ch);
+	std::less<const Game_Event*> less;
+	if (less(ev, events.data()) || !less(ev, events.data() + events.size())) {
+		return;
+	}
+	const int index = static_cast<int>(ev - events.data());
+
+	auto it = event_positions.find(PositionKey(old_x, old_y));
+	if (it != event_positions.end()) {
+		auto& bucket = it->second;
+		auto pos = std::lower_bound(bucket.begin(), bucket.end(), index);
+		if (pos != bucket.end() && *pos == index) {
+			bucket.erase(pos);
+			if (bucket.empty()) {
+				event_positions.erase(it);
+			}
+		}
+	}
+
+	auto& bucket = event_positions[PositionKey(ev->GetX(), ev->GetY())];
+	bucket.insert(std::lower_bound(bucket.begin(), bucket.end(), index), index);
+}
+
 bool Game_Map::LoopHorizontal() {
 	return map->scroll_type == lcf::rpg::Map::ScrollType_horizontal || map->scroll_type == lcf::rpg::Map::ScrollType_both;
 }
@@ -1024,16 +1231,16 @@ int Game_Map::YwithDirection(int y, int direction) {
 }
 
 int Game_Map::CheckEvent(int x, int y) {
-	for (const Game_Event& ev : events) {
-		if (ev.IsInPosition(x, y)) {
-			return ev.GetId();
-		}
+	auto it = event_positions.find(PositionKey(x, y));
+	if (it == event_positions.end()) {
+		return 0;
 	}
-
-	return 0;
+	return events[it->second.front()].GetId();
 }
 
 void Game_Map::Update(MapUpdateAsyncContext& actx, bool is_preupdate) {
+	EP_PROFILE_ZONE("Game_Map::Update");
+
 	if (GetNeedRefresh()) {
 		Refresh();
 	}
@@ -1741,6 +1948,51 @@ static Game_Map::Parallax::Params GetParallaxParams() {
 	return params;
 }
 
+static void PreloadMap(int map_id) {
+	if (map_id == Game_Map::GetMapId() || MapCache::IsCachedOrPending(map_id)) {
+		return;
+	}
+
+	// Opening is done here because the filesystem is not thread-safe.
+	// Missing maps are reported when the teleport happens.
+	std::string map_name;
+	bool xml;
+	std::string map_file = FindMapFile(map_id, map_name, xml);
+	if (map_file.empty()) {
+		return;
+	}
+
+	auto map_stream = FileFinder::Game().OpenInputStream(map_file);
+	if (!map_stream) {
+		return;
+	}
+
+	MapCache::Preload(map_id, std::move(map_stream), xml, Player::encoding);
+}
+
+void Game_Map::PrefetchAssets() {
+	Cache::PrefetchChipset(GetChipsetName());
+	Cache::PrefetchPanorama(GetParallaxParams().name);
+
+	for (const auto& ev : map->events) {
+		for (const auto& page : ev.pages) {
+			Cache::PrefetchCharset(page.character_name);
+
+			if (page.trigger == lcf::rpg::EventPage::Trigger_auto_start
+					|| page.trigger == lcf::rpg::EventPage::Trigger_parallel) {
+				Game_Interpreter::PrefetchAssets(page.event_commands);
+			}
+
+			for (const auto& cmd : page.event_commands) {
+				if (static_cast<lcf::rpg::EventCommand::Code>(cmd.code) == lcf::rpg::EventCommand::Code::Teleport
+						&& !cmd.parameters.empty()) {
+					PreloadMap(cmd.parameters[0]);
+				}
+			}
+		}
+	}
+}
+
 std::string Game_Map::Parallax::GetName() {
 	return GetParallaxParams().name;
 }
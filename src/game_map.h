@@ -132,6 +132,14 @@ namespace Game_Map {
 			lcf::rpg::SavePanorama save_pan,
 			std::vector<lcf::rpg::SaveCommonEvent> save_ce);
 
+	/**
+	 * Starts loading the graphics needed when entering the map in the
+	 * background: Chipset, panorama, event charsets and the pictures and
+	 * faces of autostart and parallel process events.
+	 * Maps that are teleport targets of the events are parsed ahead.
+	 */
+	void PrefetchAssets();
+
 	/**
 	 * Copies event data into lcf::rpg::Save data.
 	 *
@@ -146,6 +154,8 @@ namespace Game_Map {
 
 	/**
 	 * Refreshes the map.
+	 * Only events whose page conditions read a switch, variable, item or
+	 * actor that changed since the last refresh select a new page.
 	 */
 	void Refresh();
 
@@ -568,6 +578,13 @@ namespace Game_Map {
 	 */
 	std::vector<Game_CommonEvent>& GetCommonEvents();
 
+	/**
+	 * Appends the active events at (x,y) in ascending order.
+	 *
+	 * @param events vector to append to
+	 * @param x x position on the map
+	 * @param y y position on the map
+	 */
 	void GetEventsXY(std::vector<Game_Event*>& events, int x, int y);
 
 	/**
@@ -578,6 +595,16 @@ namespace Game_Map {
 	 */
 	Game_Event* GetEventAt(int x, int y, bool require_active);
 
+	/**
+	 * Updates the position index used by the event lookups by position.
+	 * Called by Game_Character when an event moved.
+	 *
+	 * @param ch character that moved, ignored if not a map event
+	 * @param old_x previous x position
+	 * @param old_y previous y position
+	 */
+	void UpdateEventPosition(const Game_Character& ch, int old_x, int old_y);
+
 	bool LoopHorizontal();
 	bool LoopVertical();
 
@@ -15,6 +15,7 @@
  * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cmath>
 #include "bitmap.h"
 #include "options.h"
@@ -154,6 +155,22 @@ Game_Pictures::Picture* Game_Pictures::GetPicturePtr(int id) {
 		? &pictures[id - 1] : nullptr;
 }
 
+bool Game_Pictures::HasUntintedPictureBelowScreen() const {
+	if (!Player::IsMajorUpdatedVersion()) {
+		// Without priority layers all pictures are above the screen
+		return false;
+	}
+
+	return std::any_of(pictures.begin(), pictures.end(), [](const Picture& pic) {
+		if (!pic.Exists() || !pic.IsOnMap() || pic.data.flags.affected_by_tint) {
+			return false;
+		}
+		// Same priority as in Sprite_Picture::OnPictureShow
+		auto priority = Drawable::GetPriorityForMapLayer(pic.data.map_layer);
+		return priority > 0 && priority < Priority_Screen;
+	});
+}
+
 void Game_Pictures::OnMapChange() {
 	for (auto& pic: pictures) {
 		if (pic.data.flags.erase_on_map_change) {
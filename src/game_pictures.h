@@ -132,6 +132,14 @@ public:
 	Picture& GetPicture(int id);
 	Picture* GetPicturePtr(int id);
 
+	/**
+	 * Checks for shown map pictures below the Screen drawable which are not
+	 * affected by the screen tint. They must not be toned by the tone pass.
+	 *
+	 * @return whether such a picture exists
+	 */
+	bool HasUntintedPictureBelowScreen() const;
+
 private:
 	void RequestPictureSprite(Picture& pic);
 	void OnPictureSpriteReady(FileRequestResult*, int id);
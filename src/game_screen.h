@@ -65,6 +65,27 @@ public:
 	 */
 	Tone GetTone();
 
+	/**
+	 * Returns the tone map sprites are drawn with.
+	 * This is the screen tone unless the tone is applied once to the whole
+	 * screen by the Screen drawable.
+	 *
+	 * @return Tone
+	 */
+	Tone GetSpriteTone();
+
+	/**
+	 * Enables applying the screen tone in a single pass over the screen
+	 * instead of tinting every sprite below the Screen drawable.
+	 * This is not saved.
+	 *
+	 * @param enabled whether the tone pass is used
+	 */
+	void SetTonePass(bool enabled);
+
+	/** @return whether the screen tone is applied in a single pass */
+	bool IsTonePass() const;
+
 	/**
 	 * Returns the current flash color.
 	 *
@@ -179,6 +200,7 @@ private:
 	lcf::rpg::SaveScreen data;
 	int flash_sat;		// RPGMaker bug: this isn't saved
 	int flash_period;	// RPGMaker bug: this isn't saved
+	bool tone_pass = false;
 
 	std::string movie_filename;
 	int movie_pos_x;
@@ -238,6 +260,18 @@ inline Tone Game_Screen::GetTone() {
 		(int)((data.tint_current_sat) * 128 / 100));
 }
 
+inline Tone Game_Screen::GetSpriteTone() {
+	return tone_pass ? Tone() : GetTone();
+}
+
+inline void Game_Screen::SetTonePass(bool enabled) {
+	tone_pass = enabled;
+}
+
+inline bool Game_Screen::IsTonePass() const {
+	return tone_pass;
+}
+
 inline Color Game_Screen::GetFlashColor() const {
 	return Flash::MakeColor(data.flash_red, data.flash_green, data.flash_blue, data.flash_current_level);
 }
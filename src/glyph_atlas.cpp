@@ -0,0 +1,145 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headers
+#include "glyph_atlas.h"
+#include "bitmap.h"
+#include "pixel_format.h"
+#include <algorithm>
+
+namespace {
+	/** Shelf heights are rounded up to this to reduce the number of shelves */
+	constexpr int shelf_granularity = 4;
+}
+
+uint64_t GlyphAtlas::MakeKey(char32_t code, int size, bool shaped) {
+	return static_cast<uint64_t>(code) |
+		(static_cast<uint64_t>(shaped) << 32) |
+		(static_cast<uint64_t>(static_cast<uint16_t>(size)) << 33);
+}
+
+const GlyphAtlas::Glyph* GlyphAtlas::Find(uint64_t key) {
+	auto it = glyphs.find(key);
+	if (it == glyphs.end()) {
+		return nullptr;
+	}
+
+	if (!it->second.rect.IsEmpty()) {
+		pages[it->second.page].last_use = ++use_counter;
+	}
+	return &it->second;
+}
+
+const GlyphAtlas::Glyph* GlyphAtlas::Insert(uint64_t key, const Bitmap& bitmap, Point advance, Point offset) {
+	const int width = bitmap.width();
+	const int height = bitmap.height();
+
+	Glyph glyph;
+	glyph.advance = advance;
+	glyph.offset = offset;
+
+	if (width == 0 || height == 0) {
+		// Nothing to draw, no space on a page is needed
+		glyph.bitmap = Bitmap::Create(width, height);
+		glyph.rect = glyph.bitmap->GetRect();
+		return &(glyphs[key] = std::move(glyph));
+	}
+
+	if (width > page_size || height > page_size) {
+		return nullptr;
+	}
+
+	Page* page = nullptr;
+	Rect rect;
+	for (auto& p : pages) {
+		rect = Allocate(p, width, height);
+		if (rect.width > 0) {
+			page = &p;
+			break;
+		}
+	}
+
+	if (!page) {
+		if (pages.size() < max_pages) {
+			pages.emplace_back();
+			page = &pages.back();
+			page->bitmap = Bitmap::Create(nullptr, page_size, page_size, 0, DynamicFormat(8, 8, 0, 8, 0, 8, 0, 8, 0, PF::Alpha));
+			page->bitmap->Clear();
+		} else {
+			page = &EvictPage();
+		}
+		rect = Allocate(*page, width, height);
+	}
+
+	page->bitmap->Blit(rect.x, rect.y, bitmap, bitmap.GetRect(), Opacity::Opaque());
+	page->last_use = ++use_counter;
+	page->keys.push_back(key);
+
+	glyph.bitmap = page->bitmap;
+	glyph.rect = rect;
+	glyph.page = static_cast<size_t>(page - pages.data());
+	return &(glyphs[key] = std::move(glyph));
+}
+
+void GlyphAtlas::Clear() {
+	pages.clear();
+	glyphs.clear();
+	use_counter = 0;
+}
+
+Rect GlyphAtlas::Allocate(Page& page, int width, int height) {
+	// Use the lowest shelf the glyph fits in
+	Shelf* best = nullptr;
+	for (auto& shelf : page.shelves) {
+		if (shelf.height >= height && page_size - shelf.x >= width &&
+			(!best || shelf.height < best->height)) {
+			best = &shelf;
+		}
+	}
+
+	// Start a new shelf when the glyph would waste too much space
+	int shelf_height = std::min((height + shelf_granularity - 1) / shelf_granularity * shelf_granularity, page_size);
+	if ((!best || best->height > shelf_height) && page_size - page.free_y >= shelf_height) {
+		page.shelves.push_back({page.free_y, shelf_height, 0});
+		page.free_y += shelf_height;
+		best = &page.shelves.back();
+	}
+
+	if (!best) {
+		return {};
+	}
+
+	Rect rect(best->x, best->y, width, height);
+	best->x += width;
+	return rect;
+}
+
+GlyphAtlas::Page& GlyphAtlas::EvictPage() {
+	auto& page = *std::min_element(pages.begin(), pages.end(), [](const Page& a, const Page& b) {
+		return a.last_use < b.last_use;
+	});
+
+	for (auto key : page.keys) {
+		glyphs.erase(key);
+	}
+	page.keys.clear();
+	page.shelves.clear();
+	page.free_y = 0;
+	page.bitmap->Clear();
+
+	return page;
+}
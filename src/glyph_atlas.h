@@ -0,0 +1,129 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_GLYPH_ATLAS_H
+#define EP_GLYPH_ATLAS_H
+
+// Headers
+#include "memory_management.h"
+#include "point.h"
+#include "rect.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Cache of rendered glyphs.
+ *
+ * Glyphs are copied into alpha-only pages which are packed in rows (shelves)
+ * of similar height. When all pages are full the least recently used page is
+ * cleared and reused.
+ */
+class GlyphAtlas {
+public:
+	/** Width and height of a page */
+	static constexpr int page_size = 256;
+	/** Pages kept per atlas, at most */
+	static constexpr size_t max_pages = 4;
+
+	/** Location and metrics of a cached glyph */
+	struct Glyph {
+		/** Page containing the glyph, a bitmap without pixels when the glyph is empty */
+		BitmapRef bitmap;
+		/** Area of the glyph within the page */
+		Rect rect;
+		/** See Font::GlyphRet */
+		Point advance;
+		/** See Font::GlyphRet */
+		Point offset;
+		/** Index of the page, unused when the glyph is empty */
+		size_t page = 0;
+	};
+
+	/**
+	 * Builds the key of a glyph.
+	 *
+	 * @param code codepoint or, for shaped glyphs, glyph index
+	 * @param size font size the glyph is rendered at
+	 * @param shaped whether code is a glyph index
+	 * @return key for Find and Insert
+	 */
+	static uint64_t MakeKey(char32_t code, int size, bool shaped);
+
+	/**
+	 * Looks up a glyph and marks its page as used.
+	 *
+	 * @param key key of the glyph
+	 * @return glyph or nullptr when the glyph is not cached
+	 */
+	const Glyph* Find(uint64_t key);
+
+	/**
+	 * Copies a rendered glyph into the atlas.
+	 * Pointers returned by earlier calls to Find are invalidated.
+	 *
+	 * @param key key of the glyph
+	 * @param bitmap rendered glyph, the alpha channel is used as the mask
+	 * @param advance see Font::GlyphRet
+	 * @param offset see Font::GlyphRet
+	 * @return cached glyph or nullptr when the glyph is larger than a page
+	 */
+	const Glyph* Insert(uint64_t key, const Bitmap& bitmap, Point advance, Point offset);
+
+	/** Removes all glyphs and frees the pages */
+	void Clear();
+
+	/** @return Number of allocated pages */
+	size_t GetPageCount() const;
+
+private:
+	struct Shelf {
+		int y = 0;
+		int height = 0;
+		/** Start of the free space */
+		int x = 0;
+	};
+
+	struct Page {
+		BitmapRef bitmap;
+		std::vector<Shelf> shelves;
+		/** Start of the space without shelves */
+		int free_y = 0;
+		uint64_t last_use = 0;
+		std::vector<uint64_t> keys;
+	};
+
+	/**
+	 * Reserves space on a page.
+	 *
+	 * @return Position of the space or an empty rect when the page is full
+	 */
+	static Rect Allocate(Page& page, int width, int height);
+
+	/** Clears the least recently used page and returns it */
+	Page& EvictPage();
+
+	std::vector<Page> pages;
+	std::unordered_map<uint64_t, Glyph> glyphs;
+	uint64_t use_counter = 0;
+};
+
+inline size_t GlyphAtlas::GetPageCount() const {
+	return pages.size();
+}
+
+#endif
@@ -29,7 +29,10 @@
 #include "scene.h"
 #include "drawable_mgr.h"
 #include "baseui.h"
+#include "damage_tracker.h"
 #include "game_clock.h"
+#include "game_system.h"
+#include "main_data.h"
 
 using namespace std::chrono_literals;
 
@@ -41,6 +44,9 @@ namespace Graphics {
 	std::unique_ptr<MessageOverlay> message_overlay;
 	std::unique_ptr<FpsOverlay> fps_overlay;
 
+	DamageTracker damage;
+	bool damage_active = false;
+
 	std::string window_title_key;
 }
 
@@ -109,13 +115,56 @@ void Graphics::Draw(Bitmap& dst) {
 
 	auto min_z = std::numeric_limits<Drawable::Z_t>::min();
 	auto max_z = std::numeric_limits<Drawable::Z_t>::max();
+	bool erased = false;
 	if (transition.IsActive()) {
 		min_z = transition.GetZ();
 	} else if (transition.IsErasedNotActive()) {
 		min_z = transition.GetZ() + 1;
+		erased = true;
+	}
+
+	if (!DisplayUi->IsDamageTracking()) {
+		if (damage_active) {
+			damage.Invalidate();
+			damage_active = false;
+		}
+		if (erased) {
+			dst.Clear();
+		}
+		LocalDraw(dst, min_z, max_z);
+		return;
+	}
+
+	auto& drawable_list = DrawableMgr::GetLocalList();
+
+	// Everything LocalDraw paints that is not a drawable
+	DamageState extra;
+	extra.Hash(&dst, current_scene.get(), erased, drawable_list.empty());
+	if (Main_Data::game_system) {
+		auto color = Main_Data::game_system->GetBackgroundColor();
+		extra.Hash(color.red, color.green, color.blue, color.alpha);
+	}
+
+	damage.Update(drawable_list, min_z, max_z, dst.GetRect(), extra.key);
+	damage_active = true;
+
+	if (damage.IsEmpty()) {
+		return;
+	}
+
+	const bool partial = !damage.IsFull();
+	if (partial) {
+		dst.SetClipRects(damage.GetRects());
+	}
+
+	if (erased) {
 		dst.Clear();
 	}
 	LocalDraw(dst, min_z, max_z);
+
+	if (partial) {
+		dst.ClearClipRects();
+	}
 }
 
 void Graphics::LocalDraw(Bitmap& dst, Drawable::Z_t min_z, Drawable::Z_t max_z) {
@@ -145,6 +194,10 @@ std::shared_ptr<Scene> Graphics::UpdateSceneCallback() {
 	return prev_scene;
 }
 
+const DamageTracker* Graphics::GetDamage() {
+	return damage_active ? &damage : nullptr;
+}
+
 MessageOverlay& Graphics::GetMessageOverlay() {
 	return *message_overlay;
 }
@@ -25,6 +25,7 @@
 #include "drawable_list.h"
 #include "game_clock.h"
 
+class DamageTracker;
 class MessageOverlay;
 class Scene;
 
@@ -48,12 +49,26 @@ namespace Graphics {
 	 */
 	void Update();
 
+	/**
+	 * Draws the current scene. When damage tracking is enabled only the
+	 * areas that changed since the last call are redrawn.
+	 *
+	 * @param dst display surface, must keep its content between calls
+	 */
 	void Draw(Bitmap& dst);
 
 	void LocalDraw(Bitmap& dst, Drawable::Z_t min_z, Drawable::Z_t max_z);
 
 	std::shared_ptr<Scene> UpdateSceneCallback();
 
+	/**
+	 * Returns the damage of the last Draw call.
+	 * Used by the Ui to only upload the changed areas.
+	 *
+	 * @return damage tracker or nullptr when damage tracking is disabled
+	 */
+	const DamageTracker* GetDamage();
+
 	/**
 	 * Returns a handle to the message overlay.
 	 * Only used by Output to put messages.
@@ -18,10 +18,88 @@
 #include "instrumentation.h"
 #include "utils.h"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <fmt/format.h>
+
 #ifdef PLAYER_INSTRUMENTATION_VTUNE
 __itt_domain* Instrumentation::domain = nullptr;
 #endif
 
+std::atomic<bool> Instrumentation::profiler_enabled = { false };
+std::atomic<uint64_t> Instrumentation::frame_count = { 0 };
+
+namespace {
+	using profiler_clock = std::chrono::steady_clock;
+
+	const profiler_clock::time_point profiler_epoch = profiler_clock::now();
+
+	struct ZoneEntry {
+		const char* name = nullptr;
+		std::atomic<uint64_t> total_ns = { 0 };
+		std::atomic<uint64_t> count = { 0 };
+	};
+
+	std::mutex zones_mutex;
+	std::array<ZoneEntry, Instrumentation::kMaxZones> zones;
+	std::atomic<int> zone_count = { 0 };
+
+	/**
+	 * An event slot of the ring. The slot is published with its sequence
+	 * number: index + 1 of the event when complete, 0 while being written.
+	 */
+	struct TraceEvent {
+		std::atomic<uint64_t> seq = { 0 };
+		std::atomic<int> zone = { 0 };
+		std::atomic<uint64_t> begin = { 0 };
+		std::atomic<uint64_t> end = { 0 };
+	};
+
+	/**
+	 * Events of one thread. Only written by the owning thread, the exporter
+	 * reads the slots whose sequence number matches.
+	 */
+	struct ThreadTrace {
+		int tid = 0;
+		std::atomic<uint64_t> head = { 0 };
+		std::array<TraceEvent, Instrumentation::kRingSize> events;
+	};
+
+	std::mutex threads_mutex;
+	std::vector<std::unique_ptr<ThreadTrace>> threads;
+	int next_tid = 1;
+
+	/** Frees the events of a thread when it exits */
+	struct ThreadTraceOwner {
+		ThreadTrace* trace = nullptr;
+
+		~ThreadTraceOwner() {
+			if (!trace) {
+				return;
+			}
+			std::lock_guard<std::mutex> lock(threads_mutex);
+			threads.erase(std::find_if(threads.begin(), threads.end(), [&](const auto& t) {
+				return t.get() == trace;
+			}));
+		}
+	};
+
+	ThreadTrace& GetThreadTrace() {
+		thread_local ThreadTraceOwner owner;
+		if (!owner.trace) {
+			std::lock_guard<std::mutex> lock(threads_mutex);
+			threads.push_back(std::make_unique<ThreadTrace>());
+			owner.trace = threads.back().get();
+			owner.trace->tid = next_tid++;
+		}
+		return *owner.trace;
+	}
+}
+
 void Instrumentation::Init(const char* name) {
 #ifdef PLAYER_INSTRUMENTATION_VTUNE
 	assert(!domain);
@@ -34,3 +112,98 @@ void Instrumentation::Init(const char* name) {
 	(void)name;
 #endif
 }
+
+Instrumentation::ZoneInfo::ZoneInfo(const char* name) : name(name) {
+	std::lock_guard<std::mutex> lock(zones_mutex);
+
+	// Zones in templates are instantiated multiple times, share one entry
+	int num_zones = zone_count.load(std::memory_order_relaxed);
+	for (int i = 0; i < num_zones; ++i) {
+		if (std::strcmp(zones[i].name, name) == 0) {
+			id = i;
+			break;
+		}
+	}
+
+	if (id < 0 && num_zones < kMaxZones) {
+		zones[num_zones].name = name;
+		id = num_zones;
+		zone_count.store(num_zones + 1, std::memory_order_release);
+	}
+#ifdef PLAYER_INSTRUMENTATION_VTUNE
+	handle = __itt_string_handle_create(name);
+#endif
+}
+
+void Instrumentation::SetProfilerEnabled(bool enabled) {
+	profiler_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+uint64_t Instrumentation::Now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(profiler_clock::now() - profiler_epoch).count();
+}
+
+void Instrumentation::RecordZone(const ZoneInfo& info, uint64_t begin, uint64_t end) {
+	auto& zone = zones[info.GetId()];
+	zone.total_ns.fetch_add(end - begin, std::memory_order_relaxed);
+	zone.count.fetch_add(1, std::memory_order_relaxed);
+
+	auto& trace = GetThreadTrace();
+	auto head = trace.head.load(std::memory_order_relaxed);
+	auto& ev = trace.events[head % kRingSize];
+	ev.seq.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	ev.zone.store(info.GetId(), std::memory_order_relaxed);
+	ev.begin.store(begin, std::memory_order_relaxed);
+	ev.end.store(end, std::memory_order_relaxed);
+	ev.seq.store(head + 1, std::memory_order_release);
+	trace.head.store(head + 1, std::memory_order_release);
+}
+
+std::vector<Instrumentation::ZoneStat> Instrumentation::GetZoneStats() {
+	int num_zones = zone_count.load(std::memory_order_acquire);
+
+	std::vector<ZoneStat> stats;
+	stats.reserve(num_zones);
+	for (int i = 0; i < num_zones; ++i) {
+		auto& zone = zones[i];
+		stats.push_back({ zone.name, zone.total_ns.load(std::memory_order_relaxed), zone.count.load(std::memory_order_relaxed) });
+	}
+	return stats;
+}
+
+void Instrumentation::WriteChromeTrace(std::ostream& os) {
+	os << "{\"traceEvents\":[";
+	bool first = true;
+
+	std::lock_guard<std::mutex> lock(threads_mutex);
+	for (auto& trace: threads) {
+		const uint64_t head = trace->head.load(std::memory_order_acquire);
+		const uint64_t available = std::min<uint64_t>(head, kRingSize);
+
+		for (uint64_t i = head - available; i < head; ++i) {
+			// Events overwritten or being written by a running thread are skipped
+			const auto& slot = trace->events[i % kRingSize];
+			if (slot.seq.load(std::memory_order_acquire) != i + 1) {
+				continue;
+			}
+			const int zone = slot.zone.load(std::memory_order_relaxed);
+			const uint64_t begin = slot.begin.load(std::memory_order_relaxed);
+			const uint64_t end = slot.end.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.seq.load(std::memory_order_relaxed) != i + 1) {
+				continue;
+			}
+
+			if (!first) {
+				os << ",";
+			}
+			first = false;
+			// Chrome trace timestamps are in microseconds
+			os << fmt::format("\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+				zones[zone].name, trace->tid, begin / 1000.0, (end - begin) / 1000.0);
+		}
+	}
+
+	os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
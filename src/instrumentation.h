@@ -25,7 +25,24 @@
 #ifdef PLAYER_INSTRUMENTATION_VTUNE
 #include <ittnotify.h>
 #endif
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+/** Concatenation helper for EP_PROFILE_ZONE */
+#define EP_PROFILE_CONCAT_IMPL(a, b) a##b
+#define EP_PROFILE_CONCAT(a, b) EP_PROFILE_CONCAT_IMPL(a, b)
+
+/**
+ * Measures the time until the end of the current scope with the built-in profiler.
+ * The name must be a string literal.
+ */
+#define EP_PROFILE_ZONE(name) \
+	static Instrumentation::ZoneInfo EP_PROFILE_CONCAT(ep_profile_zone_info_, __LINE__)(name); \
+	Instrumentation::Zone EP_PROFILE_CONCAT(ep_profile_zone_, __LINE__)(EP_PROFILE_CONCAT(ep_profile_zone_info_, __LINE__))
 
 class Instrumentation {
 public:
@@ -36,6 +53,92 @@ public:
 	 */
 	static void Init(const char* name);
 
+	/** Maximum amount of distinct zones */
+	static constexpr int kMaxZones = 64;
+
+	/** Amount of events kept per thread by the built-in profiler */
+	static constexpr int kRingSize = 1 << 16;
+
+	class Zone;
+
+	/**
+	 * Describes a zone of the built-in profiler.
+	 * Instances must have static storage duration, use EP_PROFILE_ZONE.
+	 */
+	class ZoneInfo {
+	public:
+		explicit ZoneInfo(const char* name);
+
+		ZoneInfo(const ZoneInfo&) = delete;
+		ZoneInfo& operator=(const ZoneInfo&) = delete;
+
+		/** @return name of the zone */
+		const char* GetName() const;
+
+		/** @return unique id of the zone or -1 when kMaxZones is exceeded */
+		int GetId() const;
+	private:
+		const char* name = nullptr;
+		int id = -1;
+#ifdef PLAYER_INSTRUMENTATION_VTUNE
+		__itt_string_handle* handle = nullptr;
+#endif
+		friend class Zone;
+	};
+
+	/** RAII wrapper measuring the time of a zone */
+	class Zone {
+	public:
+		explicit Zone(const ZoneInfo& info) noexcept;
+
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+
+		~Zone();
+	private:
+		const ZoneInfo* info = nullptr;
+		uint64_t begin = 0;
+	};
+
+	/** Accumulated statistic of a zone */
+	struct ZoneStat {
+		const char* name = nullptr;
+		/** Total inclusive time in nanoseconds */
+		uint64_t total_ns = 0;
+		/** How often the zone was entered */
+		uint64_t count = 0;
+	};
+
+	/**
+	 * Enables or disables the built-in profiler.
+	 * When disabled a zone only costs a single branch.
+	 *
+	 * @param enabled whether zones are recorded
+	 */
+	static void SetProfilerEnabled(bool enabled);
+
+	/** @return whether the built-in profiler records zones */
+	static bool IsProfilerEnabled();
+
+	/** @return nanoseconds since the profiler was initialized */
+	static uint64_t Now();
+
+	/** @return accumulated statistics of all zones since start, indexed by zone id */
+	static std::vector<ZoneStat> GetZoneStats();
+
+	/** @return amount of frames since start */
+	static uint64_t GetFrameCount();
+
+	/**
+	 * Writes the events of all threads in the Chrome trace event format
+	 * (JSON, loadable in chrome://tracing or Perfetto).
+	 * Threads may keep recording meanwhile. Events of threads that have
+	 * exited are not included, their rings are freed on exit.
+	 *
+	 * @param os stream to write to
+	 */
+	static void WriteChromeTrace(std::ostream& os);
+
 	/** Call at the beginning of a frame */
 	static void FrameBegin();
 
@@ -74,6 +177,10 @@ public:
 	};
 
 private:
+	static void RecordZone(const ZoneInfo& info, uint64_t begin, uint64_t end);
+
+	static std::atomic<bool> profiler_enabled;
+	static std::atomic<uint64_t> frame_count;
 #ifdef PLAYER_INSTRUMENTATION_VTUNE
 	static __itt_domain* domain;
 #endif
@@ -89,6 +196,46 @@ inline void Instrumentation::FrameEnd() {
 #ifdef PLAYER_INSTRUMENTATION_VTUNE
 	assert(domain);
 	__itt_frame_end_v3(domain, nullptr);
+#endif
+	frame_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline bool Instrumentation::IsProfilerEnabled() {
+	return profiler_enabled.load(std::memory_order_relaxed);
+}
+
+inline uint64_t Instrumentation::GetFrameCount() {
+	return frame_count.load(std::memory_order_relaxed);
+}
+
+inline const char* Instrumentation::ZoneInfo::GetName() const {
+	return name;
+}
+
+inline int Instrumentation::ZoneInfo::GetId() const {
+	return id;
+}
+
+inline Instrumentation::Zone::Zone(const ZoneInfo& info) noexcept {
+#ifdef PLAYER_INSTRUMENTATION_VTUNE
+	if (domain) {
+		__itt_task_begin(domain, __itt_null, __itt_null, info.handle);
+	}
+#endif
+	if (IsProfilerEnabled() && info.GetId() >= 0) {
+		this->info = &info;
+		begin = Now();
+	}
+}
+
+inline Instrumentation::Zone::~Zone() {
+	if (info) {
+		RecordZone(*info, begin, Now());
+	}
+#ifdef PLAYER_INSTRUMENTATION_VTUNE
+	if (domain) {
+		__itt_task_end(domain);
+	}
 #endif
 }
 
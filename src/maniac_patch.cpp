@@ -29,6 +29,10 @@
 #include "output.h"
 
 #include <lcf/reader_util.h>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <unordered_map>
 #include <vector>
 
 /*
@@ -115,315 +119,600 @@ namespace {
 		Divmul,
 		Between
 	};
-}
 
-int process(std::vector<int32_t>::iterator& it, std::vector<int32_t>::iterator end, const Game_Interpreter& ip) {
-	int value = 0;
-	int imm = 0;
-	int imm2 = 0;
-	int imm3 = 0;
+	/** Instructions of a compiled expression */
+	enum class Code : uint8_t {
+		/** Pushes arg */
+		Push,
+		/** Pushes variable arg */
+		Var,
+		/** Replaces the top with the variable it references */
+		VarDyn,
+		/** Pushes switch arg */
+		Switch,
+		SwitchDyn,
+		/** Pushes the variable referenced by variable arg */
+		VarIndirect,
+		VarIndirectDyn,
+		/** Pushes the switch referenced by variable arg */
+		SwitchIndirect,
+		SwitchIndirectDyn,
+		Negate,
+		Not,
+		Flip,
+		Add,
+		Sub,
+		Mul,
+		Div,
+		Mod,
+		BitOr,
+		BitAnd,
+		BitXor,
+		BitShiftLeft,
+		BitShiftRight,
+		Equal,
+		GreaterEqual,
+		LessEqual,
+		Greater,
+		Less,
+		NotEqual,
+		Or,
+		And,
+		/** Pops else, then, condition and pushes the selected value */
+		Ternary,
+		/** Pops the arguments of function arg & 0xFF, arg >> 8 is the argument count */
+		Call
+	};
+
+	static_assert(static_cast<int>(Code::And) - static_cast<int>(Code::Add) == static_cast<int>(Op::And) - static_cast<int>(Op::Add),
+		"Binary operations of Op and Code must be in the same order");
+
+	struct Instruction {
+		Code code;
+		int32_t arg;
+	};
+
+	/** Stack depth that is evaluated without allocation */
+	constexpr int max_fixed_stack = 64;
+
+	/** An expression compiled to stack machine code */
+	struct Expression {
+		std::vector<Instruction> code;
+		int max_stack = 0;
 
-	if (it == end) {
-		return 0;
+		int32_t Evaluate(const Game_Interpreter& ip) const;
+	};
+
+	int32_t ClampInt32(int64_t value) {
+		return static_cast<int32_t>(Utils::Clamp<int64_t>(value, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max()));
 	}
 
-	auto op = static_cast<Op>(*it);
-	++it;
-
-	// When entering the switch it is on the first argument
-	switch (op) {
-		case Op::Null:
-			it++;
-			return 0;
-		case Op::U8:
-		case Op::UX8:
-			value = *it++;
-			return value;
-		case Op::U16:
-		case Op::UX16:
-			imm = *it++;
-			if (it == end) {
+	int32_t EvaluateUnary(Code code, int32_t a) {
+		switch (code) {
+			case Code::Negate:
+				return -a;
+			case Code::Not:
+				return !a ? 0 : 1;
+			case Code::Flip:
+				return ~a;
+			default:
+				assert(false);
 				return 0;
-			}
-			imm2 = *it++;
-			value = (imm2 << 8) + imm;
-			return value;
-		case Op::S32:
-		case Op::SX32:
-			imm = *it++;
-			if (it == end) {
+		}
+	}
+
+	int32_t EvaluateBinary(Code code, int32_t a, int32_t b) {
+		switch (code) {
+			case Code::Add:
+				return ClampInt32(static_cast<int64_t>(a) + b);
+			case Code::Sub:
+				return ClampInt32(static_cast<int64_t>(a) - b);
+			case Code::Mul:
+				return ClampInt32(static_cast<int64_t>(a) * b);
+			case Code::Div:
+				if (b == 0) {
+					return a;
+				}
+				// 64 Bit because INT_MIN / -1 traps
+				return ClampInt32(static_cast<int64_t>(a) / b);
+			case Code::Mod:
+				if (b == 0) {
+					return a;
+				}
+				return static_cast<int32_t>(static_cast<int64_t>(a) % b);
+			case Code::BitOr:
+				return a | b;
+			case Code::BitAnd:
+				return a & b;
+			case Code::BitXor:
+				return a ^ b;
+			case Code::BitShiftLeft:
+				return a << b;
+			case Code::BitShiftRight:
+				return a >> b;
+			case Code::Equal:
+				return a == b ? 1 : 0;
+			case Code::GreaterEqual:
+				return a >= b ? 1 : 0;
+			case Code::LessEqual:
+				return a <= b ? 1 : 0;
+			case Code::Greater:
+				return a > b ? 1 : 0;
+			case Code::Less:
+				return a < b ? 1 : 0;
+			case Code::NotEqual:
+				return a != b ? 1 : 0;
+			case Code::Or:
+				return !!a || !!b ? 1 : 0;
+			case Code::And:
+				return !!a && !!b ? 1 : 0;
+			default:
+				assert(false);
 				return 0;
-			}
-			imm2 = *it++;
-			if (it == end) {
+		}
+	}
+
+	/** @return whether the function only depends on its arguments */
+	bool IsPureFunction(Fn fn) {
+		switch (fn) {
+			case Fn::Rand:
+			case Fn::Item:
+			case Fn::Event:
+			case Fn::Actor:
+			case Fn::Party:
+			case Fn::Enemy:
+			case Fn::Misc:
+				return false;
+			default:
+				return true;
+		}
+	}
+
+	/** @return expected argument count of the function or -1 if unknown */
+	int GetFunctionArgs(Fn fn) {
+		switch (fn) {
+			case Fn::Misc:
+			case Fn::Abs:
+				return 1;
+			case Fn::Rand:
+			case Fn::Item:
+			case Fn::Event:
+			case Fn::Actor:
+			case Fn::Party:
+			case Fn::Enemy:
+			case Fn::Pow:
+			case Fn::Sqrt:
+			case Fn::Min:
+			case Fn::Max:
+				return 2;
+			case Fn::Sin:
+			case Fn::Cos:
+			case Fn::Atan2:
+			case Fn::Clamp:
+			case Fn::Muldiv:
+			case Fn::Divmul:
+			case Fn::Between:
+				return 3;
+			default:
+				return -1;
+		}
+	}
+
+	const char* GetFunctionName(Fn fn) {
+		switch (fn) {
+			case Fn::Rand: return "rnd";
+			case Fn::Item: return "item";
+			case Fn::Event: return "event";
+			case Fn::Actor: return "actor";
+			case Fn::Party: return "member";
+			case Fn::Enemy: return "enemy";
+			case Fn::Misc: return "misc";
+			case Fn::Pow: return "pow";
+			case Fn::Sqrt: return "sqrt";
+			case Fn::Sin: return "sin";
+			case Fn::Cos: return "cos";
+			case Fn::Atan2: return "atan2";
+			case Fn::Min: return "min";
+			case Fn::Max: return "max";
+			case Fn::Abs: return "abs";
+			case Fn::Clamp: return "clamp";
+			case Fn::Muldiv: return "muldiv";
+			case Fn::Divmul: return "divmul";
+			case Fn::Between: return "between";
+			default: return "";
+		}
+	}
+
+	/**
+	 * Calls a function. The arguments are in the order of the expression.
+	 * Unknown functions return 0.
+	 */
+	int32_t EvaluateFunction(Fn fn, const int32_t* args, const Game_Interpreter* ip) {
+		switch (fn) {
+			case Fn::Rand:
+				return ControlVariables::Random(args[1], args[0]);
+			case Fn::Item:
+				return ControlVariables::Item(args[1], args[0]);
+			case Fn::Event:
+				return ControlVariables::Event(args[1], args[0], *ip);
+			case Fn::Actor:
+				return ControlVariables::Actor(args[1], args[0]);
+			case Fn::Party:
+				return ControlVariables::Party(args[1], args[0]);
+			case Fn::Enemy:
+				return ControlVariables::Enemy(args[1], args[0]);
+			case Fn::Misc:
+				return ControlVariables::Other(args[0]);
+			case Fn::Pow:
+				return ControlVariables::Pow(args[0], args[1]);
+			case Fn::Sqrt:
+				return ControlVariables::Sqrt(args[0], args[1]);
+			case Fn::Sin:
+				return ControlVariables::Sin(args[0], args[1], args[2]);
+			case Fn::Cos:
+				return ControlVariables::Cos(args[0], args[1], args[2]);
+			case Fn::Atan2:
+				return ControlVariables::Atan2(args[0], args[1], args[2]);
+			case Fn::Min:
+				return ControlVariables::Min(args[0], args[1]);
+			case Fn::Max:
+				return ControlVariables::Max(args[0], args[1]);
+			case Fn::Abs:
+				return ControlVariables::Abs(args[0]);
+			case Fn::Clamp:
+				return ControlVariables::Clamp(args[0], args[1], args[2]);
+			case Fn::Muldiv:
+				return ControlVariables::Muldiv(args[0], args[1], args[2]);
+			case Fn::Divmul:
+				return ControlVariables::Divmul(args[0], args[1], args[2]);
+			case Fn::Between:
+				return ControlVariables::Between(args[0], args[1], args[2]);
+			default:
 				return 0;
-			}
-			imm3 = *it++;
-			if (it == end) {
+		}
+	}
+
+	/**
+	 * Compiles the byte stream of an expression.
+	 * Unsupported operations are reported once here and evaluate to 0.
+	 * Constant subexpressions are folded.
+	 */
+	class Compiler {
+	public:
+		explicit Compiler(Span<const int32_t> op_codes) : op_codes(op_codes), size(op_codes.size() * 4) {}
+
+		Expression Compile() {
+			CompileOperand();
+			return std::move(expr);
+		}
+
+	private:
+		bool AtEnd() const {
+			return pos >= size;
+		}
+
+		int Read() {
+			if (AtEnd()) {
 				return 0;
 			}
-			value = *it++;
-			value = (value << 24) + (imm3 << 16) + (imm2 << 8) + imm;
+			auto uo = static_cast<uint32_t>(op_codes[pos / 4]);
+			int value = static_cast<int>((uo >> (8 * (pos % 4))) & 0xFF);
+			++pos;
 			return value;
-		case Op::Var:
-			imm = process(it, end, ip);
-			return Main_Data::game_variables->Get(imm);
-		case Op::Switch:
-			imm = process(it, end, ip);
-			return Main_Data::game_switches->GetInt(imm);
-		case Op::VarIndirect:
-			imm = process(it, end, ip);
-			return Main_Data::game_variables->GetIndirect(imm);
-		case Op::SwitchIndirect:
-			imm = process(it, end, ip);
-			return Main_Data::game_switches->GetInt(Main_Data::game_variables->Get(imm));
-		case Op::Negate:
-			imm = process(it, end, ip);
-			return -imm;
-		case Op::Not:
-			imm = process(it, end, ip);
-			return !imm ? 0 : 1;
-		case Op::Flip:
-			imm = process(it, end, ip);
-			return ~imm;
-		case Op::Add:
-			imm = process(it, end, ip);
-			imm2 = process(it, end, ip);
-			return static_cast<int32_t>(Utils::Clamp<int64_t>(static_cast<int64_t>(imm) + imm2, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max()));
-		case Op::Sub:
-			imm = process(it, end, ip);
-			imm2 = process(it, end, ip);
-			return static_cast<int32_t>(Utils::Clamp<int64_t>(static_cast<int64_t>(imm) - imm2, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max()));
-		case Op::Mul:
-			imm = process(it, end, ip);
-			imm2 = process(it, end, ip);
-			return static_cast<int32_t>(Utils::Clamp<int64_t>(static_cast<int64_t>(imm) * imm2, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max()));
-		case Op::Div:
-			imm = process(it, end, ip);
-			imm2 = process(it, end, ip);
-			if (imm2 == 0) {
-				return imm;
+		}
+
+		void Emit(Code code, int32_t arg, int stack_change) {
+			expr.code.push_back({code, arg});
+			depth += stack_change;
+			expr.max_stack = std::max(expr.max_stack, depth);
+		}
+
+		void Push(int32_t value) {
+			Emit(Code::Push, value, 1);
+		}
+
+		/** @return whether the code since start is a single constant */
+		bool IsConstant(size_t start) const {
+			return expr.code.size() == start + 1 && expr.code[start].code == Code::Push;
+		}
+
+		/** Replaces the code since start with a constant */
+		void Fold(size_t start, int operands, int32_t value) {
+			expr.code.resize(start);
+			depth -= operands;
+			Push(value);
+		}
+
+		/** Compiles an operation that reads an operand as index */
+		void CompileAccess(Code constant, Code dynamic) {
+			size_t start = expr.code.size();
+			CompileOperand();
+			if (IsConstant(start)) {
+				int32_t index = expr.code[start].arg;
+				expr.code.resize(start);
+				depth -= 1;
+				Emit(constant, index, 1);
+			} else {
+				Emit(dynamic, 0, 0);
 			}
-			return imm / imm2;
-		case Op::Mod:
-			imm = process(it, end, ip);
-			imm2 = process(it, end, ip);
-			if (imm2 == 0) {
-				return imm;
+		}
+
+		void CompileOperands(size_t start, Code code, int operands) {
+			bool constant = true;
+			for (int i = 0; i < operands; ++i) {
+				size_t operand_start = expr.code.size();
+				CompileOperand();
+				constant &= IsConstant(operand_start);
 			}
-			return imm % imm2;
-		case Op::BitOr:
-			imm = process(it, end, ip);
-			imm2 = process(it, end, ip);
-			return imm | imm2;
-		case Op::BitAnd:
-			imm = process(it, end, ip);
-			imm2 = process(it, end, ip);
-			return imm & imm2;
-		case Op::BitXor:
-			imm = process(it, end, ip);
-			imm2 = process(it, end, ip);
-			return imm ^ imm2;
-		case Op::BitShiftLeft:
-			imm = process(it, end, ip);
-			imm2 = process(it, end, ip);
-			return imm << imm2;
-		case Op::BitShiftRight:
-			imm = process(it, end, ip);
-			imm2 = process(it, end, ip);
-			return imm >> imm2;
-		case Op::Equal:
-			imm = process(it, end, ip);
-			imm2 = process(it, end, ip);
-			return imm == imm2 ? 1 : 0;
-		case Op::GreaterEqual:
-			imm = process(it, end, ip);
-			imm2 = process(it, end, ip);
-			return imm >= imm2 ? 1 : 0;
-		case Op::LessEqual:
-			imm = process(it, end, ip);
-			imm2 = process(it, end, ip);
-			return imm <= imm2 ? 1 : 0;
-		case Op::Greater:
-			imm = process(it, end, ip);
-			imm2 = process(it, end, ip);
-			return imm > imm2 ? 1 : 0;
-		case Op::Less:
-			imm = process(it, end, ip);
-			imm2 = process(it, end, ip);
-			return imm < imm2 ? 1 : 0;
-		case Op::NotEqual:
-			imm = process(it, end, ip);
-			imm2 = process(it, end, ip);
-			return imm != imm2 ? 1 : 0;
-		case Op::Or:
-			imm = process(it, end, ip);
-			imm2 = process(it, end, ip);
-			return !!imm || !!imm2 ? 1 : 0;
-		case Op::And:
-			imm = process(it, end, ip);
-			imm2 = process(it, end, ip);
-			return !!imm && !!imm2 ? 1 : 0;
-		case Op::Ternary:
-			imm = process(it, end, ip);
-			imm2 = process(it, end, ip);
-			imm3 = process(it, end, ip);
-			return imm != 0 ? imm2 : imm3;
-		case Op::Function:
-			imm = *it++; // function
-			imm2 = *it++; // arguments
-
-			if ((imm2 & 0x80) != 0) {
+
+			if (constant) {
+				// All operands are Push instructions
+				int32_t a = expr.code[start].arg;
+				int32_t value;
+				if (operands == 1) {
+					value = EvaluateUnary(code, a);
+				} else if (operands == 2) {
+					value = EvaluateBinary(code, a, expr.code[start + 1].arg);
+				} else {
+					value = a != 0 ? expr.code[start + 1].arg : expr.code[start + 2].arg;
+				}
+				Fold(start, operands, value);
+				return;
+			}
+
+			Emit(code, 0, 1 - operands);
+		}
+
+		void CompileFunction() {
+			auto fn = static_cast<Fn>(Read());
+			int args = Read();
+
+			if ((args & 0x80) != 0) {
 				// Argument count is 4 bytes, that mode is not supported
 				Output::Warning("Maniac: Expression func long args unsupported");
-				return 0;
+				Push(0);
+				return;
 			}
 
-			switch (static_cast<Fn>(imm)) {
-				case Fn::Rand:
-					if (imm2 != 2) {
-						Output::Warning("Maniac: Expression rnd args {} != 2", imm2);
-						return 0;
-					}
-					imm3 = process(it, end, ip);
-					return ControlVariables::Random(process(it, end, ip), imm3);
-				case Fn::Item:
-					if (imm2 != 2) {
-						Output::Warning("Maniac: Expression item args {} != 2", imm2);
-						return 0;
-					}
-					imm3 = process(it, end, ip);
-					return ControlVariables::Item(process(it, end, ip), imm3);
-				case Fn::Event:
-					if (imm2 != 2) {
-						Output::Warning("Maniac: Expression event args {} != 2", imm2);
-						return 0;
-					}
-					imm3 = process(it, end, ip);
-					return ControlVariables::Event(process(it, end, ip), imm3, ip);
-				case Fn::Actor:
-					if (imm2 != 2) {
-						Output::Warning("Maniac: Expression actor args {} != 2", imm2);
-						return 0;
-					}
-					return ControlVariables::Actor(process(it, end, ip), imm3);
-				case Fn::Party:
-					if (imm2 != 2) {
-						Output::Warning("Maniac: Expression member args {} != 2", imm2);
-						return 0;
+			int expected_args = GetFunctionArgs(fn);
+			if (expected_args == -1) {
+				Output::Warning("Maniac: Expression Unknown Func {}", static_cast<int>(fn));
+			} else if (args != expected_args) {
+				Output::Warning("Maniac: Expression {} args {} != {}", GetFunctionName(fn), args, expected_args);
+				Push(0);
+				return;
+			}
+
+			size_t start = expr.code.size();
+			bool constant = true;
+			for (int i = 0; i < args; ++i) {
+				size_t operand_start = expr.code.size();
+				CompileOperand();
+				constant &= IsConstant(operand_start);
+			}
+
+			if (expected_args == -1) {
+				// The arguments are still evaluated, Call returns 0
+				Emit(Code::Call, static_cast<int>(fn) | (args << 8), 1 - args);
+				return;
+			}
+
+			if (constant && IsPureFunction(fn)) {
+				std::array<int32_t, 3> values;
+				for (int i = 0; i < args; ++i) {
+					values[i] = expr.code[start + i].arg;
+				}
+				Fold(start, args, EvaluateFunction(fn, values.data(), nullptr));
+				return;
+			}
+
+			Emit(Code::Call, static_cast<int>(fn) | (args << 8), 1 - args);
+		}
+
+		void CompileOperand() {
+			if (AtEnd()) {
+				Push(0);
+				return;
+			}
+
+			auto op = static_cast<Op>(Read());
+			size_t start = expr.code.size();
+
+			switch (op) {
+				case Op::Null:
+					Read();
+					Push(0);
+					return;
+				case Op::U8:
+				case Op::UX8:
+					Push(Read());
+					return;
+				case Op::U16:
+				case Op::UX16: {
+					int imm = Read();
+					if (AtEnd()) {
+						Push(0);
+						return;
 					}
-					imm3 = process(it, end, ip);
-					return ControlVariables::Party(process(it, end, ip), imm3);
-				case Fn::Enemy:
-					if (imm2 != 2) {
-						Output::Warning("Maniac: Expression enemy args {} != 2", imm2);
-						return 0;
+					int imm2 = Read();
+					Push((imm2 << 8) + imm);
+					return;
+				}
+				case Op::S32:
+				case Op::SX32: {
+					uint32_t value = 0;
+					for (int i = 0; i < 4; ++i) {
+						if (i > 0 && AtEnd()) {
+							Push(0);
+							return;
+						}
+						value |= static_cast<uint32_t>(Read()) << (8 * i);
 					}
-					imm3 = process(it, end, ip);
-					return ControlVariables::Enemy(process(it, end, ip), imm3);
+					Push(static_cast<int32_t>(value));
+					return;
+				}
+				case Op::Var:
+					CompileAccess(Code::Var, Code::VarDyn);
+					return;
+				case Op::Switch:
+					CompileAccess(Code::Switch, Code::SwitchDyn);
+					return;
+				case Op::VarIndirect:
+					CompileAccess(Code::VarIndirect, Code::VarIndirectDyn);
+					return;
+				case Op::SwitchIndirect:
+					CompileAccess(Code::SwitchIndirect, Code::SwitchIndirectDyn);
+					return;
+				case Op::Negate:
+					CompileOperands(start, Code::Negate, 1);
+					return;
+				case Op::Not:
+					CompileOperands(start, Code::Not, 1);
+					return;
+				case Op::Flip:
+					CompileOperands(start, Code::Flip, 1);
+					return;
+				case Op::Add:
+				case Op::Sub:
+				case Op::Mul:
+				case Op::Div:
+				case Op::Mod:
+				case Op::BitOr:
+				case Op::BitAnd:
+				case Op::BitXor:
+				case Op::BitShiftLeft:
+				case Op::BitShiftRight:
+				case Op::Equal:
+				case Op::GreaterEqual:
+				case Op::LessEqual:
+				case Op::Greater:
+				case Op::Less:
+				case Op::NotEqual:
+				case Op::Or:
+				case Op::And:
+					// Both enums list the binary operations in the same order
+					CompileOperands(start, static_cast<Code>(static_cast<int>(Code::Add) + static_cast<int>(op) - static_cast<int>(Op::Add)), 2);
+					return;
+				case Op::Ternary:
+					// All operands are evaluated, they can have side effects (rnd)
+					CompileOperands(start, Code::Ternary, 3);
+					return;
+				case Op::Function:
+					CompileFunction();
+					return;
+				default:
+					Output::Warning("Maniac: Expression contains unsupported operation {}", static_cast<int>(op));
+					Push(0);
+					return;
+			}
+		}
+
+		Span<const int32_t> op_codes;
+		size_t size;
+		size_t pos = 0;
+		int depth = 0;
+		Expression expr;
+	};
+
+	int32_t Expression::Evaluate(const Game_Interpreter& ip) const {
+		std::array<int32_t, max_fixed_stack> fixed_stack;
+		std::vector<int32_t> large_stack;
+		int32_t* stack = fixed_stack.data();
+		if (max_stack > max_fixed_stack) {
+			large_stack.resize(max_stack);
+			stack = large_stack.data();
+		}
+
+		// Points behind the top of the stack
+		int32_t* sp = stack;
+
+		for (const auto& ins: code) {
+			switch (ins.code) {
+				case Code::Push:
+					*sp++ = ins.arg;
 					break;
-				case Fn::Misc:
-					if (imm2 != 1) {
-						Output::Warning("Maniac: Expression misc args {} != 1", imm2);
-						return 0;
-					}
-					return ControlVariables::Other(process(it, end, ip));
-				case Fn::Pow:
-					if (imm2 != 2) {
-						Output::Warning("Maniac: Expression pow args {} != 2", imm2);
-						return 0;
-					}
-					return ControlVariables::Pow(process(it, end, ip), process(it, end, ip));
-				case Fn::Sqrt:
-					if (imm2 != 2) {
-						Output::Warning("Maniac: Expression sqrt args {} != 2", imm2);
-						return 0;
-					}
-					return ControlVariables::Sqrt(process(it, end, ip), process(it, end, ip));
-				case Fn::Sin:
-					if (imm2 != 3) {
-						Output::Warning("Maniac: Expression sin args {} != 3", imm2);
-						return 0;
-					}
-					return ControlVariables::Sin(process(it, end, ip), process(it, end, ip), process(it, end, ip));
-				case Fn::Cos:
-					if (imm2 != 3) {
-						Output::Warning("Maniac: Expression cos args {} != 3", imm2);
-						return 0;
-					}
-					return ControlVariables::Cos(process(it, end, ip), process(it, end, ip), process(it, end, ip));
-				case Fn::Atan2:
-					if (imm2 != 3) {
-						Output::Warning("Maniac: Expression atan2 args {} != 3", imm2);
-						return 0;
-					}
-					return ControlVariables::Atan2(process(it, end, ip), process(it, end, ip), process(it, end, ip));
-				case Fn::Min:
-					if (imm2 != 2) {
-						Output::Warning("Maniac: Expression min args {} != 2", imm2);
-						return 0;
-					}
-					return ControlVariables::Min(process(it, end, ip), process(it, end, ip));
-				case Fn::Max:
-					if (imm2 != 2) {
-						Output::Warning("Maniac: Expression max args {} != 2", imm2);
-						return 0;
-					}
-					return ControlVariables::Max(process(it, end, ip), process(it, end, ip));
-				case Fn::Abs:
-					if (imm2 != 1) {
-						Output::Warning("Maniac: Expression abs args {} != 1", imm2);
-						return 0;
-					}
-					return ControlVariables::Abs(process(it, end, ip));
-				case Fn::Clamp:
-					if (imm2 != 3) {
-						Output::Warning("Maniac: Expression clamp args {} != 3", imm2);
-						return 0;
-					}
-					return ControlVariables::Clamp(process(it, end, ip), process(it, end, ip), process(it, end, ip));
-				case Fn::Muldiv:
-					if (imm2 != 3) {
-						Output::Warning("Maniac: Expression muldiv args {} != 3", imm2);
-						return 0;
-					}
-					return ControlVariables::Muldiv(process(it, end, ip), process(it, end, ip), process(it, end, ip));
-				case Fn::Divmul:
-					if (imm2 != 3) {
-						Output::Warning("Maniac: Expression divmul args {} != 3", imm2);
-						return 0;
-					}
-					return ControlVariables::Divmul(process(it, end, ip), process(it, end, ip), process(it, end, ip));
-				case Fn::Between:
-					if (imm2 != 3) {
-						Output::Warning("Maniac: Expression between args {} != 3", imm2);
-						return 0;
-					}
-					return ControlVariables::Between(process(it, end, ip), process(it, end, ip), process(it, end, ip));
+				case Code::Var:
+					*sp++ = Main_Data::game_variables->Get(ins.arg);
+					break;
+				case Code::VarDyn:
+					sp[-1] = Main_Data::game_variables->Get(sp[-1]);
+					break;
+				case Code::Switch:
+					*sp++ = Main_Data::game_switches->GetInt(ins.arg);
+					break;
+				case Code::SwitchDyn:
+					sp[-1] = Main_Data::game_switches->GetInt(sp[-1]);
+					break;
+				case Code::VarIndirect:
+					*sp++ = Main_Data::game_variables->GetIndirect(ins.arg);
+					break;
+				case Code::VarIndirectDyn:
+					sp[-1] = Main_Data::game_variables->GetIndirect(sp[-1]);
+					break;
+				case Code::SwitchIndirect:
+					*sp++ = Main_Data::game_switches->GetInt(Main_Data::game_variables->Get(ins.arg));
+					break;
+				case Code::SwitchIndirectDyn:
+					sp[-1] = Main_Data::game_switches->GetInt(Main_Data::game_variables->Get(sp[-1]));
+					break;
+				case Code::Negate:
+				case Code::Not:
+				case Code::Flip:
+					sp[-1] = EvaluateUnary(ins.code, sp[-1]);
+					break;
+				case Code::Ternary:
+					sp -= 2;
+					sp[-1] = sp[-1] != 0 ? sp[0] : sp[1];
+					break;
+				case Code::Call: {
+					int args = ins.arg >> 8;
+					sp -= args;
+					*sp = EvaluateFunction(static_cast<Fn>(ins.arg & 0xFF), sp, &ip);
+					++sp;
+					break;
+				}
 				default:
-					Output::Warning("Maniac: Expression Unknown Func {}", imm);
-					for (int i = 0; i < imm2; ++i) {
-						process(it, end, ip);
-					}
-					return 0;
+					--sp;
+					sp[-1] = EvaluateBinary(ins.code, sp[-1], sp[0]);
+					break;
 			}
-		default:
-			Output::Warning("Maniac: Expression contains unsupported operation {}", static_cast<int>(op));
-			return 0;
+		}
+
+		return sp != stack ? stack[0] : 0;
+	}
+
+	struct CachedExpression {
+		std::vector<int32_t> op_codes;
+		Expression expr;
+	};
+
+	// Keyed by the parameters of the event command, the op codes are
+	// compared because the command can be freed and the memory reused
+	std::unordered_map<const int32_t*, CachedExpression> expression_cache;
+
+	// Commands of old maps and frames stay in the cache until it is full
+	constexpr size_t max_cached_expressions = 4096;
+
+	const Expression& GetExpression(Span<const int32_t> op_codes) {
+		auto it = expression_cache.find(op_codes.data());
+		if (it != expression_cache.end()) {
+			auto& cached = it->second;
+			if (std::equal(cached.op_codes.begin(), cached.op_codes.end(), op_codes.begin(), op_codes.end())) {
+				return cached.expr;
+			}
+		} else if (expression_cache.size() >= max_cached_expressions) {
+			expression_cache.clear();
+		}
+
+		auto& cached = expression_cache[op_codes.data()];
+		cached.op_codes.assign(op_codes.begin(), op_codes.end());
+		cached.expr = Compiler(op_codes).Compile();
+		return cached.expr;
 	}
 }
 
 int32_t ManiacPatch::ParseExpression(Span<const int32_t> op_codes, const Game_Interpreter& interpreter) {
-	std::vector<int32_t> ops;
-	for (auto &o: op_codes) {
-		auto uo = static_cast<uint32_t>(o);
-		ops.push_back(static_cast<int32_t>(uo & 0x000000FF));
-		ops.push_back(static_cast<int32_t>((uo & 0x0000FF00) >> 8));
-		ops.push_back(static_cast<int32_t>((uo & 0x00FF0000) >> 16));
-		ops.push_back(static_cast<int32_t>((uo & 0xFF000000) >> 24));
-	}
-	auto beg = ops.begin();
-	return process(beg, ops.end(), interpreter);
+	return GetExpression(op_codes).Evaluate(interpreter);
 }
 
 std::array<bool, 50> ManiacPatch::GetKeyRange() {
@@ -0,0 +1,214 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <future>
+#include <list>
+#include <unordered_map>
+#include "async_handler.h"
+#include "map_cache.h"
+#include "utils.h"
+#include "instrumentation.h"
+#include <lcf/lmu/reader.h>
+
+namespace {
+	struct CacheItem {
+		int map_id;
+		MapCache::ParsedMap parsed;
+		size_t size;
+	};
+
+	// Most recently used item first
+	using lru_type = std::list<CacheItem>;
+	lru_type lru;
+	std::unordered_map<int, lru_type::iterator> cache;
+	size_t cache_bytes = 0;
+
+	// Maps parsed in the background, added to the cache by MapCache::Update
+	std::unordered_map<int, std::future<MapCache::ParsedMap>> pending_parses;
+
+	// Maps are preloaded for every teleport target, this keeps maps with
+	// many targets from flooding the workers
+	constexpr size_t max_pending_parses = 8;
+
+	size_t cache_budget = 8 * 1024 * 1024;
+
+	MapCache::Stats stats;
+
+	void FreeMapMemory() {
+		while (cache_bytes > cache_budget && !lru.empty()) {
+			auto& item = lru.back();
+			cache_bytes -= item.size;
+			cache.erase(item.map_id);
+			lru.pop_back();
+			++stats.evictions;
+		}
+	}
+}
+
+MapCache::ParsedMap MapCache::Parse(Filesystem_Stream::InputStream is, bool xml, std::string encoding, bool with_crc) {
+	EP_PROFILE_ZONE("MapCache::Parse");
+
+	ParsedMap parsed;
+	parsed.xml = xml;
+
+	if (xml) {
+		parsed.map = lcf::LMU_Reader::LoadXml(is);
+		return parsed;
+	}
+
+	parsed.map = lcf::LMU_Reader::Load(is, encoding);
+
+	if (with_crc) {
+		is.clear();
+		is.seekg(0);
+		parsed.crc = Utils::CRC32(is);
+		parsed.has_crc = true;
+	}
+
+	return parsed;
+}
+
+MapCache::ParsedMap MapCache::Get(int map_id) {
+	auto pending = pending_parses.find(map_id);
+	if (pending != pending_parses.end()) {
+		// Waiting is faster than parsing the map a second time
+		auto parsed = pending->second.get();
+		pending_parses.erase(pending);
+		if (parsed.map) {
+			++stats.preloads;
+			Add(map_id, parsed);
+		}
+	}
+
+	auto it = cache.find(map_id);
+	if (it == cache.end()) {
+		++stats.misses;
+		return {};
+	}
+
+	++stats.hits;
+	lru.splice(lru.begin(), lru, it->second);
+	return it->second->parsed;
+}
+
+void MapCache::Add(int map_id, ParsedMap parsed) {
+	if (!parsed.map) {
+		return;
+	}
+
+	auto it = cache.find(map_id);
+	if (it != cache.end()) {
+		cache_bytes -= it->second->size;
+		lru.erase(it->second);
+		cache.erase(it);
+	}
+
+	const size_t size = EstimateSize(*parsed.map);
+	if (size > cache_budget) {
+		return;
+	}
+
+	lru.push_front({map_id, std::move(parsed), size});
+	cache[map_id] = lru.begin();
+	cache_bytes += size;
+
+	FreeMapMemory();
+}
+
+void MapCache::Preload(int map_id, Filesystem_Stream::InputStream is, bool xml, std::string encoding) {
+	if (IsCachedOrPending(map_id) || pending_parses.size() >= max_pending_parses) {
+		return;
+	}
+
+	// The checksum is always calculated because the cached map can be
+	// used later when recording input
+	auto task = [is = std::move(is), xml, encoding = std::move(encoding)]() mutable {
+		return Parse(std::move(is), xml, std::move(encoding), true);
+	};
+
+	pending_parses[map_id] = AsyncHandler::RunTask(std::move(task));
+}
+
+bool MapCache::IsCachedOrPending(int map_id) {
+	return cache.count(map_id) > 0 || pending_parses.count(map_id) > 0;
+}
+
+void MapCache::Update() {
+	for (auto it = pending_parses.begin(); it != pending_parses.end();) {
+		if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			++it;
+			continue;
+		}
+
+		auto parsed = it->second.get();
+		if (parsed.map) {
+			++stats.preloads;
+			Add(it->first, std::move(parsed));
+		}
+		it = pending_parses.erase(it);
+	}
+}
+
+void MapCache::Clear() {
+	// The tasks own their data, the results are discarded
+	pending_parses.clear();
+
+	cache.clear();
+	lru.clear();
+	cache_bytes = 0;
+}
+
+MapCache::Stats MapCache::GetStats() {
+	Stats result = stats;
+	result.bytes = cache_bytes;
+	result.entries = lru.size();
+	return result;
+}
+
+void MapCache::SetBudget(size_t bytes) {
+	cache_budget = bytes;
+	FreeMapMemory();
+}
+
+size_t MapCache::GetBudget() {
+	return cache_budget;
+}
+
+size_t MapCache::EstimateSize(const lcf::rpg::Map& map) {
+	size_t size = sizeof(map);
+	size += map.lower_layer.size() * sizeof(map.lower_layer[0]);
+	size += map.upper_layer.size() * sizeof(map.upper_layer[0]);
+
+	for (const auto& ev: map.events) {
+		size += sizeof(ev) + ev.name.size();
+
+		for (const auto& page: ev.pages) {
+			size += sizeof(page) + page.character_name.size();
+
+			for (const auto& cmd: page.event_commands) {
+				size += sizeof(cmd) + cmd.string.size() + cmd.parameters.size() * sizeof(int32_t);
+			}
+
+			for (const auto& cmd: page.move_route.move_commands) {
+				size += sizeof(cmd) + cmd.parameter_string.size();
+			}
+		}
+	}
+
+	return size;
+}
@@ -0,0 +1,139 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_MAP_CACHE_H
+#define EP_MAP_CACHE_H
+
+// Headers
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <lcf/rpg/map.h>
+#include "filesystem_stream.h"
+
+/**
+ * Keeps parsed maps in memory so that returning to a recently visited map
+ * does not parse the map file again. Maps reachable from the current map
+ * are parsed ahead on a worker thread.
+ * The cached maps are never modified, users receive a copy.
+ */
+namespace MapCache {
+	/** A parsed map file */
+	struct ParsedMap {
+		std::shared_ptr<const lcf::rpg::Map> map;
+		/** Map is in the EasyRPG XML format */
+		bool xml = false;
+		/** crc contains the CRC32 of the file, only calculated for LMU files */
+		bool has_crc = false;
+		uint32_t crc = 0;
+	};
+
+	/**
+	 * Parses a map file. Does not access global state and is safe to call
+	 * from a worker thread.
+	 *
+	 * @param is stream of the map file
+	 * @param xml the file is an EasyRPG XML map instead of LMU
+	 * @param encoding encoding of the strings in a LMU file
+	 * @param with_crc calculate the CRC32 of a LMU file
+	 * @return parsed map, map is null on parse errors
+	 */
+	ParsedMap Parse(Filesystem_Stream::InputStream is, bool xml, std::string encoding, bool with_crc);
+
+	/**
+	 * Looks up a map. When the map is still parsed in the background this
+	 * waits for the result.
+	 *
+	 * @param map_id map to look up
+	 * @return cached map, map is null when the map is not cached
+	 */
+	ParsedMap Get(int map_id);
+
+	/**
+	 * Adds a map to the cache and frees the least recently used maps when
+	 * the cache exceeds its budget.
+	 *
+	 * @param map_id id of the map
+	 * @param parsed parsed map
+	 */
+	void Add(int map_id, ParsedMap parsed);
+
+	/**
+	 * Parses a map on a worker thread when it is not cached. The map is
+	 * added to the cache by Update or by the next Get.
+	 * The stream must be opened on the main thread because the filesystem
+	 * is not thread-safe.
+	 *
+	 * @param map_id id of the map
+	 * @param is stream of the map file
+	 * @param xml the file is an EasyRPG XML map instead of LMU
+	 * @param encoding encoding of the strings in a LMU file
+	 */
+	void Preload(int map_id, Filesystem_Stream::InputStream is, bool xml, std::string encoding);
+
+	/**
+	 * @param map_id map to check
+	 * @return whether the map is cached or being preloaded
+	 */
+	bool IsCachedOrPending(int map_id);
+
+	/**
+	 * Adds maps that finished parsing in the background to the cache.
+	 * Called once per frame.
+	 */
+	void Update();
+
+	/** Frees all cached maps and discards running preloads. */
+	void Clear();
+
+	/** Cache statistics */
+	struct Stats {
+		/** Lookups answered by the cache */
+		uint64_t hits = 0;
+		/** Lookups of maps that were not cached */
+		uint64_t misses = 0;
+		/** Maps freed to stay in the budget */
+		uint64_t evictions = 0;
+		/** Maps added by a background preload */
+		uint64_t preloads = 0;
+		/** Estimated bytes used by cached maps */
+		size_t bytes = 0;
+		/** Number of cached maps */
+		size_t entries = 0;
+	};
+
+	/** @return cache statistics */
+	Stats GetStats();
+
+	/**
+	 * Sets the memory budget of the map cache and frees maps that exceed it.
+	 *
+	 * @param bytes budget in bytes
+	 */
+	void SetBudget(size_t bytes);
+
+	/** @return memory budget of the map cache in bytes */
+	size_t GetBudget();
+
+	/**
+	 * @param map map to measure
+	 * @return estimated memory used by the map in bytes
+	 */
+	size_t EstimateSize(const lcf::rpg::Map& map);
+}
+
+#endif
@@ -20,6 +20,7 @@
 #include "message_overlay.h"
 #include "player.h"
 #include "bitmap.h"
+#include "damage_tracker.h"
 #include "game_message.h"
 #include "drawable_mgr.h"
 #include "baseui.h"
@@ -60,6 +61,20 @@ void MessageOverlay::Draw(Bitmap& dst) {
 	dirty = false;
 }
 
+bool MessageOverlay::GetDamageState(DamageState& state) const {
+	const bool visible = IsAnyMessageVisible() || show_all;
+	if (visible && dirty) {
+		// The text is redrawn after blitting, report unknown until it settled
+		return false;
+	}
+
+	if (visible) {
+		state.bounds = Rect(ox, oy, bitmap->GetWidth(), bitmap->GetHeight());
+	}
+	state.Hash(visible, ox, oy, bitmap.get(), bitmap ? bitmap->GetGeneration() : 0u);
+	return true;
+}
+
 void MessageOverlay::AddMessage(const std::string& message, Color color) {
 	if (message.empty()) {
 		return;
@@ -93,6 +93,9 @@
 /** File name for additional metadata, such as multi-game save imports. */
 #define META_NAME "Meta.ini"
 
+/** Directory listings kept across launches, stored in the config directory. */
+#define DIRECTORY_INDEX_NAME "directory.index"
+
 /**
  * RPG_RT.exe (official engine) filename.
  * Not used by emscripten.
@@ -22,6 +22,7 @@
 #include <cstdio>
 #include <iostream>
 #include <fstream>
+#include <mutex>
 #include <thread>
 #include <chrono>
 #ifdef __ANDROID__
@@ -93,6 +94,17 @@ namespace {
 	bool ignore_pause = false;
 
 	std::vector<std::string> log_buffer;
+
+	// Logging is not thread-safe, the main thread writes messages of other threads
+	struct BackgroundMessage {
+		LogLevel lvl;
+		std::string msg;
+		Color color;
+	};
+	thread_local bool background_thread = false;
+	std::mutex background_mutex;
+	std::vector<BackgroundMessage> background_messages;
+
 	// pair of repeat count + message
 	struct {
 		int repeat = 0;
@@ -118,6 +130,12 @@ void Output::IgnorePause(bool const val) {
 }
 
 static void WriteLog(LogLevel lvl, std::string const& msg, Color const& c = Color()) {
+	if (background_thread) {
+		std::lock_guard<std::mutex> lock(background_mutex);
+		background_messages.push_back({lvl, msg, c});
+		return;
+	}
+
 #ifdef EMSCRIPTEN
 
 // Allow pretty log output and filtering in browser console
@@ -303,6 +321,22 @@ bool Output::TakeScreenshot(std::ostream& os) {
 	return DisplayUi->GetDisplaySurface()->WritePNG(os);
 }
 
+void Output::RegisterBackgroundThread() {
+	background_thread = true;
+}
+
+void Output::Update() {
+	std::vector<BackgroundMessage> messages;
+	{
+		std::lock_guard<std::mutex> lock(background_mutex);
+		messages.swap(background_messages);
+	}
+
+	for (auto& m: messages) {
+		WriteLog(m.lvl, m.msg, m.color);
+	}
+}
+
 void Output::ToggleLog() {
 	static bool show_log = true;
 	Graphics::GetMessageOverlay().SetShowAll(show_log);
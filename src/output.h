@@ -57,6 +57,18 @@ namespace Output {
 	 */
 	void Quit();
 
+	/**
+	 * Marks the calling thread as a background thread.
+	 * Log messages of background threads are queued until the next Update.
+	 */
+	void RegisterBackgroundThread();
+
+	/**
+	 * Writes the queued log messages of background threads.
+	 * Must be called from the main thread.
+	 */
+	void Update();
+
 	/**
 	 * Takes screenshot and save it in the save directory.
 	 *
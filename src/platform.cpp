@@ -20,7 +20,12 @@
 #include "filefinder.h"
 #include "utils.h"
 #include <cassert>
+#include <climits>
+#include <limits>
 #include <utility>
+#ifdef USE_MMAP
+#  include <fcntl.h>
+#endif
 
 #ifndef DT_UNKNOWN
 #define DT_UNKNOWN 0
@@ -31,6 +36,31 @@
 #ifndef DT_DIR
 #define DT_DIR DT_UNKNOWN
 #endif
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+std::string Platform::GetWorkingDirectory() {
+#if defined(_WIN32)
+	DWORD length = ::GetCurrentDirectoryW(0, nullptr);
+	if (length == 0) {
+		return "";
+	}
+
+	std::wstring path(length, L'\0');
+	length = ::GetCurrentDirectoryW(length, &path[0]);
+	path.resize(length);
+	return Utils::FromWideString(path);
+#elif defined(__vita__)
+	return "";
+#else
+	char path[PATH_MAX];
+	if (!::getcwd(path, sizeof(path))) {
+		return "";
+	}
+	return path;
+#endif
+}
 
 Platform::File::File(std::string name) :
 #ifdef _WIN32
@@ -123,6 +153,29 @@ int64_t Platform::File::GetSize() const {
 #endif
 }
 
+int64_t Platform::File::GetModificationTime() const {
+#if defined(_WIN32)
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	BOOL res = ::GetFileAttributesExW(filename.c_str(),
+			GetFileExInfoStandard,
+			&data);
+	if (!res) {
+		return -1;
+	}
+
+	// FILETIME counts 100ns intervals since 1601-01-01
+	int64_t time = ((int64_t)data.ftLastWriteTime.dwHighDateTime << 32) | (int64_t)data.ftLastWriteTime.dwLowDateTime;
+	return time / 10000000 - 11644473600LL;
+#elif defined(__vita__)
+	// sceIoGetstat reports the time as a date structure
+	return -1;
+#else
+	struct stat sb = {};
+	int result = ::stat(filename.c_str(), &sb);
+	return (result == 0) ? (int64_t)sb.st_mtime : (int64_t)-1;
+#endif
+}
+
 bool Platform::File::MakeDirectory(bool follow_symlinks) const {
 	if (IsDirectory(follow_symlinks)) {
 		return true;
@@ -284,3 +337,62 @@ void Platform::Directory::Close() {
 
 	valid_entry = false;
 }
+
+Platform::MappedFile::MappedFile(const std::string& name) {
+#if defined(_WIN32)
+	HANDLE file_handle = ::CreateFileW(Utils::ToWideString(name).c_str(), GENERIC_READ, FILE_SHARE_READ,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file_handle == INVALID_HANDLE_VALUE) {
+		return;
+	}
+
+	LARGE_INTEGER file_size;
+	if (::GetFileSizeEx(file_handle, &file_size) && file_size.QuadPart > 0 &&
+			static_cast<uint64_t>(file_size.QuadPart) <= std::numeric_limits<size_t>::max()) {
+		mapping_handle = ::CreateFileMappingW(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping_handle) {
+			data = static_cast<const uint8_t*>(::MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+			if (data) {
+				size = static_cast<size_t>(file_size.QuadPart);
+			} else {
+				::CloseHandle(mapping_handle);
+				mapping_handle = nullptr;
+			}
+		}
+	}
+	// The mapping keeps the file open
+	::CloseHandle(file_handle);
+#elif defined(USE_MMAP)
+	int fd = ::open(name.c_str(), O_RDONLY);
+	if (fd == -1) {
+		return;
+	}
+
+	struct stat sb;
+	if (::fstat(fd, &sb) == 0 && sb.st_size > 0 &&
+			static_cast<uint64_t>(sb.st_size) <= std::numeric_limits<size_t>::max()) {
+		void* addr = ::mmap(nullptr, static_cast<size_t>(sb.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr != MAP_FAILED) {
+			data = static_cast<const uint8_t*>(addr);
+			size = static_cast<size_t>(sb.st_size);
+		}
+	}
+	// The mapping keeps the file open
+	::close(fd);
+#else
+	(void)name;
+#endif
+}
+
+Platform::MappedFile::~MappedFile() {
+	if (!*this) {
+		return;
+	}
+
+#if defined(_WIN32)
+	::UnmapViewOfFile(data);
+	::CloseHandle(mapping_handle);
+#elif defined(USE_MMAP)
+	::munmap(const_cast<uint8_t*>(data), size);
+#endif
+}
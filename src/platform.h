@@ -34,6 +34,9 @@
 #  endif
 #  include <unistd.h>
 #  include <sys/types.h>
+#  ifdef USE_MMAP
+#    include <sys/mman.h>
+#  endif
 #endif
 
 /**
@@ -49,6 +52,9 @@ namespace Platform {
 		Unknown
 	};
 
+	/** @return Current working directory or an empty string on error */
+	std::string GetWorkingDirectory();
+
 	/** Wrapper around file access */
 	class File {
 	public:
@@ -89,6 +95,9 @@ namespace Platform {
 		/** @return Filesize or -1 on error */
 		int64_t GetSize() const;
 
+		/** @return Last modification time in seconds since the epoch or -1 on error */
+		int64_t GetModificationTime() const;
+
 		/**
 		 * Creates a directory recursively at the filename path.
 		 * @param follow_symlinks Whether to follow symlinks (if supported on this platform)
@@ -154,6 +163,51 @@ namespace Platform {
 		bool valid_entry = false;
 	};
 
+	/** Read-only memory mapping of a whole file */
+	class MappedFile {
+	public:
+		explicit MappedFile() = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile(const MappedFile&) = delete;
+
+		/**
+		 * Maps a file into memory.
+		 * On platforms without memory mapping the mapping is always invalid.
+		 *
+		 * @param name File to map
+		 */
+		explicit MappedFile(const std::string& name);
+		~MappedFile();
+
+		/** @return Start of the mapped file */
+		const uint8_t* GetData() const;
+
+		/** @return Size of the mapped file */
+		size_t GetSize() const;
+
+		/** @return true if mapping the file was successful */
+		explicit operator bool() const noexcept;
+
+	private:
+#if defined(_WIN32)
+		HANDLE mapping_handle = nullptr;
+#endif
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+	};
+
+	inline const uint8_t* MappedFile::GetData() const {
+		return data;
+	}
+
+	inline size_t MappedFile::GetSize() const {
+		return size;
+	}
+
+	inline MappedFile::operator bool() const noexcept {
+		return data != nullptr;
+	}
+
 	inline Directory::operator bool() const noexcept {
 #ifdef __vita__
 		return dir_handle >= 0;
@@ -0,0 +1,92 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headers
+#include "ui.h"
+#include "bitmap.h"
+#include "game_clock.h"
+#include "output.h"
+
+#ifdef SUPPORT_AUDIO
+#include "audio.h"
+AudioInterface& HeadlessUi::GetAudio() {
+	return *audio_;
+}
+#endif
+
+HeadlessUi::HeadlessUi(long width, long height, const Game_Config& cfg) : BaseUi(cfg)
+{
+	current_display_mode.width = width;
+	current_display_mode.height = height;
+	current_display_mode.bpp = 32;
+
+	// There is no display to synchronize with: Run as fast as possible
+	SetFrameRateSynchronized(true);
+
+	// Every physical frame advances exactly one logical frame, independent of the wall clock
+	Game_Clock::SetFixedTimeStep(true);
+
+	const DynamicFormat format(
+		32,
+		0x00FF0000,
+		0x0000FF00,
+		0x000000FF,
+		0xFF000000,
+		PF::NoAlpha);
+
+	Bitmap::SetFormat(Bitmap::ChooseFormat(format));
+
+	main_surface = Bitmap::Create(current_display_mode.width,
+		current_display_mode.height,
+		false,
+		current_display_mode.bpp
+	);
+
+#ifdef SUPPORT_AUDIO
+	audio_ = std::make_unique<EmptyAudio>(cfg.audio);
+#endif
+
+	Output::Debug("Headless: {}x{} surface, frame limit disabled", width, height);
+}
+
+bool HeadlessUi::vChangeDisplaySurfaceResolution(int new_width, int new_height) {
+	BitmapRef new_main_surface = Bitmap::Create(new_width, new_height, false, current_display_mode.bpp);
+
+	if (!new_main_surface) {
+		Output::Warning("ChangeDisplaySurfaceResolution Bitmap::Create failed");
+		return false;
+	}
+
+	main_surface = new_main_surface;
+
+	current_display_mode.width = new_width;
+	current_display_mode.height = new_height;
+
+	return true;
+}
+
+void HeadlessUi::UpdateDisplay() {
+	// Nothing is presented, main_surface can be read with CaptureScreen
+}
+
+void HeadlessUi::ProcessEvents() {
+	// No event source, keys stay released
+}
+
+void HeadlessUi::vGetConfig(Game_ConfigVideo&) const {
+	// Not supported. All video options stay hidden.
+}
@@ -37,6 +37,7 @@
 #include "icon.h"
 
 #include "color.h"
+#include "damage_tracker.h"
 #include "graphics.h"
 #include "keys.h"
 #include "output.h"
@@ -558,7 +559,19 @@ void Sdl2Ui::ToggleVsync() {
 
 void Sdl2Ui::UpdateDisplay() {
 	// SDL_UpdateTexture was found to be faster than SDL_LockTexture / SDL_UnlockTexture.
-	SDL_UpdateTexture(sdl_texture_game, nullptr, main_surface->pixels(), main_surface->pitch());
+	const DamageTracker* damage = Graphics::GetDamage();
+	if (damage && !damage->IsFull() && !window.size_changed) {
+		// Only upload what changed, the texture keeps the remaining pixels
+		auto* pixels = static_cast<uint8_t*>(main_surface->pixels());
+		const int pitch = main_surface->pitch();
+		const int bytes_per_pixel = SDL_BYTESPERPIXEL(texture_format);
+		for (const auto& rect: damage->GetRects()) {
+			SDL_Rect sdl_rect = { rect.x, rect.y, rect.width, rect.height };
+			SDL_UpdateTexture(sdl_texture_game, &sdl_rect, pixels + rect.y * pitch + rect.x * bytes_per_pixel, pitch);
+		}
+	} else {
+		SDL_UpdateTexture(sdl_texture_game, nullptr, main_surface->pixels(), main_surface->pitch());
+	}
 
 	if (window.size_changed && window.width > 0 && window.height > 0) {
 		// Based on SDL2 function UpdateLogicalSize
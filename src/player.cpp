@@ -35,6 +35,7 @@
 
 #include "async_handler.h"
 #include "audio.h"
+#include "audio_decode_ahead.h"
 #include "cache.h"
 #include "rand.h"
 #include "cmdline_parser.h"
@@ -65,6 +66,7 @@
 #include <lcf/lmt/reader.h>
 #include <lcf/lsd/reader.h>
 #include "main_data.h"
+#include "map_cache.h"
 #include "output.h"
 #include "player.h"
 #include <lcf/reader_lcf.h>
@@ -83,6 +85,7 @@
 #include "baseui.h"
 #include "game_clock.h"
 #include "message_overlay.h"
+#include "replay_benchmark.h"
 
 #ifdef __ANDROID__
 #include "platform/android/android.h"
@@ -119,6 +122,7 @@ namespace Player {
 	bool no_rtp_flag;
 	std::string rtp_path;
 	bool no_audio_flag;
+	bool headless_flag;
 	bool is_easyrpg_project;
 	std::string encoding;
 	std::string escape_symbol;
@@ -131,6 +135,9 @@ namespace Player {
 	int frames;
 	std::string replay_input_path;
 	std::string record_input_path;
+	std::string benchmark_report_path;
+	bool benchmark_flag;
+	std::string profile_output_path;
 	std::string command_line;
 	int speed_modifier_a;
 	int speed_modifier_b;
@@ -181,6 +188,14 @@ void Player::Init(std::vector<std::string> args) {
 	Output::Debug("CLI: {}", command_line);
 
 	Game_Clock::logClockInfo();
+	if (benchmark_flag) {
+		if (rng_seed < 0) {
+			// Replays are only reproducible with a known seed
+			rng_seed = 1;
+			Output::Debug("Benchmark: No --seed provided, using {}", rng_seed);
+		}
+		ReplayBenchmark::Init(replay_input_path, benchmark_report_path);
+	}
 	if (rng_seed < 0) {
 		Rand::SeedRandomNumberGenerator(time(NULL));
 	} else {
@@ -199,12 +214,22 @@ void Player::Init(std::vector<std::string> args) {
 	Input::AddRecordingData(Input::RecordingData::CommandLine, command_line);
 
 	player_config = std::move(cfg.player);
+
+#ifndef EMSCRIPTEN
+	// Directory listings of previous launches, avoids enumerating the game and RTP directories again
+	FileFinder::LoadDirectoryIndex(Game_Config::GetGlobalConfigFilesystem());
+#endif
+
+	Cache::SetBudget(static_cast<size_t>(player_config.image_cache_size.Get()) * 1024 * 1024);
 	speed_modifier_a = cfg.input.speed_modifier_a.Get();
 	speed_modifier_b = cfg.input.speed_modifier_b.Get();
 }
 
 void Player::Run() {
 	Instrumentation::Init("EasyRPG-Player");
+	if (!profile_output_path.empty()) {
+		Instrumentation::SetProfilerEnabled(true);
+	}
 
 	Scene::Push(std::make_shared<Scene_Logo>());
 	Graphics::UpdateSceneCallback();
@@ -233,13 +258,16 @@ void Player::MainLoop() {
 	Player::UpdateInput();
 
 	int num_updates = 0;
+	Game_Clock::duration logic_time = {};
 	while (Game_Clock::NextGameTimeStep()) {
 		if (num_updates > 0) {
 			Player::UpdateInput();
 		}
 
 		Scene::old_instances.clear();
+		const auto logic_begin = Game_Clock::now();
 		Scene::instance->MainFunction();
+		logic_time += Game_Clock::now() - logic_begin;
 
 		Graphics::GetMessageOverlay().Update();
 
@@ -250,8 +278,14 @@ void Player::MainLoop() {
 		Input::UpdateSystem();
 	}
 
+	const auto draw_time = Game_Clock::now();
+
 	Player::Draw();
 
+	if (ReplayBenchmark::IsActive()) {
+		ReplayBenchmark::AddFrame({ logic_time, Game_Clock::now() - draw_time });
+	}
+
 	Scene::old_instances.clear();
 
 	if (!Transition::instance().IsActive() && Scene::instance->type == Scene::Null) {
@@ -334,6 +368,9 @@ void Player::Update(bool update_scene) {
 		IncFrame();
 	}
 
+	Output::Update();
+	Cache::Update();
+	MapCache::Update();
 	Audio().Update();
 	Input::Update();
 
@@ -387,6 +424,18 @@ int Player::GetFrames() {
 }
 
 void Player::Exit() {
+	ReplayBenchmark::WriteReport();
+
+	if (!profile_output_path.empty()) {
+		auto os = FileFinder::Root().OpenOutputStream(profile_output_path, std::ios_base::out | std::ios_base::trunc);
+		if (os) {
+			Instrumentation::WriteChromeTrace(os);
+			Output::Debug("Profiler: Trace written to {}", profile_output_path);
+		} else {
+			Output::Warning("Profiler: Cannot write trace to {}", profile_output_path);
+		}
+	}
+
 	if (player_config.settings_autosave.Get()) {
 		Scene_Settings::SaveConfig(true);
 	}
@@ -402,6 +451,7 @@ void Player::Exit() {
 	auto ret = FileFinder::Root().OpenOutputStream("/tmp/message.png", std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
 	if (ret) Output::TakeScreenshot(ret);
 #endif
+	AsyncHandler::StopWorkers();
 	Player::ResetGameObjects();
 	Font::Dispose();
 	DynRpg::Reset();
@@ -409,6 +459,8 @@ void Player::Exit() {
 	Output::Quit();
 	FileFinder::Quit();
 	DisplayUi.reset();
+	// After the audio system is gone, before the static MIDI synthesizers are destroyed
+	AudioDecodeAhead::Shutdown();
 }
 
 Game_Config Player::ParseCommandLine() {
@@ -422,6 +474,8 @@ Game_Config Player::ParseCommandLine() {
 	start_map_id = -1;
 	no_rtp_flag = false;
 	no_audio_flag = false;
+	headless_flag = false;
+	benchmark_flag = false;
 	is_easyrpg_project = false;
 	Game_Battle::battle_test.enabled = false;
 
@@ -606,6 +660,26 @@ Game_Config Player::ParseCommandLine() {
 			}
 			continue;
 		}
+		if (cp.ParseNext(arg, 1, "--benchmark-replay")) {
+			if (arg.NumValues() > 0) {
+				replay_input_path = arg.Value(0);
+				benchmark_flag = true;
+				headless_flag = true;
+			}
+			continue;
+		}
+		if (cp.ParseNext(arg, 1, "--benchmark-report")) {
+			if (arg.NumValues() > 0) {
+				benchmark_report_path = arg.Value(0);
+			}
+			continue;
+		}
+		if (cp.ParseNext(arg, 1, "--profile")) {
+			if (arg.NumValues() > 0) {
+				profile_output_path = arg.Value(0);
+			}
+			continue;
+		}
 		if (cp.ParseNext(arg, 1, "--encoding")) {
 			if (arg.NumValues() > 0) {
 				forced_encoding = arg.Value(0);
@@ -616,6 +690,10 @@ Game_Config Player::ParseCommandLine() {
 			no_audio_flag = true;
 			continue;
 		}
+		if (cp.ParseNext(arg, 0, "--headless")) {
+			headless_flag = true;
+			continue;
+		}
 		if (cp.ParseNext(arg, 0, "--no-rtp") || cp.ParseNext(arg, 0, "--disable-rtp")) {
 			no_rtp_flag = true;
 			continue;
@@ -810,6 +888,9 @@ void Player::CreateGameObjects() {
 
 	Main_Data::filefinder_rtp = std::make_unique<FileFinder_RTP>(no_rtp_flag, no_rtp_warning_flag, rtp_path);
 
+	// The game and RTP directories are enumerated by now
+	FileFinder::SaveDirectoryIndex();
+
 	if (!game_config.patch_override) {
 		if (!FileFinder::Game().FindFile("harmony.dll").empty()) {
 			game_config.patch_key_patch.Set(true);
@@ -1387,6 +1468,8 @@ Engine options:
                        rpg2k3     - RPG Maker 2003 (v1.00 - v1.04)
                        rpg2k3v105 - RPG Maker 2003 (v1.05 - v1.09a)
                        rpg2k3e    - RPG Maker 2003 (English release, v1.12)
+ --image-cache-size N Keep up to N MiB of unused images in memory (1-1024).
+                      Default is 10.
  --language LANG      Load the game translation in language/LANG folder.
  --load-game-id N     Skip the title scene and load SaveN.lsd (N is padded to
                       two digits).
@@ -1417,6 +1500,9 @@ Engine options:
  --seed N             Seeds the random number generator with N.
 
 Video options:
+ --damage-tracking    Only redraw and upload the areas of the screen that
+                      changed. Saves power on static screens like menus.
+                      Disable with --no-damage-tracking.
  --fps-limit          In combination with --no-vsync sets a custom frames per
                       second limit. The default is 60 FPS. Use --no-fps-limit
                       to run with unlimited frames per second.
@@ -1430,6 +1516,9 @@ Video options:
                        original   - 320x240 (4:3). Recommended
                        widescreen - 416x240 (16:9)
                        ultrawide  - 560x240 (21:9)
+ --headless           Do not open a window and run without frame limit. The
+                      game is rendered to memory. Use with --replay-input to
+                      run unattended, the Player exits when the log ends.
  --scaling S          How the video output is scaled.
                       Options:
                        nearest  - Scale to screen size. Fast, but causes scaling
@@ -1437,6 +1526,9 @@ Video options:
                        integer  - Scales to a multiple of the game resolution.
                        bilinear - Like nearest, but applies a bilinear filter to
                                   avoid artifacts.
+ --screen-tone-pass   Apply the screen tone once to the rendered map instead of
+                      tinting every map sprite. Faster, colors can differ
+                      slightly. Disable with --no-screen-tone-pass.
  --show-fps           Enable display of the frames per second counter.
                       Disable with --no-show-fps.
  --stretch            Ignore the aspect ratio and stretch video output to the
@@ -1447,6 +1539,10 @@ Video options:
  --window             Start in windowed mode.
 
 Audio options:
+ --bgm-decode-ahead MS
+                      Decode MS milliseconds of music in advance on a
+                      background thread (0-1000). 0 decodes during playback.
+                      Default is 100.
  --no-audio           Disable audio (in case you prefer your own music).
  --music-volume V     Set volume of background music to V (0-100).
  --sound-volume V     Set volume of sound effects to V (0-100).
@@ -1458,8 +1554,18 @@ Debug options:
                       Providing a single N sets the monster party.
                       Providing four N sets: monster party, formation,
                       condition and terrain ID.
+ --benchmark-replay FILE
+                      Replays the input log FILE without window as fast as
+                      possible and prints frame timings and a checksum of all
+                      switches and variables on exit. Implies --headless.
+ --benchmark-report FILE
+                      Write the report of --benchmark-replay to FILE.
  --hide-title         Hide the title background image and center the command
                       menu.
+ --profile FILE       Enable the built-in profiler. The time spent per frame in
+                      the engine subsystems is listed below the FPS counter
+                      and a trace (Chrome trace format) is written to FILE on
+                      exit.
  --start-map-id N     Overwrite the map used for new games and use MapN.lmu
                       instead (N is padded to four digits).
                       Incompatible with --load-game-id.
@@ -358,6 +358,12 @@ namespace Player {
 	/** Mutes audio playback */
 	extern bool no_audio_flag;
 
+	/** Renders without a window and without frame limit (HeadlessUi) */
+	extern bool headless_flag;
+
+	/** Measure frame timings while replaying an input log (--benchmark-replay) */
+	extern bool benchmark_flag;
+
 	/** Is this project using EasyRPG files, or the RPG_RT format? */
 	extern bool is_easyrpg_project;
 
@@ -376,6 +382,12 @@ namespace Player {
 	/** Path to record input log to */
 	extern std::string record_input_path;
 
+	/** Output file of the --benchmark-replay report */
+	extern std::string benchmark_report_path;
+
+	/** Output file of the built-in profiler trace (--profile) */
+	extern std::string profile_output_path;
+
 	/** The concatenated command line */
 	extern std::string command_line;
 
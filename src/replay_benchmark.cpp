@@ -0,0 +1,165 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headers
+#include "replay_benchmark.h"
+#include "filefinder.h"
+#include "game_switches.h"
+#include "game_variables.h"
+#include "main_data.h"
+#include "output.h"
+#include "version.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <fmt/format.h>
+#include <zlib.h>
+
+namespace {
+	bool active = false;
+	std::string log_file;
+	std::string report_file;
+	std::vector<ReplayBenchmark::FrameTiming> frames;
+	Game_Clock::time_point start_time;
+
+	double ToMs(Game_Clock::duration d) {
+		return std::chrono::duration<double, std::milli>(d).count();
+	}
+
+	void FormatSummary(std::ostream& os, const char* name, const ReplayBenchmark::Summary& s) {
+		os << fmt::format("{:<8} mean={:.3f} p50={:.3f} p95={:.3f} p99={:.3f} max={:.3f}\n",
+			name, s.mean, s.p50, s.p95, s.p99, s.max);
+	}
+}
+
+void ReplayBenchmark::Init(std::string log_path, std::string report_path) {
+	active = true;
+	log_file = std::move(log_path);
+	report_file = std::move(report_path);
+	frames.clear();
+	// One entry per frame, 1 hour of gameplay
+	frames.reserve(Game_Clock::GetTargetGameFps() * 60 * 60);
+	start_time = Game_Clock::now();
+}
+
+bool ReplayBenchmark::IsActive() {
+	return active;
+}
+
+void ReplayBenchmark::AddFrame(FrameTiming timing) {
+	frames.push_back(timing);
+}
+
+ReplayBenchmark::Summary ReplayBenchmark::Summarize(std::vector<Game_Clock::duration>& values) {
+	Summary s;
+	if (values.empty()) {
+		return s;
+	}
+
+	std::sort(values.begin(), values.end());
+
+	auto percentile = [&](int p) {
+		// Nearest-rank method
+		size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+		return ToMs(values[std::max<size_t>(rank, 1) - 1]);
+	};
+
+	auto total = std::accumulate(values.begin(), values.end(), Game_Clock::duration());
+	s.mean = ToMs(total) / values.size();
+	s.p50 = percentile(50);
+	s.p95 = percentile(95);
+	s.p99 = percentile(99);
+	s.max = ToMs(values.back());
+	return s;
+}
+
+uint32_t ReplayBenchmark::SwitchesChecksum() {
+	uLong crc = crc32(0L, Z_NULL, 0);
+	if (!Main_Data::game_switches) {
+		return crc;
+	}
+
+	// std::vector<bool> has no data(), pack one switch per byte
+	const auto& data = Main_Data::game_switches->GetData();
+	std::vector<uint8_t> bytes(data.begin(), data.end());
+	return crc32(crc, bytes.data(), bytes.size());
+}
+
+uint32_t ReplayBenchmark::VariablesChecksum() {
+	uLong crc = crc32(0L, Z_NULL, 0);
+	if (!Main_Data::game_variables) {
+		return crc;
+	}
+
+	const auto& data = Main_Data::game_variables->GetData();
+	return crc32(crc, reinterpret_cast<const Bytef*>(data.data()), data.size() * sizeof(Game_Variables::Var_t));
+}
+
+void ReplayBenchmark::WriteReport() {
+	if (!active) {
+		return;
+	}
+	active = false;
+
+	const auto wall_time = Game_Clock::now() - start_time;
+
+	std::vector<Game_Clock::duration> logic;
+	std::vector<Game_Clock::duration> render;
+	std::vector<Game_Clock::duration> total;
+	logic.reserve(frames.size());
+	render.reserve(frames.size());
+	total.reserve(frames.size());
+	for (const auto& f: frames) {
+		logic.push_back(f.logic);
+		render.push_back(f.render);
+		total.push_back(f.logic + f.render);
+	}
+
+	std::stringstream ss;
+	ss << "EasyRPG Player replay benchmark (" << Version::STRING << ")\n";
+	ss << "log:       " << log_file << "\n";
+	ss << "frames:    " << frames.size() << "\n";
+	ss << fmt::format("wall time: {:.3f} ms ({:.1f} fps)\n", ToMs(wall_time),
+		frames.empty() ? 0.0 : frames.size() / std::chrono::duration<double>(wall_time).count());
+	ss << "timings in ms:\n";
+	FormatSummary(ss, "logic", Summarize(logic));
+	FormatSummary(ss, "render", Summarize(render));
+	FormatSummary(ss, "total", Summarize(total));
+	ss << fmt::format("switches:  {} crc32={:08x}\n",
+		Main_Data::game_switches ? Main_Data::game_switches->GetSize() : 0, SwitchesChecksum());
+	ss << fmt::format("variables: {} crc32={:08x}\n",
+		Main_Data::game_variables ? Main_Data::game_variables->GetSize() : 0, VariablesChecksum());
+
+	frames = {};
+
+	if (report_file.empty()) {
+		std::cout << ss.str() << std::flush;
+		return;
+	}
+
+	auto os = FileFinder::Root().OpenOutputStream(report_file, std::ios_base::out | std::ios_base::trunc);
+	if (!os) {
+		Output::Warning("Benchmark: Cannot write report to {}", report_file);
+		std::cout << ss.str() << std::flush;
+		return;
+	}
+	os << ss.str();
+	Output::Debug("Benchmark: Report written to {}", report_file);
+}
@@ -0,0 +1,88 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_REPLAY_BENCHMARK_H
+#define EP_REPLAY_BENCHMARK_H
+
+// Headers
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "game_clock.h"
+
+/**
+ * Collects per-frame timings while replaying an input log with
+ * --benchmark-replay and writes a report when the Player exits.
+ */
+namespace ReplayBenchmark {
+	/** Timing of one physical frame */
+	struct FrameTiming {
+		/** Time spent in Scene::MainFunction */
+		Game_Clock::duration logic;
+		/** Time spent in Player::Draw */
+		Game_Clock::duration render;
+	};
+
+	/** Summary of a timing series in milliseconds */
+	struct Summary {
+		double mean = 0.0;
+		double p50 = 0.0;
+		double p95 = 0.0;
+		double p99 = 0.0;
+		double max = 0.0;
+	};
+
+	/**
+	 * Enables the benchmark.
+	 *
+	 * @param log_path input log that is replayed
+	 * @param report_path file to write the report to. When empty it is written to stdout.
+	 */
+	void Init(std::string log_path, std::string report_path);
+
+	/** @return Whether the benchmark is enabled */
+	bool IsActive();
+
+	/**
+	 * Adds the timing of a physical frame.
+	 *
+	 * @param timing frame timing
+	 */
+	void AddFrame(FrameTiming timing);
+
+	/**
+	 * Writes the report. Must be called before the game objects are reset
+	 * because the report contains a checksum of all switches and variables.
+	 */
+	void WriteReport();
+
+	/**
+	 * Calculates mean, percentiles (nearest-rank) and maximum of a series.
+	 *
+	 * @param values timings, reordered by this function
+	 * @return summary in milliseconds
+	 */
+	Summary Summarize(std::vector<Game_Clock::duration>& values);
+
+	/** @return CRC32 of the current switches */
+	uint32_t SwitchesChecksum();
+
+	/** @return CRC32 of the current variables */
+	uint32_t VariablesChecksum();
+}
+
+#endif
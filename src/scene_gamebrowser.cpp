@@ -24,6 +24,7 @@
 #include "audio_midi.h"
 #include "audio_secache.h"
 #include "cache.h"
+#include "map_cache.h"
 #include "game_system.h"
 #include "input.h"
 #include "player.h"
@@ -51,6 +52,9 @@ void Scene_GameBrowser::Continue(SceneType /* prev_scene */) {
 
 	Cache::ClearAll();
 	AudioSeCache::Clear();
+	MapCache::Clear();
+	// The stopped BGM decoder must be gone before the synthesizers are reset
+	Audio().Flush();
 	MidiDecoder::Reset();
 	lcf::Data::Clear();
 	Main_Data::Cleanup();
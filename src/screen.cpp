@@ -30,6 +30,10 @@ Screen::Screen() : Drawable(Priority_Screen)
 }
 
 void Screen::Draw(Bitmap& dst) {
+	if (tone != Tone()) {
+		dst.ToneRect(viewport != Rect() ? viewport : dst.GetRect(), tone);
+	}
+
 	auto flash_color = Main_Data::game_screen->GetFlashColor();
 	if (flash_color.alpha > 0) {
 		if (!flash) {
@@ -23,6 +23,7 @@
 #include "bitmap.h"
 #include "drawable.h"
 #include "system.h"
+#include "tone.h"
 
 /**
  * A special drawable for handling screen effects.
@@ -41,10 +42,18 @@ public:
 	Rect GetViewport() const;
 	void SetViewport(const Rect& rect);
 
+	/**
+	 * Tone applied to everything drawn below the screen before the flash.
+	 * Used when sprites are not tinted individually.
+	 */
+	Tone GetTone() const;
+	void SetTone(const Tone& tone);
+
 private:
 	BitmapRef flash;
 
 	Rect viewport;
+	Tone tone;
 };
 
 inline Rect Screen::GetViewport() const {
@@ -55,4 +64,12 @@ inline void Screen::SetViewport(const Rect &rect) {
 	viewport = rect;
 }
 
+inline Tone Screen::GetTone() const {
+	return tone;
+}
+
+inline void Screen::SetTone(const Tone& tone) {
+	this->tone = tone;
+}
+
 #endif
@@ -22,7 +22,9 @@
 #include "util_macro.h"
 #include "bitmap.h"
 #include "cache.h"
+#include "damage_tracker.h"
 #include "drawable_mgr.h"
+#include <cmath>
 
 // Constructor
 Sprite::Sprite(Drawable::Flags flags) : Drawable(0, flags)
@@ -37,6 +39,75 @@ void Sprite::Draw(Bitmap& dst) {
 	BlitScreen(dst);
 }
 
+bool Sprite::GetDamageState(DamageState& state) const {
+	if (state_set_in_draw) {
+		return false;
+	}
+
+	if (angle_effect != 0.0 || waver_effect_depth != 0) {
+		// Bounds of rotated and wavy sprites are not worth computing
+		state.bounds = Rect(0, 0, Player::screen_width, Player::screen_height);
+	} else {
+		state.bounds = GetZoomedBounds(x, y, ox - GetRenderOx(), oy - GetRenderOy(),
+			src_rect.width, src_rect.height, zoom_x_effect, zoom_y_effect);
+	}
+
+	state.Hash(bitmap.get(), bitmap ? bitmap->GetGeneration() : 0u, GetWidth(), GetHeight(),
+		src_rect.x, src_rect.y, src_rect.width, src_rect.height,
+		src_rect_effect.x, src_rect_effect.y, src_rect_effect.width, src_rect_effect.height,
+		x, y, ox, oy, GetRenderOx(), GetRenderOy(),
+		opacity_top_effect, opacity_bottom_effect, bush_effect,
+		tone_effect.red, tone_effect.green, tone_effect.blue, tone_effect.gray,
+		zoom_x_effect, zoom_y_effect, angle_effect, blend_type_effect,
+		blend_color_effect.red, blend_color_effect.green, blend_color_effect.blue, blend_color_effect.alpha,
+		waver_effect_depth, waver_effect_phase,
+		flash_effect.red, flash_effect.green, flash_effect.blue, flash_effect.alpha,
+		flipx_effect, flipy_effect);
+	return true;
+}
+
+bool Sprite::GetDrawBounds(Rect& bounds, bool& opaque) const {
+	opaque = false;
+
+	if (GetWidth() <= 0 || GetHeight() <= 0 || !bitmap || (opacity_top_effect <= 0 && opacity_bottom_effect <= 0)) {
+		bounds = Rect();
+		return true;
+	}
+
+	if (angle_effect != 0.0 || waver_effect_depth != 0) {
+		return false;
+	}
+
+	if (zoom_x_effect != 1.0 || zoom_y_effect != 1.0) {
+		bounds = GetZoomedBounds(x, y, ox - GetRenderOx(), oy - GetRenderOy(),
+			src_rect.width, src_rect.height, zoom_x_effect, zoom_y_effect);
+		return true;
+	}
+
+	bounds = Rect(x - ox + GetRenderOx(), y - oy + GetRenderOy(), src_rect.width, src_rect.height);
+
+	// Only plain blits of a fully opaque source rectangle hide what is below
+	const auto blend = static_cast<Bitmap::BlendMode>(blend_type_effect);
+	const auto bitmap_rect = bitmap->GetRect();
+	opaque = bitmap->GetImageOpacity() == ImageOpacity::Opaque
+		&& Opacity(opacity_top_effect, opacity_bottom_effect, bush_effect).IsOpaque()
+		&& (blend == Bitmap::BlendMode::Default || blend == Bitmap::BlendMode::Normal || blend == Bitmap::BlendMode::NormalWithoutAlpha)
+		&& src_rect_effect == bitmap_rect
+		&& src_rect.x >= 0 && src_rect.y >= 0
+		&& src_rect.x + src_rect.width <= bitmap_rect.width
+		&& src_rect.y + src_rect.height <= bitmap_rect.height;
+	return true;
+}
+
+Rect Sprite::GetZoomedBounds(int x, int y, int ox, int oy, int width, int height, double zoom_x, double zoom_y) {
+	// One pixel of slack for rounding inside the zoom blit
+	int left = static_cast<int>(std::floor(x - ox * zoom_x)) - 1;
+	int top = static_cast<int>(std::floor(y - oy * zoom_y)) - 1;
+	int w = static_cast<int>(std::ceil(width * zoom_x)) + 2;
+	int h = static_cast<int>(std::ceil(height * zoom_y)) + 2;
+	return Rect(left, top, w, h);
+}
+
 void Sprite::BlitScreen(Bitmap& dst) {
 	if (!bitmap || (opacity_top_effect <= 0 && opacity_bottom_effect <= 0))
 		return;
@@ -34,6 +34,9 @@ public:
 
 	void Draw(Bitmap& dst) override;
 
+	bool GetDamageState(DamageState& state) const override;
+	bool GetDrawBounds(Rect& bounds, bool& opaque) const override;
+
 	virtual int GetWidth() const;
 	virtual int GetHeight() const;
 
@@ -103,6 +106,28 @@ public:
 	 */
 	void SetFlashEffect(const Color &color);
 
+protected:
+	/**
+	 * Conservative screen rectangle of a sprite drawn with zoom.
+	 *
+	 * @param x x position
+	 * @param y y position
+	 * @param ox x origin, including the render offset
+	 * @param oy y origin, including the render offset
+	 * @param width source width
+	 * @param height source height
+	 * @param zoom_x x zoom
+	 * @param zoom_y y zoom
+	 * @return screen rectangle
+	 */
+	static Rect GetZoomedBounds(int x, int y, int ox, int oy, int width, int height, double zoom_x, double zoom_y);
+
+	/**
+	 * Set by sprites whose Draw() sets up the sprite state. Their state is
+	 * unknown beforehand, so GetDamageState always requests a redraw.
+	 */
+	bool state_set_in_draw = false;
+
 private:
 	BitmapRef bitmap;
 
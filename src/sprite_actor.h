@@ -90,6 +90,7 @@ public:
 	int GetHeight() const override;
 
 	void Draw(Bitmap& dst) override;
+	bool GetDrawBounds(Rect& bounds, bool& opaque) const override;
 
 	Game_Actor* GetBattler() const;
 
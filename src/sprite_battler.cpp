@@ -27,6 +27,7 @@
 
 Sprite_Battler::Sprite_Battler(Game_Battler* battler, int index) :
 	battler(battler), battle_index(index) {
+	state_set_in_draw = true;
 }
 
 Sprite_Battler::~Sprite_Battler() {
@@ -87,6 +87,10 @@ void Sprite_Enemy::OnMonsterSpriteReady(FileRequestResult* result) {
 	ResetZ();
 }
 
+bool Sprite_Enemy::GetDrawBounds(Rect&, bool&) const {
+	return false;
+}
+
 void Sprite_Enemy::Draw(Bitmap& dst) {
 
 	auto alpha = 255;
@@ -41,6 +41,7 @@ public:
 	~Sprite_Enemy() override;
 
 	void Draw(Bitmap& dst) override;
+	bool GetDrawBounds(Rect& bounds, bool& opaque) const override;
 
 	Game_Enemy* GetBattler() const;
 
@@ -36,6 +36,7 @@ Sprite_Picture::Sprite_Picture(int pic_id, Drawable::Flags flags)
 	// priority layers feature is enabled.
 	// Battle Animations are below pictures
 	SetZ(Priority_PictureOld + pic_id);
+	state_set_in_draw = true;
 }
 
 void Sprite_Picture::OnPictureShow() {
@@ -61,6 +62,62 @@ void Sprite_Picture::OnPictureShow() {
 }
 
 
+bool Sprite_Picture::GetDrawBounds(Rect& bounds, bool& opaque) const {
+	// Same as the sprite state Draw() sets up, computed from the picture data
+	const auto& pic = Main_Data::game_pictures->GetPicture(pic_id);
+	const auto& data = pic.data;
+
+	opaque = false;
+
+	auto& bitmap = GetBitmap();
+	const bool is_battle = Game_Battle::IsBattleRunning();
+
+	if (!bitmap || (is_battle ? !pic.IsOnBattle() : !pic.IsOnMap())) {
+		bounds = Rect();
+		return true;
+	}
+
+	const bool wave = data.effect_mode == lcf::rpg::SavePicture::Effect_wave;
+	if (wave ? data.current_effect_power != 0 : data.current_rotation != 0) {
+		return false;
+	}
+
+	const auto pos = GetScreenPosition();
+	const int width = GetFrameWidth();
+	const int height = GetFrameHeight();
+	const double zoom = data.current_magnify / 100.0;
+	bounds = GetZoomedBounds(pos.x, pos.y, width / 2 - GetRenderOx(), height / 2 - GetRenderOy(), width, height, zoom, zoom);
+
+	const auto bottom_trans = feature_bottom_trans ? data.current_bot_trans : data.current_top_trans;
+	const auto blend = static_cast<Bitmap::BlendMode>(data.easyrpg_blend_mode);
+	if (zoom == 1.0 && data.current_top_trans == 0 && bottom_trans == 0
+			&& bitmap->GetImageOpacity() == ImageOpacity::Opaque
+			&& (blend == Bitmap::BlendMode::Default || blend == Bitmap::BlendMode::Normal || blend == Bitmap::BlendMode::NormalWithoutAlpha)) {
+		bounds = Rect(pos.x - width / 2 + GetRenderOx(), pos.y - height / 2 + GetRenderOy(), width, height);
+		opaque = true;
+	}
+
+	return true;
+}
+
+Point Sprite_Picture::GetScreenPosition() const {
+	const auto& data = Main_Data::game_pictures->GetPicture(pic_id).data;
+
+	int x = data.current_x;
+	int y = data.current_y;
+	if (data.flags.affected_by_shake) {
+		x -= Main_Data::game_screen->GetShakeOffsetX();
+		y -= Main_Data::game_screen->GetShakeOffsetY();
+	}
+
+	if (Player::game_config.fake_resolution.Get()) {
+		x += Player::menu_offset_x;
+		y += Player::menu_offset_y;
+	}
+
+	return Point(x, y);
+}
+
 void Sprite_Picture::Draw(Bitmap& dst) {
 	const auto& pic = Main_Data::game_pictures->GetPicture(pic_id);
 	const auto& data = pic.data;
@@ -98,20 +155,9 @@ void Sprite_Picture::Draw(Bitmap& dst) {
 		SetSrcRect(Rect{ sx, sy, sw, sh });
 	}
 
-	int x = data.current_x;
-	int y = data.current_y;
-	if (data.flags.affected_by_shake) {
-		x -= Main_Data::game_screen->GetShakeOffsetX();
-		y -= Main_Data::game_screen->GetShakeOffsetY();
-	}
-
-	if (Player::game_config.fake_resolution.Get()) {
-		SetX(x + Player::menu_offset_x);
-		SetY(y + Player::menu_offset_y);
-	} else {
-		SetX(x);
-		SetY(y);
-	}
+	auto pos = GetScreenPosition();
+	SetX(pos.x);
+	SetY(pos.y);
 	SetZoomX(data.current_magnify / 100.0);
 	SetZoomY(data.current_magnify / 100.0);
 
@@ -148,7 +194,8 @@ void Sprite_Picture::Draw(Bitmap& dst) {
 			(int) (data.current_blue * 128 / 100),
 			(int) (data.current_sat * 128 / 100));
 	if (data.flags.affected_by_tint) {
-		auto screen_tone = Main_Data::game_screen->GetTone();
+		// Pictures below the screen layer are already toned by the tone pass
+		auto screen_tone = GetZ() < Priority_Screen ? Main_Data::game_screen->GetSpriteTone() : Main_Data::game_screen->GetTone();
 		tone = Blend(tone, screen_tone);
 	}
 	SetTone(tone);
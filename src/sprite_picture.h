@@ -18,6 +18,7 @@
 #ifndef EP_PICTURE_SPRITE_H
 #define EP_PICTURE_SPRITE_H
 
+#include "point.h"
 #include "sprite.h"
 
 class Bitmap;
@@ -35,6 +36,7 @@ public:
 	Sprite_Picture(int pic_id, Drawable::Flags flags = Drawable::Flags::Default);
 
 	void Draw(Bitmap& dst) override;
+	bool GetDrawBounds(Rect& bounds, bool& opaque) const override;
 
 	void OnPictureShow();
 
@@ -45,6 +47,9 @@ public:
 	int GetFrameHeight() const;
 
 private:
+	/** @return screen position of the center of the picture */
+	Point GetScreenPosition() const;
+
 	int last_spritesheet_frame = -1;
 	const int pic_id = 0;
 	const bool feature_spritesheet = false;
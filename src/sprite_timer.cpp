@@ -55,11 +55,16 @@ Sprite_Timer::Sprite_Timer(int which) :
 
 	SetZ(Priority_Timer);
 	SetVisible(true);
+	state_set_in_draw = true;
 }
 
 Sprite_Timer::~Sprite_Timer() {
 }
 
+bool Sprite_Timer::GetDrawBounds(Rect&, bool&) const {
+	return false;
+}
+
 void Sprite_Timer::Draw(Bitmap& dst) {
 	if (!Main_Data::game_party->GetTimerVisible(which, Game_Battle::IsBattleRunning())) {
 		return;
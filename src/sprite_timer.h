@@ -37,6 +37,7 @@ public:
 
 protected:
 	void Draw(Bitmap& dst) override;
+	bool GetDrawBounds(Rect& bounds, bool& opaque) const override;
 
 	int which = 0;
 
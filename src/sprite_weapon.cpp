@@ -30,6 +30,7 @@
 Sprite_Weapon::Sprite_Weapon(Game_Actor* actor) : Sprite() {
 	battler = actor;
 	CreateSprite();
+	state_set_in_draw = true;
 }
 
 Sprite_Weapon::~Sprite_Weapon() {
@@ -128,6 +129,10 @@ void Sprite_Weapon::OnBattleWeaponReady(FileRequestResult* result, int32_t weapo
 	SetSrcRect(Rect(0, weapon_index * 64, 64, 64));
 }
 
+bool Sprite_Weapon::GetDrawBounds(Rect&, bool&) const {
+	return false;
+}
+
 void Sprite_Weapon::Draw(Bitmap& dst) {
 	if (!attacking) {
 		return;
@@ -53,6 +53,7 @@ public:
 	void StopAttack();
 
 	void Draw(Bitmap& dst) override;
+	bool GetDrawBounds(Rect& bounds, bool& opaque) const override;
 
 protected:
 	void CreateSprite();
@@ -60,6 +60,9 @@ Spriteset_Battle::Spriteset_Battle(const std::string bg_name, int terrain_id)
 }
 
 void Spriteset_Battle::Update() {
+	// Battle animations share the layer of the battlers and must not be toned
+	Main_Data::game_screen->SetTonePass(false);
+
 	Tone new_tone = Main_Data::game_screen->GetTone();
 
 	// Handle background change
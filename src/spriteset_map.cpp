@@ -27,6 +27,8 @@
 #include "game_player.h"
 #include "game_vehicle.h"
 #include "game_screen.h"
+#include "game_pictures.h"
+#include "baseui.h"
 #include "bitmap.h"
 #include "player.h"
 #include "drawable_list.h"
@@ -83,7 +85,10 @@ void Spriteset_Map::Refresh() {
 
 // Update
 void Spriteset_Map::Update() {
-	Tone new_tone = Main_Data::game_screen->GetTone();
+	// The tone pass would also tint pictures that ignore the screen tint
+	Main_Data::game_screen->SetTonePass(DisplayUi && DisplayUi->IsScreenTonePass() &&
+		!Main_Data::game_pictures->HasUntintedPictureBelowScreen());
+	Tone new_tone = Main_Data::game_screen->GetSpriteTone();
 
 	tilemap->SetOx(Game_Map::GetDisplayX() / (SCREEN_TILE_SIZE / TILE_SIZE));
 	tilemap->SetOy(Game_Map::GetDisplayY() / (SCREEN_TILE_SIZE / TILE_SIZE));
@@ -114,6 +119,8 @@ void Spriteset_Map::Update() {
 		shadow->Update();
 	}
 
+	screen->SetTone(Main_Data::game_screen->IsTonePass() ? Main_Data::game_screen->GetTone() : Tone());
+
 	DynRpg::Update();
 }
 
@@ -0,0 +1,95 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_SPSC_QUEUE_H
+#define EP_SPSC_QUEUE_H
+
+// Headers
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/**
+ * A bounded lock-free queue for exactly one producer and one consumer
+ * thread. Push must only be called by the producer and Pop only by the
+ * consumer. Neither operation ever blocks.
+ *
+ * @tparam T element type, must be default constructible and movable
+ * @tparam N capacity, must be a power of two
+ */
+template <typename T, size_t N>
+class SpscQueue {
+	static_assert(N > 0 && (N & (N - 1)) == 0, "Capacity must be a power of two");
+	public:
+		/**
+		 * Appends an element (producer only).
+		 *
+		 * @param value element to move into the queue
+		 * @return false when the queue is full, value is unchanged then
+		 */
+		bool Push(T&& value);
+
+		/**
+		 * Removes the oldest element (consumer only).
+		 *
+		 * @param value filled with the element
+		 * @return false when the queue is empty
+		 */
+		bool Pop(T& value);
+
+		/** @return whether the queue is empty, only exact for the consumer */
+		bool Empty() const;
+
+		/** @return maximum number of elements */
+		static constexpr size_t Capacity() { return N; }
+
+	private:
+		std::array<T, N> slots = {};
+		// Separate cache lines, the indices are written by different threads
+		alignas(64) std::atomic<size_t> head = { 0 };
+		alignas(64) std::atomic<size_t> tail = { 0 };
+};
+
+template <typename T, size_t N>
+inline bool SpscQueue<T, N>::Push(T&& value) {
+	const size_t t = tail.load(std::memory_order_relaxed);
+	if (t - head.load(std::memory_order_acquire) == N) {
+		return false;
+	}
+	slots[t % N] = std::move(value);
+	tail.store(t + 1, std::memory_order_release);
+	return true;
+}
+
+template <typename T, size_t N>
+inline bool SpscQueue<T, N>::Pop(T& value) {
+	const size_t h = head.load(std::memory_order_relaxed);
+	if (h == tail.load(std::memory_order_acquire)) {
+		return false;
+	}
+	value = std::move(slots[h % N]);
+	head.store(h + 1, std::memory_order_release);
+	return true;
+}
+
+template <typename T, size_t N>
+inline bool SpscQueue<T, N>::Empty() const {
+	return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+}
+
+#endif
@@ -48,6 +48,7 @@
 #elif defined(OPENDINGUX)
 #  include <sys/types.h>
 #elif defined(__ANDROID__)
+#  define USE_MMAP
 #  define SUPPORT_ZOOM
 #  define SUPPORT_JOYSTICK
 #  define SUPPORT_JOYSTICK_AXIS
@@ -88,6 +89,7 @@
 #else // Everything not catched above, e.g. Linux/*BSD/macOS
 #  define USE_WINE_REGISTRY
 #  define USE_XDG_RTP
+#  define USE_MMAP
 #  define SUPPORT_ZOOM
 #  define SUPPORT_MOUSE
 #  define SUPPORT_TOUCH
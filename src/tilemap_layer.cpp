@@ -18,6 +18,7 @@
 // Headers
 #include <cstring>
 #include <cmath>
+#include <algorithm>
 #include "tilemap_layer.h"
 #include "output.h"
 #include "player.h"
@@ -29,6 +30,7 @@
 #include "game_system.h"
 #include "drawable_mgr.h"
 #include "baseui.h"
+#include "instrumentation.h"
 
 // Blocks subtiles IDs
 // Mess with this code and you will die in 3 days...
@@ -185,6 +187,16 @@ void TilemapLayer::DrawTileImpl(Bitmap& dst, Bitmap& tileset, Bitmap& tone_tiles
 	}
 }
 
+static int DivRoundingDown(int n, int m) {
+	if (n >= 0) return n / m;
+	return (n - m + 1) / m;
+}
+
+static int Mod(int n, int m) {
+	int rem = n % m;
+	return rem >= 0 ? rem : m + rem;
+}
+
 static uint32_t MakeFTileHash(int id) {
 	return static_cast<uint32_t>(id);
 }
@@ -205,7 +217,96 @@ static uint32_t MakeAbTileHash(int id, int anim_step) {
 	return static_cast<uint32_t>((id + (anim_step << 12)) | (4 << 24));
 }
 
+void TilemapLayer::DrawTileData(Bitmap& dst, const TileData& tile, int x, int y, int animation_step_c, int animation_step_ab) {
+	if (layer == 0) {
+		// If lower layer
+		bool allow_fast_blit = (tile.z == TileBelow);
+
+		if (tile.ID >= BLOCK_E && tile.ID < BLOCK_E + BLOCK_E_TILES) {
+			int id = substitutions[tile.ID - BLOCK_E];
+			// If Block E
+
+			int row, col;
+
+			// Get the tile coordinates from chipset
+			if (id < 96) {
+				// If from first column of the block
+				col = 12 + id % 6;
+				row = id / 6;
+			} else {
+				// If from second column of the block
+				col = 18 + (id - 96) % 6;
+				row = (id - 96) / 6;
+			}
+
+			auto tone_hash = MakeETileHash(id);
+			DrawTile(dst, *chipset, *chipset_effect, x, y, row, col, tone_hash, allow_fast_blit);
+		} else if (tile.ID >= BLOCK_C && tile.ID < BLOCK_D) {
+			// If Block C
+
+			// Get the tile coordinates from chipset
+			int col = 3 + (tile.ID - BLOCK_C) / 50;
+			int row = 4 + animation_step_c;
+
+			auto tone_hash = MakeCTileHash(tile.ID, animation_step_c);
+			DrawTile(dst, *chipset, *chipset_effect, x, y, row, col, tone_hash, allow_fast_blit);
+		} else if (tile.ID < BLOCK_C) {
+			// If Blocks A1, A2, B
+
+			// Draw the tile from autotile cache
+			TileXY pos = GetCachedAutotileAB(tile.ID, animation_step_ab);
+
+			int col = pos.x;
+			int row = pos.y;
+
+			// Create tone changed tile
+			auto tone_hash = MakeAbTileHash(tile.ID,  animation_step_ab);
+			DrawTile(dst, *autotiles_ab_screen, *autotiles_ab_screen_effect, x, y, row, col, tone_hash, allow_fast_blit);
+		} else {
+			// If blocks D1-D12
+
+			// Draw the tile from autotile cache
+			TileXY pos = GetCachedAutotileD(tile.ID);
+
+			int col = pos.x;
+			int row = pos.y;
+
+			auto tone_hash = MakeDTileHash(tile.ID);
+			DrawTile(dst, *autotiles_d_screen, *autotiles_d_screen_effect, x, y, row, col, tone_hash, allow_fast_blit);
+		}
+	} else {
+		// If upper layer
+
+		// Check that block F is being drawn
+		if (tile.ID >= BLOCK_F && tile.ID < BLOCK_F + BLOCK_F_TILES) {
+			int id = substitutions[tile.ID - BLOCK_F];
+			int row, col;
+
+			// Get the tile coordinates from chipset
+			if (id < 48) {
+				// If from first column of the block
+				col = 18 + id % 6;
+				row = 8 + id / 6;
+			} else {
+				// If from second column of the block
+				col = 24 + (id - 48) % 6;
+				row = (id - 48) / 6;
+			}
+
+			auto tone_hash = MakeFTileHash(id);
+			DrawTile(dst, *chipset, *chipset_effect, x, y, row, col, tone_hash);
+		}
+	}
+}
+
+bool TilemapLayer::IsAnimatedTile(const TileData& tile) const {
+	// Blocks A, B and C are animated, everything else is static
+	return layer == 0 && tile.ID < BLOCK_D;
+}
+
 void TilemapLayer::Draw(Bitmap& dst, uint8_t z_order, int render_ox, int render_oy) {
+	EP_PROFILE_ZONE("TilemapLayer::Draw");
+
 	// Get the number of tiles that can be displayed on window
 	int tiles_x = (int)ceil(Player::screen_width / (float)TILE_SIZE);
 	int tiles_y = (int)ceil(Player::screen_height / (float)TILE_SIZE);
@@ -222,15 +323,6 @@ void TilemapLayer::Draw(Bitmap& dst, uint8_t z_order, int render_ox, int render_
 	const bool loop_h = Game_Map::LoopHorizontal();
 	const bool loop_v = Game_Map::LoopVertical();
 
-	auto div_rounding_down = [](int n, int m) {
-		if (n >= 0) return n / m;
-		return (n - m + 1) / m;
-	};
-	auto mod = [](int n, int m) {
-		int rem = n % m;
-		return rem >= 0 ? rem : m + rem;
-	};
-
 	// FIXME: When Game_Map singleton is made an object we can remove this null check
 	const auto frames = Main_Data::game_system ? Main_Data::game_system->GetFrameCounter() : 0;
 	auto animation_step_c = (frames / 6) % 4;
@@ -244,20 +336,27 @@ void TilemapLayer::Draw(Bitmap& dst, uint8_t z_order, int render_ox, int render_
 		}
 	}
 
-	const int div_ox = div_rounding_down(ox - render_ox, TILE_SIZE);
-	const int div_oy = div_rounding_down(oy - render_oy, TILE_SIZE);
+	const int div_ox = DivRoundingDown(ox - render_ox, TILE_SIZE);
+	const int div_oy = DivRoundingDown(oy - render_oy, TILE_SIZE);
 
-	const int mod_ox = mod(ox - render_ox, TILE_SIZE);
-	const int mod_oy = mod(oy - render_oy, TILE_SIZE);
+	const int mod_ox = Mod(ox - render_ox, TILE_SIZE);
+	const int mod_oy = Mod(oy - render_oy, TILE_SIZE);
 
+	if (frames != tone_change_frame) {
+		DrawChunks(dst, z_order, div_ox, div_oy, mod_ox, mod_oy, tiles_x, tiles_y, animation_step_c, animation_step_ab);
+		return;
+	}
+
+	// The tone is fading, rebuilding the chunks every frame would be slower
+	// than drawing the tiles directly
 	for (int y = 0; y < tiles_y; y++) {
 		for (int x = 0; x < tiles_x; x++) {
 
 			// Get the real maps tile coordinates
 			int map_x = div_ox + x;
 			int map_y = div_oy + y;
-			if (loop_h) map_x = mod(map_x, width);
-			if (loop_v) map_y = mod(map_y, height);
+			if (loop_h) map_x = Mod(map_x, width);
+			if (loop_v) map_y = Mod(map_y, height);
 
 			int map_draw_x = x * TILE_SIZE - mod_ox;
 			int map_draw_y = y * TILE_SIZE - mod_oy;
@@ -275,90 +374,149 @@ void TilemapLayer::Draw(Bitmap& dst, uint8_t z_order, int render_ox, int render_
 
 			// Draw the sublayer if its z is being draw now
 			if (z_order == tile.z) {
-				if (layer == 0) {
-					// If lower layer
-					bool allow_fast_blit = (tile.z == TileBelow);
-
-					if (tile.ID >= BLOCK_E && tile.ID < BLOCK_E + BLOCK_E_TILES) {
-						int id = substitutions[tile.ID - BLOCK_E];
-						// If Block E
-
-						int row, col;
-
-						// Get the tile coordinates from chipset
-						if (id < 96) {
-							// If from first column of the block
-							col = 12 + id % 6;
-							row = id / 6;
-						} else {
-							// If from second column of the block
-							col = 18 + (id - 96) % 6;
-							row = (id - 96) / 6;
-						}
-
-						auto tone_hash = MakeETileHash(id);
-						DrawTile(dst, *chipset, *chipset_effect, map_draw_x, map_draw_y, row, col, tone_hash, allow_fast_blit);
-					} else if (tile.ID >= BLOCK_C && tile.ID < BLOCK_D) {
-						// If Block C
-
-						// Get the tile coordinates from chipset
-						int col = 3 + (tile.ID - BLOCK_C) / 50;
-						int row = 4 + animation_step_c;
-
-						auto tone_hash = MakeCTileHash(tile.ID, animation_step_c);
-						DrawTile(dst, *chipset, *chipset_effect, map_draw_x, map_draw_y, row, col, tone_hash, allow_fast_blit);
-					} else if (tile.ID < BLOCK_C) {
-						// If Blocks A1, A2, B
-
-						// Draw the tile from autotile cache
-						TileXY pos = GetCachedAutotileAB(tile.ID, animation_step_ab);
-
-						int col = pos.x;
-						int row = pos.y;
-
-						// Create tone changed tile
-						auto tone_hash = MakeAbTileHash(tile.ID,  animation_step_ab);
-						DrawTile(dst, *autotiles_ab_screen, *autotiles_ab_screen_effect, map_draw_x, map_draw_y, row, col, tone_hash, allow_fast_blit);
-					} else {
-						// If blocks D1-D12
-
-						// Draw the tile from autotile cache
-						TileXY pos = GetCachedAutotileD(tile.ID);
-
-						int col = pos.x;
-						int row = pos.y;
-
-						auto tone_hash = MakeDTileHash(tile.ID);
-						DrawTile(dst, *autotiles_d_screen, *autotiles_d_screen_effect, map_draw_x, map_draw_y, row, col, tone_hash, allow_fast_blit);
-					}
+				DrawTileData(dst, tile, map_draw_x, map_draw_y, animation_step_c, animation_step_ab);
+			}
+		}
+	}
+}
+
+void TilemapLayer::DrawChunks(Bitmap& dst, uint8_t z_order, int div_ox, int div_oy, int mod_ox, int mod_oy, int tiles_x, int tiles_y, int animation_step_c, int animation_step_ab) {
+	const bool loop_h = Game_Map::LoopHorizontal();
+	const bool loop_v = Game_Map::LoopVertical();
+
+	// Same rule as in DrawTileImpl: Only opaque tiles of the lowest sublayer may ignore alpha
+	const bool allow_fast_blit = fast_blit && layer == 0 && z_order == TileBelow;
+
+	++chunk_use_counter;
+
+	// Walk the visible area in spans that do not cross a chunk or map border.
+	// Looping maps wrap around, so a span can start anywhere inside a chunk.
+	for (int y = div_oy; y < div_oy + tiles_y;) {
+		int map_y = loop_v ? Mod(y, height) : y;
+		if (map_y < 0) {
+			y -= map_y;
+			continue;
+		}
+		if (map_y >= height) {
+			break;
+		}
+
+		const int chunk_y = map_y / CHUNK_TILES;
+		const int span_h = std::min(std::min((chunk_y + 1) * CHUNK_TILES, height) - map_y, div_oy + tiles_y - y);
+		const int draw_y = (y - div_oy) * TILE_SIZE - mod_oy;
+
+		for (int x = div_ox; x < div_ox + tiles_x;) {
+			int map_x = loop_h ? Mod(x, width) : x;
+			if (map_x < 0) {
+				x -= map_x;
+				continue;
+			}
+			if (map_x >= width) {
+				break;
+			}
+
+			const int chunk_x = map_x / CHUNK_TILES;
+			const int span_w = std::min(std::min((chunk_x + 1) * CHUNK_TILES, width) - map_x, div_ox + tiles_x - x);
+			const int draw_x = (x - div_ox) * TILE_SIZE - mod_ox;
+
+			TileChunk& chunk = GetChunk(chunk_x, chunk_y, z_order);
+			chunk.last_use = chunk_use_counter;
+
+			if (chunk.bitmap) {
+				const int tile_x = map_x - chunk_x * CHUNK_TILES;
+				const int tile_y = map_y - chunk_y * CHUNK_TILES;
+				Rect rect(tile_x * TILE_SIZE, tile_y * TILE_SIZE, span_w * TILE_SIZE, span_h * TILE_SIZE);
+
+				if (allow_fast_blit && chunk.opacity == ImageOpacity::Opaque) {
+					dst.BlitFast(draw_x, draw_y, *chunk.bitmap, rect, 255);
 				} else {
-					// If upper layer
-
-					// Check that block F is being drawn
-					if (tile.ID >= BLOCK_F && tile.ID < BLOCK_F + BLOCK_F_TILES) {
-						int id = substitutions[tile.ID - BLOCK_F];
-						int row, col;
-
-						// Get the tile coordinates from chipset
-						if (id < 48) {
-							// If from first column of the block
-							col = 18 + id % 6;
-							row = 8 + id / 6;
-						} else {
-							// If from second column of the block
-							col = 24 + (id - 48) % 6;
-							row = (id - 48) / 6;
-						}
-
-						auto tone_hash = MakeFTileHash(id);
-						DrawTile(dst, *chipset, *chipset_effect, map_draw_x, map_draw_y, row, col, tone_hash);
-					}
+					dst.Blit(draw_x, draw_y, *chunk.bitmap, rect, 255);
 				}
 			}
+
+			// Animated cells are left empty in the chunk
+			for (auto index: chunk.animated) {
+				const int cell_x = chunk_x * CHUNK_TILES + index % CHUNK_TILES;
+				const int cell_y = chunk_y * CHUNK_TILES + index / CHUNK_TILES;
+				if (cell_x < map_x || cell_x >= map_x + span_w || cell_y < map_y || cell_y >= map_y + span_h) {
+					continue;
+				}
+
+				DrawTileData(dst, GetDataCache(cell_x, cell_y),
+					draw_x + (cell_x - map_x) * TILE_SIZE, draw_y + (cell_y - map_y) * TILE_SIZE,
+					animation_step_c, animation_step_ab);
+			}
+
+			x += span_w;
 		}
+
+		y += span_h;
+	}
+
+	// Drop the least recently drawn chunks to bound the memory usage
+	while (chunks.size() > MAX_CHUNKS) {
+		auto oldest = chunks.begin();
+		for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+			if (it->second.last_use < oldest->second.last_use) {
+				oldest = it;
+			}
+		}
+		if (oldest->second.last_use == chunk_use_counter) {
+			// Everything is visible right now
+			break;
+		}
+		chunks.erase(oldest);
 	}
 }
 
+TilemapLayer::TileChunk& TilemapLayer::GetChunk(int chunk_x, int chunk_y, uint8_t z_order) {
+	const uint32_t key = (static_cast<uint32_t>(z_order) << 24) | (static_cast<uint32_t>(chunk_y) << 12) | static_cast<uint32_t>(chunk_x);
+
+	auto it = chunks.find(key);
+	if (it != chunks.end()) {
+		return it->second;
+	}
+
+	TileChunk& chunk = chunks[key];
+
+	const int first_x = chunk_x * CHUNK_TILES;
+	const int first_y = chunk_y * CHUNK_TILES;
+	const int chunk_w = std::min(CHUNK_TILES, width - first_x);
+	const int chunk_h = std::min(CHUNK_TILES, height - first_y);
+
+	for (int y = 0; y < chunk_h; ++y) {
+		for (int x = 0; x < chunk_w; ++x) {
+			const TileData& tile = GetDataCache(first_x + x, first_y + y);
+			if (tile.z != z_order) {
+				continue;
+			}
+
+			if (IsAnimatedTile(tile)) {
+				chunk.animated.push_back(static_cast<uint16_t>(x + y * CHUNK_TILES));
+				continue;
+			}
+
+			if (!chunk.bitmap) {
+				chunk.bitmap = Bitmap::Create(chunk_w * TILE_SIZE, chunk_h * TILE_SIZE, true);
+				chunk.bitmap->Clear();
+			}
+
+			// Animation steps are unused for static tiles
+			DrawTileData(*chunk.bitmap, tile, x * TILE_SIZE, y * TILE_SIZE, 0, 0);
+		}
+	}
+
+	if (chunk.bitmap) {
+		chunk.opacity = chunk.bitmap->ComputeImageOpacity();
+	}
+
+	return chunk;
+}
+
+void TilemapLayer::InvalidateChunks() {
+	chunks.clear();
+}
+
 TilemapLayer::TileXY TilemapLayer::GetCachedAutotileAB(short ID, short animID) {
 	short block = ID / 1000;
 	short b_subtile = (ID - block * 1000) / 50;
@@ -609,6 +767,8 @@ BitmapRef TilemapLayer::GenerateAutotiles(int count, const std::unordered_map<ui
 }
 
 void TilemapLayer::SetChipset(BitmapRef const& nchipset) {
+	InvalidateChunks();
+
 	chipset = nchipset;
 	chipset_effect = Bitmap::Create(chipset->width(), chipset->height());
 	chipset_tone_tiles.clear();
@@ -623,6 +783,8 @@ void TilemapLayer::SetChipset(BitmapRef const& nchipset) {
 }
 
 void TilemapLayer::SetMapData(std::vector<short> nmap_data) {
+	InvalidateChunks();
+
 	// Create the tiles data cache
 	CreateTileCache(nmap_data);
 	memset(autotiles_ab, 0, sizeof(autotiles_ab));
@@ -666,6 +828,7 @@ void TilemapLayer::SetPassable(std::vector<unsigned char> npassable) {
 
 	// Recalculate z values of all tiles
 	CreateTileCache(map_data);
+	InvalidateChunks();
 }
 
 void TilemapLayer::OnSubstitute() {
@@ -673,6 +836,7 @@ void TilemapLayer::OnSubstitute() {
 
 	// Recalculate z values of all tiles
 	CreateTileCache(map_data);
+	InvalidateChunks();
 }
 
 TilemapSubLayer::TilemapSubLayer(TilemapLayer* tilemap, Drawable::Z_t z) :
@@ -698,6 +862,10 @@ void TilemapLayer::SetTone(Tone tone) {
 
 	this->tone = tone;
 
+	// Chunks are not used while the tone is changing, see Draw()
+	InvalidateChunks();
+	tone_change_frame = Main_Data::game_system ? Main_Data::game_system->GetFrameCounter() : 0;
+
 	if (autotiles_d_screen_effect) {
 		autotiles_d_screen_effect->Clear();
 	}
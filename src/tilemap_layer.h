@@ -157,6 +157,38 @@ private:
 
 	std::vector<TileData> data_cache_vec;
 
+	void DrawTileData(Bitmap& dst, const TileData& tile, int x, int y, int animation_step_c, int animation_step_ab);
+	bool IsAnimatedTile(const TileData& tile) const;
+
+	/** Width and height of a chunk in tiles */
+	static constexpr int CHUNK_TILES = 16;
+	/** Chunks exceeding this count are evicted, least recently drawn first */
+	static constexpr size_t MAX_CHUNKS = 48;
+
+	/**
+	 * Pre-rendered static tiles of one sublayer in a CHUNK_TILES x CHUNK_TILES block.
+	 * Animated tiles (Blocks A, B and C) are not part of the bitmap and drawn
+	 * every frame from the animated list.
+	 */
+	struct TileChunk {
+		/** Static tiles, null when the chunk has none */
+		BitmapRef bitmap;
+		/** Opacity of bitmap, only fully opaque chunks may overwrite the background */
+		ImageOpacity opacity = ImageOpacity::Alpha_8Bit;
+		/** Cell indices (x + y * CHUNK_TILES) of animated tiles */
+		std::vector<uint16_t> animated;
+		uint32_t last_use = 0;
+	};
+
+	void DrawChunks(Bitmap& dst, uint8_t z_order, int div_ox, int div_oy, int mod_ox, int mod_oy, int tiles_x, int tiles_y, int animation_step_c, int animation_step_ab);
+	TileChunk& GetChunk(int chunk_x, int chunk_y, uint8_t z_order);
+	void InvalidateChunks();
+
+	/** Key is z << 24 | chunk_y << 12 | chunk_x */
+	std::unordered_map<uint32_t, TileChunk> chunks;
+	uint32_t chunk_use_counter = 0;
+	int tone_change_frame = -1;
+
 	TilemapSubLayer lower_layer;
 	TilemapSubLayer upper_layer;
 
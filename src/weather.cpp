@@ -42,7 +42,7 @@ void Weather::Update() {
 }
 
 void Weather::Draw(Bitmap& dst) {
-	SetTone(Main_Data::game_screen->GetTone());
+	SetTone(Main_Data::game_screen->GetSpriteTone());
 
 	switch (Main_Data::game_screen->GetWeatherType()) {
 		case Game_Screen::Weather_None:
@@ -23,6 +23,7 @@
 #include "util_macro.h"
 #include "window.h"
 #include "bitmap.h"
+#include "damage_tracker.h"
 #include "drawable_mgr.h"
 
 constexpr int pause_animation_frames = 20;
@@ -57,6 +58,22 @@ void Window::SetCloseAnimation(int frames) {
 	}
 }
 
+bool Window::GetDamageState(DamageState& state) const {
+	// Cursor and arrows can stick out of the window a bit
+	state.bounds = Rect(x - 16, y - 16, width + 32, height + 32);
+
+	const bool pause_visible = pause && pause_frame < pause_animation_frames;
+
+	state.Hash(windowskin.get(), windowskin ? windowskin->GetGeneration() : 0u,
+		contents.get(), contents ? contents->GetGeneration() : 0u,
+		stretch, cursor_rect.x, cursor_rect.y, cursor_rect.width, cursor_rect.height,
+		x, y, width, height, ox, oy, border_x, border_y,
+		opacity, frame_opacity, back_opacity, contents_opacity,
+		up_arrow, down_arrow, left_arrow, right_arrow,
+		cursor_frame <= 10, pause_visible, animation_frames, static_cast<int>(animation_count));
+	return true;
+}
+
 void Window::Draw(Bitmap& dst) {
 	if (width <= 0 || height <= 0) return;
 	if (x < -width || x > dst.GetWidth() || y < -height || y > dst.GetHeight()) return;
@@ -31,6 +31,7 @@
 #include "player.h"
 #include "system.h"
 #include "audio.h"
+#include "cache.h"
 
 class MenuItem final : public ConfigParam<StringView> {
 public:
@@ -254,6 +255,8 @@ void Window_Settings::RefreshVideo() {
 	AddOption(cfg.fps_limit, [this](){ DisplayUi->SetFrameLimit(GetCurrentOption().current_value); });
 	AddOption(cfg.show_fps, [](){ DisplayUi->ToggleShowFps(); });
 	AddOption(cfg.fps_render_window, [](){ DisplayUi->ToggleShowFpsOnTitle(); });
+	AddOption(cfg.damage_tracking, [](){ DisplayUi->ToggleDamageTracking(); });
+	AddOption(cfg.screen_tone_pass, [](){ DisplayUi->ToggleScreenTonePass(); });
 	AddOption(cfg.stretch, []() { DisplayUi->ToggleStretch(); });
 	AddOption(cfg.scaling_mode, [this](){ DisplayUi->SetScalingMode(static_cast<ScalingMode>(GetCurrentOption().current_value)); });
 	AddOption(cfg.touch_ui, [](){ DisplayUi->ToggleTouchUi(); });
@@ -282,11 +285,13 @@ void Window_Settings::RefreshEngine() {
 	AddOption(cfg.settings_in_title, [&cfg](){ cfg.settings_in_title.Toggle(); });
 	AddOption(cfg.settings_in_menu, [&cfg](){ cfg.settings_in_menu.Toggle(); });
 	AddOption(cfg.show_startup_logos, [this, &cfg](){ cfg.show_startup_logos.Set(static_cast<StartupLogos>(GetCurrentOption().current_value)); });
+	AddOption(cfg.image_cache_size, [this, &cfg](){ cfg.image_cache_size.Set(GetCurrentOption().current_value); Cache::SetBudget(cfg.image_cache_size.Get() * 1024 * 1024); });
 #else
 	AddOption(cfg.settings_autosave, [](){ cfg.settings_autosave.Toggle(); });
 	AddOption(cfg.settings_in_title, [](){ cfg.settings_in_title.Toggle(); });
 	AddOption(cfg.settings_in_menu, [](){ cfg.settings_in_menu.Toggle(); });
 	AddOption(cfg.show_startup_logos, [this](){ cfg.show_startup_logos.Set(static_cast<StartupLogos>(GetCurrentOption().current_value)); });
+	AddOption(cfg.image_cache_size, [this](){ cfg.image_cache_size.Set(GetCurrentOption().current_value); Cache::SetBudget(cfg.image_cache_size.Get() * 1024 * 1024); });
 #endif
 }
 
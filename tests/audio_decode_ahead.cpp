@@ -0,0 +1,157 @@
+#include "audio_decode_ahead.h"
+#include "doctest.h"
+#include <thread>
+#include <vector>
+
+TEST_SUITE_BEGIN("AudioDecodeAhead");
+
+namespace {
+
+// Produces the bytes 1, 2, ... 255, 1, 2, ... (never silence)
+class CountingDecoder : public AudioDecoderBase {
+	public:
+		explicit CountingDecoder(int length, bool* destroyed = nullptr) : length(length), destroyed(destroyed) {}
+		~CountingDecoder() override {
+			if (destroyed) {
+				*destroyed = true;
+			}
+		}
+
+		bool Open(Filesystem_Stream::InputStream) override { return true; }
+		void Pause() override {}
+		void Resume() override {}
+		int GetVolume() const override { return volume; }
+		void SetVolume(int v) override { volume = v; }
+		void SetFade(int end, std::chrono::milliseconds) override { volume = end; }
+		bool Seek(std::streamoff offset, std::ios_base::seekdir) override { pos = offset; return true; }
+		bool IsFinished() const override { return pos >= length; }
+		void Update(std::chrono::microseconds) override {}
+		void GetFormat(int& frequency, Format& format, int& channels) const override {
+			frequency = 8000;
+			format = Format::U8;
+			channels = 1;
+		}
+		int GetTicks() const override { return 0; }
+
+	private:
+		int FillBuffer(uint8_t* buffer, int size) override {
+			int n = std::min(size, length - pos);
+			for (int i = 0; i < n; ++i) {
+				buffer[i] = static_cast<uint8_t>((pos + i) % 255 + 1);
+			}
+			pos += n;
+			return n;
+		}
+
+		int length;
+		bool* destroyed;
+		int pos = 0;
+		int volume = 100;
+};
+
+std::vector<uint8_t> ReadAll(AudioDecodeAhead& decoder) {
+	std::vector<uint8_t> out;
+	uint8_t buffer[1000];
+	for (int i = 0; i < 10000; ++i) {
+		int res = decoder.Decode(buffer, sizeof(buffer));
+		if (res <= 0) {
+			break;
+		}
+		for (int j = 0; j < res; ++j) {
+			// Silence is written on underrun
+			if (buffer[j] != 0) {
+				out.push_back(buffer[j]);
+			}
+		}
+		if (res < static_cast<int>(sizeof(buffer))) {
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return out;
+}
+
+}
+
+TEST_CASE("DecodeAll") {
+	if (!AudioDecodeAhead::IsSupported()) {
+		return;
+	}
+
+	const int length = 20000;
+	AudioDecodeAhead decoder(std::make_unique<CountingDecoder>(length), std::chrono::milliseconds(100));
+
+	auto out = ReadAll(decoder);
+	REQUIRE_EQ(out.size(), length);
+	for (int i = 0; i < length; ++i) {
+		REQUIRE_EQ(out[i], i % 255 + 1);
+	}
+	REQUIRE(decoder.IsFinished());
+}
+
+TEST_CASE("Looping") {
+	if (!AudioDecodeAhead::IsSupported()) {
+		return;
+	}
+
+	auto counting = std::make_unique<CountingDecoder>(1000);
+	counting->SetLooping(true);
+	AudioDecodeAhead decoder(std::move(counting), std::chrono::milliseconds(100));
+
+	uint8_t buffer[1000];
+	for (int i = 0; i < 1000 && decoder.GetLoopCount() < 3; ++i) {
+		REQUIRE_EQ(decoder.Decode(buffer, sizeof(buffer)), sizeof(buffer));
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	REQUIRE_GE(decoder.GetLoopCount(), 3);
+	REQUIRE_FALSE(decoder.IsFinished());
+}
+
+TEST_CASE("Volume") {
+	if (!AudioDecodeAhead::IsSupported()) {
+		return;
+	}
+
+	AudioDecodeAhead decoder(std::make_unique<CountingDecoder>(1000000), std::chrono::milliseconds(100));
+	REQUIRE_EQ(decoder.GetVolume(), 100);
+
+	// Applies once the chunks decoded after the change are played
+	decoder.SetVolume(50);
+	uint8_t buffer[1000];
+	for (int i = 0; i < 1000 && decoder.GetVolume() != 50; ++i) {
+		decoder.Decode(buffer, sizeof(buffer));
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	REQUIRE_EQ(decoder.GetVolume(), 50);
+}
+
+TEST_CASE("ReleaseDecoders") {
+	if (!AudioDecodeAhead::IsSupported()) {
+		return;
+	}
+
+	bool destroyed = false;
+	auto decoder = std::make_unique<AudioDecodeAhead>(std::make_unique<CountingDecoder>(1000000, &destroyed), std::chrono::milliseconds(100));
+	decoder.reset();
+
+	// The wrapped decoder is destroyed synchronously and not by the worker
+	AudioDecodeAhead::ReleaseDecoders();
+	REQUIRE(destroyed);
+}
+
+TEST_CASE("ReleaseFinishedDecoder") {
+	if (!AudioDecodeAhead::IsSupported()) {
+		return;
+	}
+
+	bool destroyed = false;
+	AudioDecodeAhead decoder(std::make_unique<CountingDecoder>(1000, &destroyed), std::chrono::milliseconds(100));
+	REQUIRE_EQ(ReadAll(decoder).size(), 1000);
+	REQUIRE(decoder.IsFinished());
+
+	// Not needed anymore although the wrapper is still alive
+	AudioDecodeAhead::ReleaseDecoders();
+	REQUIRE(destroyed);
+}
+
+TEST_SUITE_END();
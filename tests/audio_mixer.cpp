@@ -0,0 +1,182 @@
+#include "audio_mixer.h"
+#include "doctest.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+TEST_SUITE_BEGIN("AudioMixer");
+
+namespace {
+
+using Format = AudioDecoderBase::Format;
+
+const Format formats[] = {
+	Format::S8, Format::U8, Format::S16, Format::U16, Format::S32, Format::U32, Format::F32
+};
+
+// Lengths around the SIMD block sizes, most leave a scalar tail
+const int lengths[] = { 1, 3, 4, 7, 8, 9, 15, 16, 17, 255, 256, 257, 1001 };
+
+int SampleSize(Format format) {
+	switch (format) {
+		case Format::S8:
+		case Format::U8:
+			return 1;
+		case Format::S16:
+		case Format::U16:
+			return 2;
+		default:
+			return 4;
+	}
+}
+
+std::vector<uint8_t> RandomSamples(int samples, Format format, unsigned seed) {
+	std::mt19937 rng(seed);
+	std::vector<uint8_t> data(samples * SampleSize(format));
+	if (format == Format::F32) {
+		std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+		for (int i = 0; i < samples; ++i) {
+			float f = dist(rng);
+			memcpy(&data[i * 4], &f, sizeof(f));
+		}
+	} else {
+		for (auto& b: data) {
+			b = static_cast<uint8_t>(rng());
+		}
+		// Extreme values at the start
+		if (samples >= 2) {
+			std::fill(data.begin(), data.begin() + SampleSize(format), 0x00);
+			std::fill(data.begin() + SampleSize(format), data.begin() + 2 * SampleSize(format), 0xFF);
+		}
+	}
+	return data;
+}
+
+// Sample i of src as float in the range -1.0 to 1.0
+float ReferenceSample(const uint8_t* src, int i, Format format) {
+	switch (format) {
+		case Format::S8:
+			return static_cast<int8_t>(src[i]) / 128.0f;
+		case Format::U8:
+			return (static_cast<int>(src[i]) - 128) / 128.0f;
+		case Format::S16: {
+			int16_t s;
+			memcpy(&s, src + i * 2, sizeof(s));
+			return s / 32768.0f;
+		}
+		case Format::U16: {
+			uint16_t s;
+			memcpy(&s, src + i * 2, sizeof(s));
+			return (static_cast<int>(s) - 32768) / 32768.0f;
+		}
+		case Format::S32: {
+			int32_t s;
+			memcpy(&s, src + i * 4, sizeof(s));
+			return static_cast<float>(s / 2147483648.0);
+		}
+		case Format::U32: {
+			uint32_t s;
+			memcpy(&s, src + i * 4, sizeof(s));
+			return static_cast<float>((static_cast<double>(s) - 2147483648.0) / 2147483648.0);
+		}
+		case Format::F32: {
+			float s;
+			memcpy(&s, src + i * 4, sizeof(s));
+			return s;
+		}
+	}
+	return 0.0f;
+}
+
+// Scalar mixing one frame at a time
+void MixReference(float* dst, const uint8_t* src, int frames, Format format, int channels, float volume) {
+	for (int i = 0; i < frames; ++i) {
+		const int left = i * channels;
+		const int right = channels == 1 ? left : left + 1;
+		dst[i * 2] += ReferenceSample(src, left, format) * volume;
+		dst[i * 2 + 1] += ReferenceSample(src, right, format) * volume;
+	}
+}
+
+// Scalar limiter, same formula as documented in AudioMixer::Limit
+void LimitReference(int16_t* dst, const float* src, int samples, float total_volume) {
+	const float threshold = 0.8f;
+	for (int i = 0; i < samples; ++i) {
+		float s = src[i];
+		if (total_volume > 1.0f && std::fabs(s) > threshold) {
+			const float a = threshold + (std::fabs(s) - threshold) * (1.0f - threshold) / (total_volume - threshold);
+			s = std::copysign(a, s);
+		}
+		dst[i] = static_cast<int16_t>(std::min(std::max(s * 32768.0f, -32768.0f), 32767.0f));
+	}
+}
+
+}
+
+TEST_CASE("MixMatchesScalar") {
+	for (auto format: formats) {
+		for (int channels: { 1, 2, 3 }) {
+			for (int frames: lengths) {
+				CAPTURE(static_cast<int>(format));
+				CAPTURE(channels);
+				CAPTURE(frames);
+
+				auto src = RandomSamples(frames * channels, format, frames * 7 + channels);
+
+				// Mixed on top of a previous channel
+				std::vector<float> dst(frames * 2 + 1);
+				for (size_t i = 0; i < dst.size(); ++i) {
+					dst[i] = static_cast<float>(i % 5) * 0.1f - 0.2f;
+				}
+				auto expected = dst;
+
+				MixReference(expected.data(), src.data(), frames, format, channels, 0.7f);
+				AudioMixer::Mix(dst.data(), src.data(), frames, format, channels, 0.7f);
+
+				for (size_t i = 0; i < dst.size(); ++i) {
+					REQUIRE_EQ(dst[i], doctest::Approx(expected[i]).epsilon(1e-5));
+				}
+				// Nothing is written past the frames
+				REQUIRE_EQ(dst.back(), expected.back());
+			}
+		}
+	}
+}
+
+TEST_CASE("LimitMatchesScalar") {
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> dist(-2.0f, 2.0f);
+
+	for (float total_volume: { 0.5f, 1.0f, 1.5f, 3.0f }) {
+		for (int samples: lengths) {
+			CAPTURE(total_volume);
+			CAPTURE(samples);
+
+			std::vector<float> src(samples);
+			for (auto& s: src) {
+				s = dist(rng);
+			}
+			// Threshold and clipping boundaries
+			const float special[] = { 0.0f, 0.8f, -0.8f, 1.0f, -1.0f, 0.81f, -0.81f };
+			for (int i = 0; i < samples && i < 7; ++i) {
+				src[i] = special[i];
+			}
+
+			std::vector<int16_t> dst(samples + 1, 123);
+			std::vector<int16_t> expected(samples + 1, 123);
+
+			LimitReference(expected.data(), src.data(), samples, total_volume);
+			AudioMixer::Limit(dst.data(), src.data(), samples, total_volume);
+
+			for (int i = 0; i <= samples; ++i) {
+				// Rounding of the compression may differ by one step
+				REQUIRE_LE(std::abs(dst[i] - expected[i]), 1);
+			}
+		}
+	}
+}
+
+TEST_SUITE_END();
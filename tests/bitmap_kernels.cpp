@@ -0,0 +1,117 @@
+#include "bitmap_kernels.h"
+#include "bitmap_hslrgb.h"
+#include "doctest.h"
+#include <random>
+#include <vector>
+
+TEST_SUITE_BEGIN("BitmapKernels");
+
+namespace {
+
+const Tone tones[] = {
+	Tone(),
+	Tone(0, 0, 0, 0),
+	Tone(255, 255, 255, 255),
+	Tone(128, 128, 128, 0),
+	Tone(128, 128, 128, 255),
+	Tone(40, 200, 129, 128),
+	Tone(127, 0, 255, 60),
+	Tone(255, 128, 1, 200),
+};
+
+// RGBA, BGRA and ARGB
+const int shifts[][4] = {
+	{ 0, 8, 16, 24 },
+	{ 16, 8, 0, 24 },
+	{ 24, 16, 8, 0 },
+};
+
+std::vector<uint32_t> RandomPixels(int n, unsigned seed) {
+	std::mt19937 rng(seed);
+	std::vector<uint32_t> pixels(n);
+	for (auto& p: pixels) {
+		p = rng();
+		// Make fully transparent and opaque pixels common
+		switch (rng() % 4) {
+			case 0: p &= 0x00FFFFFF; p |= (rng() % 2) << 24; break;
+			case 1: p |= 0xFF000000; break;
+			default: break;
+		}
+	}
+	pixels[0] = 0;
+	pixels[1] = 0xFFFFFFFF;
+	return pixels;
+}
+
+// The per pixel loops of Bitmap::ToneBlit before it used ApplyTone
+void ToneReference(std::vector<uint32_t>& pixels, const Tone& tone, int rs, int gs, int bs, int as, ImageOpacity opacity) {
+	const bool apply_sat = tone.gray != 128;
+	const bool apply_tone = (tone.red != 128 || tone.green != 128 || tone.blue != 128);
+	const int sat = saturation_factor(tone.gray);
+
+	for (auto& p: pixels) {
+		uint8_t a = (uint8_t)((p >> as) & 0xFF);
+		if (opacity != ImageOpacity::Opaque && a == 0) {
+			continue;
+		}
+		if (apply_sat) {
+			saturation_tone(p, sat, rs, gs, bs, as);
+		}
+		if (apply_tone) {
+			if (opacity == ImageOpacity::Alpha_8Bit && a != 255) {
+				color_tone_alpha(p, tone, rs, gs, bs, as);
+			} else {
+				color_tone(p, tone, rs, gs, bs, as);
+			}
+		}
+	}
+}
+
+}
+
+TEST_CASE("ApplyToneMatchesScalar") {
+	const ImageOpacity opacities[] = { ImageOpacity::Opaque, ImageOpacity::Alpha_1Bit, ImageOpacity::Alpha_8Bit };
+
+	for (auto& tone: tones) {
+		for (auto& s: shifts) {
+			for (auto opacity: opacities) {
+				auto pixels = RandomPixels(67, tone.red * 31 + tone.gray);
+				auto expected = pixels;
+				ToneReference(expected, tone, s[0], s[1], s[2], s[3], opacity);
+
+				BitmapKernels::ApplyTone(pixels.data(), static_cast<int>(pixels.size()), tone, s[0], s[1], s[2], s[3], opacity);
+				REQUIRE(pixels == expected);
+			}
+		}
+	}
+}
+
+TEST_CASE("HueChangeMatchesScalar") {
+	const int hues[] = { 0, 1, 0xFF, 0x100, 0x2AB, 0x3FF, 0x5FF, 0x600 };
+
+	for (int hue: hues) {
+		for (auto& s: shifts) {
+			auto pixels = RandomPixels(4099, hue);
+			// Gray and two channel ties
+			pixels[2] = 0x80808080;
+			pixels[3] = 0xFF4040A0;
+			pixels[4] = 0xFFA04040;
+			pixels[5] = 0xFF40A040;
+			auto expected = pixels;
+			for (auto& p: expected) {
+				uint8_t r = (p >> s[0]) & 0xFF;
+				uint8_t g = (p >> s[1]) & 0xFF;
+				uint8_t b = (p >> s[2]) & 0xFF;
+				uint8_t a = (p >> s[3]) & 0xFF;
+				if (a > 0)
+					RGB_adjust_HSL(r, g, b, hue);
+				p = ((uint32_t) r << s[0]) | ((uint32_t) g << s[1]) | ((uint32_t) b << s[2]) | ((uint32_t) a << s[3]);
+			}
+
+			BitmapKernels::HueChange(pixels.data(), static_cast<int>(pixels.size()), hue, s[0], s[1], s[2], s[3]);
+			REQUIRE(pixels == expected);
+		}
+	}
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,75 @@
+#include "cache.h"
+#include "bitmap.h"
+#include "pixel_format.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("Cache");
+
+TEST_CASE("HitAndMiss") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	Cache::ClearAll();
+
+	const auto before = Cache::GetStats(Cache::Pool::Other);
+
+	auto exfont = Cache::Exfont();
+	REQUIRE(exfont);
+	REQUIRE_EQ(Cache::Exfont(), exfont);
+
+	const auto after = Cache::GetStats(Cache::Pool::Other);
+	REQUIRE_EQ(after.misses, before.misses + 1);
+	REQUIRE_EQ(after.hits, before.hits + 1);
+	REQUIRE_EQ(after.entries, 1);
+	REQUIRE_EQ(after.bytes, exfont->GetSize());
+
+	Cache::ClearAll();
+}
+
+TEST_CASE("Budget") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	Cache::ClearAll();
+
+	const auto budget = Cache::GetBudget();
+
+	auto exfont = Cache::Exfont();
+	const auto evictions = Cache::GetStats(Cache::Pool::Other).evictions;
+
+	// Referenced images are never freed
+	Cache::SetBudget(0);
+	REQUIRE_EQ(Cache::GetStats(Cache::Pool::Other).entries, 1);
+
+	exfont.reset();
+	Cache::SetBudget(0);
+	auto stats = Cache::GetStats(Cache::Pool::Other);
+	REQUIRE_EQ(stats.entries, 0);
+	REQUIRE_EQ(stats.bytes, 0);
+	REQUIRE_EQ(stats.evictions, evictions + 1);
+
+	Cache::SetBudget(budget);
+	REQUIRE_EQ(Cache::GetBudget(), budget);
+
+	Cache::ClearAll();
+}
+
+TEST_CASE("BorrowUnusedShare") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	Cache::ClearAll();
+
+	const auto budget = Cache::GetBudget();
+
+	auto exfont = Cache::Exfont();
+	const auto size = exfont->GetSize();
+	exfont.reset();
+
+	// The image is larger than the share of its pool but the other pools are empty
+	Cache::SetBudget(size);
+	REQUIRE_LT(Cache::GetStats(Cache::Pool::Other).budget, size);
+	REQUIRE_EQ(Cache::GetStats(Cache::Pool::Other).entries, 1);
+
+	Cache::SetBudget(size - 1);
+	REQUIRE_EQ(Cache::GetStats(Cache::Pool::Other).entries, 0);
+
+	Cache::SetBudget(budget);
+	Cache::ClearAll();
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,167 @@
+#include "damage_tracker.h"
+#include "bitmap.h"
+#include "drawable_list.h"
+#include "drawable_mgr.h"
+#include "pixel_format.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("DamageTracker");
+
+namespace {
+
+class TestDrawable : public Drawable {
+	public:
+		TestDrawable(Drawable::Z_t z, Rect bounds) : Drawable(z, Drawable::Flags::Global), bounds(bounds) {}
+		void Draw(Bitmap&) override {}
+		bool GetDamageState(DamageState& state) const override {
+			if (!known) {
+				return false;
+			}
+			state.bounds = bounds;
+			state.Hash(value);
+			return true;
+		}
+
+		Rect bounds;
+		int value = 0;
+		bool known = true;
+};
+
+const Rect screen(0, 0, 320, 240);
+
+}
+
+TEST_CASE("AddRectClipsToScreen") {
+	std::vector<Rect> rects;
+	DamageTracker::AddRect(rects, Rect(-10, -10, 20, 20), screen);
+	REQUIRE_EQ(rects.size(), 1);
+	REQUIRE_EQ(rects[0], Rect(0, 0, 10, 10));
+
+	DamageTracker::AddRect(rects, Rect(400, 10, 20, 20), screen);
+	REQUIRE_EQ(rects.size(), 1);
+}
+
+TEST_CASE("AddRectJoinsOverlapping") {
+	std::vector<Rect> rects;
+	DamageTracker::AddRect(rects, Rect(0, 0, 10, 10), screen);
+	DamageTracker::AddRect(rects, Rect(100, 100, 10, 10), screen);
+	REQUIRE_EQ(rects.size(), 2);
+
+	DamageTracker::AddRect(rects, Rect(5, 5, 10, 10), screen);
+	REQUIRE_EQ(rects.size(), 2);
+	REQUIRE_EQ(rects.back(), Rect(0, 0, 15, 15));
+}
+
+TEST_CASE("AddRectLimit") {
+	std::vector<Rect> rects;
+	for (int i = 0; i < 20; ++i) {
+		DamageTracker::AddRect(rects, Rect(i * 15, (i % 2) * 100, 5, 5), screen);
+	}
+	REQUIRE_LE(rects.size(), DamageTracker::max_rects);
+	for (int i = 0; i < 20; ++i) {
+		Rect r(i * 15, (i % 2) * 100, 5, 5);
+		bool covered = false;
+		for (auto& d: rects) {
+			covered |= d.x <= r.x && d.y <= r.y && d.x + d.width >= r.x + r.width && d.y + d.height >= r.y + r.height;
+		}
+		REQUIRE(covered);
+	}
+}
+
+TEST_CASE("Update") {
+	DrawableList list;
+	DrawableMgr::SetLocalList(&list);
+
+	TestDrawable d1(1, Rect(0, 0, 50, 50));
+	TestDrawable d2(2, Rect(100, 100, 20, 20));
+	list.Append(&d1);
+	list.Append(&d2);
+
+	DamageTracker damage;
+	const auto min_z = std::numeric_limits<Drawable::Z_t>::min();
+	const auto max_z = std::numeric_limits<Drawable::Z_t>::max();
+
+	// First frame is always full
+	damage.Update(list, min_z, max_z, screen, 0);
+	REQUIRE(damage.IsFull());
+
+	damage.Update(list, min_z, max_z, screen, 0);
+	REQUIRE(damage.IsEmpty());
+
+	d2.value = 1;
+	damage.Update(list, min_z, max_z, screen, 0);
+	REQUIRE_FALSE(damage.IsFull());
+	REQUIRE_EQ(damage.GetRects().size(), 1);
+	REQUIRE_EQ(damage.GetRects()[0], Rect(100, 100, 20, 20));
+
+	// Moving damages the old and new position
+	d2.bounds = Rect(100, 110, 20, 20);
+	damage.Update(list, min_z, max_z, screen, 0);
+	REQUIRE_EQ(damage.GetRects().size(), 1);
+	REQUIRE_EQ(damage.GetRects()[0], Rect(100, 100, 20, 30));
+
+	d1.SetVisible(false);
+	damage.Update(list, min_z, max_z, screen, 0);
+	REQUIRE(damage.IsFull());
+
+	damage.Update(list, min_z, max_z, screen, 1);
+	REQUIRE(damage.IsFull());
+
+	damage.Update(list, min_z, max_z, screen, 1);
+	REQUIRE(damage.IsEmpty());
+
+	d2.known = false;
+	damage.Update(list, min_z, max_z, screen, 1);
+	REQUIRE(damage.IsFull());
+
+	d2.known = true;
+	damage.Update(list, min_z, max_z, screen, 1);
+	REQUIRE(damage.IsFull());
+
+	damage.Invalidate();
+	damage.Update(list, min_z, max_z, screen, 1);
+	REQUIRE(damage.IsFull());
+
+	damage.Update(list, min_z, max_z, screen, 1);
+	REQUIRE(damage.IsEmpty());
+
+	DrawableMgr::SetLocalList(nullptr);
+}
+
+TEST_CASE("BitmapGeneration") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	Bitmap dst(16, 16, true);
+	auto src = Bitmap::Create(8, 8, Color(255, 0, 0, 255));
+
+	auto gen = dst.GetGeneration();
+
+	// Operations that do not change the bitmap
+	dst.Blit(0, 0, *src, src->GetRect(), Opacity(0));
+	dst.ToneBlit(0, 0, dst, dst.GetRect(), Tone(128, 128, 128, 128), Opacity::Opaque());
+	dst.Flip(false, false);
+	dst.BlendBlit(0, 0, dst, dst.GetRect(), Color(), Opacity::Opaque());
+	REQUIRE_EQ(dst.GetGeneration(), gen);
+
+	dst.Blit(0, 0, *src, src->GetRect(), Opacity::Opaque());
+	REQUIRE_NE(dst.GetGeneration(), gen);
+}
+
+TEST_CASE("ToneBlitHonoursClip") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	auto dst = Bitmap::Create(16, 16, Color(128, 128, 128, 255));
+
+	dst->SetClipRects({ Rect(0, 0, 4, 4), Rect(2, 2, 4, 4) });
+	dst->ToneBlit(0, 0, *dst, dst->GetRect(), Tone(255, 128, 128, 128), Opacity::Opaque());
+	dst->ClearClipRects();
+
+	const auto untouched = Color(128, 128, 128, 255);
+	const auto toned = dst->GetColorAt(0, 0);
+	REQUIRE_NE(toned, untouched);
+	// Overlapping clip rectangles are toned once
+	REQUIRE_EQ(dst->GetColorAt(3, 3), toned);
+	REQUIRE_EQ(dst->GetColorAt(5, 5), toned);
+	REQUIRE_EQ(dst->GetColorAt(6, 6), untouched);
+	REQUIRE_EQ(dst->GetColorAt(15, 0), untouched);
+}
+
+TEST_SUITE_END();
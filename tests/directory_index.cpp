@@ -0,0 +1,78 @@
+#include "directory_index.h"
+#include "filefinder.h"
+#include "platform.h"
+#include "doctest.h"
+#include <cstdio>
+
+TEST_SUITE_BEGIN("DirectoryIndex");
+
+namespace {
+	const std::string folder = EP_TEST_PATH "/platform";
+}
+
+TEST_CASE("StoreAndLookup") {
+	DirectoryIndex index(FilesystemView(), "");
+
+	DirectoryTree::DirectoryListType entries;
+	int64_t mtime;
+	CHECK(!index.Lookup(folder, entries, mtime));
+	REQUIRE(mtime > 0);
+
+	entries.emplace_back("1kb", DirectoryTree::Entry("1kb", DirectoryTree::FileType::Regular));
+	entries.emplace_back("folder", DirectoryTree::Entry("Folder", DirectoryTree::FileType::Directory));
+	index.Store(folder, mtime, entries);
+
+	DirectoryTree::DirectoryListType result;
+	REQUIRE(index.Lookup(folder, result, mtime));
+	CHECK(result == entries);
+}
+
+TEST_CASE("Outdated") {
+	DirectoryIndex index(FilesystemView(), "");
+
+	DirectoryTree::DirectoryListType entries;
+	int64_t mtime;
+	CHECK(!index.Lookup(folder, entries, mtime));
+
+	// Listing of a directory that was modified afterwards
+	index.Store(folder, mtime - 10, entries);
+	CHECK(!index.Lookup(folder, entries, mtime));
+}
+
+TEST_CASE("SaveAndReload") {
+	auto fs = FileFinder::Root().Create(Platform::GetWorkingDirectory());
+	REQUIRE(fs);
+	const std::string filename = "directory_index_test.index";
+
+	DirectoryTree::DirectoryListType entries;
+	int64_t mtime;
+	{
+		DirectoryIndex index(fs, filename);
+		CHECK(!index.Lookup(folder, entries, mtime));
+
+		entries.emplace_back("1kb", DirectoryTree::Entry("1kb", DirectoryTree::FileType::Regular));
+		index.Store(folder, mtime, entries);
+		index.Save();
+	}
+	REQUIRE(fs.IsFile(filename));
+
+	DirectoryIndex index(fs, filename);
+
+	// Another instance replaces the file while this one still uses the listings
+	{
+		auto os = fs.OpenOutputStream(filename);
+		REQUIRE(os);
+	}
+
+	DirectoryTree::DirectoryListType result;
+	REQUIRE(index.Lookup(folder, result, mtime));
+	CHECK(result == entries);
+
+	// The emptied file is treated as a missing index
+	DirectoryIndex reloaded(fs, filename);
+	CHECK(!reloaded.Lookup(folder, result, mtime));
+
+	std::remove(fs.MakePath(filename).c_str());
+}
+
+TEST_SUITE_END();
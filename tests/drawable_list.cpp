@@ -4,6 +4,7 @@
 #include "drawable_list.h"
 #include "drawable_mgr.h"
 #include "bitmap.h"
+#include "rect.h"
 #include "doctest.h"
 
 TEST_SUITE_BEGIN("DrawableList");
@@ -16,6 +17,23 @@ class TestSprite : public Drawable {
 		void Draw(Bitmap&) override {}
 };
 
+class TestBounds : public Drawable {
+	public:
+		TestBounds(Drawable::Z_t z, Rect bounds, bool opaque = false)
+			: Drawable(z, Drawable::Flags::Global), bounds(bounds), opaque(opaque) {}
+		void Draw(Bitmap&) override { ++draws; }
+		bool GetDrawBounds(Rect& r, bool& o) const override {
+			r = bounds;
+			o = opaque;
+			return known;
+		}
+
+		Rect bounds;
+		bool opaque = false;
+		bool known = true;
+		int draws = 0;
+};
+
 class TestFrame : public Drawable {
 	public:
 		TestFrame(Drawable::Z_t z = 0) : Drawable(z, Drawable::Flags::Global | Drawable::Flags::Shared) {}
@@ -350,4 +368,68 @@ TEST_CASE("TakeFromPred") {
 	REQUIRE(list2.IsDirty());
 }
 
+TEST_CASE("DrawCulling") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	Bitmap bitmap(16, 16, false);
+
+	DrawableList list;
+	DrawableMgr::SetLocalList(&list);
+
+	TestBounds inside(1, Rect(4, 4, 4, 4));
+	TestBounds outside(2, Rect(16, 0, 4, 4));
+	TestBounds empty(3, Rect());
+	TestBounds unknown(4, Rect(-20, -20, 4, 4));
+	unknown.known = false;
+	list.Append(&inside);
+	list.Append(&outside);
+	list.Append(&empty);
+	list.Append(&unknown);
+
+	list.Draw(bitmap);
+	REQUIRE_EQ(inside.draws, 1);
+	REQUIRE_EQ(outside.draws, 0);
+	REQUIRE_EQ(empty.draws, 0);
+	REQUIRE_EQ(unknown.draws, 1);
+
+	DrawableMgr::SetLocalList(nullptr);
+}
+
+TEST_CASE("DrawOcclusion") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	Bitmap bitmap(16, 16, false);
+
+	DrawableList list;
+	DrawableMgr::SetLocalList(&list);
+
+	TestBounds below(1, Rect(0, 0, 16, 16));
+	TestBounds cover(2, Rect(-1, 0, 20, 16), true);
+	TestBounds partial(3, Rect(0, 0, 8, 16), true);
+	TestBounds above(4, Rect(0, 0, 16, 16));
+	list.Append(&below);
+	list.Append(&cover);
+	list.Append(&partial);
+	list.Append(&above);
+
+	list.Draw(bitmap);
+	REQUIRE_EQ(below.draws, 0);
+	REQUIRE_EQ(cover.draws, 1);
+	REQUIRE_EQ(partial.draws, 1);
+	REQUIRE_EQ(above.draws, 1);
+
+	// Hidden drawables do not occlude
+	cover.SetVisible(false);
+	list.Draw(bitmap);
+	REQUIRE_EQ(below.draws, 1);
+	REQUIRE_EQ(cover.draws, 1);
+
+	// Only drawables in the z range occlude
+	cover.SetVisible(true);
+	list.Draw(bitmap, 3, 4);
+	REQUIRE_EQ(below.draws, 1);
+	REQUIRE_EQ(cover.draws, 1);
+	REQUIRE_EQ(partial.draws, 3);
+
+	DrawableMgr::SetLocalList(nullptr);
+}
+
 TEST_SUITE_END();
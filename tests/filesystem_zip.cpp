@@ -1,8 +1,13 @@
 #include "filesystem.h"
+#include "filesystem_archive_index.h"
 #include "filefinder.h"
 #include "main_data.h"
 #include "doctest.h"
+#include "platform.h"
 #include "player.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstdio>
 
 #define ZIP_PATH EP_TEST_PATH "/filesystem/test.zip"
 #define ZIP_FOLDER_PATH EP_TEST_PATH "/filesystem/folder.zip"
@@ -42,6 +47,19 @@ TEST_CASE("GetFilesize") {
 	CHECK(fs.GetFilesize("1kb") == 1024);
 }
 
+TEST_CASE("ListDirectory") {
+	auto fs = FileFinder::Root().Create(ZIP_PATH);
+	auto* root = fs.ListDirectory();
+	REQUIRE(root);
+	CHECK(root->size() == 4);
+
+	auto* charset = fs.ListDirectory("game/Charset");
+	REQUIRE(charset);
+	REQUIRE(charset->size() == 1);
+	CHECK(charset->front().second.name == "chara1.png");
+	CHECK(charset->front().second.type == DirectoryTree::FileType::Regular);
+}
+
 TEST_CASE("File reading") {
 	auto fs = FileFinder::Root().Create(ZIP_PATH);
 	auto is = fs.OpenInputStream("text");
@@ -60,6 +78,24 @@ TEST_CASE("File reading") {
 	CHECK(line_out == "lo");
 }
 
+TEST_CASE("Deflate reading") {
+	auto fs = FileFinder::Root().Create(ZIP_PATH);
+	auto is = fs.OpenInputStream("1kb");
+	REQUIRE(is);
+	CHECK(is.GetSize() == 1024);
+
+	std::vector<char> data(2048, 1);
+	is.read(data.data(), data.size());
+	CHECK(is.gcount() == 1024);
+	CHECK(std::all_of(data.begin(), data.begin() + 1024, [](char c) { return c == 0; }));
+
+	// Seek backwards after reaching the end
+	is.clear();
+	is.seekg(1000, std::ios_base::beg);
+	is.read(data.data(), data.size());
+	CHECK(is.gcount() == 24);
+}
+
 TEST_CASE("File IO error") {
 	auto fs = FileFinder::Root().Create(ZIP_PATH);
 	CHECK(!fs.OpenInputStream("game"));
@@ -67,4 +103,58 @@ TEST_CASE("File IO error") {
 	CHECK(!fs.OpenOutputStream("not_supported"));
 }
 
+TEST_CASE("Index file") {
+	// Index files are written next to the archive, use a copy in a writable place
+	auto fs = FileFinder::Root().Create(Platform::GetWorkingDirectory());
+	REQUIRE(fs);
+	const std::string filename = "filesystem_zip_test.zip";
+	const std::string index_filename = filename + ".easyrpg-index";
+	{
+		auto is = FileFinder::Root().OpenInputStream(ZIP_PATH);
+		REQUIRE(is);
+		auto data = Utils::ReadStream(is);
+		auto os = fs.OpenOutputStream(filename);
+		REQUIRE(os);
+		os.write(reinterpret_cast<const char*>(data.data()), data.size());
+	}
+
+	auto listings = [&]() {
+		std::vector<DirectoryTree::DirectoryListType> result;
+		auto zip_fs = fs.Create(filename);
+		REQUIRE(zip_fs);
+		for (const char* dir: { "", "game", "game/Charset" }) {
+			auto* entries = zip_fs.ListDirectory(dir);
+			REQUIRE(entries);
+			result.push_back(*entries);
+		}
+		return result;
+	};
+
+	ArchiveIndex::SetMinFileEntries(1);
+
+	const auto scanned = listings();
+	REQUIRE(fs.IsFile(index_filename));
+	CHECK(listings() == scanned);
+
+	// A truncated index file is ignored and the archive is scanned again
+	std::vector<uint8_t> index_data;
+	{
+		auto is = fs.OpenInputStream(index_filename);
+		REQUIRE(is);
+		index_data = Utils::ReadStream(is);
+	}
+	REQUIRE(index_data.size() > 32);
+	{
+		auto os = fs.OpenOutputStream(index_filename);
+		REQUIRE(os);
+		os.write(reinterpret_cast<const char*>(index_data.data()), index_data.size() - 32);
+	}
+	CHECK(listings() == scanned);
+	CHECK(listings() == scanned);
+
+	ArchiveIndex::SetMinFileEntries(ArchiveIndex::default_min_file_entries);
+	std::remove(fs.MakePath(index_filename).c_str());
+	std::remove(fs.MakePath(filename).c_str());
+}
+
 TEST_SUITE_END();
@@ -3,6 +3,7 @@
 #include "cache.h"
 #include "bitmap.h"
 #include "font.h"
+#include <algorithm>
 #include <iostream>
 #include "doctest.h"
 
@@ -105,4 +106,23 @@ TEST_CASE("FontGlyphCharEx") {
 	}
 }
 
+TEST_CASE("FontGlyphAtlas") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	auto font = Font::Default();
+	auto system = Cache::SysBlack();
+
+	// The first call renders the glyph, the second one uses the glyph atlas
+	auto first = Bitmap::Create(width, height);
+	auto second = Bitmap::Create(width, height);
+	for (char32_t ch: {U'Q', U'字'}) {
+		REQUIRE_EQ(font->Render(*first, 0, 0, *system, 0, ch), font->Render(*second, 0, 0, *system, 0, ch));
+	}
+
+	REQUIRE_EQ(first->pitch(), second->pitch());
+	auto size = first->pitch() * first->height();
+	REQUIRE(std::equal(
+		reinterpret_cast<const uint8_t*>(first->pixels()), reinterpret_cast<const uint8_t*>(first->pixels()) + size,
+		reinterpret_cast<const uint8_t*>(second->pixels())));
+}
+
 TEST_SUITE_END();
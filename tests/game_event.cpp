@@ -1,4 +1,5 @@
 #include "game_event.h"
+#include "mock_game.h"
 #include "doctest.h"
 #include "options.h"
 #include "game_map.h"
@@ -28,4 +29,67 @@ TEST_CASE("IdName") {
 	}
 }
 
+TEST_CASE("RefreshDependencies") {
+	const MockGame mg(MockMap::eRefreshPages);
+
+	auto page_id = [](int id) {
+		auto* page = MockGame::GetEvent(id)->GetActivePage();
+		return page ? page->ID : 0;
+	};
+
+	Game_Map::Refresh();
+	REQUIRE_EQ(page_id(2), 1);
+	REQUIRE_EQ(page_id(3), 1);
+	REQUIRE_EQ(page_id(4), 1);
+
+	Main_Data::game_switches->Set(1, true);
+	Game_Map::Refresh();
+	REQUIRE_EQ(page_id(2), 2);
+	REQUIRE_EQ(page_id(3), 1);
+	REQUIRE_EQ(page_id(4), 1);
+
+	Main_Data::game_switches->Set(2, true);
+	Main_Data::game_variables->Set(1, 5);
+	Game_Map::Refresh();
+	REQUIRE_EQ(page_id(2), 2);
+	REQUIRE_EQ(page_id(3), 2);
+	REQUIRE_EQ(page_id(4), 2);
+
+	// Changes that are reverted before the refresh keep the page
+	Main_Data::game_variables->Set(1, 0);
+	Main_Data::game_variables->Set(1, 5);
+	Main_Data::game_switches->Set(1, false);
+	Game_Map::Refresh();
+	REQUIRE_EQ(page_id(2), 1);
+	REQUIRE_EQ(page_id(3), 2);
+	REQUIRE_EQ(page_id(4), 1);
+}
+
+TEST_CASE("PositionIndex") {
+	const MockGame mg(MockMap::eRefreshPages);
+
+	// All events start at (0, 0)
+	REQUIRE_EQ(Game_Map::CheckEvent(0, 0), 1);
+	REQUIRE_EQ(Game_Map::GetEventAt(0, 0, false)->GetId(), 4);
+
+	auto* ev = MockGame::GetEvent(4);
+	ev->SetX(3);
+	ev->SetY(2);
+	REQUIRE_EQ(Game_Map::GetEventAt(0, 0, false)->GetId(), 3);
+	REQUIRE_EQ(Game_Map::GetEventAt(3, 2, false), ev);
+	REQUIRE_EQ(Game_Map::GetEventAt(3, 0, false), nullptr);
+	REQUIRE_EQ(Game_Map::CheckEvent(3, 2), 4);
+
+	ev->MoveTo(1, 0, 0);
+	REQUIRE_EQ(Game_Map::GetEventAt(3, 2, false), nullptr);
+	REQUIRE_EQ(Game_Map::CheckEvent(0, 0), 1);
+	REQUIRE_EQ(Game_Map::GetEventAt(0, 0, false), ev);
+
+	std::vector<Game_Event*> events;
+	Game_Map::GetEventsXY(events, 0, 0);
+	REQUIRE_EQ(events.size(), 4);
+	REQUIRE_EQ(events.front()->GetId(), 1);
+	REQUIRE_EQ(events.back()->GetId(), 4);
+}
+
 TEST_SUITE_END();
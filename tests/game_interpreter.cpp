@@ -0,0 +1,47 @@
+#include "game_interpreter_map.h"
+#include "mock_game.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("Game_Interpreter");
+
+namespace {
+
+lcf::rpg::EventCommand MakeCommand(Game_Interpreter::Cmd code, int indent = 0) {
+	lcf::rpg::EventCommand com;
+	com.code = static_cast<int>(code);
+	com.indent = indent;
+	return com;
+}
+
+}
+
+TEST_CASE("SharedCommandList") {
+	const MockGame mg(MockMap::ePass40x30);
+
+	auto list = std::make_shared<const std::vector<lcf::rpg::EventCommand>>(std::vector<lcf::rpg::EventCommand>{
+		MakeCommand(Game_Interpreter::Cmd::Wait),
+		MakeCommand(Game_Interpreter::Cmd::Comment),
+	});
+
+	Game_Interpreter_Map ip;
+	ip.Push(list, 3);
+	ip.Push(list, 4);
+
+	// Frames refer to the list instead of copying it
+	REQUIRE_EQ(list.use_count(), 3);
+
+	auto state = ip.GetState();
+	REQUIRE_EQ(state.stack.size(), 2);
+	REQUIRE_EQ(state.stack[0].commands, *list);
+	REQUIRE_EQ(state.stack[1].commands, *list);
+	REQUIRE_EQ(state.stack[1].event_id, 4);
+
+	Game_Interpreter_Map loaded;
+	loaded.SetState(state);
+	REQUIRE_EQ(loaded.GetState().stack, state.stack);
+
+	ip.Clear();
+	REQUIRE_EQ(list.use_count(), 1);
+}
+
+TEST_SUITE_END();
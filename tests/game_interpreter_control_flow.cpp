@@ -0,0 +1,105 @@
+#include "game_interpreter_control_flow.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("Game_Interpreter_ControlFlow");
+
+namespace {
+
+using Cmd = lcf::rpg::EventCommand::Code;
+
+lcf::rpg::EventCommand MakeCommand(Cmd code, int indent, std::vector<int32_t> params = {}) {
+	lcf::rpg::EventCommand com;
+	com.code = static_cast<int>(code);
+	com.indent = indent;
+	com.parameters = lcf::DBArray<int32_t>(params.begin(), params.end());
+	return com;
+}
+
+}
+
+TEST_CASE("Labels") {
+	std::vector<lcf::rpg::EventCommand> list = {
+		MakeCommand(Cmd::JumpToLabel, 0, {2}),
+		MakeCommand(Cmd::Label, 0, {1}),
+		MakeCommand(Cmd::Label, 1, {2}),
+		MakeCommand(Cmd::Label, 0, {2}),
+		MakeCommand(Cmd::Wait, 0),
+	};
+	Game_Interpreter_ControlFlow flow(list);
+
+	REQUIRE_EQ(flow.FindLabel(1), 1);
+	REQUIRE_EQ(flow.FindLabel(2), 2);
+	REQUIRE_EQ(flow.FindLabel(3), -1);
+}
+
+TEST_CASE("SkipToNextConditional") {
+	std::vector<lcf::rpg::EventCommand> list = {
+		MakeCommand(Cmd::ConditionalBranch, 0),
+		MakeCommand(Cmd::ConditionalBranch, 1),
+		MakeCommand(Cmd::ElseBranch, 1),
+		MakeCommand(Cmd::EndBranch, 1),
+		MakeCommand(Cmd::ElseBranch, 0),
+		MakeCommand(Cmd::Wait, 1),
+		MakeCommand(Cmd::EndBranch, 0),
+		MakeCommand(Cmd::Wait, 0),
+	};
+	Game_Interpreter_ControlFlow flow(list);
+
+	REQUIRE_EQ(flow.SkipToNextConditional(list, 0, {Cmd::ElseBranch, Cmd::EndBranch}, 0), 4);
+	REQUIRE_EQ(flow.SkipToNextConditional(list, 0, {Cmd::EndBranch}, 0), 6);
+	REQUIRE_EQ(flow.SkipToNextConditional(list, 1, {Cmd::ElseBranch, Cmd::EndBranch}, 1), 2);
+	REQUIRE_EQ(flow.SkipToNextConditional(list, 4, {Cmd::EndLoop}, 0), 8);
+
+	// Break out of the inner branch like BreakLoop does
+	REQUIRE_EQ(flow.SkipToNextConditional(list, 2, {Cmd::ElseBranch}, 0), 4);
+}
+
+TEST_CASE("SkipToNextConditionalBrokenCode") {
+	// Branch at indent 1 without an end, the lower indented Wait must not hide the
+	// EndBranch at indent 1 that follows it
+	std::vector<lcf::rpg::EventCommand> list = {
+		MakeCommand(Cmd::ConditionalBranch, 1),
+		MakeCommand(Cmd::Wait, 2),
+		MakeCommand(Cmd::Wait, 0),
+		MakeCommand(Cmd::Wait, 2),
+		MakeCommand(Cmd::EndBranch, 1),
+	};
+	Game_Interpreter_ControlFlow flow(list);
+
+	REQUIRE_EQ(flow.SkipToNextConditional(list, 0, {Cmd::EndBranch}, 1), 4);
+	REQUIRE_EQ(flow.SkipToNextConditional(list, 1, {Cmd::EndBranch}, 1), 4);
+}
+
+TEST_CASE("LoopStart") {
+	std::vector<lcf::rpg::EventCommand> list = {
+		MakeCommand(Cmd::Loop, 0),
+		MakeCommand(Cmd::Loop, 1),
+		MakeCommand(Cmd::EndLoop, 1),
+		MakeCommand(Cmd::Wait, 1),
+		MakeCommand(Cmd::EndLoop, 0),
+		MakeCommand(Cmd::EndLoop, 0),
+		MakeCommand(Cmd::EndLoop, 1),
+		MakeCommand(Cmd::Wait, 0),
+		MakeCommand(Cmd::Loop, 1),
+		MakeCommand(Cmd::Wait, 0),
+	};
+	Game_Interpreter_ControlFlow flow(list);
+
+	REQUIRE_EQ(flow.FindLoopStart(2), 1);
+	REQUIRE_EQ(flow.FindLoopStart(4), 0);
+	REQUIRE_EQ(flow.FindLoopStart(5), 0);
+	REQUIRE_EQ(flow.FindLoopStart(6), Game_Interpreter_ControlFlow::loop_blocked);
+	REQUIRE_EQ(flow.FindLoopStart(7), Game_Interpreter_ControlFlow::loop_not_found);
+}
+
+TEST_CASE("LoopStartNoLoop") {
+	std::vector<lcf::rpg::EventCommand> list = {
+		MakeCommand(Cmd::Wait, 0),
+		MakeCommand(Cmd::EndLoop, 0),
+	};
+	Game_Interpreter_ControlFlow flow(list);
+
+	REQUIRE_EQ(flow.FindLoopStart(1), Game_Interpreter_ControlFlow::loop_not_found);
+}
+
+TEST_SUITE_END();
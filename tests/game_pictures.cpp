@@ -0,0 +1,67 @@
+#include "game_pictures.h"
+#include "mock_game.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("Game_Pictures");
+
+namespace {
+
+class EngineGuard {
+public:
+	explicit EngineGuard(int engine) : _engine(Player::game_config.engine) {
+		Player::game_config.engine = engine;
+	}
+
+	EngineGuard(const EngineGuard&) = delete;
+	EngineGuard& operator=(const EngineGuard&) = delete;
+
+	~EngineGuard() {
+		Player::game_config.engine = _engine;
+	}
+private:
+	int _engine;
+};
+
+Game_Pictures::ShowParams MakeParams(int map_layer, bool affected_by_tint) {
+	Game_Pictures::ShowParams params;
+	params.name = "picture";
+	params.map_layer = map_layer;
+	params.flags = 1 | 32 | 64 | (affected_by_tint ? 16 : 0);
+	return params;
+}
+
+}
+
+TEST_CASE("UntintedPictureBelowScreen") {
+	const MockGame mg(MockMap::ePass40x30);
+	const EngineGuard eg(Player::EngineRpg2k3 | Player::EngineMajorUpdated);
+	auto& pictures = *Main_Data::game_pictures;
+
+	REQUIRE_FALSE(pictures.HasUntintedPictureBelowScreen());
+
+	// Tinted pictures are toned by the tone pass as well
+	pictures.GetPicture(1).Show(MakeParams(lcf::rpg::SavePicture::MapLayer_tilemap_below, true));
+	REQUIRE_FALSE(pictures.HasUntintedPictureBelowScreen());
+
+	// Untinted pictures above the screen are not affected by the tone pass
+	pictures.GetPicture(2).Show(MakeParams(lcf::rpg::SavePicture::MapLayer_weather, false));
+	REQUIRE_FALSE(pictures.HasUntintedPictureBelowScreen());
+
+	pictures.GetPicture(3).Show(MakeParams(lcf::rpg::SavePicture::MapLayer_events_below, false));
+	REQUIRE(pictures.HasUntintedPictureBelowScreen());
+
+	pictures.GetPicture(3).Erase();
+	REQUIRE_FALSE(pictures.HasUntintedPictureBelowScreen());
+}
+
+TEST_CASE("UntintedPictureLegacy") {
+	const MockGame mg(MockMap::ePass40x30);
+	const EngineGuard eg(Player::EngineRpg2k3);
+	auto& pictures = *Main_Data::game_pictures;
+
+	// Without priority layers all pictures are drawn above the screen
+	pictures.GetPicture(1).Show(MakeParams(lcf::rpg::SavePicture::MapLayer_events_below, false));
+	REQUIRE_FALSE(pictures.HasUntintedPictureBelowScreen());
+}
+
+TEST_SUITE_END();
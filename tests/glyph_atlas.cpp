@@ -0,0 +1,87 @@
+#include "glyph_atlas.h"
+#include "bitmap.h"
+#include "color.h"
+#include "pixel_format.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("GlyphAtlas");
+
+namespace {
+constexpr int glyph_size = 64;
+constexpr int glyphs_per_page = (GlyphAtlas::page_size / glyph_size) * (GlyphAtlas::page_size / glyph_size);
+}
+
+TEST_CASE("InsertAndFind") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	GlyphAtlas atlas;
+	auto bm = Bitmap::Create(6, 12, Color(255, 255, 255, 255));
+
+	auto key = GlyphAtlas::MakeKey(U'X', 12, false);
+	REQUIRE(atlas.Find(key) == nullptr);
+	REQUIRE(atlas.Insert(key, *bm, Point(6, 0), Point(0, 0)) != nullptr);
+
+	auto* glyph = atlas.Find(key);
+	REQUIRE(glyph != nullptr);
+	REQUIRE(glyph->bitmap != nullptr);
+	REQUIRE_EQ(glyph->rect.width, 6);
+	REQUIRE_EQ(glyph->rect.height, 12);
+	REQUIRE_EQ(glyph->advance, Point(6, 0));
+	auto* pixels = reinterpret_cast<const uint8_t*>(glyph->bitmap->pixels());
+	REQUIRE_EQ(pixels[glyph->rect.y * glyph->bitmap->pitch() + glyph->rect.x], 255);
+
+	// Other sizes and shaped glyphs are separate entries
+	REQUIRE(atlas.Find(GlyphAtlas::MakeKey(U'X', 16, false)) == nullptr);
+	REQUIRE(atlas.Find(GlyphAtlas::MakeKey(U'X', 12, true)) == nullptr);
+}
+
+TEST_CASE("EmptyGlyph") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	GlyphAtlas atlas;
+	auto bm = Bitmap::Create(0, 0);
+
+	auto key = GlyphAtlas::MakeKey(U' ', 12, false);
+	REQUIRE(atlas.Insert(key, *bm, Point(6, 0), Point(0, 0)) != nullptr);
+
+	auto* glyph = atlas.Find(key);
+	REQUIRE(glyph != nullptr);
+	REQUIRE(glyph->rect.IsEmpty());
+	REQUIRE_EQ(glyph->advance, Point(6, 0));
+	REQUIRE_EQ(atlas.GetPageCount(), 0);
+}
+
+TEST_CASE("LargeGlyph") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	GlyphAtlas atlas;
+	auto bm = Bitmap::Create(GlyphAtlas::page_size + 1, 12);
+
+	REQUIRE(atlas.Insert(0, *bm, Point(), Point()) == nullptr);
+	REQUIRE(atlas.Find(0) == nullptr);
+}
+
+TEST_CASE("EvictLeastRecentlyUsedPage") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	GlyphAtlas atlas;
+	auto bm = Bitmap::Create(glyph_size, glyph_size);
+
+	const int count = glyphs_per_page * static_cast<int>(GlyphAtlas::max_pages);
+	for (int i = 0; i < count; ++i) {
+		REQUIRE(atlas.Insert(i, *bm, Point(), Point()) != nullptr);
+	}
+	REQUIRE_EQ(atlas.GetPageCount(), GlyphAtlas::max_pages);
+
+	// Glyph of the first page was used recently, the second page is evicted
+	REQUIRE(atlas.Find(0) != nullptr);
+	REQUIRE(atlas.Insert(count, *bm, Point(), Point()) != nullptr);
+
+	REQUIRE_EQ(atlas.GetPageCount(), GlyphAtlas::max_pages);
+	REQUIRE(atlas.Find(0) != nullptr);
+	REQUIRE(atlas.Find(glyphs_per_page) == nullptr);
+	REQUIRE(atlas.Find(glyphs_per_page * 2) != nullptr);
+	REQUIRE(atlas.Find(count) != nullptr);
+
+	atlas.Clear();
+	REQUIRE_EQ(atlas.GetPageCount(), 0);
+	REQUIRE(atlas.Find(0) == nullptr);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,91 @@
+#include "instrumentation.h"
+#include "doctest.h"
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+static const Instrumentation::ZoneStat* FindZone(const std::vector<Instrumentation::ZoneStat>& stats, const char* name) {
+	for (const auto& stat: stats) {
+		if (std::strcmp(stat.name, name) == 0) {
+			return &stat;
+		}
+	}
+	return nullptr;
+}
+
+static void ProfiledInner() {
+	EP_PROFILE_ZONE("Test::Inner");
+}
+
+static void ProfiledOuter() {
+	EP_PROFILE_ZONE("Test::Outer");
+	ProfiledInner();
+	ProfiledInner();
+}
+
+TEST_SUITE_BEGIN("Instrumentation");
+
+TEST_CASE("ZoneDisabled") {
+	Instrumentation::SetProfilerEnabled(false);
+	{
+		EP_PROFILE_ZONE("Test::Disabled");
+	}
+
+	auto stats = Instrumentation::GetZoneStats();
+	auto* zone = FindZone(stats, "Test::Disabled");
+	REQUIRE(zone != nullptr);
+	REQUIRE_EQ(zone->count, 0);
+	REQUIRE_EQ(zone->total_ns, 0);
+}
+
+TEST_CASE("ZoneNested") {
+	Instrumentation::SetProfilerEnabled(true);
+	ProfiledOuter();
+	Instrumentation::SetProfilerEnabled(false);
+
+	auto stats = Instrumentation::GetZoneStats();
+	auto* outer = FindZone(stats, "Test::Outer");
+	auto* inner = FindZone(stats, "Test::Inner");
+	REQUIRE(outer != nullptr);
+	REQUIRE(inner != nullptr);
+	REQUIRE_EQ(outer->count, 1);
+	REQUIRE_EQ(inner->count, 2);
+	REQUIRE_GE(outer->total_ns, inner->total_ns);
+}
+
+TEST_CASE("ChromeTrace") {
+	Instrumentation::SetProfilerEnabled(true);
+	ProfiledOuter();
+	Instrumentation::SetProfilerEnabled(false);
+
+	std::stringstream ss;
+	Instrumentation::WriteChromeTrace(ss);
+	auto trace = ss.str();
+
+	REQUIRE_EQ(trace.rfind("{\"traceEvents\":[", 0), 0);
+	REQUIRE_NE(trace.find("\"name\":\"Test::Outer\",\"ph\":\"X\""), std::string::npos);
+	REQUIRE_NE(trace.find("\"name\":\"Test::Inner\""), std::string::npos);
+}
+
+TEST_CASE("ChromeTraceWhileRecording") {
+	Instrumentation::SetProfilerEnabled(true);
+	std::atomic<bool> done = { false };
+	std::thread recorder([&]() {
+		// Wraps around the ring while the trace is written
+		for (int i = 0; i < Instrumentation::kRingSize; ++i) {
+			ProfiledOuter();
+		}
+		done = true;
+	});
+
+	do {
+		std::stringstream ss;
+		Instrumentation::WriteChromeTrace(ss);
+		REQUIRE_EQ(ss.str().rfind("{\"traceEvents\":[", 0), 0);
+	} while (!done);
+
+	recorder.join();
+	Instrumentation::SetProfilerEnabled(false);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,74 @@
+#include "maniac_patch.h"
+#include "game_interpreter.h"
+#include "mock_game.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("ManiacPatch");
+
+namespace {
+
+/** Packs the byte stream of an expression like the editor does */
+std::vector<int32_t> MakeExpression(std::vector<uint8_t> bytes) {
+	std::vector<int32_t> op_codes((bytes.size() + 3) / 4);
+	for (size_t i = 0; i < bytes.size(); ++i) {
+		op_codes[i / 4] |= static_cast<int32_t>(static_cast<uint32_t>(bytes[i]) << (8 * (i % 4)));
+	}
+	return op_codes;
+}
+
+int32_t Evaluate(const std::vector<int32_t>& op_codes) {
+	Game_Interpreter ip;
+	return ManiacPatch::ParseExpression(MakeSpan(op_codes), ip);
+}
+
+}
+
+TEST_CASE("Constants") {
+	const MockGame mg(MockMap::ePass40x30);
+
+	// 1 + 2 * 3
+	REQUIRE_EQ(Evaluate(MakeExpression({48, 1, 1, 50, 1, 2, 1, 3})), 7);
+	// 0x1234
+	REQUIRE_EQ(Evaluate(MakeExpression({2, 0x34, 0x12})), 0x1234);
+	// -5 as s32
+	REQUIRE_EQ(Evaluate(MakeExpression({3, 0xFB, 0xFF, 0xFF, 0xFF})), -5);
+	// Division by zero returns the dividend
+	REQUIRE_EQ(Evaluate(MakeExpression({51, 1, 9, 1, 0})), 9);
+	// Ternary and min
+	REQUIRE_EQ(Evaluate(MakeExpression({72, 1, 0, 1, 4, 1, 5})), 5);
+	REQUIRE_EQ(Evaluate(MakeExpression({78, 12, 2, 1, 4, 1, 5})), 4);
+}
+
+TEST_CASE("Variables") {
+	const MockGame mg(MockMap::ePass40x30);
+
+	Main_Data::game_variables->Set(1, 2);
+	Main_Data::game_variables->Set(2, 40);
+	Main_Data::game_switches->Set(3, true);
+
+	// v[1] * 10
+	auto expr = MakeExpression({50, 8, 1, 1, 1, 10});
+	REQUIRE_EQ(Evaluate(expr), 20);
+
+	// The compiled expression reads the current value
+	Main_Data::game_variables->Set(1, 3);
+	REQUIRE_EQ(Evaluate(expr), 30);
+
+	// v[v[1] - 1]
+	REQUIRE_EQ(Evaluate(MakeExpression({8, 49, 8, 1, 1, 1, 1})), 40);
+	// v[v[1]] through indirect access, v[1] is 3 so v[3] is read
+	Main_Data::game_variables->Set(3, 7);
+	REQUIRE_EQ(Evaluate(MakeExpression({13, 1, 1})), 7);
+	// s[3] + 1
+	REQUIRE_EQ(Evaluate(MakeExpression({48, 9, 1, 3, 1, 1})), 2);
+}
+
+TEST_CASE("Truncated") {
+	const MockGame mg(MockMap::ePass40x30);
+
+	// Missing operands evaluate to 0
+	REQUIRE_EQ(Evaluate(MakeExpression({48, 1, 5})), 5);
+	REQUIRE_EQ(Evaluate({}), 0);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,94 @@
+#include "map_cache.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("MapCache");
+
+namespace {
+
+MapCache::ParsedMap MakeMap(int size) {
+	auto map = std::make_shared<lcf::rpg::Map>();
+	map->lower_layer.resize(size);
+	map->upper_layer.resize(size);
+
+	MapCache::ParsedMap parsed;
+	parsed.map = std::move(map);
+	return parsed;
+}
+
+}
+
+TEST_CASE("HitAndMiss") {
+	MapCache::Clear();
+
+	const auto before = MapCache::GetStats();
+
+	REQUIRE_FALSE(MapCache::Get(1).map);
+	REQUIRE_FALSE(MapCache::IsCachedOrPending(1));
+
+	auto parsed = MakeMap(100);
+	MapCache::Add(1, parsed);
+	REQUIRE(MapCache::IsCachedOrPending(1));
+	REQUIRE_EQ(MapCache::Get(1).map, parsed.map);
+
+	const auto after = MapCache::GetStats();
+	REQUIRE_EQ(after.misses, before.misses + 1);
+	REQUIRE_EQ(after.hits, before.hits + 1);
+	REQUIRE_EQ(after.entries, 1);
+	REQUIRE_EQ(after.bytes, MapCache::EstimateSize(*parsed.map));
+
+	MapCache::Clear();
+	REQUIRE_FALSE(MapCache::Get(1).map);
+	REQUIRE_EQ(MapCache::GetStats().bytes, 0);
+}
+
+TEST_CASE("EstimateSize") {
+	lcf::rpg::Map map;
+	const auto empty = MapCache::EstimateSize(map);
+
+	map.lower_layer.resize(400);
+	map.upper_layer.resize(400);
+	REQUIRE_GE(MapCache::EstimateSize(map), empty + 1600);
+
+	const auto layers = MapCache::EstimateSize(map);
+	map.events.resize(1);
+	map.events[0].pages.resize(1);
+	map.events[0].pages[0].event_commands.resize(10);
+	REQUIRE_GT(MapCache::EstimateSize(map), layers);
+}
+
+TEST_CASE("Budget") {
+	MapCache::Clear();
+
+	const auto budget = MapCache::GetBudget();
+	const auto size = MapCache::EstimateSize(*MakeMap(1000).map);
+	MapCache::SetBudget(size * 2);
+
+	const auto evictions = MapCache::GetStats().evictions;
+
+	MapCache::Add(1, MakeMap(1000));
+	MapCache::Add(2, MakeMap(1000));
+
+	// Map 1 is now the most recently used one
+	REQUIRE(MapCache::Get(1).map);
+
+	MapCache::Add(3, MakeMap(1000));
+	REQUIRE_EQ(MapCache::GetStats().entries, 2);
+	REQUIRE_EQ(MapCache::GetStats().evictions, evictions + 1);
+	REQUIRE(MapCache::Get(1).map);
+	REQUIRE_FALSE(MapCache::Get(2).map);
+	REQUIRE(MapCache::Get(3).map);
+
+	// Maps larger than the budget are not cached
+	MapCache::Add(4, MakeMap(4000));
+	REQUIRE_FALSE(MapCache::Get(4).map);
+
+	MapCache::SetBudget(0);
+	REQUIRE_EQ(MapCache::GetStats().entries, 0);
+
+	MapCache::SetBudget(budget);
+	REQUIRE_EQ(MapCache::GetBudget(), budget);
+
+	MapCache::Clear();
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,100 @@
+#include "system.h"
+#include "doctest.h"
+
+#ifdef WANT_FMMIDI
+#include "midisynth.h"
+#include <algorithm>
+#include <vector>
+
+TEST_SUITE_BEGIN("MidiSynth");
+
+namespace {
+
+using midisynth::fm_sound_generator;
+
+// Operators with different rates so that the envelopes leave the attack
+// phase at different samples
+midisynth::FMPARAMETER MakeParams(int alg, bool ams) {
+	midisynth::FMPARAMETER p = {};
+	p.ALG = alg;
+	p.FB = 5;
+	p.LFO = 3;
+	p.op1 = { 31, 6, 2, 5, 3, 20, 1, 2, 1, ams ? 1 : 0 };
+	p.op2 = { 28, 8, 3, 7, 2, 25, 2, 1, 5, ams ? 2 : 0 };
+	p.op3 = { 25, 4, 1, 6, 4, 10, 0, 3, 2, 0 };
+	p.op4 = { 30, 10, 4, 9, 1, 0, 3, 1, 6, ams ? 3 : 0 };
+	return p;
+}
+
+void Setup(fm_sound_generator& fm, bool tremolo, bool vibrato) {
+	fm.set_rate(44100);
+	if (tremolo) {
+		fm.set_tremolo(90, 5.5f);
+	}
+	if (vibrato) {
+		fm.set_vibrato(0.6f, 6.0f);
+	}
+}
+
+}
+
+TEST_CASE("BlockMatchesPerSample") {
+	// Chunk sizes of the block path, the note is released after key_off_at samples
+	const size_t chunks[] = { fm_sound_generator::BLOCK_SIZE, 1, 17, 63 };
+	const size_t samples = 20000;
+	const size_t key_off_at = 12000;
+
+	for (int alg = 0; alg < 8; ++alg) {
+		for (int variant = 0; variant < 8; ++variant) {
+			const bool ams = variant & 1;
+			const bool tremolo = variant & 2;
+			const bool vibrato = variant & 4;
+			const auto params = MakeParams(alg, ams);
+
+			for (size_t chunk: chunks) {
+				CAPTURE(alg);
+				CAPTURE(variant);
+				CAPTURE(chunk);
+
+				fm_sound_generator reference(params, 60 + alg, 1.0f);
+				fm_sound_generator block(params, 60 + alg, 1.0f);
+				Setup(reference, tremolo, vibrato);
+				Setup(block, tremolo, vibrato);
+
+				std::vector<int> expected(samples);
+				for (size_t i = 0; i < samples; ++i) {
+					if (i == key_off_at) {
+						reference.key_off();
+					}
+					expected[i] = reference.get_next();
+				}
+				// The comparison is meaningless for a silent note
+				REQUIRE(std::any_of(expected.begin(), expected.end(), [](int s) { return s != 0; }));
+
+				std::vector<int> out(samples);
+				size_t pos = 0;
+				while (pos < samples) {
+					if (pos == key_off_at) {
+						block.key_off();
+					}
+					size_t n = std::min(chunk, samples - pos);
+					// Never cross the key off inside a chunk
+					if (pos < key_off_at) {
+						n = std::min(n, key_off_at - pos);
+					}
+					block.synthesize(&out[pos], n);
+					pos += n;
+				}
+
+				for (size_t i = 0; i < samples; ++i) {
+					CAPTURE(i);
+					REQUIRE_EQ(out[i], expected[i]);
+				}
+				REQUIRE_EQ(block.is_finished(), reference.is_finished());
+			}
+		}
+	}
+}
+
+TEST_SUITE_END();
+#endif
@@ -111,6 +111,26 @@ std::unique_ptr<lcf::rpg::Map> MakeMockMap(MockMap maptag) {
 		case MockMap::eMapCount:
 		case MockMap::ePass40x30:
 			break;
+		case MockMap::eRefreshPages:
+			for (int id = 2; id <= 4; ++id) {
+				map->events.push_back({});
+				map->events.back().ID = id;
+				map->events.back().pages.resize(2);
+				map->events.back().pages[0].ID = 1;
+				map->events.back().pages[1].ID = 2;
+			}
+			// Event 2: Switch 1, Event 3: Variable 1 >= 5, Event 4: Switch 1 and 2
+			map->events[1].pages[1].condition.flags.switch_a = true;
+			map->events[1].pages[1].condition.switch_a_id = 1;
+			map->events[2].pages[1].condition.flags.variable = true;
+			map->events[2].pages[1].condition.variable_id = 1;
+			map->events[2].pages[1].condition.variable_value = 5;
+			map->events[2].pages[1].condition.compare_operator = 1;
+			map->events[3].pages[1].condition.flags.switch_a = true;
+			map->events[3].pages[1].condition.switch_a_id = 1;
+			map->events[3].pages[1].condition.flags.switch_b = true;
+			map->events[3].pages[1].condition.switch_b_id = 2;
+			break;
 		case MockMap::ePassBlock20x15:
 			for (int y = 0; y < h; ++y) {
 				for (int x = 0; x < w; ++x) {
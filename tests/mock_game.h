@@ -22,6 +22,7 @@ enum class MockMap {
 	eNone,
 	ePassBlock20x15, // Left half is passable, right half is blocked
 	ePass40x30,
+	eRefreshPages, // Events 2-4 with switch and variable page conditions
 	eMapCount
 };
 
@@ -42,6 +42,12 @@ TEST_CASE("GetSize") {
 	CHECK(Platform::File(bad).GetSize() == -1);
 }
 
+TEST_CASE("GetModificationTime") {
+	CHECK(Platform::File(onekb).GetModificationTime() > 0);
+	CHECK(Platform::File(folder).GetModificationTime() > 0);
+	CHECK(Platform::File(bad).GetModificationTime() == -1);
+}
+
 TEST_CASE("ReadDirectory") {
 	Platform::Directory dir(EP_TEST_PATH "/platform");
 
@@ -0,0 +1,39 @@
+#include "replay_benchmark.h"
+#include "doctest.h"
+
+using namespace std::chrono_literals;
+
+TEST_SUITE_BEGIN("ReplayBenchmark");
+
+TEST_CASE("SummarizeEmpty") {
+	std::vector<Game_Clock::duration> values;
+	auto s = ReplayBenchmark::Summarize(values);
+
+	REQUIRE_EQ(s.mean, 0.0);
+	REQUIRE_EQ(s.p50, 0.0);
+	REQUIRE_EQ(s.max, 0.0);
+}
+
+TEST_CASE("SummarizePercentiles") {
+	std::vector<Game_Clock::duration> values;
+	for (int i = 100; i >= 1; --i) {
+		values.push_back(std::chrono::duration_cast<Game_Clock::duration>(i * 1ms));
+	}
+	auto s = ReplayBenchmark::Summarize(values);
+
+	REQUIRE_EQ(s.mean, doctest::Approx(50.5));
+	REQUIRE_EQ(s.p50, doctest::Approx(50.0));
+	REQUIRE_EQ(s.p95, doctest::Approx(95.0));
+	REQUIRE_EQ(s.p99, doctest::Approx(99.0));
+	REQUIRE_EQ(s.max, doctest::Approx(100.0));
+}
+
+TEST_CASE("SummarizeSingle") {
+	std::vector<Game_Clock::duration> values = { std::chrono::duration_cast<Game_Clock::duration>(3ms) };
+	auto s = ReplayBenchmark::Summarize(values);
+
+	REQUIRE_EQ(s.p50, doctest::Approx(3.0));
+	REQUIRE_EQ(s.p99, doctest::Approx(3.0));
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,82 @@
+#include "spsc_queue.h"
+#include "doctest.h"
+#include <memory>
+#include <thread>
+
+TEST_SUITE_BEGIN("SpscQueue");
+
+TEST_CASE("PushPop") {
+	SpscQueue<int, 4> q;
+	int v = 0;
+
+	REQUIRE(q.Empty());
+	REQUIRE_FALSE(q.Pop(v));
+
+	for (int i = 0; i < 4; ++i) {
+		REQUIRE(q.Push(int(i)));
+	}
+	REQUIRE_FALSE(q.Push(4));
+
+	for (int i = 0; i < 4; ++i) {
+		REQUIRE(q.Pop(v));
+		REQUIRE_EQ(v, i);
+	}
+	REQUIRE(q.Empty());
+}
+
+TEST_CASE("Wraparound") {
+	SpscQueue<int, 2> q;
+	int v = 0;
+
+	for (int i = 0; i < 10; ++i) {
+		REQUIRE(q.Push(int(i)));
+		REQUIRE(q.Pop(v));
+		REQUIRE_EQ(v, i);
+	}
+}
+
+TEST_CASE("MoveOnly") {
+	SpscQueue<std::unique_ptr<int>, 2> q;
+	auto p = std::make_unique<int>(5);
+	REQUIRE(q.Push(std::move(p)));
+	REQUIRE_FALSE(p);
+
+	auto full = std::make_unique<int>(6);
+	REQUIRE(q.Push(std::make_unique<int>(7)));
+	REQUIRE_FALSE(q.Push(std::move(full)));
+	REQUIRE(full);
+
+	std::unique_ptr<int> out;
+	REQUIRE(q.Pop(out));
+	REQUIRE_EQ(*out, 5);
+}
+
+TEST_CASE("Threads") {
+	SpscQueue<int, 16> q;
+	constexpr int count = 100000;
+
+	std::thread producer([&]() {
+		for (int i = 0; i < count; ++i) {
+			while (!q.Push(int(i))) {
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	bool in_order = true;
+	int expected = 0;
+	while (expected < count) {
+		int v;
+		if (q.Pop(v)) {
+			in_order &= v == expected;
+			++expected;
+		} else {
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+	REQUIRE(in_order);
+	REQUIRE(q.Empty());
+}
+
+TEST_SUITE_END();